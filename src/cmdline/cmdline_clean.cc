@@ -27,28 +27,86 @@
 #include <aptitude.h>
 
 #include <generic/apt/apt.h>
+#include <generic/apt/archive_cleaner.h>
 #include <generic/apt/config_signal.h>
 
 
 // System includes:
-#include <apt-pkg/acquire.h>
-#include <apt-pkg/clean.h>
 #include <apt-pkg/error.h>
+#include <apt-pkg/fileutl.h>
 #include <apt-pkg/strutl.h>
 
 #include <iostream>
 
 #include <stdio.h>
-#include <sys/stat.h>
 
 using namespace std;
 
+using aptitude::apt::archive_file;
+using aptitude::apt::erase_archives;
+using aptitude::apt::find_archives_to_clean;
+
 using aptitude::cmdline::create_terminal;
 using aptitude::cmdline::make_text_progress;
 using aptitude::cmdline::terminal_io;
 using aptitude::cmdline::terminal_locale;
 using boost::shared_ptr;
 
+namespace
+{
+  /** \brief Clean a download directory and its "partial"
+   *  subdirectory.
+   *
+   *  \param archivedir  the download directory.
+   *  \param cache       as for find_archives_to_clean().
+   *  \param simulate    if \b true, nothing is deleted.
+   *  \param verbose     if \b true, each package file is listed
+   *                     before it is deleted.
+   *  \param freed       incremented by the number of bytes that were
+   *                     (or in a simulation, would be) freed.
+   *
+   *  \return \b false if a directory couldn't be read.
+   */
+  bool clean_archive_dirs(const string &archivedir,
+			  pkgCache *cache,
+			  bool simulate,
+			  bool verbose,
+			  unsigned long long &freed)
+  {
+    bool rval = true;
+
+    const string dirs[] = { archivedir, archivedir + "partial/" };
+    for(unsigned int i = 0; i < sizeof(dirs) / sizeof(dirs[0]); ++i)
+      {
+	vector<archive_file> files;
+	if(!find_archives_to_clean(dirs[i], cache, files))
+	  {
+	    rval = false;
+	    continue;
+	  }
+
+	if(verbose)
+	  for(vector<archive_file>::const_iterator it = files.begin();
+	      it != files.end(); ++it)
+	    printf(_("Del %s %s [%sB]\n"),
+		   it->package.c_str(),
+		   it->version.c_str(),
+		   SizeToStr(it->size).c_str());
+
+	if(simulate)
+	  {
+	    for(vector<archive_file>::const_iterator it = files.begin();
+		it != files.end(); ++it)
+	      freed += it->size;
+	  }
+	else
+	  freed += erase_archives(dirs[i], files);
+      }
+
+    return rval;
+  }
+}
+
 int cmdline_clean(int argc, char *argv[], bool simulate)
 {
   const string archivedir = aptcfg->FindDir("Dir::Cache::archives");
@@ -64,6 +122,13 @@ int cmdline_clean(int argc, char *argv[], bool simulate)
   if(simulate)
     {
       printf(_("Del %s* %spartial/*\n"), archivedir.c_str(), archivedir.c_str());
+
+      unsigned long long freed = 0;
+      clean_archive_dirs(archivedir, NULL, true, false, freed);
+      _error->DumpErrors();
+
+      printf(_("Would free %sB of disk space\n"),
+	     SizeToStr(freed).c_str());
       return 0;
     }
 
@@ -82,46 +147,17 @@ int cmdline_clean(int argc, char *argv[], bool simulate)
       return -1;
     }
 
-  pkgAcquire fetcher;
-  fetcher.Clean(archivedir);
-  fetcher.Clean(archivedir+"partial/");
-
-  int rval=_error->PendingError() ? -1 : 0;
+  unsigned long long freed = 0;
+  int rval=0;
+  if(!clean_archive_dirs(archivedir, NULL, false, false, freed) ||
+     _error->PendingError())
+    rval=-1;
 
   _error->DumpErrors();
 
   return rval;
 }
 
-// Shamelessly stolen from apt-get:
-class LogCleaner : public pkgArchiveCleaner
-{
-  bool simulate;
-
-  long total_size;
-
-protected:
-  virtual void Erase(const char *File,string Pkg,string Ver,struct stat &St) 
-  {
-    printf(_("Del %s %s [%sB]\n"),
-	   Pkg.c_str(),
-	   Ver.c_str(),
-	   SizeToStr(St.st_size).c_str());
-
-    if (!simulate)
-      {
-	if(unlink(File)==0)
-	  total_size+=St.st_size;
-      }
-    else
-      total_size+=St.st_size;
-  };
-public:
-  LogCleaner(bool _simulate):simulate(_simulate), total_size(0) { }
-
-  long get_total_size() {return total_size;}
-};
-
 int cmdline_autoclean(int argc, char *argv[], bool simulate)
 {
   const string archivedir = aptcfg->FindDir("Dir::Cache::archives");
@@ -159,10 +195,10 @@ int cmdline_autoclean(int argc, char *argv[], bool simulate)
       return -1;
     }
 
-  LogCleaner cleaner(simulate);
+  unsigned long long freed = 0;
   int rval=0;
-  if(!(cleaner.Go(archivedir, *apt_cache_file) &&
-       cleaner.Go(archivedir+"partial/", *apt_cache_file)) ||
+  if(!clean_archive_dirs(archivedir, &(*apt_cache_file)->GetCache(),
+			 simulate, true, freed) ||
      _error->PendingError())
     rval=-1;
 
@@ -170,10 +206,10 @@ int cmdline_autoclean(int argc, char *argv[], bool simulate)
 
   if(simulate)
     printf(_("Would free %sB of disk space\n"),
-	   SizeToStr(cleaner.get_total_size()).c_str());
+	   SizeToStr(freed).c_str());
   else
     printf(_("Freed %sB of disk space\n"),
-	   SizeToStr(cleaner.get_total_size()).c_str());
+	   SizeToStr(freed).c_str());
 
   return rval;
 }
@@ -25,15 +25,18 @@
 
 #include <aptitude.h>
 
+#include <generic/util/throttle.h>
 #include <generic/views/download_progress.h>
 
 // System includes:
 #include <apt-pkg/strutl.h>
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
 
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/generic/util/transcode.h>
 
 #include <math.h>
@@ -42,6 +45,7 @@ using boost::algorithm::join;
 using boost::format;
 using boost::make_shared;
 using boost::shared_ptr;
+using aptitude::util::throttle;
 using boost::wformat;
 using cwidget::util::transcode;
 
@@ -203,6 +207,8 @@ namespace aptitude
                                    unsigned long elapsed_time,
                                    double latest_download_rate)
       {
+        status_display->discard_pending();
+
         if(display_messages)
           {
             if(fetched_bytes != 0)
@@ -224,6 +230,7 @@ namespace aptitude
       {
         // Clear any existing text to ensure that the prompt starts at
         // the beginning of the line.
+        status_display->discard_pending();
         message->set_text(L"");
 
         std::string prompt =
@@ -274,29 +281,53 @@ namespace aptitude
         shared_ptr<transient_message> message;
         shared_ptr<terminal_locale> term_locale;
         shared_ptr<terminal_metrics> term_metrics;
+        shared_ptr<throttle> update_throttle;
+
+        // The most recent status that was held back by the throttle,
+        // if any.  Drawn from the throttle's thread, hence the lock.
+        shared_ptr<download_progress::status> pending_status;
+        cwidget::threads::mutex state_mutex;
 
         download_status_display_impl(const shared_ptr<transient_message> &_message,
                                      const shared_ptr<terminal_locale> &_term_locale,
-                                     const shared_ptr<terminal_metrics> &_term_metrics);
+                                     const shared_ptr<terminal_metrics> &_term_metrics,
+                                     const shared_ptr<throttle> &_update_throttle);
 
         friend shared_ptr<download_status_display_impl>
         make_shared<download_status_display_impl>(const shared_ptr<transient_message> &,
                                                   const shared_ptr<terminal_locale> &,
-                                                  const shared_ptr<terminal_metrics> &);
+                                                  const shared_ptr<terminal_metrics> &,
+                                                  const shared_ptr<throttle> &);
+
+        void draw_status(const download_progress::status &status);
+
+        // Invoked by the throttle when it expires.
+        void flush_pending();
 
       public:
+        ~download_status_display_impl();
+
         void display_status(const download_progress::status &status);
+        void discard_pending();
       };
 
       download_status_display_impl::download_status_display_impl(const shared_ptr<transient_message> &_message,
                                                                  const shared_ptr<terminal_locale> &_term_locale,
-                                                                 const shared_ptr<terminal_metrics> &_term_metrics)
+                                                                 const shared_ptr<terminal_metrics> &_term_metrics,
+                                                                 const shared_ptr<throttle> &_update_throttle)
         : message(_message),
           term_locale(_term_locale),
-          term_metrics(_term_metrics)
+          term_metrics(_term_metrics),
+          update_throttle(_update_throttle)
       {
       }
 
+      download_status_display_impl::~download_status_display_impl()
+      {
+        if(update_throttle.get() != NULL)
+          update_throttle->cancel_call();
+      }
+
       // \todo This should be generic code:
       int as_percent(double fraction)
       {
@@ -417,6 +448,57 @@ namespace aptitude
       }
 
       void download_status_display_impl::display_status(const download_progress::status &status)
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        // Each status replaces the previous one completely, so there's
+        // no need to even format the ones that arrive too quickly;
+        // just remember the latest one in case nothing follows it.
+        if(update_throttle.get() != NULL)
+          {
+            if(!update_throttle->update_required())
+              {
+                if(pending_status.get() == NULL)
+                  update_throttle->call_when_expired(boost::bind(&download_status_display_impl::flush_pending,
+                                                                 this));
+
+                pending_status = make_shared<download_progress::status>(status);
+                return;
+              }
+
+            update_throttle->reset_timer();
+          }
+
+        pending_status.reset();
+        draw_status(status);
+      }
+
+      void download_status_display_impl::flush_pending()
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        if(pending_status.get() != NULL)
+          {
+            const shared_ptr<download_progress::status> status = pending_status;
+            pending_status.reset();
+
+            update_throttle->reset_timer();
+            draw_status(*status);
+          }
+      }
+
+      void download_status_display_impl::discard_pending()
+      {
+        // This waits for a flush in progress, so it has to happen
+        // before locking.
+        if(update_throttle.get() != NULL)
+          update_throttle->cancel_call();
+
+        cwidget::threads::mutex::lock l(state_mutex);
+        pending_status.reset();
+      }
+
+      void download_status_display_impl::draw_status(const download_progress::status &status)
       {
         typedef views::download_progress::status::worker_status worker_status;
         const double download_rate = status.get_download_rate();
@@ -526,6 +608,10 @@ namespace aptitude
     {
     }
 
+    void download_status_display::discard_pending()
+    {
+    }
+
     shared_ptr<views::download_progress>
     create_download_progress_display(const boost::shared_ptr<transient_message> &message,
                                      const boost::shared_ptr<download_status_display> &status_display,
@@ -543,13 +629,28 @@ namespace aptitude
                                            const shared_ptr<terminal_locale> &term_locale,
                                            const shared_ptr<terminal_metrics> &term_metrics,
                                            bool hide_status)
+    {
+      return create_cmdline_download_status_display(message,
+                                                    term_locale,
+                                                    term_metrics,
+                                                    hide_status,
+                                                    shared_ptr<throttle>());
+    }
+
+    shared_ptr<download_status_display>
+    create_cmdline_download_status_display(const shared_ptr<transient_message> &message,
+                                           const shared_ptr<terminal_locale> &term_locale,
+                                           const shared_ptr<terminal_metrics> &term_metrics,
+                                           bool hide_status,
+                                           const shared_ptr<throttle> &update_throttle)
     {
       if(hide_status)
         return make_shared<dummy_status_display>();
       else
         return make_shared<download_status_display_impl>(message,
                                                          term_locale,
-                                                         term_metrics);
+                                                         term_metrics,
+                                                         update_throttle);
     }
   }
 }
@@ -28,6 +28,11 @@
 
 namespace aptitude
 {
+  namespace util
+  {
+    class throttle;
+  }
+
   namespace cmdline
   {
     class terminal_input;
@@ -50,6 +55,15 @@ namespace aptitude
       virtual ~download_status_display();
 
       virtual void display_status(const views::download_progress::status &status) = 0;
+
+      /** \brief Forget any status that was received but not yet
+       *  displayed.
+       *
+       *  Invoked when the download is over, so that a late redraw
+       *  doesn't leave a stale status line behind.  The default
+       *  implementation does nothing.
+       */
+      virtual void discard_pending();
     };
 
     /**
@@ -87,6 +101,22 @@ namespace aptitude
                                            const boost::shared_ptr<terminal_locale> &term_locale,
                                            const boost::shared_ptr<terminal_metrics> &term_metrics,
                                            bool hide_status);
+
+    /** \brief Create a new command-line download status display
+     *  object whose redraws are rate-limited.
+     *
+     *  \param throttle  Statuses that arrive before this expires are
+     *                   held back; each status replaces the previous
+     *                   one entirely, so only the latest is drawn,
+     *                   once the throttle expires.  If NULL, every
+     *                   status is displayed.
+     */
+    boost::shared_ptr<download_status_display>
+    create_cmdline_download_status_display(const boost::shared_ptr<transient_message> &message,
+                                           const boost::shared_ptr<terminal_locale> &term_locale,
+                                           const boost::shared_ptr<terminal_metrics> &term_metrics,
+                                           bool hide_status,
+                                           const boost::shared_ptr<util::throttle> &throttle);
   }
 }
 
@@ -0,0 +1,216 @@
+// cmdline_history.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+
+// Local includes:
+#include "cmdline_history.h"
+
+#include <aptitude.h>
+
+#include <generic/apt/apt.h>
+#include <generic/apt/config_signal.h>
+#include <generic/apt/history/history_db.h>
+#include <generic/apt/history/history_entry.h>
+#include <generic/apt/log.h>
+#include <generic/util/sqlite.h>
+
+
+// System includes:
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using aptitude::history::action_record;
+using aptitude::history::history_db;
+using aptitude::history::history_query;
+using boost::shared_ptr;
+
+namespace
+{
+  /** \brief Parse a date given on the command line as local time.
+   *
+   *  Accepts "YYYY-MM-DD", "YYYY-MM-DD HH:MM" and "YYYY-MM-DD
+   *  HH:MM:SS".  If \b end_of_day is set and no time is given, the
+   *  last second of the day is used.
+   */
+  bool parse_date_argument(const std::string &s, bool end_of_day, time_t &out)
+  {
+    static const char * const formats[] =
+      {
+	"%Y-%m-%d %H:%M:%S",
+	"%Y-%m-%d %H:%M",
+	"%Y-%m-%d",
+	NULL
+      };
+
+    for(const char * const *fmt = formats; *fmt != NULL; ++fmt)
+      {
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+
+	const char *end = strptime(s.c_str(), *fmt, &tm);
+	if(end == NULL || *end != '\0')
+	  continue;
+
+	const bool date_only = (*(fmt + 1) == NULL);
+	if(date_only && end_of_day)
+	  {
+	    tm.tm_hour = 23;
+	    tm.tm_min = 59;
+	    tm.tm_sec = 59;
+	  }
+
+	tm.tm_isdst = -1;
+	out = mktime(&tm);
+	return out != (time_t)-1;
+      }
+
+    return false;
+  }
+
+  int do_import(int argc, char *argv[], const std::string &filename)
+  {
+    std::vector<std::string> logs;
+    for(int i = 2; i < argc; ++i)
+      logs.push_back(argv[i]);
+
+    if(logs.empty())
+      logs.push_back(aptcfg->Find(PACKAGE "::Log", "/var/log/" PACKAGE));
+
+    shared_ptr<history_db> db = history_db::create(filename);
+
+    int rval = 0;
+    for(std::vector<std::string>::const_iterator it = logs.begin();
+	it != logs.end(); ++it)
+      {
+	int num_imported;
+
+	if(*it == "-")
+	  num_imported = db->import_log(std::cin);
+	else
+	  {
+	    std::ifstream in(it->c_str());
+	    if(!in)
+	      {
+		fprintf(stderr, _("Unable to open %s: %s\n"),
+			it->c_str(), strerror(errno));
+		rval = -1;
+		continue;
+	      }
+
+	    num_imported = db->import_log(in);
+	  }
+
+	printf(_("Imported %d runs from %s.\n"), num_imported, it->c_str());
+      }
+
+    return rval;
+  }
+
+  int do_query(int argc, char *argv[], const std::string &filename,
+	       time_t since, time_t until)
+  {
+    shared_ptr<history_db> db = history_db::create(filename, true);
+
+    history_query query;
+    query.since = since;
+    query.until = until;
+
+    for(int i = 1; i < argc; ++i)
+      query.packages.push_back(argv[i]);
+
+    std::vector<action_record> results;
+    db->find(query, results);
+
+    for(std::vector<action_record>::const_iterator it = results.begin();
+	it != results.end(); ++it)
+      {
+	char timestr[64] = "";
+	struct tm ltime;
+	if(localtime_r(&it->time, &ltime) != NULL)
+	  strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", &ltime);
+
+	printf("%s  %-14s %s", timestr, it->action.c_str(), it->package.c_str());
+
+	if(!it->old_version.empty() && !it->new_version.empty() &&
+	   it->old_version != it->new_version)
+	  printf(" %s -> %s", it->old_version.c_str(), it->new_version.c_str());
+	else if(!it->new_version.empty())
+	  printf(" %s", it->new_version.c_str());
+	else if(!it->old_version.empty())
+	  printf(" %s", it->old_version.c_str());
+
+	printf("\n");
+      }
+
+    return 0;
+  }
+}
+
+int cmdline_history(int argc, char *argv[],
+		    const std::string &since,
+		    const std::string &until)
+{
+  const std::string filename = get_history_database_path();
+  if(filename.empty())
+    {
+      fprintf(stderr, _("The history database is disabled (%s is empty).\n"),
+	      PACKAGE "::History::Database");
+      return -1;
+    }
+
+  time_t since_time = 0, until_time = 0;
+  if(!since.empty() && !parse_date_argument(since, false, since_time))
+    {
+      fprintf(stderr, _("Invalid date \"%s\" (expected YYYY-MM-DD [HH:MM[:SS]]).\n"),
+	      since.c_str());
+      return -1;
+    }
+  if(!until.empty() && !parse_date_argument(until, true, until_time))
+    {
+      fprintf(stderr, _("Invalid date \"%s\" (expected YYYY-MM-DD [HH:MM[:SS]]).\n"),
+	      until.c_str());
+      return -1;
+    }
+
+  try
+    {
+      if(argc >= 2 && !strcmp(argv[1], "import"))
+	return do_import(argc, argv, filename);
+      else
+	return do_query(argc, argv, filename, since_time, until_time);
+    }
+  catch(const aptitude::sqlite::exception &ex)
+    {
+      fprintf(stderr, _("Unable to access the history database %s: %s\n"),
+	      filename.c_str(), ex.errmsg().c_str());
+      return -1;
+    }
+  catch(const aptitude::history::HistoryException &ex)
+    {
+      fprintf(stderr, _("Unable to access the history database %s: %s\n"),
+	      filename.c_str(), ex.errmsg().c_str());
+      return -1;
+    }
+}
@@ -0,0 +1,46 @@
+// cmdline_history.h                   -*-c++-*-
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#ifndef CMDLINE_HISTORY_H
+#define CMDLINE_HISTORY_H
+
+#include <string>
+
+/** \brief Query or import the history database.
+ *
+ *  \file cmdline_history.h
+ */
+
+/** \brief Handle "aptitude history".
+ *
+ *  "aptitude history [PATTERN...]" lists the recorded actions on
+ *  packages whose names match any of the given glob patterns (or on
+ *  every package if none are given); "aptitude history import
+ *  [FILE...]" reads text logs into the history database.
+ *
+ *  \param since  Only list actions at or after this date, or an
+ *                empty string for no lower bound.
+ *  \param until  Only list actions at or before this date, or an
+ *                empty string for no upper bound.
+ */
+int cmdline_history(int argc, char *argv[],
+		    const std::string &since,
+		    const std::string &until);
+
+#endif // CMDLINE_HISTORY_H
@@ -0,0 +1,108 @@
+/** \file cmdline_json.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include "cmdline_json.h"
+
+#include <aptitude.h>
+
+#include <generic/apt/apt.h>
+#include <generic/apt/aptcache.h>
+#include <generic/util/json_record.h>
+
+// System includes:
+#include <strings.h>
+
+namespace aptitude
+{
+  namespace cmdline
+  {
+    bool want_json_output()
+    {
+      const std::string format =
+        aptcfg->Find(PACKAGE "::CmdLine::Output-Format", "text");
+
+      return strcasecmp(format.c_str(), "json") == 0;
+    }
+
+    const char *json_package_state_name(const pkgCache::PkgIterator &pkg)
+    {
+      switch(pkg->CurrentState)
+        {
+        case pkgCache::State::NotInstalled:
+          return "not-installed";
+        case pkgCache::State::UnPacked:
+          return "unpacked";
+        case pkgCache::State::HalfConfigured:
+          return "half-configured";
+        case pkgCache::State::HalfInstalled:
+          return "half-installed";
+        case pkgCache::State::ConfigFiles:
+          return "config-files";
+#ifdef APT_HAS_TRIGGERS
+        case pkgCache::State::TriggersAwaited:
+          return "triggers-awaited";
+        case pkgCache::State::TriggersPending:
+          return "triggers-pending";
+#endif
+        case pkgCache::State::Installed:
+          return "installed";
+        default:
+          return "unknown";
+        }
+    }
+
+    const char *json_package_action_name(const pkgCache::PkgIterator &pkg)
+    {
+      switch((*apt_cache_file)->get_action_state(pkg))
+        {
+        case pkg_unchanged:     return "none";
+        case pkg_broken:        return "broken";
+        case pkg_unused_remove: return "remove-unused";
+        case pkg_auto_hold:     return "auto-hold";
+        case pkg_auto_install:  return "auto-install";
+        case pkg_auto_remove:   return "auto-remove";
+        case pkg_downgrade:     return "downgrade";
+        case pkg_hold:          return "hold";
+        case pkg_reinstall:     return "reinstall";
+        case pkg_install:       return "install";
+        case pkg_remove:        return "remove";
+        case pkg_upgrade:       return "upgrade";
+        case pkg_unconfigured:  return "configure";
+        default:                return "unknown";
+        }
+    }
+
+    void add_json_package_fields(util::json_record &rec,
+                                 const pkgCache::PkgIterator &pkg)
+    {
+      aptitudeDepCache::StateCache &state = (*apt_cache_file)[pkg];
+      const pkgCache::VerIterator curver = pkg.CurrentVer();
+      const pkgCache::VerIterator candver =
+        state.CandidateVerIter(*apt_cache_file);
+
+      rec.add_string("package", pkg.FullName(true));
+      rec.add_string("state", json_package_state_name(pkg));
+      rec.add_bool("automatic", (state.Flags & pkgCache::Flag::Auto) != 0);
+      rec.add_string("action", json_package_action_name(pkg));
+      rec.add_string_or_null("installed", curver.end() ? NULL : curver.VerStr());
+      rec.add_string_or_null("candidate", candver.end() ? NULL : candver.VerStr());
+    }
+  }
+}
@@ -0,0 +1,76 @@
+/** \file cmdline_json.h */   // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_CMDLINE_JSON_H
+#define APTITUDE_CMDLINE_JSON_H
+
+// System includes:
+#include <apt-pkg/pkgcache.h>
+
+/** \brief Support for the JSON Lines output format.
+ *
+ *  When Aptitude::CmdLine::Output-Format is "json" (set by
+ *  --output-format), the search, show, versions and why commands
+ *  write one JSON object per line instead of formatted text.  The
+ *  records are built directly from the package cache, bypassing the
+ *  column formatter and the cwidget fragment layer, and are written
+ *  as soon as each one is complete.
+ *
+ *  Field values are untranslated, so that scripts don't depend on
+ *  the user's locale.
+ */
+
+namespace aptitude
+{
+  namespace util
+  {
+    class json_record;
+  }
+
+  namespace cmdline
+  {
+    /** \brief Return \b true if commands should write JSON records
+     *  instead of text.
+     */
+    bool want_json_output();
+
+    /** \brief Return a machine-readable name for the dpkg state of
+     *  the given package (e.g., "installed" or "config-files").
+     */
+    const char *json_package_state_name(const pkgCache::PkgIterator &pkg);
+
+    /** \brief Return a machine-readable name for the action that
+     *  will be performed on the given package (e.g., "install" or
+     *  "none").
+     */
+    const char *json_package_action_name(const pkgCache::PkgIterator &pkg);
+
+    /** \brief Add the fields describing a package's current state
+     *  to a record.
+     *
+     *  The fields are "package", "state", "automatic", "action",
+     *  "installed" and "candidate"; the last two are version strings,
+     *  or null if there is no such version.
+     */
+    void add_json_package_fields(util::json_record &rec,
+                                 const pkgCache::PkgIterator &pkg);
+  }
+}
+
+#endif // APTITUDE_CMDLINE_JSON_H
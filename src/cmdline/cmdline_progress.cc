@@ -23,6 +23,8 @@
 #include "cmdline_progress.h"
 
 #include "cmdline_download_progress_display.h"
+#include "cmdline_progress_display.h"
+#include "cmdline_progress_records.h"
 #include "terminal.h"
 #include "transient_message.h"
 
@@ -62,11 +64,23 @@ namespace aptitude
       const shared_ptr<transient_message> message =
         create_transient_message(term_locale, term_metrics, term_output);
 
-      const shared_ptr<download_status_display> download_status =
-        create_cmdline_download_status_display(message,
-                                               term_locale,
-                                               term_metrics,
-                                               hide_status);
+      // If the output isn't a terminal, the status line would never
+      // be displayed; either write records instead or don't bother
+      // formatting it at all.
+      const bool is_terminal = term_output->output_is_a_terminal();
+
+      shared_ptr<download_status_display> download_status;
+      if(!is_terminal && !hide_status && get_use_progress_records())
+        download_status =
+          create_download_status_record_display(term_output,
+                                                create_progress_record_throttle());
+      else
+        download_status =
+          create_cmdline_download_status_display(message,
+                                                 term_locale,
+                                                 term_metrics,
+                                                 hide_status || !is_terminal,
+                                                 create_progress_throttle());
 
       const shared_ptr<views::download_progress> download_progress =
         create_download_progress_display(message,
@@ -20,6 +20,9 @@
 // Local includes:
 #include "cmdline_progress_display.h"
 
+#include "cmdline_json.h"
+#include "cmdline_progress_records.h"
+#include "terminal.h"
 #include "transient_message.h"
 
 #include <aptitude.h>
@@ -30,12 +33,16 @@
 #include <generic/apt/apt.h>
 #include <generic/apt/config_signal.h>
 #include <generic/util/progress_info.h>
+#include <generic/util/throttle.h>
 #include <generic/views/progress.h>
 
 // System includes:
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
 
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/generic/util/transcode.h>
 
 #include <sys/time.h>
@@ -44,6 +51,7 @@ using aptitude::util::progress_info;
 using aptitude::util::progress_type_bar;
 using aptitude::util::progress_type_none;
 using aptitude::util::progress_type_pulse;
+using aptitude::util::throttle;
 using boost::make_shared;
 using boost::shared_ptr;
 using boost::wformat;
@@ -55,9 +63,6 @@ namespace aptitude
   {
     namespace
     {
-      // \todo This should be configurable.
-      const int progress_update_interval = 0.25;
-
       class progress_display_impl : public views::progress
       {
         // Set to "true" when done() is called, and to "false" when
@@ -69,19 +74,37 @@ namespace aptitude
         // display if the mode or the message changed.
         progress_info last_progress;
 
+        // The most recent progress that was held back by the
+        // throttle, if any.
+        boost::optional<progress_info> pending_progress;
+
         shared_ptr<transient_message> message;
 
         bool old_style_percentage;
         bool retain_completed;
 
+        shared_ptr<throttle> update_throttle;
+
+        // Protects the state above; held-back updates are drawn from
+        // the throttle's thread.
+        cwidget::threads::mutex state_mutex;
+
         // Using the current time and the progress information to
         // display, determine if an update is required.
         bool should_update(const progress_info &progress) const;
 
+        void display(const progress_info &progress);
+
+        // Invoked by the throttle when it expires, to draw the update
+        // that it held back.
+        void flush_pending();
+
       public:
         progress_display_impl(const shared_ptr<transient_message> &_message,
                               bool _old_style_percentage,
-                              bool _retain_completed);
+                              bool _retain_completed,
+                              const shared_ptr<throttle> &_update_throttle);
+        ~progress_display_impl();
 
         void set_progress(const progress_info &progress);
         void done();
@@ -89,13 +112,21 @@ namespace aptitude
 
       progress_display_impl::progress_display_impl(const shared_ptr<transient_message> &_message,
                                                    bool _old_style_percentage,
-                                                   bool _retain_completed)
+                                                   bool _retain_completed,
+                                                   const shared_ptr<throttle> &_update_throttle)
         : is_done(false),
           last_progress(progress_info::none()),
           message(_message),
           old_style_percentage(_old_style_percentage),
-          retain_completed(_retain_completed)
+          retain_completed(_retain_completed),
+          update_throttle(_update_throttle)
+      {
+      }
+
+      progress_display_impl::~progress_display_impl()
       {
+        if(update_throttle.get() != NULL)
+          update_throttle->cancel_call();
       }
 
       bool progress_display_impl::should_update(const progress_info &progress) const
@@ -115,46 +146,101 @@ namespace aptitude
 
       void progress_display_impl::set_progress(const progress_info &progress)
       {
-        if(should_update(progress))
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        if(!should_update(progress))
           {
-            switch(progress.get_type())
-              {
-              case progress_type_none:
-                message->set_text(L"");
-                break;
+            // Anything held back is now out of date.
+            pending_progress = boost::optional<progress_info>();
+            return;
+          }
 
-              case progress_type_pulse:
-                if(old_style_percentage)
-                  message->set_text( (wformat(L"%s...")
-                                      % transcode(progress.get_progress_status())).str() );
-                else
-                  message->set_text( (wformat(L"[----] %s")
-                                      % transcode(progress.get_progress_status())).str() );
-                break;
+        if(update_throttle.get() != NULL &&
+           progress.get_type() == last_progress.get_type() &&
+           !update_throttle->update_required())
+          {
+            // Don't leave the last update off the screen if nothing
+            // follows it for a while.
+            if(!pending_progress)
+              update_throttle->call_when_expired(boost::bind(&progress_display_impl::flush_pending,
+                                                             this));
+
+            pending_progress = progress;
+            return;
+          }
 
-              case progress_type_bar:
-                if(old_style_percentage)
-                  message->set_text( (wformat(L"%s... %d%%")
-                                      % transcode(progress.get_progress_status())
-                                      % progress.get_progress_percent_int()).str() );
-                else
-                  message->set_text( (wformat(L"[%3d%%] %s")
-                                      % progress.get_progress_percent_int()
-                                      % transcode(progress.get_progress_status())).str() );
-                break;
-
-              default:
-                message->set_text(L"INTERNAL ERROR");
-                break;
-              }
+        display(progress);
+
+        if(update_throttle.get() != NULL)
+          update_throttle->reset_timer();
+      }
+
+      void progress_display_impl::flush_pending()
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        if(pending_progress)
+          {
+            display(*pending_progress);
+            update_throttle->reset_timer();
+          }
+      }
 
-            is_done = false;
-            last_progress = progress;
+      void progress_display_impl::display(const progress_info &progress)
+      {
+        switch(progress.get_type())
+          {
+          case progress_type_none:
+            message->set_text(L"");
+            break;
+
+          case progress_type_pulse:
+            if(old_style_percentage)
+              message->set_text( (wformat(L"%s...")
+                                  % transcode(progress.get_progress_status())).str() );
+            else
+              message->set_text( (wformat(L"[----] %s")
+                                  % transcode(progress.get_progress_status())).str() );
+            break;
+
+          case progress_type_bar:
+            if(old_style_percentage)
+              message->set_text( (wformat(L"%s... %d%%")
+                                  % transcode(progress.get_progress_status())
+                                  % progress.get_progress_percent_int()).str() );
+            else
+              message->set_text( (wformat(L"[%3d%%] %s")
+                                  % progress.get_progress_percent_int()
+                                  % transcode(progress.get_progress_status())).str() );
+            break;
+
+          default:
+            message->set_text(L"INTERNAL ERROR");
+            break;
           }
+
+        is_done = false;
+        last_progress = progress;
+        pending_progress = boost::optional<progress_info>();
       }
 
       void progress_display_impl::done()
       {
+        // Nothing is held back once we're done.  This waits for a
+        // flush in progress, so it has to happen before locking.
+        if(update_throttle.get() != NULL)
+          update_throttle->cancel_call();
+
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        // Report the completion of the most recent operation, even
+        // if it was never drawn.
+        if(pending_progress)
+          {
+            last_progress = *pending_progress;
+            pending_progress = boost::optional<progress_info>();
+          }
+
         if(last_progress.get_type() != progress_type_none &&
            !is_done)
           {
@@ -186,10 +272,23 @@ namespace aptitude
     create_progress_display(const shared_ptr<transient_message> &message,
                             bool old_style_percentage,
                             bool retain_completed)
+    {
+      return create_progress_display(message,
+                                     old_style_percentage,
+                                     retain_completed,
+                                     shared_ptr<throttle>());
+    }
+
+    shared_ptr<views::progress>
+    create_progress_display(const shared_ptr<transient_message> &message,
+                            bool old_style_percentage,
+                            bool retain_completed,
+                            const shared_ptr<throttle> &update_throttle)
     {
       return make_shared<progress_display_impl>(message,
                                                 old_style_percentage,
-                                                retain_completed);
+                                                retain_completed,
+                                                update_throttle);
     }
 
     shared_ptr<views::progress>
@@ -197,6 +296,13 @@ namespace aptitude
                             const shared_ptr<terminal_metrics> &term_metrics,
                             const shared_ptr<terminal_output> &term_output)
     {
+      // Progress records would corrupt a stream of JSON records.
+      if(!term_output->output_is_a_terminal() &&
+         get_use_progress_records() &&
+         !want_json_output())
+        return create_progress_record_display(term_output,
+                                              create_progress_record_throttle());
+
       const shared_ptr<transient_message> message =
         create_transient_message(term_locale, term_metrics, term_output);
 
@@ -208,7 +314,29 @@ namespace aptitude
 
       return create_progress_display(message,
                                      old_style_percentage,
-                                     retain_completed);
+                                     retain_completed,
+                                     create_progress_throttle());
+    }
+
+    double get_progress_update_interval()
+    {
+      const int frames_per_second =
+        aptcfg->FindI(PACKAGE "::CmdLine::Progress::Frames-Per-Second", 1);
+
+      if(frames_per_second <= 0)
+        return 0;
+      else
+        return 1.0 / frames_per_second;
+    }
+
+    shared_ptr<throttle> create_progress_throttle()
+    {
+      const double interval = get_progress_update_interval();
+
+      if(interval <= 0)
+        return shared_ptr<throttle>();
+      else
+        return util::create_throttle(interval);
     }
   }
 }
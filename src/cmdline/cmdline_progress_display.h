@@ -25,6 +25,11 @@
 
 namespace aptitude
 {
+  namespace util
+  {
+    class throttle;
+  }
+
   namespace views
   {
     class progress;
@@ -53,15 +58,56 @@ namespace aptitude
                             bool old_style_percentage,
                             bool retain_completed);
 
+    /** \brief Create a blank progress display whose redraws are
+     *  rate-limited.
+     *
+     *  \param throttle  Controls how often the display is redrawn.
+     *                   Changes that arrive before the throttle
+     *                   expires are coalesced: only the most recent
+     *                   one is kept, and it is drawn by the next
+     *                   update that is let through (or reported by
+     *                   done()).  Changes to the kind of progress,
+     *                   such as from a pulse to a bar, are always
+     *                   drawn immediately.  If \b throttle is NULL,
+     *                   every change is drawn.
+     */
+    boost::shared_ptr<views::progress>
+    create_progress_display(const boost::shared_ptr<transient_message> &message,
+                            bool old_style_percentage,
+                            bool retain_completed,
+                            const boost::shared_ptr<util::throttle> &throttle);
+
     /** \brief Create a blank progress display.
      *
      *  This is a convenience routine, equivalent to creating a new
-     *  transient message with the given terminal objects.
+     *  transient message with the given terminal objects.  Redraws
+     *  are limited by create_progress_throttle().
+     *
+     *  If the output is not a terminal and progress records are
+     *  enabled, the returned display writes progress records instead
+     *  (see create_progress_record_display()), unless JSON output was
+     *  requested.
      */
     boost::shared_ptr<views::progress>
     create_progress_display(const boost::shared_ptr<terminal_locale> &term_locale,
                             const boost::shared_ptr<terminal_metrics> &term_metrics,
                             const boost::shared_ptr<terminal_output> &term_output);
+
+    /** \brief Return the minimum number of seconds between two
+     *  redraws of a progress indicator, as set by
+     *  Aptitude::CmdLine::Progress::Frames-Per-Second.
+     *
+     *  \return the interval, or 0 if redraws are not limited.
+     */
+    double get_progress_update_interval();
+
+    /** \brief Create a throttle that enforces
+     *  get_progress_update_interval().
+     *
+     *  \return the new throttle, or a NULL pointer if redraws are
+     *  not limited.
+     */
+    boost::shared_ptr<util::throttle> create_progress_throttle();
   }
 }
 
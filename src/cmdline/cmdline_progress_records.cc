@@ -0,0 +1,204 @@
+/** \file cmdline_progress_records.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include "cmdline_progress_records.h"
+
+#include "cmdline_download_progress_display.h"
+#include "terminal.h"
+
+#include <aptitude.h>
+
+#include <generic/apt/apt.h>
+#include <generic/apt/config_signal.h>
+#include <generic/util/progress_info.h>
+#include <generic/util/throttle.h>
+#include <generic/views/download_progress.h>
+#include <generic/views/progress.h>
+
+// System includes:
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+
+#include <cwidget/generic/util/transcode.h>
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdlib.h>
+
+using aptitude::util::progress_info;
+using aptitude::util::progress_type_bar;
+using aptitude::util::progress_type_none;
+using aptitude::util::progress_type_pulse;
+using aptitude::util::throttle;
+using boost::format;
+using boost::make_shared;
+using boost::shared_ptr;
+using cwidget::util::transcode;
+
+namespace aptitude
+{
+  namespace cmdline
+  {
+    namespace
+    {
+      void write_record(const shared_ptr<terminal_output> &term_output,
+                        const std::string &record)
+      {
+        term_output->write_text(transcode(record));
+        term_output->write_text(L"\n");
+        term_output->flush();
+      }
+
+      class progress_record_display : public views::progress
+      {
+        shared_ptr<terminal_output> term_output;
+        shared_ptr<throttle> record_throttle;
+
+        // The last progress that was written.
+        progress_info last_progress;
+
+      public:
+        progress_record_display(const shared_ptr<terminal_output> &_term_output,
+                                const shared_ptr<throttle> &_record_throttle)
+          : term_output(_term_output),
+            record_throttle(_record_throttle),
+            last_progress(progress_info::none())
+        {
+        }
+
+        void set_progress(const progress_info &progress);
+        void done();
+      };
+
+      void progress_record_display::set_progress(const progress_info &progress)
+      {
+        const bool new_operation =
+          progress.get_type() != last_progress.get_type() ||
+          progress.get_progress_status() != last_progress.get_progress_status();
+
+        if(!new_operation)
+          {
+            if(progress.get_type() != progress_type_bar ||
+               progress.get_progress_percent_int() == last_progress.get_progress_percent_int())
+              return;
+
+            if(!record_throttle->update_required())
+              return;
+          }
+
+        switch(progress.get_type())
+          {
+          case progress_type_none:
+            break;
+
+          case progress_type_pulse:
+            write_record(term_output,
+                         (format("progress::%s")
+                          % progress.get_progress_status()).str());
+            break;
+
+          case progress_type_bar:
+            write_record(term_output,
+                         (format("progress:%d:%s")
+                          % progress.get_progress_percent_int()
+                          % progress.get_progress_status()).str());
+            break;
+          }
+
+        record_throttle->reset_timer();
+        last_progress = progress;
+      }
+
+      void progress_record_display::done()
+      {
+        if(last_progress.get_type() != progress_type_none)
+          {
+            write_record(term_output,
+                         (format("done:%s")
+                          % last_progress.get_progress_status()).str());
+
+            last_progress = progress_info::none();
+          }
+      }
+
+      class download_status_record_display : public download_status_display
+      {
+        shared_ptr<terminal_output> term_output;
+        shared_ptr<throttle> record_throttle;
+
+      public:
+        download_status_record_display(const shared_ptr<terminal_output> &_term_output,
+                                       const shared_ptr<throttle> &_record_throttle)
+          : term_output(_term_output),
+            record_throttle(_record_throttle)
+        {
+        }
+
+        void display_status(const views::download_progress::status &status);
+      };
+
+      void download_status_record_display::display_status(const views::download_progress::status &status)
+      {
+        if(!record_throttle->update_required())
+          return;
+
+        const double percent = floor(status.get_fraction_complete() * 100);
+
+        write_record(term_output,
+                     (format("dlstatus:%d:%.0f:%lu")
+                      % static_cast<int>(std::max(0.0, std::min(100.0, percent)))
+                      % status.get_download_rate()
+                      % status.get_time_remaining()).str());
+
+        record_throttle->reset_timer();
+      }
+    }
+
+    bool get_use_progress_records()
+    {
+      return aptcfg->FindB(PACKAGE "::CmdLine::Progress::Records", false);
+    }
+
+    shared_ptr<throttle> create_progress_record_throttle()
+    {
+      double interval =
+        atof(aptcfg->Find(PACKAGE "::CmdLine::Progress::Record-Interval", "1").c_str());
+      if(interval < 0)
+        interval = 0;
+
+      return util::create_throttle(interval);
+    }
+
+    shared_ptr<views::progress>
+    create_progress_record_display(const shared_ptr<terminal_output> &term_output,
+                                   const shared_ptr<throttle> &record_throttle)
+    {
+      return make_shared<progress_record_display>(term_output, record_throttle);
+    }
+
+    shared_ptr<download_status_display>
+    create_download_status_record_display(const shared_ptr<terminal_output> &term_output,
+                                          const shared_ptr<throttle> &record_throttle)
+    {
+      return make_shared<download_status_record_display>(term_output, record_throttle);
+    }
+  }
+}
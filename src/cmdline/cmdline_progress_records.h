@@ -0,0 +1,87 @@
+/** \file cmdline_progress_records.h */   // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_CMDLINE_PROGRESS_RECORDS_H
+#define APTITUDE_CMDLINE_PROGRESS_RECORDS_H
+
+// System includes:
+#include <boost/shared_ptr.hpp>
+
+/** \brief Progress reporting for output that isn't a terminal.
+ *
+ *  When standard output is redirected, aptitude normally drops its
+ *  progress indicators, since they rely on redrawing the current
+ *  line.  If Aptitude::CmdLine::Progress::Records is set, it instead
+ *  writes one line per update, at most once every
+ *  Aptitude::CmdLine::Progress::Record-Interval seconds:
+ *
+ *   - "progress:PERCENT:STATUS" while an operation is running
+ *     (PERCENT is empty if the operation has no known length);
+ *   - "done:STATUS" when it completes;
+ *   - "dlstatus:PERCENT:RATE:REMAINING" while downloading, where
+ *     RATE is in bytes per second and REMAINING is in seconds.
+ */
+
+namespace aptitude
+{
+  namespace util
+  {
+    class throttle;
+  }
+
+  namespace views
+  {
+    class progress;
+  }
+
+  namespace cmdline
+  {
+    class download_status_display;
+    class terminal_output;
+
+    /** \brief Return \b true if progress should be written as
+     *  records when the output isn't a terminal.
+     */
+    bool get_use_progress_records();
+
+    /** \brief Create a throttle that enforces the interval between
+     *  progress records.
+     */
+    boost::shared_ptr<util::throttle> create_progress_record_throttle();
+
+    /** \brief Create a progress display that writes progress records.
+     *
+     *  A record is written immediately when a new operation starts;
+     *  further updates to the same operation are written only when
+     *  \b throttle allows it.
+     */
+    boost::shared_ptr<views::progress>
+    create_progress_record_display(const boost::shared_ptr<terminal_output> &term_output,
+                                   const boost::shared_ptr<util::throttle> &throttle);
+
+    /** \brief Create a download status display that writes progress
+     *  records whenever \b throttle allows it.
+     */
+    boost::shared_ptr<download_status_display>
+    create_download_status_record_display(const boost::shared_ptr<terminal_output> &term_output,
+                                          const boost::shared_ptr<util::throttle> &throttle);
+  }
+}
+
+#endif // APTITUDE_CMDLINE_PROGRESS_RECORDS_H
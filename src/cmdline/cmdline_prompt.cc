@@ -599,6 +599,59 @@ static bool prompt_trust(const shared_ptr<terminal_metrics> &term_metrics)
   return true;
 }
 
+/** \brief Find the packages that are recommended or suggested by a
+ *  package that is about to be installed, but that won't be installed.
+ *
+ *  Only the targets of the Recommends and Suggests of changed
+ *  packages can be in either list, so they are the only packages
+ *  that need to be examined.
+ */
+static void find_unmet_recommendations(const std::set<pkgCache::PkgIterator> &changed,
+				       pkgvector &recommended,
+				       pkgvector &suggested)
+{
+  pkgset candidates;
+
+  for(std::set<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+      it != changed.end(); ++it)
+    {
+      pkgCache::VerIterator instver =
+	(*apt_cache_file)[*it].InstVerIter(*apt_cache_file);
+
+      if(instver.end())
+	continue;
+
+      for(pkgCache::DepIterator dep = instver.DependsList(); !dep.end(); ++dep)
+	{
+	  if(dep->Type != pkgCache::Dep::Recommends &&
+	     dep->Type != pkgCache::Dep::Suggests)
+	    continue;
+
+	  pkgCache::PkgIterator target = dep.TargetPkg();
+	  candidates.insert(target);
+
+	  for(pkgCache::PrvIterator prv = target.ProvidesList();
+	      !prv.end(); ++prv)
+	    candidates.insert(prv.OwnerPkg());
+	}
+    }
+
+  for(pkgset::const_iterator it = candidates.begin();
+      it != candidates.end(); ++it)
+    {
+      const pkgCache::PkgIterator &pkg = *it;
+
+      if(!pkg.CurrentVer().end() ||
+	 (*apt_cache_file)->get_action_state(pkg, true) != pkg_unchanged)
+	continue;
+
+      if(package_recommended(pkg))
+	recommended.push_back(pkg);
+      else if(package_suggested(pkg))
+	suggested.push_back(pkg);
+    }
+}
+
 /** Displays a preview of the stuff to be done -- like apt-get, it collects
  *  all the "stuff to install" in one place.
  *
@@ -621,9 +674,14 @@ bool cmdline_show_preview(bool as_upgrade, pkgset &to_install,
   pkgvector extra_install, extra_remove;
   unsigned long Upgrade=0, Downgrade=0, Install=0, ReInstall=0;
 
-  for(pkgCache::PkgIterator pkg=(*apt_cache_file)->PkgBegin();
-      !pkg.end(); ++pkg)
+  const std::set<pkgCache::PkgIterator> &changed =
+    (*apt_cache_file)->get_changed_packages();
+
+  for(std::set<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+      it != changed.end(); ++it)
     {
+      const pkgCache::PkgIterator &pkg = *it;
+
       if((*apt_cache_file)[pkg].NewInstall())
 	++Install;
       else if((*apt_cache_file)[pkg].Upgrade())
@@ -634,7 +692,7 @@ bool cmdline_show_preview(bool as_upgrade, pkgset &to_install,
 	      ((*apt_cache_file)[pkg].iFlags & pkgDepCache::ReInstall))
 	++ReInstall;
 
-      pkg_action_state state=find_pkg_state(pkg, *apt_cache_file, true);
+      pkg_action_state state = (*apt_cache_file)->get_action_state(pkg, true);
 
       switch(state)
 	{
@@ -650,14 +708,6 @@ bool cmdline_show_preview(bool as_upgrade, pkgset &to_install,
 	  if(to_remove.find(pkg)==to_remove.end())
 	    extra_remove.push_back(pkg);
 	  break;
-	case pkg_unchanged:
-	  if(pkg.CurrentVer().end())
-	    {
-	      if(package_recommended(pkg))
-		recommended.push_back(pkg);
-	      else if(package_suggested(pkg))
-		suggested.push_back(pkg);
-	    }
 	default:
 	  break;
 	}
@@ -686,6 +736,8 @@ bool cmdline_show_preview(bool as_upgrade, pkgset &to_install,
 	}
     }
 
+  find_unmet_recommendations(changed, recommended, suggested);
+
   for(int i=0; i<num_pkg_action_states; ++i)
     {
       if(!lists[i].empty())
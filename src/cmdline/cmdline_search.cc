@@ -23,6 +23,7 @@
 #include "cmdline_search.h"
 
 #include "cmdline_common.h"
+#include "cmdline_json.h"
 #include "cmdline_progress_display.h"
 #include "cmdline_search_progress.h"
 #include "cmdline_util.h"
@@ -41,6 +42,8 @@
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 #include <generic/apt/matching/serialize.h>
+#include <generic/util/json_record.h>
+#include <generic/util/output_buffer.h>
 #include <generic/util/progress_info.h>
 #include <generic/util/throttle.h>
 #include <generic/views/progress.h>
@@ -72,6 +75,8 @@ using aptitude::cmdline::terminal_metrics;
 using aptitude::cmdline::terminal_output;
 using aptitude::matching::serialize_pattern;
 using aptitude::util::create_throttle;
+using aptitude::util::json_record;
+using aptitude::util::output_buffer;
 using aptitude::util::progress_info;
 using aptitude::util::progress_type_bar;
 using aptitude::util::progress_type_none;
@@ -131,12 +136,32 @@ namespace
 
     _error->DumpErrors();
 
-    std::sort(output.begin(), output.end(),
-              aptitude::cmdline::package_results_lt(sort_policy));
-    output.erase(std::unique(output.begin(), output.end(),
-                             aptitude::cmdline::package_results_eq(sort_policy)),
-                 output.end());
+    aptitude::cmdline::sort_package_results(output, sort_policy);
 
+    if(aptitude::cmdline::want_json_output())
+      {
+        json_record rec;
+        for(results_list::const_iterator it = output.begin();
+            it != output.end(); ++it)
+          {
+            const pkgCache::PkgIterator &pkg = it->first;
+            const pkgCache::VerIterator ver =
+              pkg_item::visible_version(pkg);
+
+            rec.clear();
+            aptitude::cmdline::add_json_package_fields(rec, pkg);
+            if(ver.end())
+              rec.add_null("summary");
+            else
+              rec.add_string("summary",
+                             get_short_description(ver, apt_package_records));
+            rec.write(stdout);
+          }
+
+        return 0;
+      }
+
+    output_buffer out(stdout);
     for(results_list::const_iterator it = output.begin(); it != output.end(); ++it)
       {
         column_parameters *p =
@@ -146,11 +171,10 @@ namespace
                                             columns,
                                             0);
         if(disable_columns)
-          printf("%ls\n", aptitude::cmdline::de_columnize(columns, columnizer, *p).c_str());
+          out.write_line(aptitude::cmdline::de_columnize(columns, columnizer, *p));
         else
-          printf("%ls\n",
-                 columnizer.layout_columns(format_width == -1 ? screen_width : format_width,
-                                           *p).c_str());
+          out.write_line(columnizer.layout_columns(format_width == -1 ? screen_width : format_width,
+                                                   *p));
 
         // Note that this deletes the whole result, so we can't re-use
         // the list.
@@ -25,6 +25,7 @@
 #include <desc_render.h>
 
 #include "cmdline_common.h"
+#include "cmdline_json.h"
 #include "cmdline_util.h"
 #include "terminal.h"
 #include "text_progress.h"
@@ -34,6 +35,8 @@
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/util/json_record.h>
+#include <generic/util/output_buffer.h>
 
 
 // System includes:
@@ -46,15 +49,21 @@
 #include <apt-pkg/pkgrecords.h>
 #include <apt-pkg/progress.h>
 #include <apt-pkg/strutl.h>
+#include <apt-pkg/tagfile.h>
 #include <apt-pkg/version.h>
 
 #include <iostream>
 
+#include <ctype.h>
+#include <string.h>
+
 namespace cw = cwidget;
 using aptitude::cmdline::create_terminal;
 using aptitude::cmdline::make_text_progress;
 using aptitude::cmdline::terminal_io;
 using aptitude::cmdline::terminal_metrics;
+using aptitude::util::json_record;
+using aptitude::util::output_buffer;
 using boost::shared_ptr;
 using cwidget::fragf;
 using cwidget::fragment;
@@ -76,6 +85,31 @@ ostream &operator<<(ostream &out, const cwidget::fragment_contents &contents)
   return out;
 }
 
+/** \brief Lay out a fragment and write it to stdout in one go,
+ *  without the per-line flushes of operator<<.
+ */
+static void write_fragment(cw::fragment *f, unsigned int screen_width,
+                           bool extra_newline)
+{
+  const cwidget::fragment_contents contents =
+    f->layout(screen_width, screen_width, cwidget::style());
+
+  output_buffer out(stdout);
+  for(cwidget::fragment_contents::const_iterator i=contents.begin();
+      i!=contents.end(); ++i)
+    {
+      wstring s;
+      // Drop the attributes.
+      for(cwidget::fragment_line::const_iterator j=i->begin(); j!=i->end(); ++j)
+	s.push_back((*j).ch);
+
+      out.write_line(s);
+    }
+
+  if(extra_newline)
+    out.put('\n');
+}
+
 static cwidget::fragment *dep_lst_frag(pkgCache::DepIterator dep,
 				       string title, pkgCache::Dep::DepType T)
 {
@@ -368,10 +402,100 @@ static cwidget::fragment *state_fragment(pkgCache::PkgIterator pkg, pkgCache::Ve
     }
 }
 
+/** \brief Add the fields of the package record for the given file
+ *  to a JSON record, as an object named "fields".
+ *
+ *  The field values are copied straight from the record, so
+ *  multi-line fields keep their embedded newlines.
+ */
+static void add_json_record_fields(json_record &rec,
+                                   const pkgCache::VerFileIterator &vf)
+{
+  json_record fields;
+
+  const char *recstart = 0, *recend = 0;
+  pkgTagSection sec;
+
+  if(!vf.end())
+    apt_package_records->Lookup(vf).GetRec(recstart, recend);
+
+  if(recstart != NULL && recend != NULL &&
+     sec.Scan(recstart, recend - recstart + 1))
+    {
+      std::string name;
+      for(unsigned int i = 0; i < sec.Count(); ++i)
+        {
+          const char *start, *stop;
+          sec.Get(start, stop, i);
+
+          const char *colon = static_cast<const char *>(memchr(start, ':', stop - start));
+          if(colon == NULL)
+            continue;
+
+          const char *value_start = colon + 1;
+          while(value_start != stop && (*value_start == ' ' || *value_start == '\t'))
+            ++value_start;
+
+          const char *value_stop = stop;
+          while(value_stop != value_start && isspace(static_cast<unsigned char>(value_stop[-1])))
+            --value_stop;
+
+          name.assign(start, colon);
+          fields.add_string(name.c_str(), value_start, value_stop);
+        }
+    }
+
+  rec.add_raw("fields", fields.str());
+}
+
+/** \brief Write a JSON record describing a package that has no
+ *  versions.
+ */
+static void show_package_json(pkgCache::PkgIterator pkg)
+{
+  json_record rec;
+
+  aptitude::cmdline::add_json_package_fields(rec, pkg);
+  rec.add_null("version");
+
+  std::vector<std::string> provided_by;
+  for(pkgCache::PrvIterator prv = pkg.ProvidesList(); !prv.end(); ++prv)
+    provided_by.push_back(prv.OwnerPkg().FullName(true));
+  rec.add_string_list("provided_by", provided_by);
+
+  rec.write(stdout);
+}
+
+/** \brief Write a JSON record describing one version of a package,
+ *  as found in one of its package files.
+ */
+static void show_version_json(const pkgCache::VerIterator &ver,
+                              const pkgCache::VerFileIterator &vf)
+{
+  json_record rec;
+
+  aptitude::cmdline::add_json_package_fields(rec, ver.ParentPkg());
+  rec.add_string("version", ver.VerStr());
+  rec.add_string_or_null("architecture", ver.Arch());
+  if(vf.end())
+    rec.add_null("archive");
+  else
+    rec.add_string_or_null("archive", vf.File().Archive());
+  add_json_record_fields(rec, vf);
+
+  rec.write(stdout);
+}
+
 /** \brief Shows information about a package. */
 static void show_package(pkgCache::PkgIterator pkg, int verbose,
                          const shared_ptr<terminal_metrics> &term_metrics)
 {
+  if(aptitude::cmdline::want_json_output())
+    {
+      show_package_json(pkg);
+      return;
+    }
+
   vector<cw::fragment *> fragments;
 
   fragments.push_back(cw::fragf("%s%s%n", _("Package: "), pkg.Name()));
@@ -380,8 +504,7 @@ static void show_package(pkgCache::PkgIterator pkg, int verbose,
 
   cw::fragment *f=cw::sequence_fragment(fragments);
 
-  const unsigned int screen_width = term_metrics->get_screen_width();
-  cout << f->layout(screen_width, screen_width, cwidget::style());
+  write_fragment(f, term_metrics->get_screen_width(), false);
 
   delete f;
 }
@@ -492,12 +615,28 @@ cw::fragment *version_file_fragment(const pkgCache::VerIterator &ver,
 static void show_version(pkgCache::VerIterator ver, int verbose,
                          const shared_ptr<terminal_metrics> &term_metrics)
 {
+  if(aptitude::cmdline::want_json_output())
+    {
+      if(ver.FileList().end())
+        show_version_json(ver, ver.FileList());
+      else
+        for(pkgCache::VerFileIterator vf = ver.FileList(); !vf.end(); ++vf)
+          {
+            show_version_json(ver, vf);
+
+            // As below, only show the first file if verbose<2.
+            if(verbose < 2)
+              break;
+          }
+
+      return;
+    }
+
   if(ver.FileList().end())
     {
       cw::fragment *f=version_file_fragment(ver, ver.FileList(), verbose);
 
-      const unsigned int screen_width = term_metrics->get_screen_width();
-      cout << f->layout(screen_width, screen_width, cwidget::style());
+      write_fragment(f, term_metrics->get_screen_width(), false);
 
       delete f;
     }
@@ -507,8 +646,7 @@ static void show_version(pkgCache::VerIterator ver, int verbose,
 	{
 	  cw::fragment *f=version_file_fragment(ver, vf, verbose);
 
-          const unsigned int screen_width = term_metrics->get_screen_width();
-	  cout << f->layout(screen_width, screen_width, cwidget::style()) << endl;
+	  write_fragment(f, term_metrics->get_screen_width(), true);
 
 	  delete f;
 
@@ -40,7 +40,9 @@
 #include <cwidget/config/column_definition.h>
 #include <cwidget/generic/util/ref_ptr.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 /** \file cmdline_util.h
  */
@@ -390,6 +392,101 @@ namespace aptitude
       }
     };
 
+    /** \brief Orders indices into a list of sort keys by key, then by
+     *  index.
+     */
+    class sort_key_index_lt
+    {
+      const std::vector<std::string> &keys;
+
+    public:
+      sort_key_index_lt(const std::vector<std::string> &_keys)
+        : keys(_keys)
+      {
+      }
+
+      bool operator()(std::size_t a, std::size_t b) const
+      {
+        const int cmp = keys[a].compare(keys[b]);
+        return cmp < 0 || (cmp == 0 && a < b);
+      }
+    };
+
+    /** \brief Sort a list by precomputed sort keys and drop all but
+     *  the first of each run of elements with equal keys.
+     *
+     *  \param results  The list to sort.
+     *  \param keys     The sort key of each element of results.
+     */
+    template<typename T>
+    void sort_unique_by_keys(std::vector<T> &results,
+                             const std::vector<std::string> &keys)
+    {
+      std::vector<std::size_t> order;
+      order.reserve(results.size());
+      for(std::size_t i = 0; i < results.size(); ++i)
+        order.push_back(i);
+
+      std::sort(order.begin(), order.end(), sort_key_index_lt(keys));
+
+      std::vector<T> sorted;
+      sorted.reserve(results.size());
+      for(std::vector<std::size_t>::const_iterator it = order.begin();
+          it != order.end(); ++it)
+        if(it == order.begin() || keys[*(it - 1)] != keys[*it])
+          sorted.push_back(results[*it]);
+
+      results.swap(sorted);
+    }
+
+    /** \brief Sort package match results by a sort policy and remove
+     *  the ones that it considers equal.
+     *
+     *  Equivalent to sorting with package_results_lt and removing
+     *  duplicates with package_results_eq, but the sort policy is
+     *  only consulted once per result.
+     */
+    template<typename T>
+    void sort_package_results(std::vector<std::pair<pkgCache::PkgIterator, T> > &results,
+                              pkg_sortpolicy *s)
+    {
+      pkg_sort_key_context context;
+      std::vector<std::string> keys(results.size());
+      for(std::size_t i = 0; i < results.size(); ++i)
+        {
+          const pkgCache::PkgIterator &pkg = results[i].first;
+          const pkgCache::VerIterator ver =
+            (*apt_cache_file)[pkg].CandidateVerIter(*apt_cache_file);
+
+          s->make_key(keys[i], pkg, ver, context);
+        }
+
+      sort_unique_by_keys(results, keys);
+    }
+
+    /** \brief Sort version match results by a sort policy and remove
+     *  the ones that it considers equal.
+     *
+     *  Equivalent to sorting with version_results_lt and removing
+     *  duplicates with version_results_eq, but the sort policy is
+     *  only consulted once per result.
+     */
+    template<typename T>
+    void sort_version_results(std::vector<std::pair<pkgCache::VerIterator, T> > &results,
+                              pkg_sortpolicy *s)
+    {
+      pkg_sort_key_context context;
+      std::vector<std::string> keys(results.size());
+      for(std::size_t i = 0; i < results.size(); ++i)
+        {
+          const pkgCache::VerIterator &ver = results[i].first;
+
+          s->make_key(keys[i], ver.ParentPkg(), ver, context);
+        }
+
+      sort_unique_by_keys(results, keys);
+    }
+
 
     /** \brief Custom hash on packages. */
     class hash_pkgiterator
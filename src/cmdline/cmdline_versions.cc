@@ -21,6 +21,7 @@
 // Local includes:
 #include "cmdline_versions.h"
 
+#include "cmdline_json.h"
 #include "cmdline_progress_display.h"
 #include "cmdline_search_progress.h"
 #include "cmdline_util.h"
@@ -30,9 +31,13 @@
 #include <pkg_ver_item.h>
 #include <load_sortpolicy.h>
 
+#include <generic/apt/apt.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 #include <generic/apt/matching/serialize.h>
+#include <generic/apt/version_sources.h>
+#include <generic/util/json_record.h>
+#include <generic/util/output_buffer.h>
 #include <generic/util/progress_info.h>
 #include <generic/util/throttle.h>
 #include <generic/views/progress.h>
@@ -40,6 +45,7 @@
 
 // System includes:
 #include <apt-pkg/error.h>
+#include <apt-pkg/policy.h>
 
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
@@ -62,14 +68,15 @@ using aptitude::cmdline::create_terminal;
 using aptitude::cmdline::lessthan_1st;
 using aptitude::cmdline::package_results_lt;
 using aptitude::cmdline::search_result_column_parameters;
+using aptitude::cmdline::sort_version_results;
 using aptitude::cmdline::terminal_io;
 using aptitude::cmdline::terminal_locale;
 using aptitude::cmdline::terminal_metrics;
 using aptitude::cmdline::terminal_output;
-using aptitude::cmdline::version_results_eq;
-using aptitude::cmdline::version_results_lt;
 using aptitude::matching::serialize_pattern;
 using aptitude::util::create_throttle;
+using aptitude::util::json_record;
+using aptitude::util::output_buffer;
 using aptitude::util::progress_info;
 using aptitude::util::throttle;
 using aptitude::views::progress;
@@ -88,6 +95,10 @@ namespace
   class version_group_by_policy
   {
   public:
+    virtual ~version_group_by_policy()
+    {
+    }
+
     /** \brief Get the groups of a match against the given version.
      *
      *  \param ver    The version that was matched.
@@ -133,17 +144,14 @@ namespace
                     const cw::util::ref_ptr<m::structural_match> &match,
                     std::vector<std::string> &output)
     {
-      // I don't think FileList() *can* be invalid; this is just
-      // paranoia.
-      if(!ver.FileList().end())
-        {
-          std::string srcpkg = apt_package_records->Lookup(ver.FileList()).SourcePkg();
-
-          if(srcpkg.empty())
-            output.push_back(ver.ParentPkg().Name());
-          else
-            output.push_back(srcpkg);
-        }
+      // Versions are grouped by the source package named in their
+      // first package file.
+      const aptitude::apt::version_sources &sources =
+        aptitude::apt::get_version_sources(ver, (*apt_cache_file)->GetCache(),
+                                           *apt_package_records);
+
+      if(!sources.packages.empty())
+        output.push_back(sources.packages.front());
     }
 
     std::string format_header(const std::string &group)
@@ -160,20 +168,14 @@ namespace
                     const cw::util::ref_ptr<m::structural_match> &match,
                     std::vector<std::string> &output)
     {
-      // I don't think FileList() *can* be invalid; this is just
-      // paranoia.
-      if(!ver.FileList().end())
-        {
-          pkgRecords::Parser &rec = apt_package_records->Lookup(ver.FileList());
+      const aptitude::apt::version_sources &sources =
+        aptitude::apt::get_version_sources(ver, (*apt_cache_file)->GetCache(),
+                                           *apt_package_records);
 
-          std::string srcpkg = rec.SourcePkg();
-          std::string srcver = rec.SourceVer();
-
-          if(srcpkg.empty())
-            srcpkg = ver.ParentPkg().Name();
-
-          if(srcver.empty())
-            srcver = ver.VerStr();
+      if(!sources.packages.empty())
+        {
+          const std::string &srcpkg = sources.packages.front();
+          const std::string &srcver = sources.versions.front();
 
           std::string result;
           result.reserve(srcpkg.size() + srcver.size() + 1);
@@ -213,8 +215,63 @@ namespace
     }
   };
 
+  /** \brief Write one JSON record for each matched version.
+   *
+   *  Grouping doesn't apply to JSON output: each record carries the
+   *  package, architecture and archives of its version, so consumers
+   *  can group the records however they like.
+   */
+  void show_version_match_list_json(const std::vector<std::pair<pkgCache::VerIterator, cw::util::ref_ptr<m::structural_match> > > &output)
+  {
+    pkgPolicy *policy =
+      dynamic_cast<pkgPolicy *>(&(*apt_cache_file)->GetPolicy());
+
+    json_record rec;
+    std::vector<std::string> archives;
+    for(std::vector<std::pair<pkgCache::VerIterator, cw::util::ref_ptr<m::structural_match> > >::const_iterator it = output.begin();
+        it != output.end(); ++it)
+      {
+        const pkgCache::VerIterator &ver = it->first;
+        const pkgCache::PkgIterator pkg = ver.ParentPkg();
+        const pkgCache::VerIterator candver =
+          (*apt_cache_file)[pkg].CandidateVerIter(*apt_cache_file);
+
+        archives.clear();
+        bool have_priority = false;
+        signed short priority = 0;
+        for(pkgCache::VerFileIterator vf = ver.FileList(); !vf.end(); ++vf)
+          {
+            if(vf.File().Archive() != NULL)
+              archives.push_back(vf.File().Archive());
+
+            if(policy != NULL)
+              {
+                const signed short file_priority =
+                  policy->GetPriority(vf.File());
+                if(!have_priority || file_priority > priority)
+                  priority = file_priority;
+                have_priority = true;
+              }
+          }
+
+        rec.clear();
+        rec.add_string("package", pkg.FullName(true));
+        rec.add_string("version", ver.VerStr());
+        rec.add_string_or_null("architecture", ver.Arch());
+        rec.add_bool("installed", ver == pkg.CurrentVer());
+        rec.add_bool("candidate", ver == candver);
+        rec.add_string_list("archives", archives);
+        if(have_priority)
+          rec.add_number("priority", priority);
+        else
+          rec.add_null("priority");
+        rec.write(stdout);
+      }
+  }
+
   // Print the matches against a group of versions.
-  void show_version_match_list(const std::vector<std::pair<pkgCache::VerIterator, cw::util::ref_ptr<m::structural_match> > > &output,
+  void show_version_match_list(output_buffer &out,
+                               const std::vector<std::pair<pkgCache::VerIterator, cw::util::ref_ptr<m::structural_match> > > &output,
                                const cw::config::column_definition_list &columns,
                                int format_width,
                                const unsigned int screen_width,
@@ -230,11 +287,10 @@ namespace
                                       columns,
                                       0);
         if(disable_columns)
-          printf("%ls\n", aptitude::cmdline::de_columnize(columns, columnizer, *p).c_str());
+          out.write_line(aptitude::cmdline::de_columnize(columns, columnizer, *p));
         else
-          printf("%ls\n",
-                 columnizer.layout_columns(format_width == -1 ? screen_width : format_width,
-                                           *p).c_str());
+          out.write_line(columnizer.layout_columns(format_width == -1 ? screen_width : format_width,
+                                                   *p));
       }
   }
 
@@ -391,10 +447,16 @@ namespace
     // don't have to sort lots of little lists later.  The code below
     // very carefully builds a list of the versions of each package in
     // a stable way, so the versions will continue to be in order.
-    std::sort(output.begin(), output.end(), version_results_lt(sort_policy));
-    output.erase(std::unique(output.begin(), output.end(), version_results_eq(sort_policy)),
-                 output.end());
+    sort_version_results(output, sort_policy);
+
+    if(aptitude::cmdline::want_json_output())
+      {
+        show_version_match_list_json(output);
+        delete group_by_policy;
+        return return_value;
+      }
 
+    output_buffer out(stdout);
     if(group_by_policy != NULL)
       {
         typedef boost::unordered_map<std::string, boost::shared_ptr<results_list> >
@@ -447,11 +509,13 @@ namespace
             it != by_groups_list.end(); ++it)
           {
             if(it != by_groups_list.begin())
-              printf("\n");
-            printf("%s\n", group_by_policy->format_header(it->first).c_str());
+              out.put('\n');
+            out.write(group_by_policy->format_header(it->first));
+            out.put('\n');
             // No need to sort the versions in this list since we
             // sorted them above.
-            show_version_match_list(*it->second,
+            show_version_match_list(out,
+                                    *it->second,
                                     columns,
                                     format_width,
                                     screen_width,
@@ -460,7 +524,8 @@ namespace
           }
       }
     else
-      show_version_match_list(output,
+      show_version_match_list(out,
+                              output,
                               columns,
                               format_width,
                               screen_width,
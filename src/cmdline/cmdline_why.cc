@@ -26,6 +26,7 @@
 #include "cmdline_why.h"
 
 #include "cmdline_common.h"
+#include "cmdline_json.h"
 #include "cmdline_show.h"
 #include "cmdline_util.h"
 #include "terminal.h"
@@ -40,7 +41,8 @@
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 
-#include <generic/util/immset.h>
+#include <generic/util/json_record.h>
+#include <generic/util/ordered_strategies.h>
 #include <generic/util/util.h>
 
 // System includes:
@@ -53,15 +55,19 @@
 #include <boost/make_shared.hpp>
 
 #include <cwidget/fragment.h>
+#include <cwidget/generic/threads/threads.h>
 
 #include <algorithm>
 #include <deque>
 #include <set>
 
+#include <unistd.h>
+
 namespace cw = cwidget;
 using aptitude::cmdline::create_terminal;
 using aptitude::cmdline::terminal_io;
 using aptitude::cmdline::terminal_metrics;
+using aptitude::util::json_record;
 using aptitude::why::make_cmdline_why_callbacks;
 using aptitude::why::why_callbacks;
 using boost::make_shared;
@@ -89,6 +95,94 @@ namespace
 		   dep.TargetPkg().FullName(true).c_str());
   }
 
+  // Untranslated names of the dependency types, for JSON output.
+  const char *json_dep_type_name(const pkgCache::DepIterator &dep)
+  {
+    switch(dep->Type)
+      {
+      case pkgCache::Dep::Depends:    return "Depends";
+      case pkgCache::Dep::PreDepends: return "PreDepends";
+      case pkgCache::Dep::Suggests:   return "Suggests";
+      case pkgCache::Dep::Recommends: return "Recommends";
+      case pkgCache::Dep::Conflicts:  return "Conflicts";
+      case pkgCache::Dep::Replaces:   return "Replaces";
+      case pkgCache::Dep::Obsoletes:  return "Obsoletes";
+      case pkgCache::Dep::DpkgBreaks: return "Breaks";
+      case pkgCache::Dep::Enhances:   return "Enhances";
+      default:                        return "Unknown";
+      }
+  }
+
+  /** \brief Write one chain of actions found by "why" as a JSON
+   *  record.
+   *
+   *  Each link of the chain names the package (and version) that
+   *  holds the relationship, the kind of relationship, and the
+   *  alternatives it names.
+   */
+  void write_why_json(const pkgCache::PkgIterator &root,
+                      bool root_is_removal,
+                      const std::vector<aptitude::why::action> &chain)
+  {
+    std::string links("[");
+    json_record link;
+    std::vector<std::string> targets;
+    for(std::vector<aptitude::why::action>::const_iterator it = chain.begin();
+        it != chain.end(); ++it)
+      {
+        pkgCache::DepIterator dep = it->get_dep();
+        pkgCache::PrvIterator prv = it->get_prv();
+
+        targets.clear();
+        pkgCache::VerIterator ver;
+        const char *type;
+        if(!dep.end())
+          {
+            ver = dep.ParentVer();
+            type = json_dep_type_name(dep);
+
+            pkgCache::DepIterator start, end;
+            surrounding_or(dep, start, end);
+            for(pkgCache::DepIterator d = start; d != end; ++d)
+              {
+                std::string target = d.TargetPkg().FullName(true);
+                if(d.TargetVer() != NULL)
+                  {
+                    target += " (";
+                    target += d.CompType();
+                    target += " ";
+                    target += d.TargetVer();
+                    target += ")";
+                  }
+                targets.push_back(target);
+              }
+          }
+        else
+          {
+            ver = prv.OwnerVer();
+            type = "Provides";
+            targets.push_back(prv.ParentPkg().FullName(true));
+          }
+
+        link.clear();
+        link.add_string("package", ver.ParentPkg().FullName(true));
+        link.add_string("version", ver.VerStr());
+        link.add_string("type", type);
+        link.add_string_list("targets", targets);
+
+        if(it != chain.begin())
+          links += ',';
+        links += link.str();
+      }
+    links += ']';
+
+    json_record rec;
+    rec.add_string("target", root.FullName(true));
+    rec.add_bool("removal", root_is_removal);
+    rec.add_raw("chain", links);
+    rec.write(stdout);
+  }
+
   // Place weaker dependencies first, then order alphabetically.
   struct compare_pair_by_dep_type
   {
@@ -109,69 +203,18 @@ namespace aptitude
 {
   namespace why
   {
-    // Represents a full forward or reverse justification for the
-    // installation of the given package/version.  The justification
-    // may terminate on either a package version, a provided package
-    // name, or the removal of a package.
-    class justification
+    void search_node::get_chain(const std::vector<search_node> &nodes,
+				int index,
+				std::vector<action> &output)
     {
-      target the_target;
-      imm::set<action> actions;
+      output.clear();
+      output.reserve(nodes[index].get_depth());
 
-      justification(const target &_the_target,
-		    const imm::set<action> &_actions)
-	: the_target(_the_target), actions(_actions)
-      {
-      }
-    public:
-      // Create a node with an empty history rooted at the given target.
-      justification(const target &_the_target)
-	: the_target(_the_target)
-      {
-      }
-
-      const target &get_target() const
-      {
-	return the_target;
-      }
-
-      const imm::set<action> &get_actions() const
-      {
-	return actions;
-      }
-
-      // Generate all the successors of this node (Q: could I lift
-      // justify_target::generate_successors into this class?  It feels
-      // like it makes more sense to have the smarts in here)
-      void generate_successors(std::deque<justification> &output,
-			       const search_params &params,
-			       int verbosity,
-                               const shared_ptr<why_callbacks> &callbacks) const
-      {
-	the_target.generate_successors(*this, output, params, verbosity, callbacks);
-      }
-
-      // Build a successor of this node.
-      justification successor(const target &new_target,
-			      const pkgCache::DepIterator &dep) const
-      {
-	imm::set<action> new_actions(actions);
-	new_actions.insert(action(dep, new_actions.size()));
-
-	return justification(new_target, new_actions);
-      }
-
-      justification successor(const target &new_target,
-			      const pkgCache::PrvIterator &prv) const
-      {
-	imm::set<action> new_actions(actions);
-	new_actions.insert(action(prv, new_actions.size()));
-
-	return justification(new_target, new_actions);
-      }
-
-      cwidget::fragment *description() const;
-    };
+      // Walking from the node to the root produces the actions in
+      // the order in which they were performed.
+      for(int i = index; nodes[i].get_parent() >= 0; i = nodes[i].get_parent())
+	output.push_back(nodes[i].get_action());
+    }
 
     cw::style action::get_style() const
     {
@@ -341,12 +384,12 @@ namespace aptitude
     }
 
     cw::fragment *justification_description(const target &t,
-                                            const imm::set<action> &actions)
+                                            const std::vector<action> &actions)
     {
       std::vector<cw::fragment *> rval;
       rval.push_back(cw::fragf("%F\n", t.description()));
       std::vector<cw::fragment *> col1_entries, col2_entries, col3_entries;
-      for(imm::set<action>::const_iterator it = actions.begin();
+      for(std::vector<action>::const_iterator it = actions.begin();
 	  it != actions.end(); ++it)
 	{
 	  col1_entries.push_back(cw::hardwrapbox(cw::fragf("%F | \n", it->description_column1_fragment())));
@@ -366,11 +409,6 @@ namespace aptitude
       return cw::sequence_fragment(rval);
     }
 
-    cw::fragment *justification::description() const
-    {
-      return justification_description(the_target, actions);
-    }
-
   cw::fragment *target::description() const
   {
     pkgCache::PkgIterator &mpkg = const_cast<pkgCache::PkgIterator &>(pkg);
@@ -394,13 +432,14 @@ namespace aptitude
       }
   }
 
-  void target::generate_successors(const justification &parent,
-				   std::deque<justification> &output,
+  void target::generate_successors(int parent,
+				   std::vector<search_node> &nodes,
 				   const search_params &params,
 				   int verbosity,
                                    const shared_ptr<why_callbacks> &callbacks) const
   {
     why_callbacks * const callbacks_bare = callbacks.get();
+    const int depth = nodes[parent].get_depth() + 1;
 
     // The reverse successors of an install node are all the revdeps
     // of the package, minus conflicts and deps from versions that
@@ -561,7 +600,7 @@ namespace aptitude
             if(callbacks_bare != NULL)
               callbacks_bare->enqueued(dep.ParentPkg());
 	    target the_target(Install(dep.ParentPkg()));
-	    output.push_back(parent.successor(the_target, dep));
+	    nodes.push_back(search_node(the_target, dep, parent, depth));
 	  }
 	else
 	  {
@@ -586,7 +625,7 @@ namespace aptitude
                 if(callbacks_bare != NULL)
                   callbacks_bare->enqueued(prv);
 		target the_target(Provide(prv.ParentPkg(), prv, is_remove()));
-		output.push_back(parent.successor(the_target, prv));
+		nodes.push_back(search_node(the_target, prv, parent, depth));
 	      }
 	  }
       }
@@ -594,204 +633,273 @@ namespace aptitude
 
     namespace
     {
-  class justification_search
-  {
-    // The central queue.  Nodes are inserted at the back and removed
-    // from the front.
-    std::deque<justification> q;
+      /** \brief Remembers which versions match the leaf patterns of a
+       *  search.
+       *
+       *  A version is matched against the patterns the first time it is
+       *  tested, and the result is shared by every search that uses this
+       *  object; most packages have the same selected version under most
+       *  search parameters.
+       *
+       *  Searches running on several threads can share a matcher; the
+       *  patterns are only ever matched by one of them at a time.
+       */
+      class leaf_matcher
+      {
+	cw::threads::mutex matches_mutex;
 
-    std::vector<cwidget::util::ref_ptr<pattern> > leaves;
+	std::vector<cwidget::util::ref_ptr<pattern> > leaves;
 
-    cwidget::util::ref_ptr<search_cache> search_info;
+	cwidget::util::ref_ptr<search_cache> search_info;
 
-    search_params params;
+	// Indexed by version ID: 1 if the version matches a leaf, 0 if
+	// it doesn't, and -1 if it hasn't been tested yet.
+	std::vector<signed char> matches;
 
-    // Array of flags indicating which packages have been visited.
-    bool *seen_packages;
+      public:
+	explicit leaf_matcher(const std::vector<cwidget::util::ref_ptr<pattern> > &_leaves)
+	  : leaves(_leaves),
+	    search_info(search_cache::create()),
+	    matches((*apt_cache_file)->Head().VersionCount, -1)
+	{
+	}
 
-    // Used for debug output.
-    bool first_iteration;
+	/** \return \b true if \b ver, a version of \b pkg, matches
+	 *  one of the leaf patterns.
+	 */
+	bool is_leaf(const pkgCache::PkgIterator &pkg,
+		     const pkgCache::VerIterator &ver)
+	{
+	  cw::threads::mutex::lock l(matches_mutex);
 
-    int verbosity;
+	  signed char &match(matches[ver->ID]);
+	  if(match < 0)
+	    {
+	      match = 0;
+	      for(std::vector<cwidget::util::ref_ptr<pattern> >::const_iterator it = leaves.begin();
+		  match == 0 && it != leaves.end(); ++it)
+		if(get_match(*it, pkg, ver,
+			     search_info,
+			     *apt_cache_file,
+			     *apt_package_records).valid())
+		  match = 1;
+	    }
 
-  public:
-    /** \brief Initialize a search for justifications.
-     *
-     *  \param leaves the point at which to stop searching and signal
-     *                success.
-     *                These pointers are NOT owner by the search; they
-     *                must live as long as the search does, and will
-     *                not be freed when it is destroyed.
-     *
-     *  \param root the root package of the search.
-     *
-     *  \param search_for_removal if true, the root note is the removal
-     *                            of root; otherwise, it is the installation
-     *                            of root.
-     *
-     *  \param params the search parameters: whether to use the current
-     *                or the inst ver, and whether to consider
-     *                suggests/recommends to be important.
-     */
-    justification_search(const std::vector<cwidget::util::ref_ptr<pattern> > &_leaves,
-			 const target &root,
-			 const search_params &_params,
-			 int _verbosity)
-      : leaves(_leaves),
-	search_info(aptitude::matching::search_cache::create()),
-	params(_params),
-	seen_packages(NULL),
-	first_iteration(true),
-	verbosity(_verbosity)
-    {
-      // Prime the pump.
-      q.push_back(justification(root));
-    }
+	  return match > 0;
+	}
+      };
 
-    justification_search(const justification_search &other)
-      : q(other.q),
-	leaves(other.leaves),
-	params(other.params),
-	first_iteration(other.first_iteration),
-	verbosity(other.verbosity)
-    {
-      if(other.seen_packages == NULL)
-	seen_packages = NULL;
-      else
+      class justification_search
+      {
+	// Every node that the search has generated, in the order in
+	// which they were generated.  Since the search is breadth-first,
+	// the nodes from queue_front onwards are its queue; the nodes
+	// before it are kept because their children refer to them.
+	std::vector<search_node> nodes;
+	std::vector<search_node>::size_type queue_front;
+
+	shared_ptr<leaf_matcher> leaves;
+
+	search_params params;
+
+	// Flags indicating which packages have been visited, indexed by
+	// package ID.
+	std::vector<bool> seen_packages;
+
+	// Used for debug output.
+	bool first_iteration;
+
+	int verbosity;
+
+      public:
+	/** \brief Initialize a search for justifications.
+	 *
+	 *  \param leaves the point at which to stop searching and signal
+	 *                success.  The matcher may be shared with other
+	 *                searches.
+	 *
+	 *  \param root the root package of the search.
+	 *
+	 *  \param search_for_removal if true, the root note is the removal
+	 *                            of root; otherwise, it is the installation
+	 *                            of root.
+	 *
+	 *  \param params the search parameters: whether to use the current
+	 *                or the inst ver, and whether to consider
+	 *                suggests/recommends to be important.
+	 */
+	justification_search(const shared_ptr<leaf_matcher> &_leaves,
+			     const target &root,
+			     const search_params &_params,
+			     int _verbosity)
+	  : queue_front(0),
+	    leaves(_leaves),
+	    params(_params),
+	    first_iteration(true),
+	    verbosity(_verbosity)
 	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = other.seen_packages[i];
+	  // Prime the pump.
+	  nodes.push_back(search_node(root));
 	}
-    }
 
-    justification_search &operator=(const justification_search &other)
-    {
-      q = other.q;
-      leaves = other.leaves;
-      params = other.params;
-      if(other.seen_packages == NULL)
-	seen_packages = NULL;
-      else
+	/** \brief Compute the next output of this search.
+	 *
+	 *  \param output a vector whose contents will be replaced with the
+	 *                results of the search (expressed as a sequence
+	 *                of actions in the order in which they were
+	 *                performed).  If no justification is found,
+	 *                output will be set to an empty list.
+	 *
+	 *  \param callbacks  Callbacks to invoke as the search progresses,
+	 *                    or \b null to invoke nothing.
+	 *
+	 *  \param canceled   If not \b NULL, the search gives up as soon
+	 *                    as this becomes nonzero.
+	 *
+	 *  \return true if a justification was found, false otherwise.
+	 */
+	bool next(std::vector<action> &output,
+		  const boost::shared_ptr<why_callbacks> &callbacks,
+		  const volatile int *canceled)
 	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = other.seen_packages[i];
-	}
-      first_iteration = other.first_iteration;
-      verbosity = other.verbosity;
-      return *this;
-    }
+	  why_callbacks * const callbacks_bare = callbacks.get();
+	  const bool trace_targets =
+	    callbacks_bare != NULL && callbacks_bare->traces_targets();
 
-    ~justification_search()
-    {
-      delete[] seen_packages;
-    }
+	  if(seen_packages.empty())
+	    seen_packages.resize((*apt_cache_file)->Head().PackageCount, false);
 
-    /** \brief Compute the next output of this search.
-     *
-     *  \param output a vector whose contents will be replaced with the
-     *                results of the search (expressed as a sequence
-     *                of actions in the order in which they were
-     *                performed).  If no justification is found,
-     *                output will be set to an empty list.
-     *
-     *  \param callbacks  Callbacks to invoke as the search progresses,
-     *                    or \b null to invoke nothing.
-     *
-     *  \return true if a justification was found, false otherwise.
-     */
-    bool next(std::vector<action> &output,
-              const boost::shared_ptr<why_callbacks> &callbacks)
-    {
-      why_callbacks * const callbacks_bare = callbacks.get();
+	  if(first_iteration)
+	    {
+	      if(callbacks_bare != NULL)
+		callbacks_bare->begin(params);
+	      first_iteration = false;
+	    }
 
+	  while(queue_front < nodes.size() &&
+		(canceled == NULL || *canceled == 0))
+	    {
+	      const int front = queue_front;
+	      ++queue_front;
 
-      std::vector<action> tmp;
-      bool reached_leaf = false;
+	      // Copied, since generating successors can reallocate the
+	      // node vector.
+	      const target front_target(nodes[front].get_target());
+	      const bool is_root = nodes[front].get_parent() < 0;
 
-      if(seen_packages == NULL)
-	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = false;
+	      if(trace_targets)
+		{
+		  std::vector<action> chain;
+		  search_node::get_chain(nodes, front, chain);
+		  callbacks_bare->start_target(front_target, chain);
+		}
+
+	      // If we visited this package already, skip it.  Otherwise,
+	      // flag it as visited.
+	      pkgCache::PkgIterator frontpkg = front_target.get_visited_package();
+	      std::vector<bool>::reference package_is_seen = seen_packages[frontpkg->ID];
+	      if(package_is_seen)
+		continue;
+	      // Don't flag the starting package as "seen", since we want
+	      // to be able to find self-loops.
+	      if(!is_root)
+		package_is_seen = true;
+
+	      // If we've stepped at least once, test whether the front
+	      // node is a leaf; if it is, return it and quit.
+	      //
+	      // Checking that we stepped at least once ensures that we
+	      // always return nontrivial answers (i.e., even if the target
+	      // of the search matches a leaf pattern, we'll keep looking
+	      // past it).
+	      pkgCache::VerIterator frontver = params.selected_version(frontpkg);
+	      if(!is_root && !frontver.end() &&
+		 leaves->is_leaf(frontpkg, frontver))
+		{
+		  search_node::get_chain(nodes, front, output);
+		  return true;
+		}
+
+	      // Since this isn't a leaf, add its successors to the queue
+	      // and carry on.
+	      front_target.generate_successors(front,
+					       nodes,
+					       params,
+					       verbosity,
+					       callbacks);
+	    }
+
+	  output.clear();
+	  return false;
 	}
+      };
 
-      if(first_iteration)
+      typedef aptitude::util::ordered_strategies<std::vector<action> > justification_strategies;
+
+      /** \brief Runs one of the search strategies of
+       *  find_best_justification().
+       */
+      class justification_strategy
+      {
+	const std::vector<search_params> *searches;
+	shared_ptr<leaf_matcher> leaves;
+	target goal;
+	int verbosity;
+	shared_ptr<why_callbacks> callbacks;
+
+      public:
+	justification_strategy(const std::vector<search_params> *_searches,
+			       const shared_ptr<leaf_matcher> &_leaves,
+			       const target &_goal,
+			       int _verbosity,
+			       const shared_ptr<why_callbacks> &_callbacks)
+	  : searches(_searches),
+	    leaves(_leaves),
+	    goal(_goal),
+	    verbosity(_verbosity),
+	    callbacks(_callbacks)
 	{
-          if(callbacks_bare != NULL)
-            callbacks_bare->begin(params);
-	  first_iteration = false;
 	}
 
-      while(!q.empty() && !reached_leaf)
+	void operator()(justification_strategies::context &c) const
 	{
-	  using cwidget::util::ref_ptr;
+	  justification_search search(leaves, goal, (*searches)[c.get_index()],
+				      verbosity);
+	  std::vector<action> results;
+	  while(search.next(results, callbacks, c.get_canceled_flag()))
+	    if(!c.add_result(results))
+	      return;
+	}
+      };
 
-	  // NB: could avoid this copy, but I'd have to move the
-	  // pop_front() into all execution branches.  Not worth it.
-	  const justification front(q.front());
-	  q.pop_front();
+      /** \brief Return the number of threads that
+       *  find_best_justification() should run its strategies on.
+       *
+       *  This is limited by the number of processors and by
+       *  Aptitude::Why-Threads.  Callbacks that aren't thread-safe force
+       *  the strategies to run one at a time.
+       */
+      int get_num_strategy_threads(int num_strategies,
+				   const shared_ptr<why_callbacks> &callbacks)
+      {
+	if(callbacks.get() != NULL && !callbacks->is_thread_safe())
+	  return 1;
 
+	long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_cpus < 1)
+	  num_cpus = 1;
 
-          if(callbacks_bare != NULL)
-            callbacks_bare->start_target(front.get_target(),
-                                         front.get_actions());
+	long max_threads = aptcfg->FindI(PACKAGE "::Why-Threads", 4);
+	if(max_threads < 1)
+	  max_threads = 1;
 
-	  // If we visited this package already, skip it.  Otherwise,
-	  // flag it as visited.
-	  pkgCache::PkgIterator frontpkg = front.get_target().get_visited_package();
-	  int frontid = frontpkg->ID;
-	  bool &package_is_seen = seen_packages[frontid];
-	  if(package_is_seen)
-	    continue;
-	  // Don't flag the starting package as "seen", since we want
-	  // to be able to find self-loops.
-	  if(!front.get_actions().empty())
-	    package_is_seen = true;
-
-	  // If we've stepped at least once, test whether the front
-	  // node is a leaf; if it is, return it and quit.
-	  //
-	  // Checking that we stepped at least once (verified by
-	  // checking whether we have any actions in our result list)
-	  // ensures that we always return nontrivial answers (i.e.,
-	  // even if the target of the search matches a leaf pattern,
-	  // we'll keep looking past it).
-	  pkgCache::VerIterator frontver = params.selected_version(frontpkg);
-	  if(!frontver.end() && !front.get_actions().empty())
-	    for(std::vector<ref_ptr<pattern> >::const_iterator it = leaves.begin();
-		!reached_leaf && it != leaves.end(); ++it)
-	      {
-		if(get_match((*it),
-			     frontpkg, frontver,
-			     search_info,
-			     *apt_cache_file,
-			     *apt_package_records).valid())
-		  reached_leaf = true;
-	      }
-	  if(reached_leaf)
-	    {
-	      tmp.insert(tmp.begin(),
-			 front.get_actions().begin(),
-			 front.get_actions().end());
-	    }
-	  else
-	    // Since this isn't a leaf, stick its successors on the
-	    // queue and carry on.
-	    front.generate_successors(q,
-                                      params,
-                                      verbosity,
-                                      callbacks);
-	}
+	long num_threads = std::min(num_cpus, max_threads);
+	num_threads = std::min(num_threads, static_cast<long>(num_strategies));
+	if(num_threads < 1)
+	  num_threads = 1;
 
-      output.swap(tmp);
-      return reached_leaf;
-    }
-  };
+	return num_threads;
+      }
     }
 
     bool find_justification(const target &target,
@@ -801,14 +909,15 @@ namespace aptitude
                             const boost::shared_ptr<why_callbacks> &callbacks,
 			    std::vector<std::vector<action> > &output)
     {
-      justification_search search(leaves, target, params, 0);
+      justification_search search(make_shared<leaf_matcher>(leaves),
+				  target, params, 0);
 
       std::vector<std::vector<action> > rval;
       std::vector<action> tmp;
 
       int i = 0;
 
-      while((i == 0 || find_all) && search.next(tmp, callbacks))
+      while((i == 0 || find_all) && search.next(tmp, callbacks, NULL))
 	{
 	  rval.push_back(std::vector<action>());
 	  rval.back().swap(tmp);
@@ -824,15 +933,8 @@ namespace aptitude
     }
 
 
-    void find_best_justification(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
-				 const target &goal,
-				 bool find_all,
-				 int verbosity,
-                                 const shared_ptr<why_callbacks> &callbacks,
-				 std::vector<std::vector<action> > &output)
+    void get_default_search_params(std::vector<search_params> &output)
     {
-      std::vector<search_params> searches;
-
       // The priority of searches goes like this:
       // (1) install version, depends only
       // (2) current version, depends only
@@ -840,55 +942,55 @@ namespace aptitude
       // (4) current version, recommends or depends
       // (5) install version, recommends or depends or suggests
       // (6) current version, recommends or depends or suggests
-      searches.push_back(search_params(search_params::Install,
-				       search_params::DependsOnly,
-				       false));
-      searches.push_back(search_params(search_params::Current,
-				       search_params::DependsOnly,
-				       false));
+      output.push_back(search_params(search_params::Install,
+				     search_params::DependsOnly,
+				     false));
+      output.push_back(search_params(search_params::Current,
+				     search_params::DependsOnly,
+				     false));
 
-      searches.push_back(search_params(search_params::Install,
-				       search_params::DependsOnly,
-				       true));
-      searches.push_back(search_params(search_params::Current,
-				       search_params::DependsOnly,
-				       true));
+      output.push_back(search_params(search_params::Install,
+				     search_params::DependsOnly,
+				     true));
+      output.push_back(search_params(search_params::Current,
+				     search_params::DependsOnly,
+				     true));
 
 
 
-      searches.push_back(search_params(search_params::Install,
-				       search_params::Recommends,
-				       false));
-      searches.push_back(search_params(search_params::Current,
-				       search_params::Recommends,
-				       false));
+      output.push_back(search_params(search_params::Install,
+				     search_params::Recommends,
+				     false));
+      output.push_back(search_params(search_params::Current,
+				     search_params::Recommends,
+				     false));
 
-      searches.push_back(search_params(search_params::Install,
-				       search_params::Recommends,
-				       true));
-      searches.push_back(search_params(search_params::Current,
-				       search_params::Recommends,
-				       true));
+      output.push_back(search_params(search_params::Install,
+				     search_params::Recommends,
+				     true));
+      output.push_back(search_params(search_params::Current,
+				     search_params::Recommends,
+				     true));
 
 
 
 
 
-      searches.push_back(search_params(search_params::Install,
-				       search_params::Suggests,
-				       false));
+      output.push_back(search_params(search_params::Install,
+				     search_params::Suggests,
+				     false));
 
-      searches.push_back(search_params(search_params::Current,
-				       search_params::Suggests,
-				       false));
+      output.push_back(search_params(search_params::Current,
+				     search_params::Suggests,
+				     false));
 
-      searches.push_back(search_params(search_params::Install,
-				       search_params::Suggests,
-				       true));
+      output.push_back(search_params(search_params::Install,
+				     search_params::Suggests,
+				     true));
 
-      searches.push_back(search_params(search_params::Current,
-				       search_params::Suggests,
-				       true));
+      output.push_back(search_params(search_params::Current,
+				     search_params::Suggests,
+				     true));
 
 
 
@@ -896,46 +998,68 @@ namespace aptitude
       // As a last-ditch thing, run searches against candidate versions.
       // We prefer *any* match that sticks to current/future installed versions
       // to this, though.
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::DependsOnly,
-				       false));
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::DependsOnly,
-				       true));
-
-
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::Recommends,
-				       false));
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::Recommends,
-				       true));
-
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::Suggests,
-				       false));
-      searches.push_back(search_params(search_params::Candidate,
-				       search_params::Suggests,
-				       true));
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::DependsOnly,
+				     false));
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::DependsOnly,
+				     true));
+
+
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::Recommends,
+				     false));
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::Recommends,
+				     true));
+
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::Suggests,
+				     false));
+      output.push_back(search_params(search_params::Candidate,
+				     search_params::Suggests,
+				     true));
+    }
 
+    void find_best_justification(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
+				 const target &goal,
+				 bool find_all,
+				 int verbosity,
+                                 const shared_ptr<why_callbacks> &callbacks,
+				 std::vector<std::vector<action> > &output)
+    {
+      std::vector<search_params> searches;
+      get_default_search_params(searches);
+
+      if(!output.empty() && !find_all)
+	return;
+
+      // Run the strategies, several at a time if possible.  A
+      // strategy that is weaker than one that has succeeded is
+      // canceled, and the results are combined below in order of
+      // preference, so the outcome is the same as running them one
+      // after another.
+      justification_strategies strategies(searches.size(), find_all);
+      strategies.run(justification_strategy(&searches,
+					    make_shared<leaf_matcher>(leaves),
+					    goal, verbosity, callbacks),
+		     get_num_strategy_threads(searches.size(), callbacks));
 
       // Throw out completely identical search results.  (note that this
       // might not perfectly eliminate results that appear identical if
       // multiple versions of something are available; needs more work to
       // do that)
       std::set<std::vector<action> > seen_results;
-      std::vector<action> results;
 
-      for(std::vector<search_params>::const_iterator it = searches.begin();
-	  it != searches.end(); ++it)
+      for(int i = 0; i < strategies.size(); ++i)
 	{
-	  if(!output.empty() && !find_all)
-	    return;
+	  const std::vector<std::vector<action> > &strategy_results(strategies.get_results(i));
 
-	  justification_search search(leaves, goal, *it, verbosity);
-
-	  while(search.next(results, callbacks))
+	  for(std::vector<std::vector<action> >::const_iterator resultsIt = strategy_results.begin();
+	      resultsIt != strategy_results.end(); ++resultsIt)
 	    {
+	      const std::vector<action> &results(*resultsIt);
+
 	      if(seen_results.find(results) != seen_results.end())
 		{
                   if(callbacks.get() != NULL)
@@ -955,6 +1079,289 @@ namespace aptitude
 	}
     }
 
+    /** \brief The links found by one forward search of a
+     *  justification_index.
+     *
+     *  The search has two kinds of nodes, like the backward search:
+     *  installing a package, and installing something that provides
+     *  a package name through a particular Provides.  Each node
+     *  remembers the link that it was first reached through.
+     */
+    class justification_index::level
+    {
+    public:
+      struct install_link
+      {
+	/** \brief The dependency whose source led here, or NULL. */
+	pkgCache::Dependency *dep;
+
+	/** \brief The Provides node that led here, or NULL. */
+	pkgCache::Provides *prv;
+
+	/** \brief \b true if the node was reached; a reached node
+	 *  with no link is a leaf.
+	 */
+	bool reached;
+
+	install_link()
+	  : dep(NULL), prv(NULL), reached(false)
+	{
+	}
+      };
+
+      /** \brief Indexed by package ID. */
+      std::vector<install_link> install_links;
+
+      /** \brief Indexed by Provides ID: the dependency that led to
+       *  the Provides, or NULL if it wasn't reached.
+       */
+      std::vector<pkgCache::Dependency *> provides_links;
+
+      level(unsigned long num_packages, unsigned long num_provides)
+	: install_links(num_packages),
+	  provides_links(num_provides, static_cast<pkgCache::Dependency *>(NULL))
+      {
+      }
+    };
+
+    namespace
+    {
+      // These mirror the tests in target::generate_successors(), for
+      // the forward direction.
+
+      /** \brief Return \b true if installing the target package of
+       *  \b dep is a successor of the dependency's source.
+       */
+      bool install_follows_dep(const pkgCache::DepIterator &dep,
+			       const search_params &params)
+      {
+	const pkgCache::PkgIterator pkg(const_cast<pkgCache::DepIterator &>(dep).TargetPkg());
+
+	if(params.get_only_not_current() &&
+	   (*apt_cache_file)[pkg].Status != 2)
+	  {
+	    pkgCache::VerIterator current = pkg.CurrentVer();
+	    if(!current.end() &&
+	       (dep.TargetVer() == NULL ||
+		_system->VS->CheckDep(current.VerStr(),
+				      dep->CompareOp,
+				      dep.TargetVer())))
+	      return false;
+	  }
+
+	if(dep.TargetVer() == NULL)
+	  return true;
+
+	pkgCache::VerIterator ver = params.selected_version(pkg);
+	return _system->VS->CheckDep(ver.end() ? "" : ver.VerStr(),
+				     dep->CompareOp,
+				     dep.TargetVer());
+      }
+
+      /** \brief Return \b true if installing the owner of \b prv is
+       *  a successor of the source of \b dep, which names the
+       *  provided package.
+       */
+      bool provides_follows_dep(const pkgCache::DepIterator &dep,
+				const pkgCache::PrvIterator &prv,
+				const search_params &params)
+      {
+	if(params.get_only_not_current())
+	  {
+	    pkgCache::VerIterator provider_current =
+	      const_cast<pkgCache::PrvIterator &>(prv).OwnerPkg().CurrentVer();
+
+	    if(!provider_current.end())
+	      for(pkgCache::PrvIterator current_prv = provider_current.ProvidesList();
+		  !current_prv.end(); ++current_prv)
+		{
+		  if(dep.TargetVer() == NULL ||
+		     (current_prv.ProvideVersion() != NULL &&
+		      _system->VS->CheckDep(current_prv.ProvideVersion(),
+					    dep->CompareOp,
+					    dep.TargetVer())))
+		    return false;
+		}
+	  }
+
+	return dep.TargetVer() == NULL ||
+	  (prv.ProvideVersion() != NULL &&
+	   _system->VS->CheckDep(prv.ProvideVersion(),
+				 dep->CompareOp,
+				 dep.TargetVer()));
+      }
+    }
+
+    justification_index::justification_index(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
+					     const std::vector<search_params> &params)
+    {
+      pkgCache &cache((*apt_cache_file)->GetCache());
+      const unsigned long num_packages = cache.Head().PackageCount;
+      const unsigned long num_provides = cache.Head().ProvidesCount;
+
+      best_level.resize(num_packages, -1);
+      leaf_packages.resize(num_packages, false);
+
+      leaf_matcher matcher(leaves);
+
+      // Install nodes are numbered by package ID and Provides nodes
+      // by num_packages plus the Provides ID.
+      std::deque<unsigned long> q;
+
+      for(std::vector<search_params>::const_iterator paramsIt = params.begin();
+	  paramsIt != params.end(); ++paramsIt)
+	{
+	  const search_params &p(*paramsIt);
+	  shared_ptr<level> l(make_shared<level>(num_packages, num_provides));
+
+	  for(pkgCache::PkgIterator pkg = cache.PkgBegin(); !pkg.end(); ++pkg)
+	    {
+	      pkgCache::VerIterator ver = p.selected_version(pkg);
+	      if(ver.end())
+		continue;
+
+	      if(matcher.is_leaf(pkg, ver))
+		{
+		  l->install_links[pkg->ID].reached = true;
+		  leaf_packages[pkg->ID] = true;
+		  q.push_back(pkg->ID);
+		}
+	    }
+
+	  while(!q.empty())
+	    {
+	      const unsigned long node = q.front();
+	      q.pop_front();
+
+	      if(node >= num_packages)
+		{
+		  // Installing something through a Provides installs
+		  // the package that owns it.
+		  pkgCache::PrvIterator prv(cache, cache.ProvideP + (node - num_packages),
+					    (pkgCache::Version *)0);
+		  level::install_link &link(l->install_links[prv.OwnerPkg()->ID]);
+		  if(!link.reached)
+		    {
+		      link.reached = true;
+		      link.prv = prv;
+		      q.push_back(prv.OwnerPkg()->ID);
+		    }
+
+		  continue;
+		}
+
+	      pkgCache::PkgIterator pkg(cache, cache.PkgP + node);
+	      pkgCache::VerIterator ver = p.selected_version(pkg);
+	      if(ver.end())
+		continue;
+
+	      for(pkgCache::DepIterator dep = ver.DependsList(); !dep.end(); ++dep)
+		{
+		  if(is_conflict(dep->Type) || !p.should_follow_dep(dep))
+		    continue;
+
+		  if(!p.get_allow_choices())
+		    {
+		      if(dep->CompareOp & pkgCache::Dep::Or)
+			continue;
+
+		      pkgCache::DepIterator start, end;
+		      surrounding_or(dep, start, end);
+		      if(start != dep)
+			continue;
+		    }
+
+		  pkgCache::PkgIterator target = dep.TargetPkg();
+		  level::install_link &link(l->install_links[target->ID]);
+		  if(!link.reached && install_follows_dep(dep, p))
+		    {
+		      link.reached = true;
+		      link.dep = dep;
+		      q.push_back(target->ID);
+		    }
+
+		  // Provides are choices, like ORs.
+		  if(!p.get_allow_choices())
+		    continue;
+
+		  for(pkgCache::PrvIterator prv = target.ProvidesList(); !prv.end(); ++prv)
+		    {
+		      pkgCache::Dependency *&prv_link(l->provides_links[prv->ID]);
+		      if(prv_link != NULL ||
+			 prv.OwnerVer() != p.selected_version(prv.OwnerPkg()) ||
+			 !provides_follows_dep(dep, prv, p))
+			continue;
+
+		      prv_link = dep;
+		      q.push_back(num_packages + prv->ID);
+		    }
+		}
+	    }
+
+	  bool reached_new_package = false;
+	  for(unsigned long id = 0; id < num_packages; ++id)
+	    if(best_level[id] < 0 && l->install_links[id].reached)
+	      {
+		best_level[id] = levels.size();
+		reached_new_package = true;
+	      }
+
+	  // Keep the links only if some package will be explained
+	  // with them.
+	  if(reached_new_package)
+	    levels.push_back(l);
+	  else
+	    levels.push_back(shared_ptr<level>());
+	}
+    }
+
+    justification_index::~justification_index()
+    {
+    }
+
+    bool justification_index::is_leaf(const pkgCache::PkgIterator &pkg) const
+    {
+      return pkg->ID < leaf_packages.size() && leaf_packages[pkg->ID];
+    }
+
+    bool justification_index::get_justification(const pkgCache::PkgIterator &pkg,
+						 std::vector<action> &output) const
+    {
+      output.clear();
+
+      if(pkg->ID >= best_level.size() || best_level[pkg->ID] < 0 || is_leaf(pkg))
+	return false;
+
+      pkgCache &cache((*apt_cache_file)->GetCache());
+      const level &l(*levels[best_level[pkg->ID]]);
+
+      // Walk back to the leaf.  Actions are numbered from the
+      // target, as in a backward search.
+      std::vector<action> chain;
+      const level::install_link *link = &l.install_links[pkg->ID];
+      while(link->dep != NULL || link->prv != NULL)
+	{
+	  if(link->prv != NULL)
+	    {
+	      pkgCache::PrvIterator prv(cache, link->prv, (pkgCache::Version *)0);
+	      chain.push_back(action(prv, chain.size()));
+
+	      pkgCache::DepIterator dep(cache, l.provides_links[prv->ID]);
+	      chain.push_back(action(dep, chain.size()));
+	      link = &l.install_links[dep.ParentPkg()->ID];
+	    }
+	  else
+	    {
+	      pkgCache::DepIterator dep(cache, link->dep);
+	      chain.push_back(action(dep, chain.size()));
+	      link = &l.install_links[dep.ParentPkg()->ID];
+	    }
+	}
+
+      output.assign(chain.rbegin(), chain.rend());
+      return true;
+    }
+
     namespace
     {
       cw::fragment *render_reason_columns(const std::vector<std::vector<action> > &solutions,
@@ -1139,8 +1546,19 @@ namespace aptitude
                                   params.description().c_str());
         }
 
+        bool traces_targets() const
+        {
+          return verbosity > 1;
+        }
+
+        // Nothing is printed unless the verbosity is above 1.
+        bool is_thread_safe() const
+        {
+          return verbosity <= 1;
+        }
+
         void start_target(const target &target,
-                          const imm::set<action> &actions)
+                          const std::vector<action> &actions)
         {
           if(verbosity > 1)
             {
@@ -1165,6 +1583,82 @@ namespace aptitude
   }
 }
 
+namespace
+{
+  /** \brief Render the justifications found for \b root for
+   *  display.
+   *
+   *  \param success  set to \b false if \b solutions is empty.
+   */
+  cw::fragment *render_why(const std::vector<std::vector<aptitude::why::action> > &solutions,
+			   const pkgCache::PkgIterator &root,
+			   aptitude::why::roots_string_mode display_mode,
+			   int verbosity,
+			   bool root_is_removal,
+			   bool &success)
+  {
+    using namespace aptitude::why;
+
+    success = true;
+
+    if(solutions.empty())
+      {
+	success = false;
+
+	if(root_is_removal)
+	  return cw::fragf(_("Unable to find a reason to remove %s.\n"), root.FullName(true).c_str());
+	else
+	  return cw::fragf(_("Unable to find a reason to install %s.\n"), root.FullName(true).c_str());
+      }
+    else if(display_mode == aptitude::why::no_summary)
+      return render_reason_columns(solutions, verbosity >= 1);
+    else
+      {
+	// HACK: drop all chains that include a dependency that's less
+	// strict than Recommends.  (ideally we should let the user set
+	// a level of strictness and conform to that here AND in the
+	// search, rather than generating a lot of junk we then throw
+	// away)
+	std::vector<std::vector<action> > strong_solutions;
+	for(std::vector<std::vector<action> >::const_iterator it = solutions.begin();
+	    it != solutions.end(); ++it)
+	  {
+	    bool keeper = true;
+	    for(std::vector<action>::const_iterator act_it = it->begin();
+		keeper && act_it != it->end(); ++act_it)
+	      {
+		if(!act_it->get_dep().end())
+		  {
+		    pkgCache::Dep::DepType type = (pkgCache::Dep::DepType)act_it->get_dep()->Type;
+
+		    if(!(type == pkgCache::Dep::Depends ||
+			 type == pkgCache::Dep::PreDepends ||
+			 type == pkgCache::Dep::Recommends ||
+			 type == pkgCache::Dep::Conflicts))
+		      keeper = false;
+		  }
+	      }
+
+	    if(keeper)
+	      strong_solutions.push_back(*it);
+	  }
+
+	std::vector<std::string> lines;
+	aptitude::why::summarize_reasons(strong_solutions, display_mode, lines);
+
+	std::vector<cw::fragment *> fragments;
+	fragments.push_back(cw::fragf(_("Packages requiring %s:"), root.FullName(true).c_str()));
+	fragments.push_back(cw::newline_fragment());
+
+	for(std::vector<std::string>::const_iterator it = lines.begin();
+	    it != lines.end(); ++it)
+	  fragments.push_back(cw::fragf("  %s\n", it->c_str()));
+
+	return sequence_fragment(fragments);
+      }
+  }
+}
+
 cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
 		 const pkgCache::PkgIterator &root,
 		     aptitude::why::roots_string_mode display_mode,
@@ -1175,8 +1669,6 @@ cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves
 {
   using namespace aptitude::why;
 
-  success = true;
-
   std::vector<std::vector<action> > solutions;
   target goal = root_is_removal ? target::Remove(root) : target::Install(root);
 
@@ -1186,61 +1678,8 @@ cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves
                           callbacks,
 			  solutions);
 
-  if(solutions.empty())
-    {
-      success = false;
-
-      if(root_is_removal)
-	return cw::fragf(_("Unable to find a reason to remove %s.\n"), root.FullName(true).c_str());
-      else
-	return cw::fragf(_("Unable to find a reason to install %s.\n"), root.FullName(true).c_str());
-    }
-  else if(display_mode == aptitude::why::no_summary)
-    return render_reason_columns(solutions, verbosity >= 1);
-  else
-    {
-      // HACK: drop all chains that include a dependency that's less
-      // strict than Recommends.  (ideally we should let the user set
-      // a level of strictness and conform to that here AND in the
-      // search, rather than generating a lot of junk we then throw
-      // away)
-      std::vector<std::vector<action> > strong_solutions;
-      for(std::vector<std::vector<action> >::const_iterator it = solutions.begin();
-	  it != solutions.end(); ++it)
-	{
-	  bool keeper = true;
-	  for(std::vector<action>::const_iterator act_it = it->begin();
-	      keeper && act_it != it->end(); ++act_it)
-	    {
-	      if(!act_it->get_dep().end())
-		{
-		  pkgCache::Dep::DepType type = (pkgCache::Dep::DepType)act_it->get_dep()->Type;
-
-		  if(!(type == pkgCache::Dep::Depends ||
-		       type == pkgCache::Dep::PreDepends ||
-		       type == pkgCache::Dep::Recommends ||
-		       type == pkgCache::Dep::Conflicts))
-		    keeper = false;
-		}
-	    }
-
-	  if(keeper)
-	    strong_solutions.push_back(*it);
-	}
-
-      std::vector<std::string> lines;
-      aptitude::why::summarize_reasons(strong_solutions, display_mode, lines);
-
-      std::vector<cw::fragment *> fragments;
-      fragments.push_back(cw::fragf(_("Packages requiring %s:"), root.FullName(true).c_str()));
-      fragments.push_back(cw::newline_fragment());
-
-      for(std::vector<std::string>::const_iterator it = lines.begin();
-	  it != lines.end(); ++it)
-	fragments.push_back(cw::fragf("  %s\n", it->c_str()));
-
-      return sequence_fragment(fragments);
-    }
+  return render_why(solutions, root, display_mode, verbosity,
+		    root_is_removal, success);
 }
 
 int do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
@@ -1253,6 +1692,30 @@ int do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
   bool success = false;
   const shared_ptr<why_callbacks> callbacks =
     make_cmdline_why_callbacks(verbosity, term_metrics);
+
+  if(aptitude::cmdline::want_json_output())
+    {
+      std::vector<std::vector<aptitude::why::action> > solutions;
+      const aptitude::why::target goal =
+        root_is_removal
+          ? aptitude::why::target::Remove(root)
+          : aptitude::why::target::Install(root);
+
+      aptitude::why::find_best_justification(leaves, goal,
+                                             verbosity >= 1,
+                                             verbosity,
+                                             callbacks,
+                                             solutions);
+
+      // Each chain is written as soon as the search is done, without
+      // going through the fragment layout.
+      for(std::vector<std::vector<aptitude::why::action> >::const_iterator it =
+            solutions.begin(); it != solutions.end(); ++it)
+        write_why_json(root, root_is_removal, *it);
+
+      return solutions.empty() ? 1 : 0;
+    }
+
   std::auto_ptr<cw::fragment> f(do_why(leaves, root, display_mode,
 				       verbosity, root_is_removal,
 				       callbacks,
@@ -1264,6 +1727,78 @@ int do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
   return success ? 0 : 1;
 }
 
+namespace
+{
+  /** \brief Explain the installation of every package that matches
+   *  \b targets, using one justification_index for all of them.
+   *
+   *  Only the best justification of each package is shown, whatever
+   *  the verbosity.
+   *
+   *  \return 0 if every package could be explained, 1 otherwise.
+   */
+  int do_why_all(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
+		 const cwidget::util::ref_ptr<pattern> &targets,
+		 aptitude::why::roots_string_mode display_mode,
+		 int verbosity,
+		 const shared_ptr<terminal_metrics> &term_metrics)
+  {
+    using namespace aptitude::why;
+
+    std::vector<std::pair<pkgCache::PkgIterator, cwidget::util::ref_ptr<structural_match> > > matches;
+    aptitude::matching::search(targets, search_cache::create(),
+			       matches,
+			       *apt_cache_file,
+			       *apt_package_records);
+
+    std::vector<search_params> params;
+    get_default_search_params(params);
+    const justification_index index(leaves, params);
+
+    const shared_ptr<why_callbacks> callbacks =
+      make_cmdline_why_callbacks(verbosity, term_metrics);
+    const unsigned int screen_width = term_metrics->get_screen_width();
+    const bool json = aptitude::cmdline::want_json_output();
+
+    bool all_explained = true;
+    std::vector<std::vector<action> > solutions;
+    std::vector<action> chain;
+    for(std::vector<std::pair<pkgCache::PkgIterator, cwidget::util::ref_ptr<structural_match> > >::const_iterator
+	  it = matches.begin(); it != matches.end(); ++it)
+      {
+	const pkgCache::PkgIterator &pkg(it->first);
+
+	solutions.clear();
+	// The index doesn't hold chains that lead from one leaf to
+	// another, so search for those separately.
+	if(index.is_leaf(pkg))
+	  find_best_justification(leaves, target::Install(pkg),
+				  false, verbosity, callbacks, solutions);
+	else if(index.get_justification(pkg, chain))
+	  solutions.push_back(chain);
+
+	if(solutions.empty())
+	  all_explained = false;
+
+	if(json)
+	  {
+	    for(std::vector<std::vector<action> >::const_iterator solutionIt =
+		  solutions.begin(); solutionIt != solutions.end(); ++solutionIt)
+	      write_why_json(pkg, false, *solutionIt);
+	  }
+	else
+	  {
+	    bool success;
+	    std::auto_ptr<cw::fragment> f(render_why(solutions, pkg, display_mode,
+						     0, false, success));
+	    std::cout << f->layout(screen_width, screen_width, cw::style());
+	  }
+      }
+
+    return all_explained ? 0 : 1;
+  }
+}
+
 cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves,
 		 const pkgCache::PkgIterator &root,
 		     aptitude::why::roots_string_mode display_mode,
@@ -1385,11 +1920,24 @@ int cmdline_why(int argc, char *argv[],
 
   const char *pkgname = argv[argc - 1];
   bool is_removal = is_why_not;
-  pkgCache::PkgIterator pkg = (*apt_cache_file)->FindPkg(argv[argc - 1]);
-  if(pkg.end())
+  pkgCache::PkgIterator pkg;
+  // A pattern in place of the package asks for an explanation of
+  // every package that it matches.
+  cwidget::util::ref_ptr<pattern> targets;
+  if(!is_why_not && aptitude::matching::is_pattern(pkgname))
+    {
+      targets = parse(pkgname);
+      if(!targets.valid())
+	parsing_arguments_failed = true;
+    }
+  else
     {
-      _error->Error(_("No package named \"%s\" exists."), pkgname);
-      parsing_arguments_failed = true;
+      pkg = (*apt_cache_file)->FindPkg(pkgname);
+      if(pkg.end())
+	{
+	  _error->Error(_("No package named \"%s\" exists."), pkgname);
+	  parsing_arguments_failed = true;
+	}
     }
 
   std::vector<std::string> arguments;
@@ -1417,6 +1965,12 @@ int cmdline_why(int argc, char *argv[],
   int rval;
   if(parsing_arguments_failed)
     rval = -1;
+  else if(targets.valid())
+    rval = do_why_all(matchers,
+		      targets,
+		      display_mode,
+		      verbosity,
+		      term);
   else
     rval = do_why(matchers,
                   pkg,
@@ -27,8 +27,6 @@
 #include <generic/apt/aptcache.h>
 #include <generic/apt/matching/pattern.h>
 
-#include <generic/util/immset.h>
-
 
 // System includes:
 #include <apt-pkg/depcache.h>
@@ -85,6 +83,10 @@ namespace aptitude
  *    --> Equivalent to aptitude why ~i!~M B
  *  aptitude why-not B
  *    --> Equivalent to aptitude why-not ~i!~M B
+ *  aptitude why [A1 ...] P
+ *    --> If P is a pattern, show the best justification for
+ *        installing each package that matches it, using a
+ *        justification_index.
  *
  *  If -v is passed on the command-line, aptitude displays all the
  *  justifications it can find, rather than stopping at the shortest
@@ -115,7 +117,7 @@ namespace aptitude
   {
     class why_callbacks;
 
-    class justification;
+    class search_node;
 
     class search_params
     {
@@ -345,23 +347,27 @@ namespace aptitude
 
       cwidget::fragment *description() const;
 
-      /** \brief Push the successors of this target onto the head of a queue.
+      /** \brief Append the successors of this target to the nodes of
+       *  a search.
        *
        *  This is mainly used by the "why" algorithm itself.
        *
        *  The successors of a node are the actions that could have generated
        *  it (installing this package, installing this provides).
        *
-       *  \param parent the parent of any new search nodes that are generated.
-       *  \param output the queue onto which the successors should be loaded.
+       *  \param parent the index in \b nodes of the node whose
+       *                successors should be generated.
+       *  \param nodes  the nodes of the search; the successors are
+       *                appended to it.  Since this may reallocate the
+       *                vector, this target must not be stored in it.
        *  \param params the parameters of the search (these control
        *                which dependencies get followed).
        *  \param callbacks  an object used to inform the caller about the
        *                    progress of the "why" algorithm.  If NULL, no
        *                    callbacks will be invoked.
        */
-      void generate_successors(const justification &parent,
-			       std::deque<justification> &output,
+      void generate_successors(int parent,
+			       std::vector<search_node> &nodes,
 			       const search_params &params,
 			       int verbosity,
                                const boost::shared_ptr<why_callbacks> &callbacks) const;
@@ -420,6 +426,89 @@ namespace aptitude
       bool operator<(const action &other) const;
     };
 
+    /** \brief One node of a "why" search.
+     *
+     *  A search stores its nodes in a single vector, in the order
+     *  that they are generated.  Each node holds only the action that
+     *  led to it and the index of the node that it was generated
+     *  from; the whole chain of actions is only built, by
+     *  get_chain(), for the nodes that the search returns.
+     */
+    class search_node
+    {
+      target the_target;
+      pkgCache::DepIterator dep;
+      pkgCache::PrvIterator prv;
+      int parent;
+      int depth;
+
+    public:
+      /** \brief Create the root node of a search. */
+      explicit search_node(const target &_the_target)
+	: the_target(_the_target), parent(-1), depth(0)
+      {
+      }
+
+      /** \brief Create a node that is reached from node \b _parent
+       *  by following a dependency.
+       */
+      search_node(const target &_the_target,
+		  const pkgCache::DepIterator &_dep,
+		  int _parent, int _depth)
+	: the_target(_the_target), dep(_dep),
+	  parent(_parent), depth(_depth)
+      {
+      }
+
+      /** \brief Create a node that is reached from node \b _parent
+       *  by following a Provides.
+       */
+      search_node(const target &_the_target,
+		  const pkgCache::PrvIterator &_prv,
+		  int _parent, int _depth)
+	: the_target(_the_target), prv(_prv),
+	  parent(_parent), depth(_depth)
+      {
+      }
+
+      const target &get_target() const { return the_target; }
+
+      /** \return the index of the node that this node was generated
+       *  from, or -1 if this is the root of the search.
+       */
+      int get_parent() const { return parent; }
+
+      /** \return the number of actions between the root of the
+       *  search and this node.
+       */
+      int get_depth() const { return depth; }
+
+      /** \return the action that led to this node.  Must not be
+       *  invoked on the root.
+       */
+      action get_action() const
+      {
+	if(!dep.end())
+	  return action(dep, depth - 1);
+	else
+	  return action(prv, depth - 1);
+      }
+
+      /** \brief Retrieve the actions leading from the root of a
+       *  search to one of its nodes.
+       *
+       *  \param nodes   the nodes of the search.
+       *  \param index   the index of the node in \b nodes.
+       *  \param output  a vector whose contents will be replaced by
+       *                 the actions, in the order in which they were
+       *                 performed (the action furthest from the root
+       *                 first).
+       */
+      static void get_chain(const std::vector<search_node> &nodes,
+			    int index,
+			    std::vector<action> &output);
+    };
+
     /** \brief Collects the callbacks that are used to trace out the
      *  progress of a "why" search.
      *
@@ -479,11 +568,28 @@ namespace aptitude
       /** \brief Invoked when "why" starts working. */
       virtual void begin(const search_params &params) = 0;
 
+      /** \brief Return \b false if start_target() does nothing, so
+       *  that the search can skip building the chain it would be
+       *  passed.
+       */
+      virtual bool traces_targets() const { return true; }
+
+      /** \brief Return \b true if these callbacks can be invoked
+       *  from several threads at once.
+       *
+       *  If this returns \b false, find_best_justification() runs
+       *  its searches one at a time.
+       */
+      virtual bool is_thread_safe() const { return false; }
+
       /** \brief Invoked when "why" starts trying to justify a single
        *  target.
+       *
+       *  \param actions  the actions leading to \b t, as returned by
+       *                  search_node::get_chain().
        */
       virtual void start_target(const target &t,
-                                const imm::set<action> &actions) = 0;
+                                const std::vector<action> &actions) = 0;
     };
 
     /** \brief Create a why_callbacks object suitable for use in the
@@ -540,6 +646,82 @@ namespace aptitude
 				 int verbosity,
                                  const boost::shared_ptr<why_callbacks> &callbacks,
 				 std::vector<std::vector<action> > &output);
+
+    /** \brief Retrieve the search parameters that
+     *  find_best_justification() tries, most preferred first.
+     */
+    void get_default_search_params(std::vector<search_params> &output);
+
+    /** \brief The best justification for installing every package,
+     *  computed all at once.
+     *
+     *  find_best_justification() searches backwards from a single
+     *  target until it reaches a leaf, once for each set of
+     *  parameters.  This index instead searches forwards from every
+     *  leaf at once, once for each set of parameters, and remembers
+     *  the link through which each package was first reached.  The
+     *  justification for a package is read off by following those
+     *  links back to a leaf, so explaining every package on a
+     *  system costs one pass per set of parameters instead of one
+     *  search per package.
+     *
+     *  Only installations are indexed.  A chain read from the index
+     *  is as strong and as short as the first chain that
+     *  find_best_justification() would find, but when several chains
+     *  tie, the two may pick different ones.
+     */
+    class justification_index
+    {
+      class level;
+
+      // The links found with each set of parameters, in order of
+      // preference; NULL for a set of parameters that didn't reach
+      // any package that an earlier one missed.
+      std::vector<boost::shared_ptr<level> > levels;
+
+      // Indexed by package ID: the first entry of levels that
+      // reached the package, or -1 if none did.
+      std::vector<int> best_level;
+
+      // Indexed by package ID: true if the package matched a leaf
+      // pattern under some set of parameters.
+      std::vector<bool> leaf_packages;
+
+    public:
+      /** \brief Build the index.
+       *
+       *  \param leaves  patterns selecting the packages that
+       *                 justifications start from.
+       *  \param params  the parameters to search with, most
+       *                 preferred first.
+       */
+      justification_index(const std::vector<cwidget::util::ref_ptr<aptitude::matching::pattern> > &leaves,
+			   const std::vector<search_params> &params);
+
+      ~justification_index();
+
+      /** \brief Return \b true if the given package is itself a
+       *  leaf.
+       *
+       *  Leaves are where justifications start, so the index holds
+       *  nothing for them; use find_best_justification() to look
+       *  for a chain that reaches a leaf from another leaf.
+       */
+      bool is_leaf(const pkgCache::PkgIterator &pkg) const;
+
+      /** \brief Look up the justification for installing a package.
+       *
+       *  \param pkg     the package to explain.
+       *  \param output  set to the chain of actions, starting at a
+       *                 leaf, in the same order that
+       *                 find_best_justification() uses.
+       *
+       *  \return \b false if no justification was found or if \b
+       *  pkg is a leaf.
+       */
+      bool get_justification(const pkgCache::PkgIterator &pkg,
+			     std::vector<action> &output) const;
+    };
   }
 }
 
@@ -131,6 +131,29 @@ namespace aptitude
                   cursor_position = 0;
                   break;
 
+                case '\b':
+                  // Move back one cell.  This can leave the cursor in
+                  // the middle of a wide character; in that case
+                  // cursor_idx points at the wide character.
+                  if(cursor_position > 0)
+                    {
+                      --cursor_position;
+
+                      cursor_idx = 0;
+                      unsigned int column = 0;
+                      while(cursor_idx < new_last_line.size())
+                        {
+                          const unsigned int next_column =
+                            column + safe_wcwidth(new_last_line[cursor_idx]);
+                          if(next_column > cursor_position)
+                            break;
+
+                          column = next_column;
+                          ++cursor_idx;
+                        }
+                    }
+                  break;
+
                 default:
                   {
                     const int c_width = safe_wcwidth(c);
@@ -162,7 +185,8 @@ namespace aptitude
                             // we start writing in the middle of a
                             // character, since that can't happen (since
                             // the cursor starts at the left and only
-                            // moves via writes).
+                            // moves via writes or by backing up over
+                            // whole characters).
                             int chars_to_replace = 0;
                             int replaced_width = 0;
 
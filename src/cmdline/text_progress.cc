@@ -22,6 +22,7 @@
 #include "text_progress.h"
 
 #include "cmdline_progress_display.h"
+#include "cmdline_progress_records.h"
 
 #include <aptitude.h>
 
@@ -105,7 +106,11 @@ namespace aptitude
 
       void text_progress::Update()
       {
-        if(CheckChange(0.7))
+        // The display throttles its own redraws and draws the last
+        // update it held back, so pass every change along.  (An
+        // interval of 0 would make CheckChange() ignore changes to
+        // the percentage.)
+        if(CheckChange(0.001))
           {
             if(!use_tty_decorations)
               {
@@ -136,7 +141,9 @@ namespace aptitude
       bool hide_tty_decorations = false;
       bool hidden = false;
 
-      if(!isatty(1) ||
+      // Progress records are written through the display, just like
+      // the terminal decorations are.
+      if((!isatty(1) && !get_use_progress_records()) ||
          aptcfg->FindI("quiet", 0) >= 1 ||
          aptcfg->FindB("quiet::NoUpdate", false) == true)
         hide_tty_decorations = true;
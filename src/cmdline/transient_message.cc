@@ -28,8 +28,10 @@
 // System includes:
 #include <boost/make_shared.hpp>
 
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/generic/util/transcode.h>
 
+#include <algorithm>
 #include <iostream>
 
 using boost::make_shared;
@@ -78,9 +80,13 @@ namespace aptitude
         // bytes.
         std::size_t last_line_len;
 
-        // The last string we displayed.
+        // The last string we were asked to display.
         std::wstring last_line;
 
+        // The part of last_line that actually fit on the terminal.
+        // The cursor is always left just after it.
+        std::wstring last_display;
+
         // The locale to be used with that terminal.
         shared_ptr<terminal_locale> term_locale;
 
@@ -90,8 +96,15 @@ namespace aptitude
         // The terminal output object used to display this message.
         shared_ptr<terminal_output> term_output;
 
+        // Throttled progress displays redraw from a background
+        // thread, so keep their writes from interleaving with ours.
+        cwidget::threads::mutex output_mutex;
+
         void clear_last_line();
 
+        int string_width(std::wstring::const_iterator begin,
+                         std::wstring::const_iterator end) const;
+
       public:
         transient_message_impl(const shared_ptr<terminal_locale> &_term_locale,
                                const shared_ptr<terminal_metrics> &_term_metrics,
@@ -118,10 +131,13 @@ namespace aptitude
         term_output->move_to_beginning_of_line();
 
         last_line_len = 0;
+        last_display.clear();
       }
 
       void transient_message_impl::set_text(const std::wstring &line)
       {
+        cwidget::threads::mutex::lock l(output_mutex);
+
         if(last_line == line)
           // Don't clutter the terminal stream if there's nothing to
           // do.
@@ -159,21 +175,98 @@ namespace aptitude
         }
         const std::wstring display(line.begin(), display_end);
 
-        clear_last_line();
-        term_output->write_text(display);
+        // Find the part of the previous text that is still correct.
+        // Progress lines usually change only near their end (the
+        // percentage or the download rate), so rewriting just the
+        // changed suffix is much cheaper than redrawing the whole
+        // line on a slow terminal.
+        std::wstring::size_type prefix_len = 0;
+        while(prefix_len < display.size() &&
+              prefix_len < last_display.size() &&
+              display[prefix_len] == last_display[prefix_len])
+          ++prefix_len;
+
+        // Don't split a combining character from the character it
+        // modifies.
+        while(prefix_len > 0 &&
+              ((prefix_len < display.size() &&
+                term_locale->wcwidth(display[prefix_len]) <= 0) ||
+               (prefix_len < last_display.size() &&
+                term_locale->wcwidth(last_display[prefix_len]) <= 0)))
+          --prefix_len;
+
+        const std::wstring::const_iterator suffix_begin =
+          display.begin() + prefix_len;
+        const int prefix_width = string_width(display.begin(), suffix_begin);
+        const int old_suffix_width = static_cast<int>(last_line_len) - prefix_width;
+        const int new_suffix_width = static_cast<int>(display_width) - prefix_width;
+        const int padding = std::max(0, old_suffix_width - new_suffix_width);
+
+        // Backing up with '\b' is only safe while the cursor hasn't
+        // reached the last column; most terminals defer wrapping
+        // there and treat backspace inconsistently.
+        const bool can_back_up =
+          last_line_len < screen_width && display_width < screen_width;
+
+        std::wstring output;
+        if(!can_back_up)
+          {
+            clear_last_line();
+            output = display;
+          }
+        else
+          {
+            if(!last_display.empty() &&
+               old_suffix_width + (display.end() - suffix_begin) <
+               1 + static_cast<int>(display.size()))
+              {
+                output.append(old_suffix_width, L'\b');
+                output.append(suffix_begin, display.end());
+              }
+            else
+              {
+                term_output->move_to_beginning_of_line();
+                output = display;
+              }
+
+            // Blank out whatever is left of the old text, then return
+            // to the end of the new text.
+            output.append(padding, L' ');
+            output.append(padding, L'\b');
+          }
+
+        term_output->write_text(output);
         term_output->flush();
         last_line_len = display_width;
         last_line = line;
+        last_display = display;
+      }
+
+      int transient_message_impl::string_width(std::wstring::const_iterator begin,
+                                               std::wstring::const_iterator end) const
+      {
+        int rval = 0;
+        for(std::wstring::const_iterator it = begin; it != end; ++it)
+          {
+            const int width = term_locale->wcwidth(*it);
+            if(width > 0)
+              rval += width;
+          }
+
+        return rval;
       }
 
       void transient_message_impl::display_and_advance(const std::wstring &msg)
       {
+        cwidget::threads::mutex::lock l(output_mutex);
+
         clear_last_line();
         term_output->write_text(msg);
         term_output->write_text(L"\n");
 
         last_line_len = 0;
         last_line.clear();
+        last_display.clear();
       }
     }
 
@@ -50,6 +50,13 @@ class pkg_depitem:public pkg_subtree
 
   bool is_broken();
   // Returns true if the dependency should be displayed as a broken dependency
+protected:
+  // select() is special, so a parent must not apply it to the
+  // targets directly.
+  bool collect_leaf_packages(std::vector<pkgCache::Package *> &out)
+  {
+    return false;
+  }
 public:
   pkg_depitem(pkgCache::DepIterator &_first, pkg_signal *_sig);
 
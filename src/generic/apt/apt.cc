@@ -32,11 +32,13 @@
 #include "rev_dep_iterator.h"
 #include "tags.h"
 #include "tasks.h"
+#include "version_sources.h"
 
 #include <cwidget/generic/util/eassert.h>
 #include <cwidget/generic/util/transcode.h>
 
 #include <generic/util/file_cache.h>
+#include <generic/util/perf_stats.h>
 #include <generic/util/util.h>
 
 #include <generic/util/undo.h>
@@ -58,6 +60,7 @@
 
 using namespace std;
 using aptitude::Loggers;
+namespace stats = aptitude::util::stats;
 
 namespace cw = cwidget;
 
@@ -85,6 +88,8 @@ sigc::signal0<void> cache_closed, cache_reloaded, cache_reload_failed;
 sigc::signal0<void> hier_reloaded;
 sigc::signal0<void> consume_errors;
 
+static stats::timer load_cache_timer("cache.load");
+
 static void reset_interesting_dep_memoization()
 {
   delete[] cached_deps_interesting;
@@ -235,6 +240,8 @@ void apt_preinit(const char *rootdir)
 
   cache_closed.connect(sigc::ptr_fun(&reset_surrounding_or_memoization));
 
+  cache_closed.connect(sigc::ptr_fun(&aptitude::apt::reset_version_sources));
+
   apt_dumpcfg(PACKAGE);
 
   apt_undos=new undo_list;
@@ -401,6 +408,7 @@ void apt_load_cache(OpProgress *progress_bar, bool do_initselections,
 		    const char * status_fname)
 {
   logging::LoggerPtr logger(Loggers::getAptitudeAptGlobals());
+  stats::scoped_timer load_cache_timing(load_cache_timer);
 
   if(apt_cache_file != NULL)
     {
@@ -169,43 +169,6 @@ void forget_new();
 extern undo_list *apt_undos;
 // There's a global undo stack for apt actions, to keep things sane..
 
-/** \brief Represents a package's logical state.
- *
- *  find_pkg_state computes this value.
- */
-enum pkg_action_state
-  {
-    /** \brief No action is being performed on the package. */
-    pkg_unchanged=-1,
-    /** \brief The package has broken dependencies. */
-    pkg_broken,
-    /** \brief The package is unused and will be removed. */
-    pkg_unused_remove,
-    /** \brief The package was automatically held on the system. */
-    pkg_auto_hold,
-    /** \brief The package is being installed to fulfill dependencies. */
-    pkg_auto_install,
-    /** \brief The package is being removed to fulfill dependencies. */
-    pkg_auto_remove,
-    /** \brief The package is being downgraded. */
-    pkg_downgrade,
-    /** \brief The package is held back. */
-    pkg_hold,
-    /** \brief The package is being reinstalled. */
-    pkg_reinstall,
-    /** \brief The package is being installed. */
-    pkg_install,
-    /** \brief The package is being removed. */
-    pkg_remove,
-    /** \brief The package is being upgraded. */
-    pkg_upgrade,
-    /** \brief The package is installed but not configured. */
-    pkg_unconfigured
-  };
-/** \brief The number of package action states, not counting
- *  pkg_unchanged.
- */
-const int num_pkg_action_states=12;
 /** \brief Compute the action state of a package.
  *
  *  \param pkg   The package whose state is to be computed.
@@ -30,6 +30,7 @@
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 #include <generic/problemresolver/solution.h>
+#include <generic/util/perf_stats.h>
 #include <generic/util/undo.h>
 
 #include <apt-pkg/error.h>
@@ -43,6 +44,7 @@
 #include <apt-pkg/policy.h>
 #include <apt-pkg/version.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <unistd.h>
@@ -60,6 +62,13 @@ namespace cw = cwidget;
 
 using namespace std;
 using aptitude::Loggers;
+namespace stats = aptitude::util::stats;
+
+namespace
+{
+  stats::timer build_selection_list_timer("cache.build-selection-list");
+  stats::timer save_selection_list_timer("state.save-selection-list");
+}
 
 class aptitudeDepCache::apt_undoer:public undoable
 // Allows an action performed on the package cache to be undone.  My first
@@ -326,6 +335,7 @@ bool aptitudeDepCache::build_selection_list(OpProgress &Prog, bool WithLock,
 					    bool do_initselections,
 					    const char *status_fname)
 {
+  stats::scoped_timer build_timing(build_selection_list_timer);
   action_group group(*this);
 
   bool initial_open=false;
@@ -594,6 +604,7 @@ bool aptitudeDepCache::build_selection_list(OpProgress &Prog, bool WithLock,
   Prog.OverallProgress(Head().PackageCount, Head().PackageCount, 1, _("Initializing package states"));
 
   duplicate_cache(&backup_state);
+  rebuild_action_state_index();
 
   if(aptcfg->FindB(PACKAGE "::Auto-Upgrade", false) && do_initselections)
     mark_all_upgradable(aptcfg->FindB(PACKAGE "::Auto-Install", true),
@@ -726,6 +737,8 @@ bool aptitudeDepCache::save_selection_list(OpProgress &prog,
   if(lock==-1 && !status_fname)
     return true;
 
+  stats::scoped_timer save_timing(save_selection_list_timer);
+
   // Don't write the global apt state file if we're not writing our
   // own global state.  TODO: this means that su-to-root will lose
   // automatic states! (but we couldn't do anything about it anyway
@@ -1069,6 +1082,7 @@ void aptitudeDepCache::cleanup_after_change(undo_group *undo,
       // shouldn't trigger undo but might trigger updating the
       // package's display.
       else if(PkgState[pkg->ID].Flags != backup_state.PkgState[pkg->ID].Flags ||
+	      PkgState[pkg->ID].iFlags != backup_state.PkgState[pkg->ID].iFlags ||
 	      PkgState[pkg->ID].DepState != backup_state.PkgState[pkg->ID].DepState ||
 	      PkgState[pkg->ID].CandidateVer != backup_state.PkgState[pkg->ID].CandidateVer ||
 	      PkgState[pkg->ID].Marked != backup_state.PkgState[pkg->ID].Marked ||
@@ -1077,11 +1091,45 @@ void aptitudeDepCache::cleanup_after_change(undo_group *undo,
 	      package_states[pkg->ID].new_package != backup_state.AptitudeState[pkg->ID].new_package)
 	visibly_changed = true;
 
-      if(visibly_changed && changed_packages != NULL)
-	changed_packages->insert(pkg);
+      if(visibly_changed)
+	{
+	  update_action_state(pkg);
+
+	  if(changed_packages != NULL)
+	    changed_packages->insert(pkg);
+	}
     }
 }
 
+void aptitudeDepCache::update_action_state(const PkgIterator &pkg)
+{
+  if(action_states.size() != Head().PackageCount)
+    {
+      rebuild_action_state_index();
+      return;
+    }
+
+  const unsigned long id = pkg->ID;
+
+  action_states[id] = find_pkg_state(pkg, *this, true);
+  broken_states[id] = (*this)[pkg].InstBroken();
+
+  if(broken_states[id] || action_states[id] != pkg_unchanged)
+    changed_packages_index.insert(pkg);
+  else
+    changed_packages_index.erase(pkg);
+}
+
+void aptitudeDepCache::rebuild_action_state_index()
+{
+  action_states.assign(Head().PackageCount, pkg_unchanged);
+  broken_states.assign(Head().PackageCount, false);
+  changed_packages_index.clear();
+
+  for(pkgCache::PkgIterator pkg = PkgBegin(); !pkg.end(); ++pkg)
+    update_action_state(pkg);
+}
+
 void aptitudeDepCache::mark_install(const PkgIterator &Pkg,
 				    bool AutoInst,
 				    bool ReInstall,
@@ -49,6 +49,45 @@
  * \file aptcache.h
  */
 
+/** \brief Represents a package's logical state.
+ *
+ *  find_pkg_state computes this value; aptitudeDepCache keeps an
+ *  index of it for every package that isn't pkg_unchanged.
+ */
+enum pkg_action_state
+  {
+    /** \brief No action is being performed on the package. */
+    pkg_unchanged=-1,
+    /** \brief The package has broken dependencies. */
+    pkg_broken,
+    /** \brief The package is unused and will be removed. */
+    pkg_unused_remove,
+    /** \brief The package was automatically held on the system. */
+    pkg_auto_hold,
+    /** \brief The package is being installed to fulfill dependencies. */
+    pkg_auto_install,
+    /** \brief The package is being removed to fulfill dependencies. */
+    pkg_auto_remove,
+    /** \brief The package is being downgraded. */
+    pkg_downgrade,
+    /** \brief The package is held back. */
+    pkg_hold,
+    /** \brief The package is being reinstalled. */
+    pkg_reinstall,
+    /** \brief The package is being installed. */
+    pkg_install,
+    /** \brief The package is being removed. */
+    pkg_remove,
+    /** \brief The package is being upgraded. */
+    pkg_upgrade,
+    /** \brief The package is installed but not configured. */
+    pkg_unconfigured
+  };
+/** \brief The number of package action states, not counting
+ *  pkg_unchanged.
+ */
+const int num_pkg_action_states=12;
+
 class undoable;
 class undo_group;
 class pkgProblemResolver;
@@ -288,6 +327,30 @@ private:
 
   pkgRecords *records;
 
+  /** \brief The action state of each package as of the last
+   *  cleanup_after_change(), indexed by package ID.
+   *
+   *  This is the state that find_pkg_state() returns when it ignores
+   *  broken packages; broken_states records brokenness separately.
+   */
+  std::vector<signed char> action_states;
+
+  /** \brief Whether each package was broken as of the last
+   *  cleanup_after_change(), indexed by package ID.
+   */
+  std::vector<bool> broken_states;
+
+  /** \brief The packages that are broken or that have an action
+   *  state other than pkg_unchanged.
+   */
+  std::set<pkgCache::PkgIterator> changed_packages_index;
+
+  /** \brief Recompute the indexed action state of a single package. */
+  void update_action_state(const PkgIterator &pkg);
+
+  /** \brief Recompute the indexed action state of every package. */
+  void rebuild_action_state_index();
+
   /** Call whenever the cache state is modified; discards the
    *  state of the active resolver.
    *
@@ -370,6 +433,35 @@ public:
   /** Gets the number of new packages. */
   int get_new_package_count() const {return new_package_count;}
 
+  /** \brief Retrieve the action state of a package from the index.
+   *
+   *  This is equivalent to find_pkg_state(), but doesn't need to
+   *  examine the package.  The index is brought up to date at the end
+   *  of each action group, so inside an action group it may not
+   *  reflect changes made by that group.
+   */
+  pkg_action_state get_action_state(const PkgIterator &pkg,
+				    bool ignore_broken = false) const
+  {
+    if(pkg->ID >= action_states.size())
+      return pkg_unchanged;
+    else if(!ignore_broken && broken_states[pkg->ID])
+      return pkg_broken;
+    else
+      return static_cast<pkg_action_state>(action_states[pkg->ID]);
+  }
+
+  /** \brief Retrieve every package whose action state is not
+   *  pkg_unchanged (including packages that are broken).
+   *
+   *  Use this instead of scanning the whole cache with
+   *  find_pkg_state() when only changed packages are interesting.
+   */
+  const std::set<pkgCache::PkgIterator> &get_changed_packages() const
+  {
+    return changed_packages_index;
+  }
+
   inline aptitude_state &get_ext_state(const PkgIterator &Pkg)
   {return package_states[Pkg->ID];}
 
@@ -758,6 +758,19 @@ aptitude_resolver::aptitude_resolver(int step_score,
 	}
     }
 
+  const std::string search_trace_file =
+    aptcfg->Find(PACKAGE "::ProblemResolver::Search-Trace-File", "");
+  if(!search_trace_file.empty())
+    {
+      boost::shared_ptr<search_trace_writer> trace =
+        search_trace_writer::open(search_trace_file);
+
+      if(trace.get() == NULL)
+        LOG_WARN(loggerScores, "Unable to open the search trace file " << search_trace_file);
+      else
+        set_search_trace(trace);
+    }
+
   bool discardNullSolution = aptcfg->FindB(PACKAGE "::ProblemResolver::Discard-Null-Solution", false);
   if(keep_all_solution.size() > 0)
     {
@@ -816,7 +829,7 @@ bool aptitude_resolver::is_break_hold(const aptitude_resolver::version &v) const
     }
   else
     {
-      if(loggerScores->isEnabledFor(logging::TRACE_LEVEL))
+      if(LOG_ENABLED(logging::TRACE_LEVEL, loggerScores))
 	{
 	  if(held_back && forbidden)
 	    LOG_TRACE(loggerScores, v << " breaks a hold and a forbid.");
@@ -0,0 +1,246 @@
+// archive_cleaner.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#include "archive_cleaner.h"
+
+#include <aptitude.h>
+#include <generic/util/dirent_safe.h>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/error.h>
+#include <apt-pkg/pkgcache.h>
+#include <apt-pkg/strutl.h>
+
+#include <boost/unordered_set.hpp>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace aptitude
+{
+  namespace apt
+  {
+    namespace
+    {
+      // Package names and versions can't contain underscores, so
+      // this is unique.
+      std::string version_key(const std::string &package,
+			      const std::string &version)
+      {
+	std::string rval;
+	rval.reserve(package.size() + version.size() + 1);
+	rval += package;
+	rval += '_';
+	rval += version;
+	return rval;
+      }
+
+      /** \brief Collect the keys of the versions whose package files
+       *  autoclean keeps: the ones that can still be downloaded.
+       *
+       *  This makes the same decisions as apt's pkgArchiveCleaner,
+       *  but for every version at once, so that each file is tested
+       *  with a single hash lookup.
+       */
+      void get_wanted_versions(pkgCache &cache,
+			       boost::unordered_set<std::string> &output)
+      {
+	const bool clean_installed = _config->FindB("APT::Clean-Installed", true);
+
+	for(pkgCache::PkgIterator pkg = cache.PkgBegin(); !pkg.end(); ++pkg)
+	  for(pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+	    for(pkgCache::VerFileIterator vf = ver.FileList(); !vf.end(); ++vf)
+	      {
+		// Versions that are only in the status file can't be
+		// downloaded.
+		if(clean_installed &&
+		   (vf.File()->Flags & pkgCache::Flag::NotSource) != 0)
+		  continue;
+
+		output.insert(version_key(pkg.Name(), ver.VerStr()));
+		break;
+	      }
+      }
+
+      bool archive_inode_lt(const archive_file &f1, const archive_file &f2)
+      {
+	return f1.inode < f2.inode;
+      }
+    }
+
+    bool parse_archive_name(const std::string &name,
+			    std::string &package,
+			    std::string &version,
+			    std::string &arch)
+    {
+      const std::string::size_type first = name.find('_');
+      if(first == std::string::npos)
+	return false;
+
+      const std::string::size_type second = name.find('_', first + 1);
+      if(second == std::string::npos)
+	return false;
+
+      const std::string::size_type dot = name.find('.', second + 1);
+      if(dot == std::string::npos)
+	return false;
+
+      package = DeQuoteString(name.substr(0, first));
+      version = DeQuoteString(name.substr(first + 1, second - first - 1));
+      arch = DeQuoteString(name.substr(second + 1, dot - second - 1));
+      return true;
+    }
+
+    bool find_archives_to_clean(const std::string &dir,
+				pkgCache *cache,
+				std::vector<archive_file> &output)
+    {
+      DIR *d = opendir(dir.c_str());
+      if(d == NULL)
+	return _error->Errno("opendir", _("Unable to read %s"), dir.c_str());
+
+      const std::string my_arch = _config->Find("APT::Architecture");
+
+      // Only built if the directory holds a package file for this
+      // system.
+      boost::unordered_set<std::string> wanted;
+      bool have_wanted = false;
+
+      std::vector<archive_file> found;
+      std::string package, version, arch;
+
+      struct dirent *tmp;
+      dirent_safe dir_entry;
+      for(int readdir_result = readdir_r(d, &dir_entry.d, &tmp);
+	  readdir_result == 0 && tmp != NULL;
+	  readdir_result = readdir_r(d, &dir_entry.d, &tmp))
+	{
+	  const char * const name = dir_entry.d.d_name;
+
+	  if(strcmp(name, ".") == 0 ||
+	     strcmp(name, "..") == 0 ||
+	     strcmp(name, "lock") == 0 ||
+	     strcmp(name, "partial") == 0)
+	    continue;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	  if(dir_entry.d.d_type == DT_DIR)
+	    continue;
+#endif
+
+	  const bool is_package_file =
+	    parse_archive_name(name, package, version, arch);
+
+	  if(cache != NULL)
+	    {
+	      // Like apt, autoclean leaves alone anything that isn't
+	      // a package file for this system.
+	      if(!is_package_file ||
+		 (arch != "all" && arch != my_arch))
+		continue;
+
+	      if(!have_wanted)
+		{
+		  get_wanted_versions(*cache, wanted);
+		  have_wanted = true;
+		}
+
+	      if(wanted.find(version_key(package, version)) != wanted.end())
+		continue;
+	    }
+
+	  found.push_back(archive_file());
+	  archive_file &f(found.back());
+	  f.name = name;
+	  if(is_package_file)
+	    {
+	      f.package = package;
+	      f.version = version;
+	    }
+	  f.inode = dir_entry.d.d_ino;
+	  f.size = 0;
+	}
+
+      // Visiting the files in inode order rather than directory
+      // order keeps the disk from seeking back and forth in large
+      // directories.
+      std::sort(found.begin(), found.end(), archive_inode_lt);
+
+      for(std::vector<archive_file>::iterator it = found.begin();
+	  it != found.end(); ++it)
+	{
+	  struct stat st;
+	  // Files that disappeared in the meantime, and directories
+	  // that readdir() didn't identify, are skipped.
+	  if(fstatat(dirfd(d), it->name.c_str(), &st, 0) != 0 ||
+	     S_ISDIR(st.st_mode))
+	    continue;
+
+	  it->size = st.st_size;
+	  output.push_back(*it);
+	}
+
+      closedir(d);
+      return true;
+    }
+
+    unsigned long long erase_archives(const std::string &dir,
+				      const std::vector<archive_file> &files)
+    {
+      if(files.empty())
+	return 0;
+
+      const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+      if(fd < 0)
+	{
+	  _error->Errno("open", _("Unable to read %s"), dir.c_str());
+	  return 0;
+	}
+
+      unsigned long long rval = 0;
+      for(std::vector<archive_file>::const_iterator it = files.begin();
+	  it != files.end(); ++it)
+	if(unlinkat(fd, it->name.c_str(), 0) == 0)
+	  rval += it->size;
+
+      close(fd);
+      return rval;
+    }
+
+    unsigned long long clean_archives(const std::string &dir,
+				      pkgCache *cache)
+    {
+      unsigned long long rval = 0;
+
+      const std::string dirs[] = { dir, dir + "partial/" };
+      for(unsigned int i = 0; i < sizeof(dirs) / sizeof(dirs[0]); ++i)
+	{
+	  std::vector<archive_file> files;
+	  if(find_archives_to_clean(dirs[i], cache, files))
+	    rval += erase_archives(dirs[i], files);
+	}
+
+      return rval;
+    }
+  }
+}
@@ -0,0 +1,125 @@
+// archive_cleaner.h         -*-c++-*-
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#ifndef ARCHIVE_CLEANER_H
+#define ARCHIVE_CLEANER_H
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+class pkgCache;
+
+/** \brief Routines to delete downloaded package files, for the
+ *  "clean" and "autoclean" commands.
+ *
+ *  Cleaning a directory happens in two steps: find_archives_to_clean()
+ *  reads the directory once and decides which files to delete from
+ *  their names alone, and erase_archives() deletes them as a batch.
+ *  Only the files that are deleted are ever stat()ed.
+ *
+ *  \file archive_cleaner.h
+ */
+
+namespace aptitude
+{
+  namespace apt
+  {
+    /** \brief A file that find_archives_to_clean() selected for
+     *  deletion.
+     */
+    struct archive_file
+    {
+      /** \brief The name of the file, relative to its directory. */
+      std::string name;
+
+      /** \brief The package and version named by the file, or empty
+       *  strings if its name isn't that of a package file.
+       */
+      std::string package;
+      std::string version;
+
+      /** \brief The inode number of the file, used to order the
+       *  system calls that touch it.
+       */
+      ino_t inode;
+
+      /** \brief The size of the file in bytes. */
+      off_t size;
+    };
+
+    /** \brief Split the name of a downloaded package file into the
+     *  package, version and architecture that it names.
+     *
+     *  For instance, "foo_1%3a2.0-1_i386.deb" names version 1:2.0-1
+     *  of foo for i386.
+     *
+     *  \return \b false if \b name doesn't have that form.
+     */
+    bool parse_archive_name(const std::string &name,
+			    std::string &package,
+			    std::string &version,
+			    std::string &arch);
+
+    /** \brief Find the files in a download directory that should be
+     *  deleted.
+     *
+     *  The lock file and subdirectories are never selected.
+     *
+     *  \param dir     the directory to read.
+     *  \param cache   if \b NULL, every file is selected (as by
+     *                 "clean").  Otherwise, only package files for
+     *                 this system whose version can't be downloaded
+     *                 any more are selected (as by "autoclean").
+     *  \param output  a vector to which the selected files are
+     *                 appended, in the order in which they should be
+     *                 deleted.
+     *
+     *  \return \b false if the directory couldn't be read; an error
+     *  is posted to _error in that case.
+     */
+    bool find_archives_to_clean(const std::string &dir,
+				pkgCache *cache,
+				std::vector<archive_file> &output);
+
+    /** \brief Delete files that find_archives_to_clean() selected.
+     *
+     *  Files that can't be deleted are skipped.
+     *
+     *  \return the total size of the files that were deleted.
+     */
+    unsigned long long erase_archives(const std::string &dir,
+				      const std::vector<archive_file> &files);
+
+    /** \brief Delete the files that find_archives_to_clean() selects
+     *  from a download directory and from its "partial"
+     *  subdirectory.
+     *
+     *  \param dir    the download directory, ending in a slash.
+     *  \param cache  as for find_archives_to_clean().
+     *
+     *  \return the total size of the files that were deleted.
+     */
+    unsigned long long clean_archives(const std::string &dir,
+				      pkgCache *cache);
+  }
+}
+
+#endif // ARCHIVE_CLEANER_H
@@ -25,6 +25,8 @@
 
 #include <aptitude.h>
 
+#include <generic/util/perf_stats.h>
+
 #include <apt-pkg/acquire-item.h>
 #include <apt-pkg/dpkgpm.h>
 #include <apt-pkg/error.h>
@@ -36,6 +38,13 @@
 #include <signal.h>
 
 using namespace std;
+namespace stats = aptitude::util::stats;
+
+namespace
+{
+  stats::timer prepare_timer("download.prepare");
+  stats::timer dpkg_timer("dpkg.run");
+}
 
 download_install_manager::download_install_manager(bool _download_only,
 						   const run_dpkg_in_terminal_func &_run_dpkg_in_terminal)
@@ -53,6 +62,7 @@ bool download_install_manager::prepare(OpProgress &progress,
 				       pkgAcquireStatus &acqlog,
 				       download_signal_log *signallog)
 {
+  stats::scoped_timer prepare_timing(prepare_timer);
   log = signallog;
 
   if(apt_cache_file == NULL)
@@ -154,6 +164,7 @@ download_manager::result download_install_manager::finish_pre_dpkg(pkgAcquire::R
 
 pkgPackageManager::OrderResult download_install_manager::run_dpkg(int status_fd)
 {
+  stats::scoped_timer dpkg_timing(dpkg_timer);
   sigset_t allsignals;
   sigset_t oldsignals;
   sigfillset(&allsignals);
@@ -19,6 +19,15 @@
 
 #include "download_manager.h"
 
+#include <generic/util/perf_stats.h>
+
+namespace stats = aptitude::util::stats;
+
+namespace
+{
+  stats::timer fetch_timer("download.fetch");
+}
+
 download_manager::download_manager()
   : fetcher(NULL)
 {
@@ -31,10 +40,12 @@ download_manager::~download_manager()
 
 pkgAcquire::RunResult download_manager::do_download()
 {
+  stats::scoped_timer fetch_timing(fetch_timer);
   return fetcher->Run();
 }
 
 pkgAcquire::RunResult download_manager::do_download(int PulseInterval)
 {
+  stats::scoped_timer fetch_timing(fetch_timer);
   return fetcher->Run(PulseInterval);
 }
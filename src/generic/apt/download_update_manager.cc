@@ -20,12 +20,12 @@
 #include "download_update_manager.h"
 
 #include "apt.h"
+#include "archive_cleaner.h"
 #include "config_signal.h"
 #include "download_signal_log.h"
 
 #include <apt-pkg/acquire-item.h>
 #include <apt-pkg/cachefile.h>
-#include <apt-pkg/clean.h>
 #include <apt-pkg/error.h>
 #include <apt-pkg/algorithms.h>
 
@@ -39,18 +39,6 @@
 
 namespace cw = cwidget;
 
-class my_cleaner:public pkgArchiveCleaner
-{
-protected:
-  virtual void Erase(const char *file,
-		     string pkg,
-		     string ver,
-		     struct stat &stat)
-  {
-    unlink(file);
-  }
-};
-
 download_update_manager::download_update_manager()
   : log(NULL)
 {
@@ -400,10 +388,8 @@ void download_update_manager::finish(pkgAcquire::RunResult res,
     {
       pre_autoclean_hook();
 
-      my_cleaner cleaner;
-      cleaner.Go(aptcfg->FindDir("Dir::Cache::archives"), *apt_cache_file);
-      cleaner.Go(aptcfg->FindDir("Dir::Cache::archives")+"partial/",
-		 *apt_cache_file);
+      aptitude::apt::clean_archives(aptcfg->FindDir("Dir::Cache::archives"),
+				    &(*apt_cache_file)->GetCache());
 
       post_autoclean_hook();
     }
@@ -0,0 +1,513 @@
+// history_db.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#include "history_db.h"
+
+#include "history_entry.h"
+
+#include <config.h>
+
+#include <generic/util/sqlite.h>
+
+#include <boost/format.hpp>
+
+#include <istream>
+
+#include <stdio.h>
+#include <string.h>
+
+using aptitude::sqlite::db;
+using aptitude::sqlite::statement;
+
+namespace aptitude
+{
+  namespace history
+  {
+    namespace
+    {
+      // Maps the (untranslated) tags written by do_log() to the
+      // action names stored in the database.
+      struct log_tag
+      {
+	const char *tag;
+	const char *action;
+      };
+
+      const log_tag log_tags[] =
+	{
+	  { "UPGRADE", "upgrade" },
+	  { "DOWNGRADE", "downgrade" },
+	  { "INSTALL", "install" },
+	  { "INSTALL, DEPENDENCIES", "install-auto" },
+	  { "REINSTALL", "reinstall" },
+	  { "REMOVE", "remove" },
+	  { "REMOVE, DEPENDENCIES", "remove-auto" },
+	  { "REMOVE, NOT USED", "remove-unused" },
+	  { "HOLD", "hold" },
+	  { "HOLD, DEPENDENCIES", "hold-auto" },
+	  { "BROKEN", "broken" },
+	  { "UNCONFIGURED", "unconfigured" },
+	  { NULL, NULL }
+	};
+
+      const char *find_log_tag_action(const std::string &tag)
+      {
+	for(const log_tag *t = log_tags; t->tag != NULL; ++t)
+	  if(tag == t->tag)
+	    return t->action;
+
+	return NULL;
+      }
+
+      bool starts_with(const std::string &s, const char *prefix)
+      {
+	return s.compare(0, strlen(prefix), prefix) == 0;
+      }
+
+      bool ends_with(const std::string &s, const char *suffix)
+      {
+	const std::string::size_type len = strlen(suffix);
+	return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+      }
+
+      /** \brief Parse one "[TAG] package [old -> new]" line. */
+      bool parse_log_action(const std::string &line, action_record &out)
+      {
+	if(line.empty() || line[0] != '[')
+	  return false;
+
+	const std::string::size_type close = line.find("] ");
+	if(close == std::string::npos)
+	  return false;
+
+	const char *action = find_log_tag_action(line.substr(1, close - 1));
+	if(action == NULL)
+	  return false;
+
+	const std::string rest = line.substr(close + 2);
+	const std::string::size_type space = rest.find(' ');
+
+	out.action = action;
+	out.package = rest.substr(0, space);
+	out.old_version.clear();
+	out.new_version.clear();
+
+	if(space != std::string::npos)
+	  {
+	    const std::string::size_type arrow = rest.find(" -> ", space);
+	    if(arrow != std::string::npos)
+	      {
+		out.old_version = rest.substr(space + 1, arrow - space - 1);
+		out.new_version = rest.substr(arrow + 4);
+	      }
+	  }
+
+	return !out.package.empty();
+      }
+    }
+
+    bool action_installs_version(const std::string &action)
+    {
+      return
+	action == "install" ||
+	action == "install-auto" ||
+	action == "reinstall" ||
+	action == "upgrade" ||
+	action == "downgrade";
+    }
+
+    action_record make_action_record(time_t time,
+				     const std::string &package,
+				     const std::string &action,
+				     const std::string &old_version,
+				     const std::string &install_version)
+    {
+      return action_record(time, package, action, old_version,
+			   action_installs_version(action)
+			     ? install_version : std::string());
+    }
+
+    std::string find_database_path(const Configuration &config,
+				   const std::string &default_path)
+    {
+      // Find() returns the default for an empty value, which would
+      // make it impossible to turn the database off.
+      const char * const name = PACKAGE "::History::Database";
+
+      if(config.Exists(name))
+	return config.Find(name);
+      else
+	return default_path;
+    }
+
+    bool parse_log_date(const std::string &s, time_t &out)
+    {
+      static const char * const months[] =
+	{
+	  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+	};
+
+      char wday[4], month[4], sign;
+      int day, year, hour, minute, second, tz_hours, tz_minutes;
+
+      if(sscanf(s.c_str(), "%3s, %3s %d %d %d:%d:%d %c%2d%2d",
+		wday, month, &day, &year,
+		&hour, &minute, &second,
+		&sign, &tz_hours, &tz_minutes) != 10 ||
+	 (sign != '+' && sign != '-'))
+	return false;
+
+      int mon = -1;
+      for(int i = 0; i < 12; ++i)
+	if(strcmp(month, months[i]) == 0)
+	  {
+	    mon = i;
+	    break;
+	  }
+
+      if(mon < 0)
+	return false;
+
+      struct tm tm;
+      memset(&tm, 0, sizeof(tm));
+      tm.tm_year = year - 1900;
+      tm.tm_mon = mon;
+      tm.tm_mday = day;
+      tm.tm_hour = hour;
+      tm.tm_min = minute;
+      tm.tm_sec = second;
+
+      const time_t local = timegm(&tm);
+      if(local == (time_t)-1)
+	return false;
+
+      const long offset = (tz_hours * 60 + tz_minutes) * 60;
+      out = sign == '+' ? local - offset : local + offset;
+      return true;
+    }
+
+    const int history_db::current_version_number;
+
+    history_db::history_db(const std::string &filename, bool read_only)
+      : store(db::create(filename,
+			 read_only
+			   ? SQLITE_OPEN_READONLY
+			   : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE))
+    {
+      // Several aptitude processes (or an import and a live run) can
+      // touch the database at once; give them a little time to get
+      // out of each other's way.
+      store->set_busy_timeout(500);
+
+      db::statement_proxy check_for_format_statement =
+	store->get_cached_statement("select 1 from sqlite_master where name = 'format'");
+      bool has_format = false;
+      {
+	statement::execution check_for_format_execution(*check_for_format_statement);
+	has_format = check_for_format_execution.step();
+      }
+
+      if(has_format)
+	check_database();
+      else if(read_only)
+	throw HistoryException("The history database has not been initialized.");
+      else
+	create_new_database();
+    }
+
+    history_db::~history_db()
+    {
+    }
+
+    boost::shared_ptr<history_db>
+    history_db::create(const std::string &filename, bool read_only)
+    {
+      return boost::shared_ptr<history_db>(new history_db(filename, read_only));
+    }
+
+    void history_db::create_new_database()
+    {
+      // Each action repeats the time of its run so that time-range
+      // queries can be answered from the actions table's indices
+      // without a join.
+      std::string schema = "                                        \
+begin transaction;							\
+create table format ( version integer );				\
+									\
+create table runs ( RunId integer primary key,				\
+                    Time integer not null,				\
+                    Source text not null );				\
+									\
+create table actions ( RunId integer not null,				\
+                       Time integer not null,				\
+                       Package text not null,				\
+                       Action text not null,				\
+                       OldVersion text not null,			\
+                       NewVersion text not null );			\
+									\
+create index runs_by_time on runs (Time);				\
+create index actions_by_run on actions (RunId);				\
+create index actions_by_package on actions (Package, Time);		\
+create index actions_by_time on actions (Time);				\
+create index actions_by_action on actions (Action, Time);		\
+";
+
+      store->exec(schema);
+
+      try
+	{
+	  boost::shared_ptr<statement> set_version_statement =
+	    statement::prepare(*store, "insert into format(version) values(?)");
+
+	  set_version_statement->bind_int(1, current_version_number);
+	  set_version_statement->exec();
+
+	  store->exec("commit");
+	}
+      catch(...)
+	{
+	  try
+	    {
+	      store->exec("rollback");
+	    }
+	  catch(...)
+	    {
+	    }
+
+	  throw;
+	}
+    }
+
+    void history_db::check_database()
+    {
+      db::statement_proxy get_version_statement =
+	store->get_cached_statement("select version from format");
+
+      statement::execution get_version_execution(*get_version_statement);
+      if(!get_version_execution.step())
+	throw HistoryException("The history database has no version number.");
+
+      const int version = get_version_statement->get_int(0);
+      if(version != current_version_number)
+	throw HistoryException((boost::format("Unsupported history database version %d (expected %d).")
+				% version % current_version_number).str());
+    }
+
+    namespace
+    {
+      void insert_run(db &store,
+		      time_t time, const std::string &source,
+		      const std::vector<action_record> &actions)
+      {
+	db::statement_proxy insert_run_statement =
+	  store.get_cached_statement("insert into runs(Time, Source) values(?, ?)");
+	insert_run_statement->bind_int64(1, time);
+	insert_run_statement->bind_string(2, source);
+	insert_run_statement->exec();
+
+	const sqlite3_int64 run_id = store.get_last_insert_rowid();
+
+	for(std::vector<action_record>::const_iterator it = actions.begin();
+	    it != actions.end(); ++it)
+	  {
+	    // The statement is reset when the proxy is released, so
+	    // fetch it from the cache once per row.
+	    db::statement_proxy insert_action_statement =
+	      store.get_cached_statement("insert into actions(RunId, Time, Package, Action, OldVersion, NewVersion) values(?, ?, ?, ?, ?, ?)");
+
+	    insert_action_statement->bind_int64(1, run_id);
+	    insert_action_statement->bind_int64(2, time);
+	    insert_action_statement->bind_string(3, it->package);
+	    insert_action_statement->bind_string(4, it->action);
+	    insert_action_statement->bind_string(5, it->old_version);
+	    insert_action_statement->bind_string(6, it->new_version);
+	    insert_action_statement->exec();
+	  }
+      }
+    }
+
+    void history_db::add_run(time_t time, const std::string &source,
+			     const std::vector<action_record> &actions)
+    {
+      store->exec("begin transaction");
+
+      try
+	{
+	  insert_run(*store, time, source, actions);
+	  store->exec("commit");
+	}
+      catch(...)
+	{
+	  try
+	    {
+	      store->exec("rollback");
+	    }
+	  catch(...)
+	    {
+	    }
+
+	  throw;
+	}
+    }
+
+    bool history_db::has_run_at(time_t time)
+    {
+      db::statement_proxy find_run_statement =
+	store->get_cached_statement("select 1 from runs where Time = ?");
+      find_run_statement->bind_int64(1, time);
+
+      statement::execution find_run_execution(*find_run_statement);
+      return find_run_execution.step();
+    }
+
+    void history_db::find(const history_query &query,
+			  std::vector<action_record> &output)
+    {
+      std::string sql = "select Time, Package, Action, OldVersion, NewVersion from actions where 1";
+
+      // One combined clause, so that a row that matches several
+      // patterns is only returned once.
+      if(!query.packages.empty())
+	{
+	  sql += " and (Package glob ?";
+	  for(std::vector<std::string>::size_type i = 1;
+	      i < query.packages.size(); ++i)
+	    sql += " or Package glob ?";
+	  sql += ")";
+	}
+      if(!query.action.empty())
+	sql += " and Action = ?";
+      if(query.since != 0)
+	sql += " and Time >= ?";
+      if(query.until != 0)
+	sql += " and Time <= ?";
+
+      sql += " order by Time, RunId, Package";
+
+      db::statement_proxy find_statement = store->get_cached_statement(sql);
+
+      int param = 1;
+      for(std::vector<std::string>::const_iterator it = query.packages.begin();
+	  it != query.packages.end(); ++it)
+	find_statement->bind_string(param++, *it);
+      if(!query.action.empty())
+	find_statement->bind_string(param++, query.action);
+      if(query.since != 0)
+	find_statement->bind_int64(param++, query.since);
+      if(query.until != 0)
+	find_statement->bind_int64(param++, query.until);
+
+      statement::execution find_execution(*find_statement);
+      while(find_execution.step())
+	output.push_back(action_record(find_statement->get_int64(0),
+				       find_statement->get_string(1),
+				       find_statement->get_string(2),
+				       find_statement->get_string(3),
+				       find_statement->get_string(4)));
+    }
+
+    int history_db::import_log(std::istream &in)
+    {
+      int num_imported = 0;
+
+      // Import everything in one transaction; committing each run
+      // separately makes importing a large log very slow.
+      store->exec("begin transaction");
+
+      try
+	{
+	  // True while we're inside a stanza that should be imported.
+	  bool in_run = false;
+	  time_t run_time = 0;
+	  std::vector<action_record> actions;
+	  // True if the next line should be the date of a stanza.
+	  bool expect_date = false;
+
+	  std::string line;
+	  while(std::getline(in, line))
+	    {
+	      if(expect_date)
+		{
+		  expect_date = false;
+		  in_run = parse_log_date(line, run_time) && !has_run_at(run_time);
+		}
+	      else if(starts_with(line, "Aptitude ") && ends_with(line, ": log report"))
+		{
+		  // A stanza that wasn't terminated properly; keep
+		  // whatever it managed to log.
+		  if(in_run && !actions.empty())
+		    {
+		      insert_run(*store, run_time, "log", actions);
+		      ++num_imported;
+		    }
+
+		  in_run = false;
+		  actions.clear();
+		  expect_date = true;
+		}
+	      else if(!in_run)
+		continue;
+	      else if(line == "Log complete.")
+		{
+		  if(!actions.empty())
+		    {
+		      insert_run(*store, run_time, "log", actions);
+		      ++num_imported;
+		    }
+
+		  in_run = false;
+		  actions.clear();
+		}
+	      else
+		{
+		  action_record action;
+		  if(parse_log_action(line, action))
+		    {
+		      action.time = run_time;
+		      actions.push_back(action);
+		    }
+		}
+	    }
+
+	  if(in_run && !actions.empty())
+	    {
+	      insert_run(*store, run_time, "log", actions);
+	      ++num_imported;
+	    }
+
+	  store->exec("commit");
+	}
+      catch(...)
+	{
+	  try
+	    {
+	      store->exec("rollback");
+	    }
+	  catch(...)
+	    {
+	    }
+
+	  throw;
+	}
+
+      return num_imported;
+    }
+  }
+}
@@ -0,0 +1,241 @@
+// history_db.h         -*-c++-*-
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#ifndef HISTORY_DB_H
+#define HISTORY_DB_H
+
+/** \file history_db.h */
+
+#include <boost/shared_ptr.hpp>
+
+#include <apt-pkg/configuration.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+namespace aptitude
+{
+  namespace sqlite
+  {
+    class db;
+  }
+
+  namespace history
+  {
+    /** \brief One package change recorded in the history database.
+     *
+     *  The action is stored as one of the short names below, which
+     *  correspond to the tags that log_changes() writes to the text
+     *  log:
+     *
+     *   - "install", "install-auto", "reinstall"
+     *   - "upgrade", "downgrade"
+     *   - "remove", "remove-auto", "remove-unused"
+     *   - "hold", "hold-auto"
+     *   - "broken", "unconfigured"
+     *
+     *  Versions are empty when they aren't known; the text log only
+     *  records them for upgrades and downgrades.  The new version is
+     *  always empty for actions that don't install anything (see
+     *  action_installs_version()).
+     */
+    struct action_record
+    {
+      /** \brief When the run that performed this action happened. */
+      time_t time;
+      std::string package;
+      std::string action;
+      std::string old_version;
+      std::string new_version;
+
+      action_record()
+	: time(0)
+      {
+      }
+
+      action_record(time_t _time,
+		    const std::string &_package,
+		    const std::string &_action,
+		    const std::string &_old_version,
+		    const std::string &_new_version)
+	: time(_time),
+	  package(_package),
+	  action(_action),
+	  old_version(_old_version),
+	  new_version(_new_version)
+      {
+      }
+    };
+
+    /** \brief Test whether an action installs a version of its
+     *  package.
+     *
+     *  Only these actions have a new version; removals, holds and
+     *  broken packages leave the installed version (if any) alone.
+     */
+    bool action_installs_version(const std::string &action);
+
+    /** \brief Build the record of a change that is about to be
+     *  performed.
+     *
+     *  \param install_version  The version that the package is
+     *                          marked to have afterwards; it is only
+     *                          recorded if \b action installs it.
+     */
+    action_record make_action_record(time_t time,
+				     const std::string &package,
+				     const std::string &action,
+				     const std::string &old_version,
+				     const std::string &install_version);
+
+    /** \brief Restricts the actions returned by history_db::find(). */
+    struct history_query
+    {
+      /** \brief Glob patterns (as understood by sqlite's GLOB
+       *  operator); package names must match at least one of them.
+       *  If this is empty, every package matches.
+       */
+      std::vector<std::string> packages;
+
+      /** \brief The action to return, or an empty string to return
+       *  every action.
+       */
+      std::string action;
+
+      /** \brief Return only actions at or after this time; 0 means
+       *  "no lower bound".
+       */
+      time_t since;
+
+      /** \brief Return only actions at or before this time; 0 means
+       *  "no upper bound".
+       */
+      time_t until;
+
+      history_query()
+	: since(0), until(0)
+      {
+      }
+    };
+
+    /** \brief Find the history database named by a configuration.
+     *
+     *  \param config        The configuration to read
+     *                       Aptitude::History::Database from.
+     *  \param default_path  The database to use if the option isn't
+     *                       set.
+     *
+     *  \return the filename, or an empty string if the option is set
+     *  to an empty string to disable the history database.
+     */
+    std::string find_database_path(const Configuration &config,
+				   const std::string &default_path);
+
+    /** \brief An indexed, queryable record of the actions aptitude
+     *  has performed.
+     *
+     *  The text log is convenient to read but expensive to search;
+     *  this stores the same information in an sqlite database with
+     *  indices on package name, time and action, so that questions
+     *  like "when was libfoo last upgraded?" can be answered without
+     *  scanning every run.
+     *
+     *  Each call to add_run() adds one row to the "runs" table and
+     *  one row per action to the "actions" table, in a single
+     *  transaction.
+     *
+     *  Errors are reported by throwing sqlite::exception or
+     *  HistoryException.
+     */
+    class history_db
+    {
+      boost::shared_ptr<sqlite::db> store;
+
+      static const int current_version_number = 1;
+
+      void create_new_database();
+      void check_database();
+
+      history_db(const std::string &filename, bool read_only);
+
+    public:
+      ~history_db();
+
+      /** \brief Open a history database.
+       *
+       *  \param filename   The file containing the database.
+       *  \param read_only  If \b true, the database is opened
+       *                    read-only and must already exist;
+       *                    otherwise it is created if necessary.
+       */
+      static boost::shared_ptr<history_db>
+      create(const std::string &filename, bool read_only = false);
+
+      /** \brief Record a single run of aptitude.
+       *
+       *  \param time     The time at which the run happened.
+       *  \param source   Where the run came from ("aptitude" for
+       *                  live runs, "log" for imported ones).
+       *  \param actions  The actions performed by the run; their
+       *                  time fields are ignored in favor of \b time.
+       */
+      void add_run(time_t time, const std::string &source,
+		   const std::vector<action_record> &actions);
+
+      /** \brief Test whether a run was already recorded at the given
+       *  time.
+       */
+      bool has_run_at(time_t time);
+
+      /** \brief Find recorded actions.
+       *
+       *  Matching actions are appended to \b output, ordered by time
+       *  and then by package name.
+       */
+      void find(const history_query &query,
+		std::vector<action_record> &output);
+
+      /** \brief Import runs from a text log written by
+       *  log_changes().
+       *
+       *  Only the untranslated log format can be parsed; runs whose
+       *  header or tags were translated are skipped, as are runs
+       *  that are already in the database (runs are identified by
+       *  their timestamp).
+       *
+       *  \return the number of runs that were imported.
+       */
+      int import_log(std::istream &in);
+    };
+
+    /** \brief Parse the date written in the header of a text log
+     *  stanza (e.g., "Mon, May 10 2010 21:15:02 -0700").
+     *
+     *  Month and day names must be in English.
+     *
+     *  \return \b true if the date was parsed.
+     */
+    bool parse_log_date(const std::string &s, time_t &out);
+  }
+}
+
+#endif // HISTORY_DB_H
@@ -24,6 +24,9 @@
 
 #include <aptitude.h>
 
+#include <generic/apt/history/history_db.h>
+#include <generic/apt/history/history_entry.h>
+#include <generic/util/sqlite.h>
 #include <generic/util/util.h>
 
 #include <apt-pkg/error.h>
@@ -35,6 +38,10 @@
 
 #include <algorithm>
 
+using aptitude::history::action_record;
+using aptitude::history::find_database_path;
+using aptitude::history::history_db;
+using aptitude::history::make_action_record;
 using namespace std;
 
 typedef std::pair<pkgCache::PkgIterator, pkg_action_state> logitem;
@@ -152,6 +159,75 @@ bool do_log(const string &log,
   return true;
 }
 
+namespace
+{
+  /** \brief Get the name under which the history database stores
+   *  an action, or NULL if it shouldn't be recorded.
+   */
+  const char *get_history_action_name(pkg_action_state s)
+  {
+    switch(s)
+      {
+      case pkg_broken:        return "broken";
+      case pkg_unused_remove: return "remove-unused";
+      case pkg_auto_hold:     return "hold-auto";
+      case pkg_auto_install:  return "install-auto";
+      case pkg_auto_remove:   return "remove-auto";
+      case pkg_downgrade:     return "downgrade";
+      case pkg_hold:          return "hold";
+      case pkg_reinstall:     return "reinstall";
+      case pkg_install:       return "install";
+      case pkg_remove:        return "remove";
+      case pkg_upgrade:       return "upgrade";
+      case pkg_unconfigured:  return "unconfigured";
+      default:                return NULL;
+      }
+  }
+
+  void record_history(const string &filename,
+		      const loglist &changed_packages)
+  {
+    vector<action_record> actions;
+    const time_t now = time(NULL);
+
+    for(loglist::const_iterator i = changed_packages.begin();
+	i != changed_packages.end(); ++i)
+      {
+	const char *name = get_history_action_name(i->second);
+	if(name == NULL)
+	  continue;
+
+	pkgCache::VerIterator current = i->first.CurrentVer();
+	pkgCache::VerIterator install =
+	  (*apt_cache_file)[i->first].InstVerIter(*apt_cache_file);
+
+	actions.push_back(make_action_record(now,
+					     i->first.FullName(false),
+					     name,
+					     current.end() ? "" : current.VerStr(),
+					     install.end() ? "" : install.VerStr()));
+      }
+
+    if(actions.empty())
+      return;
+
+    try
+      {
+	history_db::create(filename)->add_run(now, PACKAGE, actions);
+      }
+    catch(const aptitude::sqlite::exception &ex)
+      {
+	_error->Warning(_("Unable to record actions in the history database %s: %s"),
+			filename.c_str(), ex.errmsg().c_str());
+      }
+    catch(const aptitude::history::HistoryException &ex)
+      {
+	_error->Warning(_("Unable to record actions in the history database %s: %s"),
+			filename.c_str(), ex.errmsg().c_str());
+      }
+  }
+}
+
 struct log_sorter
 {
   pkg_name_lt plt;
@@ -167,6 +243,14 @@ public:
   }
 };
 
+string get_history_database_path()
+{
+  const string default_path =
+    aptcfg->FindDir("Dir::Aptitude::state", STATEDIR) + "history.db";
+
+  return find_database_path(*_config, default_path);
+}
+
 void log_changes()
 {
   vector<string> logs;
@@ -186,21 +270,26 @@ void log_changes()
 	  logs.push_back(curr->Value);
       }
 
-  if(!logs.empty())
+  const string history_file = get_history_database_path();
+
+  if(!logs.empty() || !history_file.empty())
     {
+      const std::set<pkgCache::PkgIterator> &changed =
+	(*apt_cache_file)->get_changed_packages();
+
       loglist changed_packages;
-      for(pkgCache::PkgIterator i
-	    = (*apt_cache_file)->PkgBegin(); !i.end(); i++)
-	{
-	  pkg_action_state s = find_pkg_state(i, *apt_cache_file);
-	  if(s != pkg_unchanged)
-	    changed_packages.push_back(logitem(i, s));
-	}
+      changed_packages.reserve(changed.size());
+      for(std::set<pkgCache::PkgIterator>::const_iterator i = changed.begin();
+	  i != changed.end(); ++i)
+	changed_packages.push_back(logitem(*i, (*apt_cache_file)->get_action_state(*i)));
 
       sort(changed_packages.begin(), changed_packages.end(), log_sorter());
 
       for(vector<string>::iterator i
 	    = logs.begin(); i != logs.end(); ++i)
 	do_log(*i, changed_packages);
+
+      if(!history_file.empty())
+	record_history(history_file, changed_packages);
     }
 }
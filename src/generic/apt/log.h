@@ -21,6 +21,8 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include <string>
+
 /** \brief A routine to write aptitude's automatic installation log.
  *
  *  \file log.h
@@ -31,4 +33,12 @@
  */
 void log_changes();
 
+/** \brief Look up the location of the history database in the apt
+ *  configuration.
+ *
+ *  \return the filename, or an empty string if the history database
+ *  is disabled.
+ */
+std::string get_history_database_path();
+
 #endif
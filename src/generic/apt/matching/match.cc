@@ -24,6 +24,8 @@
 #include <generic/apt/apt.h>
 #include <generic/apt/tags.h>
 #include <generic/apt/tasks.h>
+#include <generic/apt/version_sources.h>
+#include <generic/util/perf_stats.h>
 #include <generic/util/progress_info.h>
 #include <generic/util/util.h>
 
@@ -1522,41 +1524,21 @@ namespace aptitude
 	      if(!target.get_has_version())
 		return NULL;
 
-	      bool checked_real_package = false;
-
-	      pkgCache::PkgIterator pkg(target.get_package_iterator(cache));
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
+	      const std::vector<std::string> &packages =
+		aptitude::apt::get_version_sources(ver, cache.GetCache(), records).packages;
 
-	      for(pkgCache::VerFileIterator vf = ver.FileList();
-		  !vf.end(); ++vf)
+	      for(std::vector<std::string>::const_iterator it = packages.begin();
+		  it != packages.end(); ++it)
 		{
-		  pkgRecords::Parser &rec = records.Lookup(vf);
-
-		  if(rec.SourcePkg().empty())
-		    {
-		      if(!checked_real_package)
-			{
-			  ref_ptr<match> rval =
-			    evaluate_regexp(p,
-					    p->get_source_package_regex_info(),
-					    pkg.Name(),
-					    debug);
-
-			  if(rval.valid())
-			    return rval;
-			}
-		    }
-		  else
-		    {
-		      ref_ptr<match> rval =
-			evaluate_regexp(p,
-					p->get_source_package_regex_info(),
-					rec.SourcePkg().c_str(),
-					debug);
+		  ref_ptr<match> rval =
+		    evaluate_regexp(p,
+				    p->get_source_package_regex_info(),
+				    it->c_str(),
+				    debug);
 
-		      if(rval.valid())
-			return rval;
-		    }
+		  if(rval.valid())
+		    return rval;
 		}
 
 	      return NULL;
@@ -1568,41 +1550,21 @@ namespace aptitude
 	      if(!target.get_has_version())
 		return NULL;
 
-	      bool checked_real_package = false;
-
-	      pkgCache::PkgIterator pkg(target.get_package_iterator(cache));
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
+	      const std::vector<std::string> &versions =
+		aptitude::apt::get_version_sources(ver, cache.GetCache(), records).versions;
 
-	      for(pkgCache::VerFileIterator vf = ver.FileList();
-		  !vf.end(); ++vf)
+	      for(std::vector<std::string>::const_iterator it = versions.begin();
+		  it != versions.end(); ++it)
 		{
-		  pkgRecords::Parser &rec = records.Lookup(vf);
-
-		  if(rec.SourceVer().empty())
-		    {
-		      if(!checked_real_package)
-			{
-			  ref_ptr<match> rval =
-			    evaluate_regexp(p,
-					    p->get_source_version_regex_info(),
-					    ver.VerStr(),
-					    debug);
-
-			  if(rval.valid())
-			    return rval;
-			}
-		    }
-		  else
-		    {
-		      ref_ptr<match> rval =
-			evaluate_regexp(p,
-					p->get_source_version_regex_info(),
-					rec.SourceVer().c_str(),
-					debug);
+		  ref_ptr<match> rval =
+		    evaluate_regexp(p,
+				    p->get_source_version_regex_info(),
+				    it->c_str(),
+				    debug);
 
-		      if(rval.valid())
-			return rval;
-		    }
+		  if(rval.valid())
+		    return rval;
 		}
 
 	      return NULL;
@@ -3052,6 +3014,13 @@ namespace aptitude
 	}
     }
 
+    namespace
+    {
+      util::stats::timer search_packages_timer("search.packages");
+      util::stats::timer search_versions_timer("search.versions");
+      util::stats::counter search_matches_counter("search.matches");
+    }
+
     void search(const ref_ptr<pattern> &p,
 		const ref_ptr<search_cache> &search_info,
 		std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match> > > &matches,
@@ -3060,6 +3029,9 @@ namespace aptitude
                 bool debug,
                 const sigc::slot<void, progress_info> &progress_slot)
     {
+      util::stats::scoped_timer search_timing(search_packages_timer);
+      const std::size_t initial_matches = matches.size();
+
       try
 	{
           progress_slot(progress_info::pulse(_("Accessing index")));
@@ -3161,6 +3133,8 @@ namespace aptitude
 	{
 	  _error->Error("%s", e.get_msg().c_str());
 	}
+
+      search_matches_counter.add(matches.size() - initial_matches);
     }
 
     void search_versions(const ref_ptr<pattern> &p,
@@ -3174,6 +3148,9 @@ namespace aptitude
       // It's a bit ugly that this is separate from search(), but it's
       // not obvious how to merge them given their different looping
       // requirements.
+      util::stats::scoped_timer search_timing(search_versions_timer);
+      const std::size_t initial_matches = matches.size();
+
       try
 	{
 	  eassert(p.valid());
@@ -3275,6 +3252,8 @@ namespace aptitude
 	{
 	  _error->Error("%s", e.get_msg().c_str());
 	}
+
+      search_matches_counter.add(matches.size() - initial_matches);
     }
   }
 }
@@ -34,6 +34,7 @@
 #include <loggers.h>
 
 #include <generic/problemresolver/problemresolver.h>
+#include <generic/util/perf_stats.h>
 #include <generic/util/temp.h>
 #include <generic/util/undo.h>
 
@@ -49,9 +50,17 @@
 #include <sys/wait.h>
 
 using aptitude::Loggers;
+namespace stats = aptitude::util::stats;
 
 const int defaultStepLimit = 500000;
 
+namespace
+{
+  stats::timer find_solution_timer("resolver.find-solution");
+  stats::counter solutions_counter("resolver.solutions");
+  stats::queue_stats background_queue_stats("resolver.background");
+}
+
 class resolver_manager::resolver_interaction
 {
 public:
@@ -541,7 +550,7 @@ void resolver_manager::background_thread_execution()
       while((background_thread_suspend_count > 0 || resolver_null || pending_jobs.empty()) &&
 	    !background_thread_killed)
 	{
-	  if(logger->isEnabledFor(logging::TRACE_LEVEL))
+	  if(LOG_ENABLED(logging::TRACE_LEVEL, logger))
 	    {
 	      std::vector<std::string> why_suspended;
 	      if(background_thread_suspend_count > 0)
@@ -577,6 +586,8 @@ void resolver_manager::background_thread_execution()
 
       job_request job = pending_jobs.top();
       pending_jobs.pop();
+      if(job.measured)
+	background_queue_stats.wait_usec.add_sample(stats::usec_since(job.queued));
 
       LOG_DEBUG(logger,
 		"Resolver thread: got a new job { solution number = "
@@ -589,10 +600,13 @@ void resolver_manager::background_thread_execution()
 
       try
 	{
-	  const aptitude_resolver::solution *sol =
-	    do_get_solution(job.max_steps,
-			    job.sol_num,
-			    visited_packages);
+	  const aptitude_resolver::solution *sol;
+	  {
+	    stats::scoped_histogram_timer run_timing(background_queue_stats.run_usec);
+	    sol = do_get_solution(job.max_steps,
+				  job.sol_num,
+				  visited_packages);
+	  }
 
 	  LOG_DEBUG(logger,
 		    "Resolver thread: got a solution: " << *sol);
@@ -631,6 +645,7 @@ void resolver_manager::background_thread_execution()
 				job.sol_num);
 	  background_thread_in_resolver = false;
 	  background_resolver_cond.wake_all();
+	  job.measured = stats::start_measurement(job.queued);
 	  pending_jobs.push(job);
 
 	  l.release();
@@ -1139,7 +1154,12 @@ resolver_manager::do_get_solution(int max_steps, unsigned int solution_num,
 
       try
 	{
-	  generic_solution<aptitude_universe> sol = resolver->find_next_solution(max_steps, &visited_packages);
+	  generic_solution<aptitude_universe> sol;
+	  {
+	    stats::scoped_timer find_solution_timing(find_solution_timer);
+	    sol = resolver->find_next_solution(max_steps, &visited_packages);
+	  }
+	  solutions_counter.add();
 
 	  sol_l.acquire();
 
@@ -1348,7 +1368,10 @@ void resolver_manager::get_solution_background(unsigned int solution_num,
 
 
   cwidget::threads::mutex::lock control_lock(background_control_mutex);
-  pending_jobs.push(job_request(solution_num, max_steps, k, post_thunk));
+  job_request job(solution_num, max_steps, k, post_thunk);
+  job.measured = stats::start_measurement(job.queued);
+  pending_jobs.push(job);
+  background_queue_stats.depth.add_sample(pending_jobs.size());
   background_control_cond.wake_all();
 }
 
@@ -1988,7 +2011,7 @@ void resolver_manager::setup_safe_resolver(bool no_new_installs, bool no_new_upg
 	      aptitude_resolver_version p_v =
 		aptitude_resolver_version::make_install(v, *cache_file);
 
-	      if(logger->isEnabledFor(logging::DEBUG_LEVEL))
+	      if(LOG_ENABLED(logging::DEBUG_LEVEL, logger))
 		{
 		  if(v_is_a_non_default_version)
 		    LOG_DEBUG(logger, "setup_safe_resolver: Rejecting " << p_v << " (it is a non-default version).");
@@ -37,6 +37,8 @@
 #include <set>
 #include <vector>
 
+#include <sys/time.h>
+
 #include <generic/util/immset.h>
 #include <generic/util/post_thunk.h>
 
@@ -179,11 +181,18 @@ private:
      */
     post_thunk_f post_thunk;
 
+    /** \brief When this job was queued, if \b measured is set.
+     *
+     *  Used to collect statistics on how long jobs wait.
+     */
+    struct timeval queued;
+    bool measured;
+
     job_request(int _sol_num, int _max_steps,
 		const boost::shared_ptr<background_continuation> &_k,
 		post_thunk_f _post_thunk)
       : sol_num(_sol_num), max_steps(_max_steps), k(_k),
-	post_thunk(_post_thunk)
+	post_thunk(_post_thunk), measured(false)
     {
     }
   };
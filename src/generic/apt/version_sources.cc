@@ -0,0 +1,104 @@
+// version_sources.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#include "version_sources.h"
+
+#include <apt-pkg/pkgrecords.h>
+
+#include <cwidget/generic/threads/threads.h>
+
+#include <algorithm>
+
+namespace cw = cwidget;
+
+namespace aptitude
+{
+  namespace apt
+  {
+    namespace
+    {
+      // Allocated at startup, so that it exists before any thread
+      // can look anything up.
+      cw::threads::mutex *version_sources_mutex = new cw::threads::mutex;
+
+      // The cache whose versions the table describes, or NULL if the
+      // table is empty.
+      const pkgCache *sources_cache = NULL;
+
+      // Indexed by version ID.  Entries are filled in as they are
+      // requested, and never move until the table is discarded.
+      std::vector<version_sources> sources_table;
+      std::vector<bool> sources_filled;
+
+      void add_unique(std::vector<std::string> &strings,
+		      const std::string &s)
+      {
+	if(std::find(strings.begin(), strings.end(), s) == strings.end())
+	  strings.push_back(s);
+      }
+    }
+
+    const version_sources &get_version_sources(const pkgCache::VerIterator &ver,
+					       pkgCache &cache,
+					       pkgRecords &records)
+    {
+      cw::threads::mutex::lock l(*version_sources_mutex);
+
+      // Version IDs are only meaningful in the cache they came from.
+      if(sources_cache != &cache)
+	{
+	  const unsigned long count = cache.Head().VersionCount;
+	  std::vector<version_sources>(count).swap(sources_table);
+	  std::vector<bool>(count, false).swap(sources_filled);
+	  sources_cache = &cache;
+	}
+
+      const unsigned long id = ver->ID;
+      version_sources &rval(sources_table[id]);
+      if(!sources_filled[id])
+	{
+	  for(pkgCache::VerFileIterator vf = ver.FileList(); !vf.end(); ++vf)
+	    {
+	      pkgRecords::Parser &rec = records.Lookup(vf);
+
+	      const std::string srcpkg = rec.SourcePkg();
+	      const std::string srcver = rec.SourceVer();
+
+	      add_unique(rval.packages,
+			 srcpkg.empty() ? std::string(ver.ParentPkg().Name()) : srcpkg);
+	      add_unique(rval.versions,
+			 srcver.empty() ? std::string(ver.VerStr()) : srcver);
+	    }
+
+	  sources_filled[id] = true;
+	}
+
+      return rval;
+    }
+
+    void reset_version_sources()
+    {
+      cw::threads::mutex::lock l(*version_sources_mutex);
+
+      std::vector<version_sources>().swap(sources_table);
+      std::vector<bool>().swap(sources_filled);
+      sources_cache = NULL;
+    }
+  }
+}
@@ -0,0 +1,95 @@
+// version_sources.h         -*-c++-*-
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#ifndef VERSION_SOURCES_H
+#define VERSION_SOURCES_H
+
+#include <apt-pkg/pkgcache.h>
+
+#include <string>
+#include <vector>
+
+class pkgRecords;
+
+/** \brief A table of the source packages that package versions were
+ *  built from.
+ *
+ *  \file version_sources.h
+ */
+
+namespace aptitude
+{
+  namespace apt
+  {
+    /** \brief The source packages and source versions named by the
+     *  package records of a version.
+     */
+    struct version_sources
+    {
+      /** \brief The source package named by each package file of the
+       *  version, in file order, without duplicates.  If a record
+       *  doesn't name a source package, the name of the binary
+       *  package is used instead.
+       */
+      std::vector<std::string> packages;
+
+      /** \brief The source version named by each package file of the
+       *  version, in file order, without duplicates.  If a record
+       *  doesn't name a source version, the binary version is used
+       *  instead.
+       */
+      std::vector<std::string> versions;
+    };
+
+    /** \brief Return the source packages and source versions of a
+     *  package version.
+     *
+     *  The package records of each version are only read the first
+     *  time that it is looked up; the result is kept until the cache
+     *  is closed.  The "?source-package" and "?source-version" search
+     *  terms and the source grouping of "aptitude versions" share the
+     *  table, so between them they read a version's records at most
+     *  once.
+     *
+     *  This may be invoked from any thread, and before the cache is
+     *  stored in apt_cache_file (for instance, while the depcache is
+     *  being initialized).
+     *
+     *  \param ver      the version to look up.
+     *  \param cache    the cache that \b ver belongs to.  If it isn't
+     *                  the cache of the previous lookup, the table is
+     *                  discarded and started over.
+     *  \param records  the package records of \b cache.
+     *
+     *  \return a reference that is valid until the cache is closed or
+     *  a version of another cache is looked up.
+     */
+    const version_sources &get_version_sources(const pkgCache::VerIterator &ver,
+					       pkgCache &cache,
+					       pkgRecords &records);
+
+    /** \brief Discard the table used by get_version_sources().
+     *
+     *  This is invoked when the cache is closed.
+     */
+    void reset_version_sources();
+  }
+}
+
+#endif // VERSION_SOURCES_H
@@ -0,0 +1,146 @@
+// decode_search_trace.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+//
+// Converts a binary resolver search trace (see search_trace.h) to
+// text or JSON Lines, and/or prints summary statistics about it.
+
+#include "search_trace.h"
+
+#include <iostream>
+#include <string>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+  void usage(const char *argv0)
+  {
+    cerr << "Usage: " << argv0 << " [--json] [--summary | --summary-only] [FILE ...]" << endl;
+    cerr << endl;
+    cerr << "Decode resolver search traces written when" << endl;
+    cerr << "Aptitude::ProblemResolver::Search-Trace-File is set.  Reads" << endl;
+    cerr << "standard input if no files are given." << endl;
+    cerr << endl;
+    cerr << "  --json          Write JSON Lines instead of plain text." << endl;
+    cerr << "  --summary       Write summary statistics after the events." << endl;
+    cerr << "  --summary-only  Write only the summary statistics." << endl;
+  }
+
+  bool decode(FILE *in, const char *name,
+	      bool json, bool write_events,
+	      search_trace_summary &summary,
+	      unsigned int &segment_offset)
+  {
+    search_trace_reader reader(in, false);
+    search_trace_event event;
+
+    while(reader.next(event))
+      {
+	const unsigned int segment = segment_offset + reader.get_segment();
+
+	if(write_events)
+	  {
+	    if(json)
+	      write_search_trace_event_json(cout, segment, event);
+	    else
+	      write_search_trace_event_text(cout, segment, event);
+	  }
+
+	update_search_trace_summary(summary, segment, event);
+      }
+
+    segment_offset += reader.get_segment();
+
+    if(reader.get_bad())
+      {
+	cerr << name << ": not a valid search trace (or truncated)" << endl;
+	return false;
+      }
+
+    return true;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool json = false;
+  bool write_summary = false;
+  bool write_events = true;
+  int first_file = argc;
+
+  for(int i = 1; i < argc; ++i)
+    {
+      if(!strcmp(argv[i], "--json"))
+	json = true;
+      else if(!strcmp(argv[i], "--summary"))
+	write_summary = true;
+      else if(!strcmp(argv[i], "--summary-only"))
+	{
+	  write_summary = true;
+	  write_events = false;
+	}
+      else if(!strcmp(argv[i], "--help"))
+	{
+	  usage(argv[0]);
+	  return 0;
+	}
+      else if(argv[i][0] == '-' && argv[i][1] != '\0')
+	{
+	  usage(argv[0]);
+	  return 1;
+	}
+      else
+	{
+	  first_file = i;
+	  break;
+	}
+    }
+
+  search_trace_summary summary;
+  unsigned int segment_offset = 0;
+  bool ok = true;
+
+  if(first_file == argc)
+    ok = decode(stdin, "<stdin>", json, write_events, summary, segment_offset);
+  else
+    for(int i = first_file; i < argc; ++i)
+      {
+	FILE *f = (strcmp(argv[i], "-") == 0) ? stdin : fopen(argv[i], "rb");
+	if(f == NULL)
+	  {
+	    perror(argv[i]);
+	    ok = false;
+	    continue;
+	  }
+
+	if(!decode(f, argv[i], json, write_events, summary, segment_offset))
+	  ok = false;
+
+	if(f != stdin)
+	  fclose(f);
+      }
+
+  if(write_summary)
+    write_search_trace_summary(cout, summary, json);
+
+  return ok ? 0 : 1;
+}
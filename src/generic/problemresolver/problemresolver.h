@@ -57,6 +57,7 @@
 #include "solution.h"
 #include "resolver_undo.h"
 #include "search_graph.h"
+#include "search_trace.h"
 #include "cost.h"
 #include "cost_limits.h"
 
@@ -557,6 +558,23 @@ private:
   logging::LoggerPtr logger;
   bool debug;
 
+  /** \brief If not NULL, a compact record of the search is written
+   *  here.
+   */
+  boost::shared_ptr<search_trace_writer> search_trace;
+
+  /** \brief Get the ID to record in the search trace for a choice:
+   *  the ID of the version it installs, or -1 if it doesn't install
+   *  a version.
+   */
+  static int get_trace_version_id(const choice &c)
+  {
+    if(c.get_type() == choice::install_version)
+      return c.get_ver().get_id();
+    else
+      return -1;
+  }
+
   search_graph graph;
 
   /** Hash function for packages: */
@@ -1066,6 +1084,10 @@ private:
       else
 	{
 	  LOG_TRACE(resolver.logger, deferred_choice << " is now deferred; marking it as such in all active steps.");
+	  if(resolver.search_trace.get() != NULL)
+	    resolver.search_trace->deferral_changed(get_trace_version_id(deferred_choice),
+						    true,
+						    deferred_choice.get_type());
 	  // Note that this is not quite right in logical terms.
 	  // Technically, the promotion we generate should contain the
 	  // choice that led to the deferral.  However, that's not
@@ -1474,6 +1496,14 @@ private:
    *  place.
    */
   void add_promotion(const promotion &p)
+  {
+    add_promotion_learned_at(-1, p);
+  }
+
+  /** \brief Add a promotion to the global set, recording the step
+   *  it was learned at (or -1) in the search trace.
+   */
+  void add_promotion_learned_at(int step_num, const promotion &p)
   {
     if(p.get_choices().size() == 0)
       LOG_TRACE(logger, "Ignoring the empty promotion " << p);
@@ -1482,6 +1512,11 @@ private:
 	LOG_TRACE(logger, "Added the promotion " << p
 		  << " to the global promotion set.");
 
+	if(search_trace.get() != NULL)
+	  search_trace->promotion_learned(promotion_queue_tail->get_index(),
+					  step_num,
+					  p.get_choices().size());
+
 	promotion_queue_tail->set_promotion(p);
 	eassert(promotion_queue_tail->get_has_contents());
 	promotion_queue_tail = promotion_queue_tail->get_next();
@@ -1523,7 +1558,7 @@ private:
    */
   void add_promotion(int step_num, const promotion &p)
   {
-    add_promotion(p);
+    add_promotion_learned_at(step_num, p);
     graph.schedule_promotion_propagation(step_num, p);
   }
 
@@ -2156,7 +2191,7 @@ private:
       user_approved_or_rejected_versions.find(v);
 
     if(found == user_approved_or_rejected_versions.end())
-      found = user_approved_or_rejected_versions.insert(std::make_pair(v, approved_or_rejected_info(v, logger->isEnabledFor(logging::TRACE_LEVEL)))).first;
+      found = user_approved_or_rejected_versions.insert(std::make_pair(v, approved_or_rejected_info(v, LOG_ENABLED(logging::TRACE_LEVEL, logger)))).first;
 
     return found->second;
   }
@@ -2167,7 +2202,7 @@ private:
       user_approved_or_rejected_broken_deps.find(d);
 
     if(found == user_approved_or_rejected_broken_deps.end())
-      found = user_approved_or_rejected_broken_deps.insert(std::make_pair(d, approved_or_rejected_info(d, logger->isEnabledFor(logging::TRACE_LEVEL)))).first;
+      found = user_approved_or_rejected_broken_deps.insert(std::make_pair(d, approved_or_rejected_info(d, LOG_ENABLED(logging::TRACE_LEVEL, logger)))).first;
 
     return found->second;
   }
@@ -2347,6 +2382,10 @@ private:
 			  const dep &deferral_dep)
   {
     LOG_TRACE(logger, "The choice " << deferral_choice << " is no longer deferred; recomputing its cost in all steps.");
+    if(search_trace.get() != NULL)
+      search_trace->deferral_changed(get_trace_version_id(deferral_choice),
+				     false,
+				     deferral_choice.get_type());
 
     invoke_recompute_solver_cost recompute_f(*this, deferral_dep);
     graph.for_each_step_related_to_choice_with_dep(deferral_choice,
@@ -2992,6 +3031,9 @@ private:
 
     if(!s.effective_step_cost.is_above_or_equal(p_cost))
       {
+        if(search_trace.get() != NULL)
+          search_trace->promotion_applied(s.step_num, -1, p.get_choices().size());
+
         cost new_effective_step_cost =
           cost::least_upper_bound(p_cost, s.effective_step_cost);
 
@@ -3107,6 +3149,10 @@ private:
     LOG_TRACE(logger, "Applying the promotion " << p
 	      << " to the solver " << solver
 	      << " in the step " << s.step_num);
+    if(search_trace.get() != NULL)
+      search_trace->promotion_applied(s.step_num,
+				      get_trace_version_id(solver),
+				      p.get_choices().size());
     const cost &new_cost(p.get_cost());
     // There are really two cases here: either the cost was increased
     // to the point that the solver should be ejected, or the cost
@@ -3539,6 +3585,10 @@ private:
 	      << " for the action " << c
 	      << " with intrinsic cost " << c_cost
 	      << " and outputting to step " << output.step_num);
+    if(search_trace.get() != NULL)
+      search_trace->successor_generated(parent.step_num,
+					output.step_num,
+					get_trace_version_id(c));
 
     // We need a dependency to correctly generate the deferral
     // information.
@@ -3624,6 +3674,10 @@ private:
     LOG_TRACE(logger, "Generated step " << output.step_num
 	      << " (" << output.actions.size() << " actions): " << output.actions << ";T" << output.final_step_cost
 	      << "S" << output.score);
+    if(search_trace.get() != NULL)
+      search_trace->step_created(output.step_num,
+				 parent.step_num,
+				 output.score);
 
     if(is_discard_cost(output.final_step_cost))
       // TODO: this is wrong!  Should check for deferral, not discarding.
@@ -3805,7 +3859,7 @@ public:
 	if(!universe.is_candidate_for_initial_set(d))
 	  {
 	    // This test is slow and only used for logging:
-	    if(logger->isEnabledFor(logging::TRACE_LEVEL))
+	    if(LOG_ENABLED(logging::TRACE_LEVEL, logger))
 	      {
 		if(!d.broken_under(initial_state))
 		  LOG_TRACE(logger, "Not using " << d
@@ -3872,6 +3926,16 @@ public:
     debug = new_debug;
   }
 
+  /** \brief Write a binary trace of the search to the given writer.
+   *
+   *  \param trace  The writer to use, or a NULL pointer to disable
+   *                tracing.
+   */
+  void set_search_trace(const boost::shared_ptr<search_trace_writer> &trace)
+  {
+    search_trace = trace;
+  }
+
   /** Clears all the internal state of the solver, discards solutions,
    *  zeroes out scores.  Call this routine after changing the state
    *  of packages to avoid inconsistent results.
@@ -4493,6 +4557,8 @@ private:
 	else
 	  {
 	    LOG_TRACE(logger, "Processing step " << step_num);
+	    if(search_trace.get() != NULL)
+	      search_trace->step_processed(step_num, s.actions.size(), s.score);
 
 	    closed[step_contents(s.score, s.action_score, s.actions)] =
 	      step_num;
@@ -4503,6 +4569,11 @@ private:
 		LOG_INFO(logger, " --- Found solution at step " << s.step_num
 			 << ": " << s.actions << ";T" << s.final_step_cost
 			 << "S" << s.score);
+		if(search_trace.get() != NULL)
+		  {
+		    search_trace->solution_found(s.step_num, s.actions.size(), s.score);
+		    search_trace->flush();
+		  }
 
 		// Remember this solution, so we don't try to return it
 		// again in the future.
@@ -4625,6 +4696,8 @@ public:
 
 	LOG_TRACE(logger, "Inserting the root at step " << root.step_num
 		  << " with cost " << root.final_step_cost);
+	if(search_trace.get() != NULL)
+	  search_trace->step_created(root.step_num, -1, root.score);
 	pending.insert(root.step_num);
       }
 
@@ -4672,7 +4745,7 @@ public:
 	process_pending_promotions();
       }
 
-    if(logger->isEnabledFor(logging::TRACE_LEVEL))
+    if(LOG_ENABLED(logging::TRACE_LEVEL, logger))
       {
 	if(most_future_solution_steps > future_horizon)
 	  LOG_TRACE(logger, "Done examining future steps for a better solution.");
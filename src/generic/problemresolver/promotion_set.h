@@ -1739,7 +1739,7 @@ private:
 				   const logging::LoggerPtr &logger,
 				   const Pred &pred)
   {
-    if(logger->isEnabledFor(logging::TRACE_LEVEL))
+    if(LOG_ENABLED(logging::TRACE_LEVEL, logger))
       {
 	for(typename std::vector<entry_ref>::const_iterator it =
 	      entries.begin(); it != entries.end(); ++it)
@@ -0,0 +1,399 @@
+/** \file search_trace.cc */
+
+
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#include "search_trace.h"
+
+#include <ostream>
+
+#include <string.h>
+
+const char search_trace_writer::magic[8] = { 'A', 'P', 'T', 'R', 'S', 'T', 'R', 'C' };
+
+namespace
+{
+  // The segment header is the magic string followed by the format
+  // version and the record size.
+  const size_t header_size = 16;
+
+  void put_u32(unsigned char *buf, unsigned int value)
+  {
+    buf[0] = value & 0xff;
+    buf[1] = (value >> 8) & 0xff;
+    buf[2] = (value >> 16) & 0xff;
+    buf[3] = (value >> 24) & 0xff;
+  }
+
+  void put_u64(unsigned char *buf, unsigned long long value)
+  {
+    put_u32(buf, (unsigned int)(value & 0xffffffffULL));
+    put_u32(buf + 4, (unsigned int)(value >> 32));
+  }
+
+  unsigned int get_u32(const unsigned char *buf)
+  {
+    return
+      (unsigned int)buf[0] |
+      ((unsigned int)buf[1] << 8) |
+      ((unsigned int)buf[2] << 16) |
+      ((unsigned int)buf[3] << 24);
+  }
+
+  unsigned long long get_u64(const unsigned char *buf)
+  {
+    return
+      (unsigned long long)get_u32(buf) |
+      ((unsigned long long)get_u32(buf + 4) << 32);
+  }
+}
+
+const char *search_trace_event_name(int type)
+{
+  switch(type)
+    {
+    case search_trace_step_created:        return "step-created";
+    case search_trace_step_processed:      return "step-processed";
+    case search_trace_promotion_learned:   return "promotion-learned";
+    case search_trace_promotion_applied:   return "promotion-applied";
+    case search_trace_successor_generated: return "successor-generated";
+    case search_trace_deferral_changed:    return "deferral-changed";
+    case search_trace_solution_found:      return "solution-found";
+    default:                               return NULL;
+    }
+}
+
+search_trace_writer::search_trace_writer(FILE *_out)
+  : out(_out)
+{
+  gettimeofday(&start, NULL);
+
+  unsigned char header[header_size];
+  memcpy(header, magic, sizeof(magic));
+  put_u32(header + 8, format_version);
+  put_u32(header + 12, record_size);
+
+  fwrite(header, 1, sizeof(header), out);
+}
+
+search_trace_writer::~search_trace_writer()
+{
+  fclose(out);
+}
+
+boost::shared_ptr<search_trace_writer>
+search_trace_writer::open(const std::string &filename)
+{
+  FILE *f = fopen(filename.c_str(), "ab");
+  if(f == NULL)
+    return boost::shared_ptr<search_trace_writer>();
+
+  // Events are small and frequent; use a large buffer so that the
+  // search loop rarely has to wait on a write.
+  setvbuf(f, NULL, _IOFBF, 1 << 16);
+
+  return boost::shared_ptr<search_trace_writer>(new search_trace_writer(f));
+}
+
+void search_trace_writer::write_record(search_trace_event_type type,
+				       int arg1, int arg2, int arg3)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  const long long elapsed =
+    (long long)(now.tv_sec - start.tv_sec) * 1000000LL +
+    (now.tv_usec - start.tv_usec);
+
+  unsigned char record[record_size];
+  put_u32(record, type);
+  put_u64(record + 4, elapsed < 0 ? 0 : elapsed);
+  put_u32(record + 12, arg1);
+  put_u32(record + 16, arg2);
+  put_u32(record + 20, arg3);
+
+  fwrite(record, 1, sizeof(record), out);
+}
+
+void search_trace_writer::flush()
+{
+  fflush(out);
+}
+
+search_trace_reader::search_trace_reader(FILE *_in, bool _owns_in)
+  : in(_in), owns_in(_owns_in), segment(0), bad(false)
+{
+}
+
+search_trace_reader::~search_trace_reader()
+{
+  if(owns_in)
+    fclose(in);
+}
+
+bool search_trace_reader::read_header()
+{
+  // The first four bytes of the magic have already been consumed by
+  // next().
+  unsigned char header[header_size - 4];
+  if(fread(header, 1, sizeof(header), in) != sizeof(header) ||
+     memcmp(header, search_trace_writer::magic + 4, 4) != 0 ||
+     get_u32(header + 4) != search_trace_writer::format_version ||
+     get_u32(header + 8) != search_trace_writer::record_size)
+    {
+      bad = true;
+      return false;
+    }
+
+  ++segment;
+  return true;
+}
+
+bool search_trace_reader::next(search_trace_event &event)
+{
+  unsigned char record[search_trace_writer::record_size];
+
+  while(!bad)
+    {
+      // Records start with a small event type, so they can't be
+      // confused with the magic string that starts a new segment.
+      const size_t amt = fread(record, 1, 4, in);
+      if(amt == 0)
+	return false;
+      else if(amt != 4)
+	{
+	  bad = true;
+	  return false;
+	}
+
+      if(memcmp(record, search_trace_writer::magic, 4) == 0)
+	{
+	  if(!read_header())
+	    return false;
+	  continue;
+	}
+
+      if(segment == 0 ||
+	 fread(record + 4, 1, sizeof(record) - 4, in) != sizeof(record) - 4)
+	{
+	  bad = true;
+	  return false;
+	}
+
+      event.type = get_u32(record);
+      event.timestamp = get_u64(record + 4);
+      event.arg1 = (int)get_u32(record + 12);
+      event.arg2 = (int)get_u32(record + 16);
+      event.arg3 = (int)get_u32(record + 20);
+
+      return true;
+    }
+
+  return false;
+}
+
+namespace
+{
+  void write_timestamp(std::ostream &out, unsigned long long timestamp)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%llu.%06llu",
+	     timestamp / 1000000, timestamp % 1000000);
+    out << buf;
+  }
+
+  // The names of the arguments of each event type, used to label
+  // them in the decoded output.
+  void get_argument_names(int type,
+			  const char *&name1,
+			  const char *&name2,
+			  const char *&name3)
+  {
+    switch(type)
+      {
+      case search_trace_step_created:
+	name1 = "step"; name2 = "parent"; name3 = "score";
+	break;
+      case search_trace_step_processed:
+      case search_trace_solution_found:
+	name1 = "step"; name2 = "actions"; name3 = "score";
+	break;
+      case search_trace_promotion_learned:
+	name1 = "promotion"; name2 = "step"; name3 = "choices";
+	break;
+      case search_trace_promotion_applied:
+	name1 = "step"; name2 = "solver"; name3 = "choices";
+	break;
+      case search_trace_successor_generated:
+	name1 = "parent"; name2 = "child"; name3 = "version";
+	break;
+      case search_trace_deferral_changed:
+	name1 = "version"; name2 = "deferred"; name3 = "choice_type";
+	break;
+      default:
+	name1 = "arg1"; name2 = "arg2"; name3 = "arg3";
+	break;
+      }
+  }
+}
+
+void write_search_trace_event_text(std::ostream &out,
+				   unsigned int segment,
+				   const search_trace_event &event)
+{
+  const char *name = search_trace_event_name(event.type);
+  const char *name1, *name2, *name3;
+  get_argument_names(event.type, name1, name2, name3);
+
+  out << "[" << segment << "] ";
+  write_timestamp(out, event.timestamp);
+  out << " ";
+  if(name != NULL)
+    out << name;
+  else
+    out << "unknown-" << event.type;
+  out << " " << name1 << "=" << event.arg1
+      << " " << name2 << "=" << event.arg2
+      << " " << name3 << "=" << event.arg3
+      << std::endl;
+}
+
+void write_search_trace_event_json(std::ostream &out,
+				   unsigned int segment,
+				   const search_trace_event &event)
+{
+  const char *name = search_trace_event_name(event.type);
+  const char *name1, *name2, *name3;
+  get_argument_names(event.type, name1, name2, name3);
+
+  out << "{\"segment\": " << segment
+      << ", \"time\": ";
+  write_timestamp(out, event.timestamp);
+  out << ", \"event\": ";
+  if(name != NULL)
+    out << "\"" << name << "\"";
+  else
+    out << event.type;
+  out << ", \"" << name1 << "\": " << event.arg1
+      << ", \"" << name2 << "\": " << event.arg2
+      << ", \"" << name3 << "\": " << event.arg3
+      << "}" << std::endl;
+}
+
+void update_search_trace_summary(search_trace_summary &summary,
+				 unsigned int segment,
+				 const search_trace_event &event)
+{
+  if(segment != summary.segments)
+    {
+      summary.segments = segment;
+      summary.step_depths.clear();
+    }
+
+  if(event.type > 0 && (size_t)event.type < summary.event_counts.size())
+    ++summary.event_counts[event.type];
+
+  if(event.timestamp > summary.longest_segment_duration)
+    summary.longest_segment_duration = event.timestamp;
+
+  switch(event.type)
+    {
+    case search_trace_step_created:
+      if(event.arg1 >= 0)
+	{
+	  unsigned int depth = 0;
+	  if(event.arg2 >= 0 && (size_t)event.arg2 < summary.step_depths.size())
+	    depth = summary.step_depths[event.arg2] + 1;
+
+	  if((size_t)event.arg1 >= summary.step_depths.size())
+	    summary.step_depths.resize(event.arg1 + 1, 0);
+	  summary.step_depths[event.arg1] = depth;
+
+	  if(depth > summary.max_depth)
+	    summary.max_depth = depth;
+	}
+      break;
+
+    case search_trace_solution_found:
+      if(!summary.found_solution)
+	{
+	  summary.found_solution = true;
+	  summary.time_to_first_solution = event.timestamp;
+	}
+      break;
+
+    default:
+      break;
+    }
+}
+
+void write_search_trace_summary(std::ostream &out,
+				const search_trace_summary &summary,
+				bool json)
+{
+  if(json)
+    {
+      out << "{\"segments\": " << summary.segments
+	  << ", \"longest_segment\": ";
+      write_timestamp(out, summary.longest_segment_duration);
+      out << ", \"time_to_first_solution\": ";
+      if(summary.found_solution)
+	write_timestamp(out, summary.time_to_first_solution);
+      else
+	out << "null";
+      out << ", \"max_depth\": " << summary.max_depth
+	  << ", \"counts\": {";
+
+      bool first = true;
+      for(size_t i = 0; i < summary.event_counts.size(); ++i)
+	{
+	  const char *name = search_trace_event_name(i);
+	  if(name == NULL)
+	    continue;
+
+	  if(!first)
+	    out << ", ";
+	  first = false;
+	  out << "\"" << name << "\": " << summary.event_counts[i];
+	}
+      out << "}}" << std::endl;
+    }
+  else
+    {
+      out << "Segments: " << summary.segments << std::endl;
+      out << "Longest segment: ";
+      write_timestamp(out, summary.longest_segment_duration);
+      out << "s" << std::endl;
+      out << "Time to first solution: ";
+      if(summary.found_solution)
+	{
+	  write_timestamp(out, summary.time_to_first_solution);
+	  out << "s" << std::endl;
+	}
+      else
+	out << "none found" << std::endl;
+      out << "Maximum depth: " << summary.max_depth << std::endl;
+
+      for(size_t i = 0; i < summary.event_counts.size(); ++i)
+	{
+	  const char *name = search_trace_event_name(i);
+	  if(name != NULL)
+	    out << name << ": " << summary.event_counts[i] << std::endl;
+	}
+    }
+}
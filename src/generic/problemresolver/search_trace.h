@@ -0,0 +1,299 @@
+/** \file search_trace.h */    // -*-c++-*-
+
+
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#ifndef SEARCH_TRACE_H
+#define SEARCH_TRACE_H
+
+#include <boost/shared_ptr.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <sys/time.h>
+
+/** \brief The kinds of event that can appear in a binary search
+ *  trace.
+ *
+ *  The numeric values are part of the file format; don't renumber
+ *  them.  Each event carries three integer arguments whose meaning
+ *  depends on the event type; "version" below means the universe ID
+ *  of a version, or -1 if the choice doesn't install a version.
+ */
+enum search_trace_event_type
+  {
+    /** \brief A step was added to the search graph.
+     *
+     *  Arguments: step number, parent step number (-1 for the root),
+     *  score.
+     */
+    search_trace_step_created = 1,
+
+    /** \brief A step was taken off the open queue and expanded.
+     *
+     *  Arguments: step number, number of actions, score.
+     */
+    search_trace_step_processed = 2,
+
+    /** \brief A new promotion was added to the global promotion set.
+     *
+     *  Arguments: promotion index in the promotion queue, step
+     *  number it was learned at (-1 if none), number of choices.
+     */
+    search_trace_promotion_learned = 3,
+
+    /** \brief A promotion raised the cost of a step or of one of its
+     *  solvers.
+     *
+     *  Arguments: step number, solver version (-1 if the promotion
+     *  applied to the step's action set), number of choices in the
+     *  promotion.
+     */
+    search_trace_promotion_applied = 4,
+
+    /** \brief A successor step is being generated.
+     *
+     *  Arguments: parent step number, child step number, version
+     *  installed by the new choice.
+     */
+    search_trace_successor_generated = 5,
+
+    /** \brief A choice became deferred or stopped being deferred.
+     *
+     *  Arguments: version, 1 if the choice is now deferred or 0 if
+     *  the deferral was retracted, choice type.
+     */
+    search_trace_deferral_changed = 6,
+
+    /** \brief A solution was found.
+     *
+     *  Arguments: step number, number of actions, score.
+     */
+    search_trace_solution_found = 7
+  };
+
+/** \brief Get a short name for an event type, or NULL if the type
+ *  is unknown.
+ */
+const char *search_trace_event_name(int type);
+
+/** \brief A single decoded trace event. */
+struct search_trace_event
+{
+  int type;
+  /** \brief Microseconds since the start of the trace segment. */
+  unsigned long long timestamp;
+  int arg1, arg2, arg3;
+
+  search_trace_event()
+    : type(0), timestamp(0), arg1(0), arg2(0), arg3(0)
+  {
+  }
+};
+
+/** \brief Writes a compact binary stream of resolver search events.
+ *
+ *  Text TRACE logging of the resolver formats every choice set it
+ *  mentions, which makes it far too slow and bulky to leave enabled.
+ *  This writer records just the shape of the search: each event is a
+ *  fixed-size record holding an event type, a timestamp and three
+ *  integers, appended to a buffered file.
+ *
+ *  A trace file is a sequence of segments, one per resolver instance.
+ *  Each segment starts with a header (magic, format version and
+ *  record size) followed by records.  All integers are stored in
+ *  little-endian order.  Use decode-search-trace (built in this
+ *  directory) to convert a trace to text or JSON.
+ *
+ *  The writer is not thread-safe; each resolver owns its own writer
+ *  and only touches it from the thread running the search.
+ */
+class search_trace_writer
+{
+  FILE *out;
+  struct timeval start;
+
+  search_trace_writer(FILE *_out);
+  search_trace_writer(const search_trace_writer &);
+
+  void write_record(search_trace_event_type type,
+		    int arg1, int arg2, int arg3);
+
+public:
+  /** \brief The magic string at the start of each segment. */
+  static const char magic[8];
+
+  /** \brief The version of the format written by this code. */
+  static const unsigned int format_version = 1;
+
+  /** \brief The size in bytes of each event record. */
+  static const unsigned int record_size = 24;
+
+  ~search_trace_writer();
+
+  /** \brief Open a trace file for appending and write a segment
+   *  header to it.
+   *
+   *  \return the new writer, or a NULL pointer if the file couldn't
+   *  be opened.
+   */
+  static boost::shared_ptr<search_trace_writer> open(const std::string &filename);
+
+  void step_created(int step_num, int parent_step_num, int score)
+  {
+    write_record(search_trace_step_created, step_num, parent_step_num, score);
+  }
+
+  void step_processed(int step_num, int num_actions, int score)
+  {
+    write_record(search_trace_step_processed, step_num, num_actions, score);
+  }
+
+  void promotion_learned(int promotion_index, int step_num, int num_choices)
+  {
+    write_record(search_trace_promotion_learned, promotion_index, step_num, num_choices);
+  }
+
+  void promotion_applied(int step_num, int solver_version, int num_choices)
+  {
+    write_record(search_trace_promotion_applied, step_num, solver_version, num_choices);
+  }
+
+  void successor_generated(int parent_step_num, int child_step_num, int version)
+  {
+    write_record(search_trace_successor_generated, parent_step_num, child_step_num, version);
+  }
+
+  void deferral_changed(int version, bool deferred, int choice_type)
+  {
+    write_record(search_trace_deferral_changed, version, deferred ? 1 : 0, choice_type);
+  }
+
+  void solution_found(int step_num, int num_actions, int score)
+  {
+    write_record(search_trace_solution_found, step_num, num_actions, score);
+  }
+
+  /** \brief Push buffered records to the operating system. */
+  void flush();
+};
+
+/** \brief Aggregate statistics computed from a decoded trace. */
+struct search_trace_summary
+{
+  /** \brief The number of segments (resolver instances) seen. */
+  unsigned int segments;
+
+  /** \brief The number of events of each type, indexed by type. */
+  std::vector<unsigned long long> event_counts;
+
+  /** \brief The largest timestamp seen in any segment. */
+  unsigned long long longest_segment_duration;
+
+  /** \brief \b true if any segment found a solution. */
+  bool found_solution;
+
+  /** \brief The timestamp of the first solution in the first
+   *  segment that found one; only meaningful if found_solution is
+   *  set.
+   */
+  unsigned long long time_to_first_solution;
+
+  /** \brief The depth of the deepest step that was created. */
+  unsigned int max_depth;
+
+  /** \brief Scratch space: the depth of each step in the current
+   *  segment, indexed by step number.
+   */
+  std::vector<unsigned int> step_depths;
+
+  search_trace_summary()
+    : segments(0), event_counts(search_trace_solution_found + 1, 0),
+      longest_segment_duration(0),
+      found_solution(false), time_to_first_solution(0),
+      max_depth(0)
+  {
+  }
+};
+
+/** \brief Reads events back out of a trace file. */
+class search_trace_reader
+{
+  FILE *in;
+  bool owns_in;
+  unsigned int segment;
+  bool bad;
+
+  bool read_header();
+
+  search_trace_reader(const search_trace_reader &);
+
+public:
+  /** \brief Create a reader for the given stream.
+   *
+   *  \param _in      The stream to read from.
+   *  \param _owns_in If \b true, the stream is closed when the
+   *                  reader is destroyed.
+   */
+  search_trace_reader(FILE *_in, bool _owns_in);
+  ~search_trace_reader();
+
+  /** \brief Read the next event.
+   *
+   *  \return \b false at the end of the input or if the input is
+   *  malformed (in which case get_bad() returns \b true).
+   */
+  bool next(search_trace_event &event);
+
+  /** \brief Return the 1-based index of the segment containing the
+   *  most recently read event.
+   */
+  unsigned int get_segment() const { return segment; }
+
+  /** \brief Return \b true if the input was not a valid trace. */
+  bool get_bad() const { return bad; }
+};
+
+/** \brief Write a human-readable description of an event. */
+void write_search_trace_event_text(std::ostream &out,
+				   unsigned int segment,
+				   const search_trace_event &event);
+
+/** \brief Write an event as a single-line JSON object. */
+void write_search_trace_event_json(std::ostream &out,
+				   unsigned int segment,
+				   const search_trace_event &event);
+
+/** \brief Incorporate a single event into a summary.
+ *
+ *  \param segment The segment the event was read from, as returned
+ *                 by search_trace_reader::get_segment().
+ */
+void update_search_trace_summary(search_trace_summary &summary,
+				 unsigned int segment,
+				 const search_trace_event &event);
+
+/** \brief Write a summary in text or JSON form. */
+void write_search_trace_summary(std::ostream &out,
+				const search_trace_summary &summary,
+				bool json);
+
+#endif // SEARCH_TRACE_H
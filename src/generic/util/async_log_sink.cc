@@ -0,0 +1,626 @@
+/** \file async_log_sink.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "async_log_sink.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <cwidget/generic/threads/threads.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+using boost::make_shared;
+using boost::shared_ptr;
+using cwidget::threads::condition;
+using cwidget::threads::mutex;
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace logging
+    {
+      async_log_sink::~async_log_sink()
+      {
+      }
+
+      namespace
+      {
+        /** \brief A single-producer, single-consumer byte ring.
+         *
+         *  The producer is the thread that owns the ring; the
+         *  consumer is the writer thread.  head is only written by
+         *  the producer and tail only by the consumer, so the only
+         *  synchronization needed is a memory barrier between filling
+         *  in the bytes and publishing the new index.
+         *
+         *  Indices increase monotonically and are reduced modulo the
+         *  capacity when the buffer is accessed.
+         */
+        class log_ring
+        {
+          std::vector<char> buf;
+          const size_t mask;
+
+          volatile size_t head;
+          volatile size_t tail;
+
+          // Written only by the producer.
+          volatile unsigned long long committed;
+          volatile unsigned long long dropped;
+
+          // Set when the owning thread exits; the consumer drains
+          // the ring one last time and then forgets it.
+          volatile int abandoned;
+
+          // Used only by the consumer.
+          unsigned long long dropped_reported;
+          unsigned long long committed_drained;
+
+          // Cache of the formatted timestamp, so that we only call
+          // localtime_r() once per second per thread.
+          time_t cached_time;
+          char cached_time_str[32];
+          size_t cached_time_len;
+
+          const pthread_t owner;
+
+          void put(size_t &pos, const char *data, size_t len)
+          {
+            const size_t capacity = mask + 1;
+            const size_t offset = pos & mask;
+            const size_t first = std::min(len, capacity - offset);
+
+            memcpy(&buf[offset], data, first);
+            if(first < len)
+              memcpy(&buf[0], data + first, len - first);
+
+            pos += len;
+          }
+
+        public:
+          log_ring(size_t capacity, pthread_t _owner)
+            : buf(capacity), mask(capacity - 1),
+              head(0), tail(0),
+              committed(0), dropped(0),
+              abandoned(0),
+              dropped_reported(0), committed_drained(0),
+              cached_time(0), cached_time_len(0),
+              owner(_owner)
+          {
+            cached_time_str[0] = '\0';
+          }
+
+          pthread_t get_owner() const { return owner; }
+
+          unsigned long long get_dropped() const { return dropped; }
+
+          /** \brief Note that the owning thread has exited. */
+          void abandon()
+          {
+            __sync_lock_test_and_set(&abandoned, 1);
+          }
+
+          bool is_abandoned() const
+          {
+            __sync_synchronize();
+            return abandoned != 0;
+          }
+
+          /** \brief Append one formatted log line (producer side). */
+          void push(const char *sourceFilename,
+                    int sourceLineNumber,
+                    log_level level,
+                    const std::string &category,
+                    const std::string &msg)
+          {
+            const time_t now = time(NULL);
+            if(now != cached_time || cached_time_len == 0)
+              {
+                struct tm local_now;
+                localtime_r(&now, &local_now);
+                cached_time_len = strftime(cached_time_str,
+                                           sizeof(cached_time_str),
+                                           "%F %T", &local_now);
+                cached_time = now;
+              }
+
+            char header[512];
+            int header_len = snprintf(header, sizeof(header),
+                                      " [%lu] %s:%d %s ",
+                                      (unsigned long)owner,
+                                      sourceFilename,
+                                      sourceLineNumber,
+                                      describe_log_level(level));
+            if(header_len < 0)
+              header_len = 0;
+            else if((size_t)header_len >= sizeof(header))
+              header_len = sizeof(header) - 1;
+
+            static const char separator[] = " - ";
+            const size_t needed =
+              cached_time_len + header_len +
+              category.size() + (sizeof(separator) - 1) +
+              msg.size() + 1;
+
+            __sync_synchronize();
+            const size_t current_tail = tail;
+            const size_t available = (mask + 1) - (head - current_tail);
+
+            if(needed > available)
+              {
+                dropped = dropped + 1;
+                return;
+              }
+
+            size_t pos = head;
+            put(pos, cached_time_str, cached_time_len);
+            put(pos, header, header_len);
+            put(pos, category.data(), category.size());
+            put(pos, separator, sizeof(separator) - 1);
+            put(pos, msg.data(), msg.size());
+            put(pos, "\n", 1);
+
+            // Make sure the text is visible before the new head is,
+            // and the new head before the new count: the consumer
+            // reads them in the opposite order, so that every message
+            // it counts is in the bytes it drains.
+            __sync_synchronize();
+            head = pos;
+            __sync_synchronize();
+            committed = committed + 1;
+          }
+
+          /** \brief Move everything that's been published into out
+           *  (consumer side).
+           *
+           *  \return the number of messages that were completely
+           *  published before the bytes were copied out and haven't
+           *  been returned by an earlier call.  A message that was
+           *  published while this was running is returned by the next
+           *  call.
+           */
+          unsigned long long drain(std::string &out)
+          {
+            const unsigned long long current_committed = committed;
+            __sync_synchronize();
+            const size_t current_head = head;
+            __sync_synchronize();
+
+            const size_t current_tail = tail;
+            const size_t len = current_head - current_tail;
+            if(len > 0)
+              {
+                const size_t capacity = mask + 1;
+                const size_t offset = current_tail & mask;
+                const size_t first = std::min(len, capacity - offset);
+
+                out.append(&buf[offset], first);
+                if(first < len)
+                  out.append(&buf[0], len - first);
+              }
+
+            const unsigned long long current_dropped = dropped;
+            if(current_dropped != dropped_reported)
+              {
+                char note[128];
+                const int note_len =
+                  snprintf(note, sizeof(note),
+                           "[%lu] *** %llu log messages dropped (ring buffer full) ***\n",
+                           (unsigned long)owner,
+                           current_dropped - dropped_reported);
+                if(note_len > 0)
+                  out.append(note, std::min((size_t)note_len, sizeof(note) - 1));
+                dropped_reported = current_dropped;
+              }
+
+            // Don't let the producer reuse the space until we're
+            // done copying out of it.
+            __sync_synchronize();
+            tail = current_head;
+
+            const unsigned long long rval = current_committed - committed_drained;
+            committed_drained = current_committed;
+            return rval;
+          }
+        };
+
+        // Thread-local cache of the ring used by the most recent
+        // sink this thread logged to.  Sinks are identified by a
+        // serial number that is never reused, so a stale entry left
+        // behind by a destroyed sink is never dereferenced.
+        __thread unsigned long cached_sink_serial = 0;
+        __thread log_ring *cached_ring = NULL;
+
+        unsigned long next_sink_serial = 0;
+
+        /** \brief The rings that one thread logs to, by sink serial
+         *  number.
+         *
+         *  Rings are looked up here rather than by thread ID, since
+         *  the ID of a thread that exited can be given to a new
+         *  thread.  The sink owns the rings; these references only
+         *  let the thread mark its rings as abandoned when it exits.
+         */
+        typedef std::vector<std::pair<unsigned long, boost::weak_ptr<log_ring> > > thread_rings;
+
+        pthread_key_t thread_rings_key;
+        pthread_once_t thread_rings_key_once = PTHREAD_ONCE_INIT;
+
+        void abandon_thread_rings(void *p)
+        {
+          thread_rings *rings = static_cast<thread_rings *>(p);
+
+          // The sink forgets the rings once it has drained them, so
+          // anything this thread logs from now on needs a new one.
+          cached_sink_serial = 0;
+          cached_ring = NULL;
+
+          for(thread_rings::const_iterator it = rings->begin();
+              it != rings->end(); ++it)
+            {
+              const shared_ptr<log_ring> ring(it->second.lock());
+              if(ring.get() != NULL)
+                ring->abandon();
+            }
+
+          delete rings;
+        }
+
+        void create_thread_rings_key()
+        {
+          pthread_key_create(&thread_rings_key, &abandon_thread_rings);
+        }
+
+        thread_rings &get_thread_rings()
+        {
+          pthread_once(&thread_rings_key_once, &create_thread_rings_key);
+
+          thread_rings *rval =
+            static_cast<thread_rings *>(pthread_getspecific(thread_rings_key));
+          if(rval == NULL)
+            {
+              rval = new thread_rings;
+              pthread_setspecific(thread_rings_key, rval);
+            }
+
+          return *rval;
+        }
+
+        class async_log_sink_impl : public async_log_sink
+        {
+          const unsigned long serial;
+          const size_t ring_size;
+          const unsigned int flush_interval_ms;
+
+          int fd;
+          bool owns_fd;
+
+          // Protects the list of rings and the writer-thread control
+          // state below.
+          mutex state_mutex;
+          condition state_changed;
+
+          std::vector<shared_ptr<log_ring> > rings;
+
+          // Dropped messages counted by rings that have been
+          // forgotten.
+          unsigned long long retired_dropped;
+
+          bool stopping;
+          unsigned long flush_requested;
+          unsigned long flush_completed;
+
+          unsigned long long written;
+          unsigned long long batches;
+
+          shared_ptr<cwidget::threads::thread> writer_thread;
+
+          class bootstrap
+          {
+            async_log_sink_impl *target;
+
+          public:
+            bootstrap(async_log_sink_impl *_target)
+              : target(_target)
+            {
+            }
+
+            void operator()() const
+            {
+              target->run_writer();
+            }
+          };
+
+          log_ring &get_ring();
+          bool write_batch(const std::string &batch);
+          void run_writer();
+
+        public:
+          async_log_sink_impl(const std::string &filename,
+                              size_t _ring_size,
+                              unsigned int _flush_interval_ms);
+          ~async_log_sink_impl();
+
+          void log_message(const char *sourceFilename,
+                           int sourceLineNumber,
+                           log_level level,
+                           LoggerPtr logger,
+                           std::string msg);
+
+          void flush();
+
+          async_log_sink_stats get_stats();
+        };
+
+        async_log_sink_impl::async_log_sink_impl(const std::string &filename,
+                                                 size_t _ring_size,
+                                                 unsigned int _flush_interval_ms)
+          : serial(__sync_add_and_fetch(&next_sink_serial, 1)),
+            ring_size(_ring_size),
+            flush_interval_ms(_flush_interval_ms),
+            fd(-1),
+            owns_fd(false),
+            retired_dropped(0),
+            stopping(false),
+            flush_requested(0),
+            flush_completed(0),
+            written(0),
+            batches(0)
+        {
+          if(filename == "-")
+            fd = STDOUT_FILENO;
+          else
+            {
+              fd = open(filename.c_str(),
+                        O_WRONLY | O_APPEND | O_CREAT,
+                        0644);
+              owns_fd = (fd != -1);
+            }
+
+          writer_thread = make_shared<cwidget::threads::thread>(bootstrap(this));
+        }
+
+        async_log_sink_impl::~async_log_sink_impl()
+        {
+          {
+            mutex::lock l(state_mutex);
+            stopping = true;
+            state_changed.wake_all();
+          }
+
+          writer_thread->join();
+
+          if(owns_fd)
+            close(fd);
+        }
+
+        log_ring &async_log_sink_impl::get_ring()
+        {
+          if(cached_sink_serial == serial && cached_ring != NULL)
+            return *cached_ring;
+
+          thread_rings &my_rings = get_thread_rings();
+
+          log_ring *rval = NULL;
+          for(thread_rings::iterator it = my_rings.begin();
+              rval == NULL && it != my_rings.end(); )
+            {
+              const shared_ptr<log_ring> ring(it->second.lock());
+              if(ring.get() == NULL)
+                // The sink was destroyed.
+                it = my_rings.erase(it);
+              else
+                {
+                  if(it->first == serial)
+                    rval = ring.get();
+                  ++it;
+                }
+            }
+
+          if(rval == NULL)
+            {
+              shared_ptr<log_ring> r = make_shared<log_ring>(ring_size, pthread_self());
+
+              {
+                mutex::lock l(state_mutex);
+                rings.push_back(r);
+              }
+
+              my_rings.push_back(std::make_pair(serial, boost::weak_ptr<log_ring>(r)));
+              rval = r.get();
+            }
+
+          cached_sink_serial = serial;
+          cached_ring = rval;
+
+          return *rval;
+        }
+
+        void async_log_sink_impl::log_message(const char *sourceFilename,
+                                              int sourceLineNumber,
+                                              log_level level,
+                                              LoggerPtr logger,
+                                              std::string msg)
+        {
+          get_ring().push(sourceFilename,
+                          sourceLineNumber,
+                          level,
+                          logger->getCategory(),
+                          msg);
+        }
+
+        bool async_log_sink_impl::write_batch(const std::string &batch)
+        {
+          // Since logging is just for debugging, I don't do anything
+          // if the log file couldn't be opened or written, except
+          // leave the messages out of the count of written ones.
+          if(fd == -1)
+            return false;
+
+          const char *data = batch.data();
+          size_t remaining = batch.size();
+          while(remaining > 0)
+            {
+              const ssize_t amt = write(fd, data, remaining);
+              if(amt < 0)
+                {
+                  if(errno == EINTR)
+                    continue;
+                  else
+                    return false;
+                }
+
+              data += amt;
+              remaining -= amt;
+            }
+
+          return true;
+        }
+
+        void async_log_sink_impl::run_writer()
+        {
+          std::string batch;
+          std::vector<shared_ptr<log_ring> > current_rings;
+          std::vector<shared_ptr<log_ring> > finished_rings;
+
+          mutex::lock l(state_mutex);
+          while(true)
+            {
+              if(!stopping && flush_requested == flush_completed)
+                {
+                  struct timeval now;
+                  gettimeofday(&now, NULL);
+
+                  struct timespec until;
+                  until.tv_sec = now.tv_sec + flush_interval_ms / 1000;
+                  until.tv_nsec = now.tv_usec * 1000 + (flush_interval_ms % 1000) * 1000000L;
+                  if(until.tv_nsec >= 1000000000L)
+                    {
+                      until.tv_sec += 1;
+                      until.tv_nsec -= 1000000000L;
+                    }
+
+                  state_changed.timed_wait(l, until);
+                }
+
+              const bool exiting = stopping;
+              const unsigned long flush_target = flush_requested;
+              current_rings = rings;
+
+              l.release();
+
+              batch.clear();
+              finished_rings.clear();
+              unsigned long long drained = 0;
+              for(std::vector<shared_ptr<log_ring> >::const_iterator it =
+                    current_rings.begin(); it != current_rings.end(); ++it)
+                {
+                  // Checked first, so that nothing the thread logged
+                  // before it exited is left in the ring.
+                  const bool abandoned = (*it)->is_abandoned();
+
+                  drained += (*it)->drain(batch);
+
+                  if(abandoned)
+                    finished_rings.push_back(*it);
+                }
+
+              const bool batch_written = !batch.empty() && write_batch(batch);
+
+              l.acquire();
+
+              if(batch_written)
+                {
+                  ++batches;
+                  written += drained;
+                }
+
+              for(std::vector<shared_ptr<log_ring> >::const_iterator it =
+                    finished_rings.begin(); it != finished_rings.end(); ++it)
+                {
+                  retired_dropped += (*it)->get_dropped();
+                  rings.erase(std::find(rings.begin(), rings.end(), *it));
+                }
+
+              current_rings.clear();
+              flush_completed = flush_target;
+              state_changed.wake_all();
+
+              if(exiting)
+                break;
+            }
+        }
+
+        void async_log_sink_impl::flush()
+        {
+          mutex::lock l(state_mutex);
+
+          const unsigned long target = ++flush_requested;
+          state_changed.wake_all();
+
+          while(flush_completed < target && !stopping)
+            state_changed.wait(l);
+        }
+
+        async_log_sink_stats async_log_sink_impl::get_stats()
+        {
+          async_log_sink_stats rval;
+
+          mutex::lock l(state_mutex);
+
+          rval.written = written;
+          rval.batches = batches;
+          rval.dropped = retired_dropped;
+          for(std::vector<shared_ptr<log_ring> >::const_iterator it =
+                rings.begin(); it != rings.end(); ++it)
+            rval.dropped += (*it)->get_dropped();
+
+          return rval;
+        }
+      }
+
+      shared_ptr<async_log_sink>
+      create_async_log_sink(const std::string &filename,
+                            unsigned int ring_size,
+                            unsigned int flush_interval_ms)
+      {
+        size_t capacity = 4096;
+        while(capacity < ring_size)
+          capacity <<= 1;
+
+        return boost::make_shared<async_log_sink_impl>(filename,
+                                                capacity,
+                                                flush_interval_ms);
+      }
+    }
+  }
+}
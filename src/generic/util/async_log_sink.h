@@ -0,0 +1,142 @@
+/** \file async_log_sink.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_ASYNC_LOG_SINK_H
+#define APTITUDE_UTIL_ASYNC_LOG_SINK_H
+
+#include "logging.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <sigc++/trackable.h>
+
+#include <string>
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace logging
+    {
+      /** \brief Statistics about the messages handled by an
+       *  async_log_sink.
+       */
+      struct async_log_sink_stats
+      {
+        /** \brief The number of messages that were written to the
+         *  output file.  Messages that were taken out of a ring but
+         *  couldn't be written aren't counted.
+         */
+        unsigned long long written;
+
+        /** \brief The number of messages that were discarded because
+         *  the ring buffer of the thread that logged them was full.
+         */
+        unsigned long long dropped;
+
+        /** \brief The number of write() calls issued by the writer
+         *  thread.
+         */
+        unsigned long long batches;
+
+        async_log_sink_stats()
+          : written(0), dropped(0), batches(0)
+        {
+        }
+      };
+
+      /** \brief A destination for log messages that moves all the
+       *  file I/O off the logging thread.
+       *
+       *  Each thread that logs a message gets its own ring buffer the
+       *  first time it logs; the ring is drained and freed after the
+       *  thread exits.  A message is formatted straight into
+       *  the calling thread's ring; no locks are taken and no system
+       *  calls are made on that path (apart from reading the clock).
+       *  A single background thread owns the output file, which stays
+       *  open for the lifetime of the sink, and periodically drains
+       *  every ring into one large write().
+       *
+       *  If a ring is full, the message is dropped rather than
+       *  blocking the thread that logged it, and a counter is
+       *  incremented; the writer notes the number of lost messages in
+       *  the output the next time it drains that ring.  Use this
+       *  when you need TRACE logs from code that can't afford to wait
+       *  on the disk (e.g., the resolver).
+       *
+       *  To use it, connect log_message() to the root logger:
+       *
+       *  \code
+       *  Logger::getLogger("")
+       *    ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+       *  \endcode
+       *
+       *  The sink is sigc::trackable, so destroying it disconnects it
+       *  from any loggers it was attached to.  Destroying the sink
+       *  flushes all pending messages and joins the writer thread.
+       */
+      class async_log_sink : public sigc::trackable
+      {
+      public:
+        virtual ~async_log_sink();
+
+        /** \brief Format a message into the current thread's ring
+         *  buffer.
+         *
+         *  The signature matches the slot accepted by
+         *  Logger::connect_message_logged.  This function is
+         *  thread-safe and never blocks on I/O.
+         */
+        virtual void log_message(const char *sourceFilename,
+                                 int sourceLineNumber,
+                                 log_level level,
+                                 LoggerPtr logger,
+                                 std::string msg) = 0;
+
+        /** \brief Block until every message logged before this call
+         *  has been handed to the operating system.
+         */
+        virtual void flush() = 0;
+
+        /** \brief Retrieve the current message counters. */
+        virtual async_log_sink_stats get_stats() = 0;
+      };
+
+      /** \brief Create a new asynchronous log sink.
+       *
+       *  \param filename  The file to append messages to, or "-" to
+       *                   write them to standard output.  If the file
+       *                   can't be opened, messages are silently
+       *                   discarded (logging is only a debugging aid).
+       *
+       *  \param ring_size The size in bytes of each thread's ring
+       *                   buffer.  Rounded up to a power of two.
+       *
+       *  \param flush_interval_ms  How long the writer thread sleeps
+       *                            between passes over the rings.
+       */
+      boost::shared_ptr<async_log_sink>
+      create_async_log_sink(const std::string &filename,
+                            unsigned int ring_size = 1 << 20,
+                            unsigned int flush_interval_ms = 50);
+    }
+  }
+}
+
+#endif // APTITUDE_UTIL_ASYNC_LOG_SINK_H
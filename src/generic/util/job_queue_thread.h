@@ -26,6 +26,8 @@
 
 #include <loggers.h>
 
+#include "perf_stats.h"
+
 namespace aptitude
 {
   namespace util
@@ -42,14 +44,27 @@ namespace aptitude
      *  be copy-constructable, default-constructable, and support
      *  output to ostreams via operator<<.
      *
+     *  Each instantiation records the depth of its queue, and the
+     *  time jobs spend waiting and running, in histograms named after
+     *  its log category (see stats::queue_stats).
+     *
      *  \todo Add support for running up to a fixed number of jobs at
      *  the same time?
      */
     template<typename Subclass, typename Job>
     class job_queue_thread
     {
+      // A job waiting to be run, with the time it was queued if
+      // statistics were enabled.
+      struct queued_job
+      {
+        Job job;
+        bool measured;
+        struct timeval queued;
+      };
+
       // The jobs waiting to be run.
-      static std::deque<Job> jobs;
+      static std::deque<queued_job> jobs;
 
       // The single instance of this class.
       static boost::shared_ptr<job_queue_thread> active_instance;
@@ -66,6 +81,18 @@ namespace aptitude
       // job.
       static cwidget::threads::mutex state_mutex;
 
+      // The statistics for this queue.  Created on first use, since
+      // the log category isn't available during static
+      // initialization; never deleted, since histograms must outlive
+      // the program.
+      static stats::queue_stats &get_queue_stats()
+      {
+	static stats::queue_stats *rval =
+	  new stats::queue_stats(Subclass::get_log_category()->getCategory());
+
+	return *rval;
+      }
+
       class bootstrap
       {
 	boost::shared_ptr<job_queue_thread> target;
@@ -120,7 +147,11 @@ namespace aptitude
 	LOG_TRACE(Subclass::get_log_category(),
 		  "Adding a job to the queue: " << job);
 
-	jobs.push_back(job);
+	queued_job entry;
+	entry.job = job;
+	entry.measured = stats::start_measurement(entry.queued);
+	jobs.push_back(entry);
+	get_queue_stats().depth.add_sample(jobs.size());
 
 	if(!stopped)
 	  start();
@@ -194,7 +225,9 @@ namespace aptitude
 
 	    while(!jobs.empty() && !stopped)
 	      {
-		Job next(jobs.front());
+		Job next(jobs.front().job);
+		if(jobs.front().measured)
+		  get_queue_stats().wait_usec.add_sample(stats::usec_since(jobs.front().queued));
 		jobs.pop_front();
 
 		// Unlock the state mutex, so that jobs can be
@@ -204,6 +237,7 @@ namespace aptitude
 
 		try
 		  {
+		    stats::scoped_histogram_timer timing(get_queue_stats().run_usec);
 		    process_job(next);
 		  }
 		catch(const std::exception &ex)
@@ -252,7 +286,7 @@ namespace aptitude
 
     // Instantiate static members:
     template<typename Subclass, typename Job>
-    std::deque<Job> job_queue_thread<Subclass, Job>::jobs;
+    std::deque<typename job_queue_thread<Subclass, Job>::queued_job> job_queue_thread<Subclass, Job>::jobs;
 
     template<typename Subclass, typename Job>
     boost::shared_ptr<job_queue_thread<Subclass, Job> > job_queue_thread<Subclass, Job>::active_instance;
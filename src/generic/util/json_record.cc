@@ -0,0 +1,295 @@
+/** \file json_record.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "json_record.h"
+
+// System includes:
+#include <string.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace
+    {
+      const char hex_digits[] = "0123456789abcdef";
+
+      // U+FFFD, encoded as UTF-8.
+      const char replacement_character[] = "\xef\xbf\xbd";
+
+      // Append the escape for a character that can't appear literally
+      // in a JSON string, or return false if it can.
+      bool append_escape(std::string &out, unsigned long c)
+      {
+        switch(c)
+          {
+          case '"':  out += "\\\""; return true;
+          case '\\': out += "\\\\"; return true;
+          case '\b': out += "\\b";  return true;
+          case '\f': out += "\\f";  return true;
+          case '\n': out += "\\n";  return true;
+          case '\r': out += "\\r";  return true;
+          case '\t': out += "\\t";  return true;
+          default:
+            if(c < 0x20)
+              {
+                out += "\\u00";
+                out += hex_digits[(c >> 4) & 0xf];
+                out += hex_digits[c & 0xf];
+                return true;
+              }
+            else
+              return false;
+          }
+      }
+
+      void append_utf8(std::string &out, unsigned long c)
+      {
+        if(c < 0x80)
+          out += static_cast<char>(c);
+        else if(c < 0x800)
+          {
+            out += static_cast<char>(0xc0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+          }
+        else if(c < 0x10000)
+          {
+            out += static_cast<char>(0xe0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+          }
+        else if(c < 0x110000)
+          {
+            out += static_cast<char>(0xf0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+          }
+        else
+          // Not a Unicode character; use the replacement character.
+          out += replacement_character;
+      }
+
+      // Return the length of the well-formed UTF-8 sequence starting
+      // at the non-ASCII byte "begin", or 0 if it isn't one.
+      // Overlong forms, surrogates and code points past U+10FFFF are
+      // rejected, as in table 3-7 of the Unicode standard.
+      int utf8_sequence_length(const char *begin, const char *end)
+      {
+        const unsigned char c = static_cast<unsigned char>(*begin);
+
+        int len;
+        unsigned char second_min = 0x80, second_max = 0xbf;
+        if(c >= 0xc2 && c <= 0xdf)
+          len = 2;
+        else if(c >= 0xe0 && c <= 0xef)
+          {
+            len = 3;
+            if(c == 0xe0)
+              second_min = 0xa0;
+            else if(c == 0xed)
+              second_max = 0x9f;
+          }
+        else if(c >= 0xf0 && c <= 0xf4)
+          {
+            len = 4;
+            if(c == 0xf0)
+              second_min = 0x90;
+            else if(c == 0xf4)
+              second_max = 0x8f;
+          }
+        else
+          return 0;
+
+        if(end - begin < len)
+          return 0;
+
+        const unsigned char second = static_cast<unsigned char>(begin[1]);
+        if(second < second_min || second > second_max)
+          return 0;
+
+        for(int i = 2; i < len; ++i)
+          {
+            const unsigned char next = static_cast<unsigned char>(begin[i]);
+            if(next < 0x80 || next > 0xbf)
+              return 0;
+          }
+
+        return len;
+      }
+    }
+
+    void append_json_string(std::string &out,
+                            const char *begin, const char *end)
+    {
+      out += '"';
+
+      // Copy runs of characters that need no escaping in one go.
+      const char *run_start = begin;
+      const char *it = begin;
+      while(it != end)
+        {
+          const unsigned char c = static_cast<unsigned char>(*it);
+          if(c == '"' || c == '\\' || c < 0x20)
+            {
+              out.append(run_start, it);
+              append_escape(out, c);
+              ++it;
+              run_start = it;
+            }
+          else if(c < 0x80)
+            ++it;
+          else
+            {
+              const int len = utf8_sequence_length(it, end);
+              if(len != 0)
+                it += len;
+              else
+                {
+                  // Package records are not always valid UTF-8, and
+                  // JSON must be; replace each bad byte.
+                  out.append(run_start, it);
+                  out += replacement_character;
+                  ++it;
+                  run_start = it;
+                }
+            }
+        }
+      out.append(run_start, end);
+
+      out += '"';
+    }
+
+    void append_json_string(std::string &out, const std::wstring &s)
+    {
+      out += '"';
+
+      for(std::wstring::const_iterator it = s.begin(); it != s.end(); ++it)
+        {
+          const unsigned long c = static_cast<unsigned long>(*it);
+          if(!append_escape(out, c))
+            append_utf8(out, c);
+        }
+
+      out += '"';
+    }
+
+    json_record::json_record()
+      : buffer("{"), empty(true)
+    {
+    }
+
+    void json_record::clear()
+    {
+      buffer = "{";
+      empty = true;
+    }
+
+    void json_record::begin_field(const char *name)
+    {
+      if(empty)
+        empty = false;
+      else
+        buffer += ',';
+
+      append_json_string(buffer, name, name + strlen(name));
+      buffer += ':';
+    }
+
+    void json_record::add_string(const char *name, const std::string &value)
+    {
+      begin_field(name);
+      append_json_string(buffer, value.data(), value.data() + value.size());
+    }
+
+    void json_record::add_string(const char *name,
+                                 const char *begin, const char *end)
+    {
+      begin_field(name);
+      append_json_string(buffer, begin, end);
+    }
+
+    void json_record::add_string(const char *name, const std::wstring &value)
+    {
+      begin_field(name);
+      append_json_string(buffer, value);
+    }
+
+    void json_record::add_string_or_null(const char *name, const char *value)
+    {
+      if(value == NULL)
+        add_null(name);
+      else
+        add_string(name, value, value + strlen(value));
+    }
+
+    void json_record::add_number(const char *name, long value)
+    {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%ld", value);
+
+      begin_field(name);
+      buffer += buf;
+    }
+
+    void json_record::add_bool(const char *name, bool value)
+    {
+      begin_field(name);
+      buffer += value ? "true" : "false";
+    }
+
+    void json_record::add_null(const char *name)
+    {
+      begin_field(name);
+      buffer += "null";
+    }
+
+    void json_record::add_string_list(const char *name,
+                                      const std::vector<std::string> &values)
+    {
+      begin_field(name);
+      buffer += '[';
+      for(std::vector<std::string>::const_iterator it = values.begin();
+          it != values.end(); ++it)
+        {
+          if(it != values.begin())
+            buffer += ',';
+          append_json_string(buffer, it->data(), it->data() + it->size());
+        }
+      buffer += ']';
+    }
+
+    void json_record::add_raw(const char *name, const std::string &json)
+    {
+      begin_field(name);
+      buffer += json;
+    }
+
+    std::string json_record::str() const
+    {
+      return buffer + '}';
+    }
+
+    void json_record::write(FILE *out) const
+    {
+      fwrite(buffer.data(), 1, buffer.size(), out);
+      fputs("}\n", out);
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/** \file json_record.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_JSON_RECORD_H
+#define APTITUDE_UTIL_JSON_RECORD_H
+
+// System includes:
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Append the JSON encoding of a string, including the
+     *  surrounding quotes, to \b out.
+     *
+     *  The input should be UTF-8 and is copied through unchanged,
+     *  except for the characters that JSON requires to be escaped.
+     *  Each byte that is not part of a well-formed UTF-8 sequence is
+     *  replaced with U+FFFD, so that the output is always valid
+     *  JSON.
+     */
+    void append_json_string(std::string &out,
+                            const char *begin, const char *end);
+
+    /** \brief Append the JSON encoding of a wide string, including the
+     *  surrounding quotes, to \b out, encoding it as UTF-8.
+     */
+    void append_json_string(std::string &out, const std::wstring &s);
+
+    /** \brief Builds a single JSON object, for writing one record of
+     *  a JSON Lines stream.
+     *
+     *  Fields are appended directly to an output buffer in the order
+     *  they are added; nothing is stored per field, so building a
+     *  record costs little more than copying its text.  The caller is
+     *  responsible for not adding the same field twice.
+     *
+     *  \code
+     *  json_record rec;
+     *  rec.add_string("package", "aptitude");
+     *  rec.add_bool("automatic", false);
+     *  rec.write(stdout);
+     *  \endcode
+     */
+    class json_record
+    {
+      std::string buffer;
+      bool empty;
+
+      void begin_field(const char *name);
+
+    public:
+      json_record();
+
+      /** \brief Discard all the fields of this record. */
+      void clear();
+
+      void add_string(const char *name, const std::string &value);
+      void add_string(const char *name, const char *begin, const char *end);
+      void add_string(const char *name, const std::wstring &value);
+
+      /** \brief Add a string field, or a null if \b value is NULL. */
+      void add_string_or_null(const char *name, const char *value);
+
+      void add_number(const char *name, long value);
+      void add_bool(const char *name, bool value);
+      void add_null(const char *name);
+      void add_string_list(const char *name,
+                           const std::vector<std::string> &values);
+
+      /** \brief Add a field whose value is already encoded as JSON
+       *  (for instance, a nested record produced by str()).
+       */
+      void add_raw(const char *name, const std::string &json);
+
+      /** \brief Return the JSON encoding of this record. */
+      std::string str() const;
+
+      /** \brief Write this record to \b out, followed by a newline. */
+      void write(FILE *out) const;
+    };
+  }
+}
+
+#endif // APTITUDE_UTIL_JSON_RECORD_H
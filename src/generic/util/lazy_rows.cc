@@ -0,0 +1,106 @@
+/** \file lazy_rows.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "lazy_rows.h"
+
+namespace aptitude
+{
+  namespace util
+  {
+    lazy_rows::lazy_rows(unsigned long max_id)
+      : present(max_id, false),
+        filled(max_id, false),
+        num_filled(0)
+    {
+    }
+
+    void lazy_rows::grow(unsigned long id)
+    {
+      if(id >= present.size())
+        {
+          present.resize(id + 1, false);
+          filled.resize(id + 1, false);
+        }
+    }
+
+    lazy_rows::size_type lazy_rows::append(const std::vector<unsigned long> &batch)
+    {
+      const size_type first = ids.size();
+
+      ids.reserve(ids.size() + batch.size());
+      for(std::vector<unsigned long>::const_iterator it = batch.begin();
+          it != batch.end(); ++it)
+        {
+          const unsigned long id = *it;
+
+          grow(id);
+          if(!present[id])
+            {
+              present[id] = true;
+              ids.push_back(id);
+            }
+        }
+
+      return first;
+    }
+
+    void lazy_rows::clear()
+    {
+      // Only the entries that were set need to be reset, so that the
+      // tables don't have to be reallocated for the next list.
+      for(std::vector<unsigned long>::const_iterator it = ids.begin();
+          it != ids.end(); ++it)
+        {
+          present[*it] = false;
+          filled[*it] = false;
+        }
+
+      ids.clear();
+      num_filled = 0;
+    }
+
+    bool lazy_rows::claim(unsigned long id)
+    {
+      if(!contains(id) || filled[id])
+        return false;
+
+      filled[id] = true;
+      ++num_filled;
+      return true;
+    }
+
+    void lazy_rows::invalidate(unsigned long id)
+    {
+      if(is_filled(id))
+        {
+          filled[id] = false;
+          --num_filled;
+        }
+    }
+
+    void lazy_rows::invalidate_all()
+    {
+      for(std::vector<unsigned long>::const_iterator it = ids.begin();
+          it != ids.end(); ++it)
+        filled[*it] = false;
+
+      num_filled = 0;
+    }
+  }
+}
@@ -0,0 +1,124 @@
+/** \file lazy_rows.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_LAZY_ROWS_H
+#define APTITUDE_UTIL_LAZY_ROWS_H
+
+// System includes:
+#include <vector>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Tracks the rows of a list that is delivered a batch at
+     *  a time and whose contents are only computed when they are
+     *  needed.
+     *
+     *  Each row is identified by a small integer ID, such as a
+     *  package ID.  IDs are appended in the order the producer finds
+     *  them; a row starts out empty, and the first call to claim() for
+     *  its ID tells the caller to compute its contents.  invalidate()
+     *  and invalidate_all() put rows back into the empty state, for
+     *  instance after the data they display changes.
+     *
+     *  An ID may only appear in the list once.  This class doesn't
+     *  know anything about how rows are displayed, so it can be used
+     *  (and tested) without a GUI.
+     */
+    class lazy_rows
+    {
+      // The IDs in the order they were appended.
+      std::vector<unsigned long> ids;
+
+      // Indexed by ID: true if the ID is in the list.
+      std::vector<bool> present;
+
+      // Indexed by ID: true if the row's contents have been computed.
+      std::vector<bool> filled;
+
+      std::vector<unsigned long>::size_type num_filled;
+
+      void grow(unsigned long id);
+
+    public:
+      typedef std::vector<unsigned long>::size_type size_type;
+
+      /** \brief Create an empty list.
+       *
+       *  \param max_id  A hint: IDs are expected to be less than
+       *                 this.  Larger IDs are allowed, but cause the
+       *                 internal tables to be reallocated.
+       */
+      explicit lazy_rows(unsigned long max_id = 0);
+
+      /** \brief Append a batch of IDs to the list.
+       *
+       *  IDs that are already in the list are skipped.
+       *
+       *  \return the index of the first row that was added.
+       */
+      size_type append(const std::vector<unsigned long> &batch);
+
+      /** \brief Remove every row. */
+      void clear();
+
+      size_type size() const { return ids.size(); }
+      bool empty() const { return ids.empty(); }
+
+      /** \brief Return the ID of the row at the given position. */
+      unsigned long get_id(size_type index) const { return ids[index]; }
+
+      /** \brief Return \b true if the given ID is in the list. */
+      bool contains(unsigned long id) const
+      {
+        return id < present.size() && present[id];
+      }
+
+      /** \brief Return \b true if the row with the given ID has been
+       *  filled in.
+       */
+      bool is_filled(unsigned long id) const
+      {
+        return id < filled.size() && filled[id];
+      }
+
+      /** \brief Return the number of rows that have been filled in. */
+      size_type get_num_filled() const { return num_filled; }
+
+      /** \brief Note that a row's contents are about to be needed.
+       *
+       *  \return \b true if the row is in the list and was empty; it
+       *  is marked as filled, and the caller should compute its
+       *  contents.  \b false if there is nothing to do.
+       */
+      bool claim(unsigned long id);
+
+      /** \brief Mark the row with the given ID as empty, so that the
+       *  next claim() fills it in again.
+       */
+      void invalidate(unsigned long id);
+
+      /** \brief Mark every row as empty. */
+      void invalidate_all();
+    };
+  }
+}
+
+#endif // APTITUDE_UTIL_LAZY_ROWS_H
@@ -50,6 +50,61 @@ namespace aptitude
   {
     namespace logging
     {
+      namespace detail
+      {
+        volatile int lowest_enabled_level = INT_MAX;
+      }
+
+      namespace
+      {
+        // The number of loggers, in every logging system, whose
+        // effective level is each of the levels from TRACE_LEVEL to
+        // FATAL_LEVEL.  Loggers that are off aren't counted.
+        const int num_counted_levels = FATAL_LEVEL + 1;
+        int loggers_at_level[num_counted_levels];
+
+        // Protects loggers_at_level and the writing of
+        // detail::lowest_enabled_level.  This is not the mutex of
+        // any one logging system, since the counts are global.
+        mutex &get_levels_mutex()
+        {
+          // Leaked for the same reason as the global logging system.
+          static mutex *levels_mutex = new mutex;
+          return *levels_mutex;
+        }
+
+        /** \brief Replace one logger's effective level in the counts
+         *  and recompute the lowest enabled level.
+         *
+         *  \param oldLevel  The level to stop counting, or OFF_LEVEL
+         *                   for a new logger.
+         *  \param newLevel  The level to start counting, or OFF_LEVEL
+         *                   for a logger that is going away.
+         */
+        void update_level_count(log_level oldLevel, log_level newLevel)
+        {
+          if(oldLevel == newLevel)
+            return;
+
+          mutex::lock l(get_levels_mutex());
+
+          if(oldLevel >= 0 && oldLevel < num_counted_levels)
+            --loggers_at_level[oldLevel];
+          if(newLevel >= 0 && newLevel < num_counted_levels)
+            ++loggers_at_level[newLevel];
+
+          int lowest = INT_MAX;
+          for(int level = 0; level < num_counted_levels; ++level)
+            if(loggers_at_level[level] > 0)
+              {
+                lowest = level;
+                break;
+              }
+
+          detail::lowest_enabled_level = lowest;
+        }
+      }
+
       const char *describe_log_level(log_level l)
       {
         switch(l)
@@ -91,6 +146,10 @@ namespace aptitude
         Impl(const std::string &_category,
              const shared_ptr<Logger::Impl> &_parent,
              const shared_ptr<LoggingSystem::Impl> &_loggingSystem);
+        ~Impl();
+
+        /** \brief Change the effective level of this logger. */
+        void setEffectiveLevel(log_level newLevel);
 
         void log(const char *sourceFilename,
                  int sourceLineNumber,
@@ -122,6 +181,18 @@ namespace aptitude
           parent(_parent),
           loggingSystemWeak(_loggingSystem)
       {
+        update_level_count(OFF_LEVEL, effectiveLevel);
+      }
+
+      Logger::Impl::~Impl()
+      {
+        update_level_count(effectiveLevel, OFF_LEVEL);
+      }
+
+      void Logger::Impl::setEffectiveLevel(log_level newLevel)
+      {
+        update_level_count(effectiveLevel, newLevel);
+        effectiveLevel = newLevel;
       }
 
       void Logger::Impl::log(const char *sourceFilename,
@@ -129,25 +200,28 @@ namespace aptitude
                              log_level logLevel,
                              const std::string &msg)
       {
-        // \note shared_from_this() could be costly; it would be more
-        // efficient to receive the logger as a parameter, but that
-        // would clutter the interface.
-
-
         // We emit this log message at each level of the hierarchy,
         // but the logger passed along always refers to where the
         // message started.
-        const boost::shared_ptr<Impl> self = shared_from_this();
-        boost::shared_ptr<Impl> logger = self;
-        while(logger.get() != NULL)
+        //
+        // Most levels of the hierarchy have nothing connected to
+        // them, so skip them without touching any reference counts;
+        // in particular, shared_from_this() is only invoked once we
+        // know that someone is listening.
+        boost::shared_ptr<Impl> self;
+        for(Impl *logger = this; logger != NULL; logger = logger->parent.get())
           {
+            if(logger->signal_message_logged.empty())
+              continue;
+
+            if(self.get() == NULL)
+              self = shared_from_this();
+
             logger->signal_message_logged(sourceFilename,
                                           sourceLineNumber,
                                           logLevel,
                                           self,
                                           msg);
-
-            logger = logger->parent;
           }
       }
 
@@ -227,7 +301,7 @@ namespace aptitude
         void recursiveSetEffectiveLevel(const shared_ptr<Logger::Impl> &logger,
                                         log_level effectiveLevel)
         {
-          logger->effectiveLevel = effectiveLevel;
+          logger->setEffectiveLevel(effectiveLevel);
           std::pair<child_iterator, child_iterator> children =
             find_children(logger);
 
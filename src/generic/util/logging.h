@@ -20,6 +20,8 @@
 #ifndef APTITUDE_UTIL_LOGGING_H
 #define APTITUDE_UTIL_LOGGING_H
 
+#include <config.h>
+
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -28,7 +30,18 @@
 
 #include <sstream>
 
-#include <limits.h> // For INT_MIN
+#include <limits.h> // For INT_MIN, INT_MAX
+
+/** \brief The lowest log level that is compiled in.
+ *
+ *  LOG_*() statements below this level are removed by the compiler,
+ *  along with the code that formats their messages.  Set by the
+ *  --with-min-log-level configure option; by default, every level is
+ *  compiled in.
+ */
+#ifndef APTITUDE_MIN_LOG_LEVEL
+#define APTITUDE_MIN_LOG_LEVEL 0
+#endif
 
 namespace aptitude
 {
@@ -73,6 +86,29 @@ namespace aptitude
 
       class LoggingSystem;
 
+      namespace detail
+      {
+        /** \brief The lowest effective level of any logger in any
+         *  logging system, or INT_MAX if every logger is off.
+         *
+         *  Maintained by the logging systems whenever a logger is
+         *  created, destroyed or reconfigured.
+         */
+        extern volatile int lowest_enabled_level;
+      }
+
+      /** \brief Return \b false if no logger at all would display a
+       *  message at the given level.
+       *
+       *  This is a single load and comparison, so LOG_*() statements
+       *  use it to skip disabled messages without evaluating their
+       *  logger expression.
+       */
+      inline bool anyLoggerEnabledFor(log_level l)
+      {
+        return l >= detail::lowest_enabled_level;
+      }
+
       /** \brief A logger is used to log messages in a particular
        *  category in conjunction with the LOG_*() macros below.
        */
@@ -190,19 +226,41 @@ namespace aptitude
         static LoggerPtr getLogger(const std::string &category);
       };
 
+/** \brief Evaluates to \b true if a message logged to the given
+ *  logger at the given level would appear.
+ *
+ *  Use this instead of Logger::isEnabledFor() to guard code that
+ *  only exists to produce log messages, so that the code is compiled
+ *  out along with the messages and skipped cheaply when logging is
+ *  off.  \b logger is only evaluated if some logger is enabled at
+ *  \b level.
+ */
+#define LOG_ENABLED(level, logger)                                      \
+      ((level) >= APTITUDE_MIN_LOG_LEVEL &&                             \
+       ::aptitude::util::logging::anyLoggerEnabledFor(level) &&         \
+       (logger)->isEnabledFor(level))
+
+// The first test is a compile-time constant for the LOG_TRACE() et
+// al, so disabled levels generate no code.  The logger is bound to a
+// reference rather than copied, to avoid touching its reference
+// count.
 #define LOG_LEVEL(level, logger, msg)                                   \
       do                                                                \
         {                                                               \
-          ::aptitude::util::logging::log_level __aptitude_util_logging_level = (level); \
-          ::aptitude::util::logging::LoggerPtr __aptitude_util_logging_logger = (logger); \
-          if(__aptitude_util_logging_logger->isEnabledFor(__aptitude_util_logging_level)) \
+          const ::aptitude::util::logging::log_level __aptitude_util_logging_level = (level); \
+          if(__aptitude_util_logging_level >= APTITUDE_MIN_LOG_LEVEL && \
+             ::aptitude::util::logging::anyLoggerEnabledFor(__aptitude_util_logging_level)) \
             {                                                           \
-              std::ostringstream __aptitude_util_logging_stream;        \
-              __aptitude_util_logging_stream << msg;                    \
-              (__aptitude_util_logging_logger)->log(__FILE__,           \
-                                                    __LINE__,           \
-                                                    __aptitude_util_logging_level, \
-                                                    __aptitude_util_logging_stream.str()); \
+              const ::aptitude::util::logging::LoggerPtr &__aptitude_util_logging_logger = (logger); \
+              if(__aptitude_util_logging_logger->isEnabledFor(__aptitude_util_logging_level)) \
+                {                                                       \
+                  std::ostringstream __aptitude_util_logging_stream;    \
+                  __aptitude_util_logging_stream << msg;                \
+                  (__aptitude_util_logging_logger)->log(__FILE__,       \
+                                                        __LINE__,       \
+                                                        __aptitude_util_logging_level, \
+                                                        __aptitude_util_logging_stream.str()); \
+                }                                                       \
             }                                                           \
         } while(0)                                                      \
 
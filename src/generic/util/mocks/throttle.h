@@ -39,6 +39,8 @@ namespace aptitude
       public:
         MOCK_METHOD0(update_required, bool());
         MOCK_METHOD0(reset_timer, void());
+        MOCK_METHOD1(call_when_expired, void(const boost::function<void ()> &));
+        MOCK_METHOD0(cancel_call, void());
       };
     }
   }
@@ -0,0 +1,224 @@
+/** \file ordered_strategies.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_ORDERED_STRATEGIES_H
+#define APTITUDE_UTIL_ORDERED_STRATEGIES_H
+
+// System includes:
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cwidget/generic/threads/threads.h>
+
+#include <vector>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Runs a list of strategies, strongest first, on several
+     *  threads, and keeps the results of each one.
+     *
+     *  Each strategy is taken by exactly one thread, in order of
+     *  preference.  Unless every result is wanted, a strategy stops
+     *  at its first result and every weaker strategy is canceled.
+     *  Reading the results strongest first and stopping at the
+     *  first one then gives the same answer as running the
+     *  strategies one after another and stopping at the first that
+     *  succeeds.
+     *
+     *  \tparam Result  The type of the results of a strategy.
+     */
+    template<typename Result>
+    class ordered_strategies
+    {
+      struct strategy
+      {
+        std::vector<Result> results;
+
+        // Set to 1 when a stronger strategy has succeeded, so that
+        // this one's results won't be used.
+        volatile int canceled;
+
+        strategy()
+          : canceled(0)
+        {
+        }
+      };
+
+      std::vector<strategy> strategies;
+      const bool find_all;
+
+      // The index of the next strategy to take.
+      volatile int next_strategy;
+
+    public:
+      /** \brief What a strategy sees of the runner while it runs. */
+      class context
+      {
+        ordered_strategies &parent;
+        const int index;
+
+      public:
+        context(ordered_strategies &_parent, int _index)
+          : parent(_parent), index(_index)
+        {
+        }
+
+        /** \brief Return the index of the running strategy. */
+        int get_index() const { return index; }
+
+        /** \brief Return a flag that becomes nonzero when the running
+         *  strategy is canceled, for code that polls a variable.
+         */
+        const volatile int *get_canceled_flag() const
+        {
+          return &parent.strategies[index].canceled;
+        }
+
+        /** \brief Return \b true if the running strategy was
+         *  canceled; it should give up as soon as it can.
+         */
+        bool is_canceled() const
+        {
+          __sync_synchronize();
+          return parent.strategies[index].canceled != 0;
+        }
+
+        /** \brief Record a result of the running strategy.
+         *
+         *  \return \b true if the strategy should look for more
+         *  results.
+         */
+        bool add_result(const Result &result)
+        {
+          parent.strategies[index].results.push_back(result);
+
+          if(parent.find_all)
+            return true;
+
+          for(typename std::vector<strategy>::size_type i = index + 1;
+              i < parent.strategies.size(); ++i)
+            __sync_lock_test_and_set(&parent.strategies[i].canceled, 1);
+
+          return false;
+        }
+      };
+
+      /** \brief Runs one strategy; it must not throw, since it may be
+       *  invoked on a background thread.
+       */
+      typedef boost::function<void (context &)> strategy_function;
+
+    private:
+      class runner
+      {
+        ordered_strategies *parent;
+        strategy_function f;
+
+      public:
+        runner(ordered_strategies *_parent, const strategy_function &_f)
+          : parent(_parent), f(_f)
+        {
+        }
+
+        void operator()() const
+        {
+          const int num_strategies = parent->strategies.size();
+          int i;
+          while((i = __sync_fetch_and_add(&parent->next_strategy, 1)) < num_strategies)
+            {
+              context c(*parent, i);
+              if(!c.is_canceled())
+                f(c);
+            }
+        }
+      };
+
+    public:
+      /** \brief Create a runner for some strategies.
+       *
+       *  \param num_strategies  The number of strategies; they are
+       *                         identified by index, strongest first.
+       *  \param _find_all       If \b true, every result of every
+       *                         strategy is wanted and nothing is
+       *                         canceled.
+       */
+      ordered_strategies(int num_strategies, bool _find_all)
+        : strategies(num_strategies), find_all(_find_all), next_strategy(0)
+      {
+      }
+
+      /** \brief Run every strategy, on at most \b num_threads threads
+       *  counting the calling one, and wait for them to finish.
+       *
+       *  If a thread can't be started, the strategies that it would
+       *  have run are picked up by the others.  Invoke this once.
+       */
+      void run(const strategy_function &f, int num_threads)
+      {
+        const runner r(this, f);
+
+        std::vector<boost::shared_ptr<cwidget::threads::thread> > threads;
+        for(int i = 1; i < num_threads; ++i)
+          {
+            try
+              {
+                threads.push_back(boost::make_shared<cwidget::threads::thread>(r));
+              }
+            catch(cwidget::threads::ThreadCreateException &)
+              {
+                break;
+              }
+          }
+
+        r();
+
+        for(typename std::vector<boost::shared_ptr<cwidget::threads::thread> >::const_iterator
+              it = threads.begin(); it != threads.end(); ++it)
+          (*it)->join();
+      }
+
+      /** \brief Return the number of strategies. */
+      int size() const { return strategies.size(); }
+
+      /** \brief Return the results of a strategy, in the order it
+       *  produced them.
+       */
+      const std::vector<Result> &get_results(int i) const
+      {
+        return strategies[i].results;
+      }
+
+      /** \brief Return \b true if a stronger strategy succeeded, so
+       *  that the results of strategy \b i aren't wanted.
+       *
+       *  A strategy that finished before it was canceled keeps its
+       *  results.
+       */
+      bool is_canceled(int i) const
+      {
+        return strategies[i].canceled != 0;
+      }
+    };
+  }
+}
+
+#endif // APTITUDE_UTIL_ORDERED_STRATEGIES_H
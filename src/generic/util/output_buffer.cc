@@ -0,0 +1,102 @@
+/** \file output_buffer.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "output_buffer.h"
+
+// System includes:
+#include <limits.h>
+#include <string.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace
+    {
+      // Check whether the current locale encodes every ASCII
+      // character as the corresponding single byte.  True for UTF-8
+      // and the usual 8-bit locales; false for the odd stateful or
+      // EBCDIC-based one.
+      bool locale_ascii_is_identity()
+      {
+        for(wint_t c = 0; c < 0x80; ++c)
+          if(wctob(c) != static_cast<int>(c))
+            return false;
+
+        return true;
+      }
+    }
+
+    output_buffer::output_buffer(FILE *_out,
+                                 std::string::size_type _threshold)
+      : out(_out),
+        threshold(_threshold),
+        ascii_is_identity(locale_ascii_is_identity())
+    {
+      memset(&state, 0, sizeof(state));
+      buffer.reserve(threshold + MB_LEN_MAX);
+    }
+
+    output_buffer::~output_buffer()
+    {
+      flush();
+    }
+
+    void output_buffer::write(const wchar_t *begin, const wchar_t *end)
+    {
+      char mb[MB_LEN_MAX];
+
+      for(const wchar_t *it = begin; it != end; ++it)
+        {
+          const wchar_t c = *it;
+
+          if(ascii_is_identity && c >= 0 && c < 0x80)
+            buffer.push_back(static_cast<char>(c));
+          else
+            {
+              const size_t len = wcrtomb(mb, c, &state);
+              if(len == static_cast<size_t>(-1))
+                {
+                  memset(&state, 0, sizeof(state));
+                  buffer.push_back('?');
+                }
+              else
+                buffer.append(mb, len);
+            }
+        }
+
+      maybe_write();
+    }
+
+    void output_buffer::write_buffer()
+    {
+      if(!buffer.empty())
+        {
+          fwrite(buffer.data(), 1, buffer.size(), out);
+          buffer.clear();
+        }
+    }
+
+    void output_buffer::flush()
+    {
+      write_buffer();
+      fflush(out);
+    }
+  }
+}
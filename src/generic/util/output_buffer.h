@@ -0,0 +1,126 @@
+/** \file output_buffer.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_OUTPUT_BUFFER_H
+#define APTITUDE_UTIL_OUTPUT_BUFFER_H
+
+// System includes:
+#include <string>
+
+#include <stdio.h>
+#include <wchar.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Collects text for a stdio stream and writes it in
+     *  large blocks.
+     *
+     *  Wide strings are converted to the locale's multibyte encoding
+     *  as they are added, into a buffer that is reused for the life
+     *  of the object.  If the locale encodes ASCII as itself, ASCII
+     *  characters are copied directly instead of going through
+     *  wcrtomb().  Characters that the locale can't represent are
+     *  written as '?'.
+     *
+     *  The buffer is written out when it grows past a threshold, when
+     *  flush() is called, and when the object is destroyed.  Anything
+     *  else that writes to the same stream should call flush() first
+     *  to keep the output in order.
+     */
+    class output_buffer
+    {
+      FILE *out;
+      std::string buffer;
+      const std::string::size_type threshold;
+      const bool ascii_is_identity;
+      mbstate_t state;
+
+      output_buffer(const output_buffer &);
+      output_buffer &operator=(const output_buffer &);
+
+      void maybe_write()
+      {
+        if(buffer.size() >= threshold)
+          write_buffer();
+      }
+
+      void write_buffer();
+
+    public:
+      /** \brief The default size at which the buffer is written out. */
+      static const std::string::size_type default_threshold = 64 * 1024;
+
+      /** \brief Create an output buffer.
+       *
+       *  \param _out        The stream to write to.
+       *  \param _threshold  Write the buffer once it holds at least
+       *                     this many bytes.
+       */
+      explicit output_buffer(FILE *_out,
+                             std::string::size_type _threshold = default_threshold);
+
+      /** \brief Flush the buffer. */
+      ~output_buffer();
+
+      /** \brief Append text that is already in the locale's encoding. */
+      void write(const char *begin, const char *end)
+      {
+        buffer.append(begin, end);
+        maybe_write();
+      }
+
+      void write(const std::string &s)
+      {
+        write(s.data(), s.data() + s.size());
+      }
+
+      /** \brief Append a wide string, converting it to the locale's
+       *  encoding.
+       */
+      void write(const wchar_t *begin, const wchar_t *end);
+
+      void write(const std::wstring &s)
+      {
+        write(s.data(), s.data() + s.size());
+      }
+
+      void put(char c)
+      {
+        buffer.push_back(c);
+        maybe_write();
+      }
+
+      /** \brief Append a wide string followed by a newline. */
+      void write_line(const std::wstring &s)
+      {
+        write(s);
+        put('\n');
+      }
+
+      /** \brief Write everything that has been appended to the
+       *  stream, and flush the stream.
+       */
+      void flush();
+    };
+  }
+}
+
+#endif // APTITUDE_UTIL_OUTPUT_BUFFER_H
@@ -0,0 +1,445 @@
+/** \file perf_stats.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "perf_stats.h"
+
+#include "json_record.h"
+
+// System includes:
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace stats
+    {
+      namespace
+      {
+        // The registries are intrusive singly-linked lists.  Their
+        // heads are zero-initialized before any constructor runs, so
+        // static counters and timers in other translation units can
+        // register themselves safely.
+        counter *counters_head = NULL;
+        timer *timers_head = NULL;
+        histogram *histograms_head = NULL;
+
+        volatile bool enabled = false;
+
+        unsigned long long usec_between(const struct timeval &start,
+                                        const struct timeval &end)
+        {
+          const long long usec =
+            (static_cast<long long>(end.tv_sec) - start.tv_sec) * 1000000LL +
+            (end.tv_usec - start.tv_usec);
+
+          // The wall clock can move backwards.
+          return usec < 0 ? 0 : static_cast<unsigned long long>(usec);
+        }
+      }
+
+      class registry_access
+      {
+      public:
+        template<typename T>
+        static void push(T *&head, T *item)
+        {
+          T *old_head;
+          do
+            {
+              old_head = head;
+              item->next = old_head;
+            }
+          while(!__sync_bool_compare_and_swap(&head, old_head, item));
+        }
+
+        static const counter *next(const counter *c) { return c->next; }
+        static const timer *next(const timer *t) { return t->next; }
+        static const histogram *next(const histogram *h) { return h->next; }
+      };
+
+      namespace
+      {
+        void atomic_max(volatile unsigned long long &target,
+                        unsigned long long value)
+        {
+          unsigned long long old_max = target;
+          while(value > old_max &&
+                !__sync_bool_compare_and_swap(&target, old_max, value))
+            old_max = target;
+        }
+      }
+
+      counter::counter(const char *_name)
+        : name(_name), value(0), next(NULL)
+      {
+        registry_access::push(counters_head, this);
+      }
+
+      timer::timer(const char *_name)
+        : name(_name), calls(0), total_usec(0), max_usec(0), next(NULL)
+      {
+        registry_access::push(timers_head, this);
+      }
+
+      void timer::add_sample(unsigned long long usec)
+      {
+        __sync_add_and_fetch(&calls, 1);
+        __sync_add_and_fetch(&total_usec, usec);
+        atomic_max(max_usec, usec);
+      }
+
+      histogram::histogram(const std::string &_name)
+        : name(_name), count(0), total(0), max(0), next(NULL)
+      {
+        for(int i = 0; i < num_buckets; ++i)
+          buckets[i] = 0;
+
+        registry_access::push(histograms_head, this);
+      }
+
+      int histogram::bucket_of(unsigned long long value)
+      {
+        int bucket = 0;
+        while(value != 0 && bucket < num_buckets - 1)
+          {
+            value >>= 1;
+            ++bucket;
+          }
+
+        return bucket;
+      }
+
+      unsigned long long histogram::bucket_upper_bound(int i)
+      {
+        return i == 0 ? 0 : (1ULL << i) - 1;
+      }
+
+      unsigned long long histogram::estimate_quantile(double fraction) const
+      {
+        const unsigned long long n = count;
+        if(n == 0)
+          return 0;
+
+        const double wanted = fraction * n;
+        unsigned long long seen = 0;
+        for(int i = 0; i < num_buckets; ++i)
+          {
+            seen += buckets[i];
+            if(seen > 0 && seen >= wanted)
+              {
+                // The last bucket has no upper bound of its own.
+                if(i == num_buckets - 1)
+                  return max;
+
+                // The maximum is a tighter bound for the top bucket.
+                const unsigned long long bound = bucket_upper_bound(i);
+                return bound < max ? bound : max;
+              }
+          }
+
+        return max;
+      }
+
+      void histogram::add_sample(unsigned long long value)
+      {
+        __sync_add_and_fetch(&buckets[bucket_of(value)], 1);
+        __sync_add_and_fetch(&count, 1);
+        __sync_add_and_fetch(&total, value);
+        atomic_max(max, value);
+      }
+
+      queue_stats::queue_stats(const std::string &prefix)
+        : depth(prefix + ".queue-depth"),
+          wait_usec(prefix + ".wait-usec"),
+          run_usec(prefix + ".run-usec")
+      {
+      }
+
+      bool start_measurement(struct timeval &tv)
+      {
+        if(enabled && gettimeofday(&tv, 0) == 0)
+          return true;
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        return false;
+      }
+
+      unsigned long long usec_since(const struct timeval &start)
+      {
+        if(start.tv_sec == 0 && start.tv_usec == 0)
+          return 0;
+
+        struct timeval now;
+        if(gettimeofday(&now, 0) != 0)
+          return 0;
+
+        return usec_between(start, now);
+      }
+
+      bool is_enabled()
+      {
+        return enabled;
+      }
+
+      void set_enabled(bool new_enabled)
+      {
+        enabled = new_enabled;
+      }
+
+      scoped_timer::scoped_timer(timer &_t)
+        : t(NULL)
+      {
+        if(enabled && gettimeofday(&start, 0) == 0)
+          t = &_t;
+      }
+
+      scoped_timer::~scoped_timer()
+      {
+        if(t != NULL)
+          {
+            struct timeval end;
+            if(gettimeofday(&end, 0) == 0)
+              t->add_sample(usec_between(start, end));
+          }
+      }
+
+      scoped_histogram_timer::scoped_histogram_timer(histogram &_h)
+        : h(start_measurement(start) ? &_h : NULL)
+      {
+      }
+
+      scoped_histogram_timer::~scoped_histogram_timer()
+      {
+        if(h != NULL)
+          h->add_sample(usec_since(start));
+      }
+
+      namespace
+      {
+        struct timer_total_gt
+        {
+          bool operator()(const timer *t1, const timer *t2) const
+          {
+            if(t1->get_total_usec() != t2->get_total_usec())
+              return t1->get_total_usec() > t2->get_total_usec();
+            else
+              return strcmp(t1->get_name(), t2->get_name()) < 0;
+          }
+        };
+
+        struct counter_name_lt
+        {
+          bool operator()(const counter *c1, const counter *c2) const
+          {
+            return strcmp(c1->get_name(), c2->get_name()) < 0;
+          }
+        };
+
+        struct histogram_name_lt
+        {
+          bool operator()(const histogram *h1, const histogram *h2) const
+          {
+            return h1->get_name() < h2->get_name();
+          }
+        };
+
+        // Collect the timers that have run, slowest first.
+        void get_used_timers(std::vector<const timer *> &output)
+        {
+          for(const timer *t = timers_head; t != NULL;
+              t = registry_access::next(t))
+            if(t->get_calls() > 0)
+              output.push_back(t);
+
+          std::sort(output.begin(), output.end(), timer_total_gt());
+        }
+
+        // Collect the nonzero counters, by name.
+        void get_used_counters(std::vector<const counter *> &output)
+        {
+          for(const counter *c = counters_head; c != NULL;
+              c = registry_access::next(c))
+            if(c->get_value() > 0)
+              output.push_back(c);
+
+          std::sort(output.begin(), output.end(), counter_name_lt());
+        }
+
+        // Collect the histograms that have samples, by name.
+        void get_used_histograms(std::vector<const histogram *> &output)
+        {
+          for(const histogram *h = histograms_head; h != NULL;
+              h = registry_access::next(h))
+            if(h->get_count() > 0)
+              output.push_back(h);
+
+          std::sort(output.begin(), output.end(), histogram_name_lt());
+        }
+      }
+
+      void write_text_report(FILE *out)
+      {
+        std::vector<const timer *> timers;
+        get_used_timers(timers);
+
+        std::vector<const counter *> counters;
+        get_used_counters(counters);
+
+        std::vector<const histogram *> histograms;
+        get_used_histograms(histograms);
+
+        if(!timers.empty())
+          {
+            fprintf(out, "%-32s %10s %12s %12s %12s\n",
+                    "Timer", "Calls", "Total (s)", "Mean (ms)", "Max (ms)");
+            for(std::vector<const timer *>::const_iterator it = timers.begin();
+                it != timers.end(); ++it)
+              {
+                const timer &t = **it;
+                fprintf(out, "%-32s %10llu %12.3f %12.3f %12.3f\n",
+                        t.get_name(),
+                        t.get_calls(),
+                        t.get_total_usec() / 1000000.0,
+                        t.get_total_usec() / 1000.0 / t.get_calls(),
+                        t.get_max_usec() / 1000.0);
+              }
+          }
+
+        if(!counters.empty())
+          {
+            if(!timers.empty())
+              fputc('\n', out);
+
+            fprintf(out, "%-32s %10s\n", "Counter", "Value");
+            for(std::vector<const counter *>::const_iterator it = counters.begin();
+                it != counters.end(); ++it)
+              fprintf(out, "%-32s %10llu\n",
+                      (*it)->get_name(), (*it)->get_value());
+          }
+
+        if(!histograms.empty())
+          {
+            if(!timers.empty() || !counters.empty())
+              fputc('\n', out);
+
+            fprintf(out, "%-32s %10s %12s %10s %10s %10s %10s\n",
+                    "Histogram", "Count", "Mean", "p50", "p90", "p99", "Max");
+            for(std::vector<const histogram *>::const_iterator it = histograms.begin();
+                it != histograms.end(); ++it)
+              {
+                const histogram &h = **it;
+                fprintf(out, "%-32s %10llu %12.1f %10llu %10llu %10llu %10llu\n",
+                        h.get_name().c_str(),
+                        h.get_count(),
+                        static_cast<double>(h.get_total()) / h.get_count(),
+                        h.estimate_quantile(0.5),
+                        h.estimate_quantile(0.9),
+                        h.estimate_quantile(0.99),
+                        h.get_max());
+              }
+          }
+
+        fflush(out);
+      }
+
+      void write_json_report(FILE *out)
+      {
+        std::vector<const timer *> timers;
+        get_used_timers(timers);
+
+        std::vector<const counter *> counters;
+        get_used_counters(counters);
+
+        std::vector<const histogram *> histograms;
+        get_used_histograms(histograms);
+
+        json_record entry;
+
+        std::string timers_json("{");
+        for(std::vector<const timer *>::const_iterator it = timers.begin();
+            it != timers.end(); ++it)
+          {
+            const timer &t = **it;
+
+            entry.clear();
+            entry.add_number("calls", static_cast<long>(t.get_calls()));
+            entry.add_number("total_usec", static_cast<long>(t.get_total_usec()));
+            entry.add_number("max_usec", static_cast<long>(t.get_max_usec()));
+
+            if(it != timers.begin())
+              timers_json += ',';
+            append_json_string(timers_json, t.get_name(),
+                               t.get_name() + strlen(t.get_name()));
+            timers_json += ':';
+            timers_json += entry.str();
+          }
+        timers_json += '}';
+
+        json_record counters_json;
+        for(std::vector<const counter *>::const_iterator it = counters.begin();
+            it != counters.end(); ++it)
+          counters_json.add_number((*it)->get_name(),
+                                   static_cast<long>((*it)->get_value()));
+
+        json_record histograms_json;
+        for(std::vector<const histogram *>::const_iterator it = histograms.begin();
+            it != histograms.end(); ++it)
+          {
+            const histogram &h = **it;
+
+            // Trailing empty buckets are left out.
+            int num_used = histogram::num_buckets;
+            while(num_used > 0 && h.get_bucket(num_used - 1) == 0)
+              --num_used;
+
+            std::string buckets_json("[");
+            for(int i = 0; i < num_used; ++i)
+              {
+                char buf[32];
+                snprintf(buf, sizeof(buf), i == 0 ? "%llu" : ",%llu",
+                         h.get_bucket(i));
+                buckets_json += buf;
+              }
+            buckets_json += ']';
+
+            entry.clear();
+            entry.add_number("count", static_cast<long>(h.get_count()));
+            entry.add_number("total", static_cast<long>(h.get_total()));
+            entry.add_number("max", static_cast<long>(h.get_max()));
+            entry.add_raw("buckets", buckets_json);
+            histograms_json.add_raw(h.get_name().c_str(), entry.str());
+          }
+
+        json_record report;
+        report.add_raw("timers", timers_json);
+        report.add_raw("counters", counters_json.str());
+        report.add_raw("histograms", histograms_json.str());
+        report.write(out);
+
+        fflush(out);
+      }
+    }
+  }
+}
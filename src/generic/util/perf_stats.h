@@ -0,0 +1,286 @@
+/** \file perf_stats.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_PERF_STATS_H
+#define APTITUDE_UTIL_PERF_STATS_H
+
+// System includes:
+#include <string>
+
+#include <stdio.h>
+#include <sys/time.h>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Process-wide performance counters and timers.
+     *
+     *  Counters and timers are meant to be declared as static objects
+     *  next to the code they measure:
+     *
+     *  \code
+     *  namespace
+     *  {
+     *    stats::timer load_timer("cache.load");
+     *  }
+     *
+     *  void load()
+     *  {
+     *    stats::scoped_timer t(load_timer);
+     *    ...
+     *  }
+     *  \endcode
+     *
+     *  Each one adds itself to a global registry when it is
+     *  constructed, and write_text_report() or write_json_report()
+     *  walks the registry.  Updates are lock-free atomic additions,
+     *  so any thread can use them.  Counters are always maintained;
+     *  timers only read the clock when statistics are enabled.
+     *
+     *  Counters and timers are never removed from the registry, so
+     *  they must live until the end of the program.
+     */
+    namespace stats
+    {
+      /** \brief A named count of events. */
+      class counter
+      {
+        const char * const name;
+        volatile unsigned long long value;
+        counter *next;
+
+        friend class registry_access;
+
+        counter(const counter &);
+        counter &operator=(const counter &);
+
+      public:
+        /** \brief Create and register a counter.
+         *
+         *  \param _name   The name used in reports; must be a
+         *                 string constant.
+         */
+        explicit counter(const char *_name);
+
+        const char *get_name() const { return name; }
+        unsigned long long get_value() const { return value; }
+
+        /** \brief Add \b n to this counter. */
+        void add(unsigned long long n = 1)
+        {
+          __sync_add_and_fetch(&value, n);
+        }
+      };
+
+      /** \brief A named total of the time spent in an operation. */
+      class timer
+      {
+        const char * const name;
+        volatile unsigned long long calls;
+        volatile unsigned long long total_usec;
+        volatile unsigned long long max_usec;
+        timer *next;
+
+        friend class registry_access;
+
+        timer(const timer &);
+        timer &operator=(const timer &);
+
+      public:
+        /** \brief Create and register a timer.
+         *
+         *  \param _name   The name used in reports; must be a
+         *                 string constant.
+         */
+        explicit timer(const char *_name);
+
+        const char *get_name() const { return name; }
+        unsigned long long get_calls() const { return calls; }
+        unsigned long long get_total_usec() const { return total_usec; }
+        unsigned long long get_max_usec() const { return max_usec; }
+
+        /** \brief Record one call that took \b usec microseconds. */
+        void add_sample(unsigned long long usec);
+      };
+
+      /** \brief A named distribution of values, such as queue
+       *  lengths or latencies.
+       *
+       *  Samples are counted in power-of-two buckets: bucket 0 holds
+       *  zero, and bucket i holds values from 2^(i-1) to 2^i - 1.  The
+       *  last bucket also holds everything larger.
+       *
+       *  Unlike counters and timers, a histogram's name may be built
+       *  at run time, so that templates can create one per
+       *  instantiation.
+       */
+      class histogram
+      {
+      public:
+        static const int num_buckets = 32;
+
+      private:
+        const std::string name;
+        volatile unsigned long long buckets[num_buckets];
+        volatile unsigned long long count;
+        volatile unsigned long long total;
+        volatile unsigned long long max;
+        histogram *next;
+
+        friend class registry_access;
+
+        histogram(const histogram &);
+        histogram &operator=(const histogram &);
+
+      public:
+        /** \brief Create and register a histogram. */
+        explicit histogram(const std::string &_name);
+
+        const std::string &get_name() const { return name; }
+        unsigned long long get_count() const { return count; }
+        unsigned long long get_total() const { return total; }
+        unsigned long long get_max() const { return max; }
+        unsigned long long get_bucket(int i) const { return buckets[i]; }
+
+        /** \brief Return the bucket that holds \b value. */
+        static int bucket_of(unsigned long long value);
+
+        /** \brief Return the largest value that bucket \b i holds
+         *  (ignoring the overflow of the last bucket).
+         */
+        static unsigned long long bucket_upper_bound(int i);
+
+        /** \brief Return an upper bound on the given fraction of the
+         *  samples, or 0 if there are no samples.
+         *
+         *  \param fraction  A number between 0 and 1; for instance,
+         *                   0.9 estimates the 90th percentile.
+         */
+        unsigned long long estimate_quantile(double fraction) const;
+
+        /** \brief Record one sample. */
+        void add_sample(unsigned long long value);
+      };
+
+      /** \brief The histograms kept for a queue of jobs that are run
+       *  by a background thread.
+       *
+       *  Queue depths are recorded whenever a job is queued; wait
+       *  times and run times only when statistics are enabled.
+       */
+      struct queue_stats
+      {
+        /** \brief The number of jobs in the queue after a job is
+         *  added, including the new one.
+         */
+        histogram depth;
+
+        /** \brief How long jobs waited in the queue, in
+         *  microseconds.
+         */
+        histogram wait_usec;
+
+        /** \brief How long jobs took to run, in microseconds. */
+        histogram run_usec;
+
+        /** \brief Create and register the histograms
+         *  "<prefix>.queue-depth", "<prefix>.wait-usec" and
+         *  "<prefix>.run-usec".
+         */
+        explicit queue_stats(const std::string &prefix);
+      };
+
+      /** \brief Read the clock for a measurement.
+       *
+       *  \return \b false if statistics are disabled or the clock
+       *  can't be read; \b tv is zeroed in that case.
+       */
+      bool start_measurement(struct timeval &tv);
+
+      /** \brief Return the number of microseconds since \b start, or 0
+       *  if \b start was zeroed by start_measurement().
+       */
+      unsigned long long usec_since(const struct timeval &start);
+
+      /** \brief Return \b true if timers should measure the time
+       *  spent in their operations.
+       */
+      bool is_enabled();
+
+      /** \brief Turn timing on or off.
+       *
+       *  Only scoped_timers that are created after this call are
+       *  affected.
+       */
+      void set_enabled(bool enabled);
+
+      /** \brief Adds the time between its construction and its
+       *  destruction to a timer.
+       *
+       *  If statistics are disabled when it is constructed, this
+       *  does nothing.
+       */
+      class scoped_timer
+      {
+        timer *t;
+        struct timeval start;
+
+        scoped_timer(const scoped_timer &);
+        scoped_timer &operator=(const scoped_timer &);
+
+      public:
+        explicit scoped_timer(timer &_t);
+        ~scoped_timer();
+      };
+
+      /** \brief Adds the time between its construction and its
+       *  destruction, in microseconds, to a histogram.
+       *
+       *  If statistics are disabled when it is constructed, this
+       *  does nothing.
+       */
+      class scoped_histogram_timer
+      {
+        histogram *h;
+        struct timeval start;
+
+        scoped_histogram_timer(const scoped_histogram_timer &);
+        scoped_histogram_timer &operator=(const scoped_histogram_timer &);
+
+      public:
+        explicit scoped_histogram_timer(histogram &_h);
+        ~scoped_histogram_timer();
+      };
+
+      /** \brief Write a human-readable report of every timer that
+       *  was used (slowest first), every counter that is nonzero and
+       *  every histogram that has samples (in name order).
+       */
+      void write_text_report(FILE *out);
+
+      /** \brief Write the same information as write_text_report(),
+       *  as a single line holding a JSON object.
+       */
+      void write_json_report(FILE *out);
+    }
+  }
+}
+
+#endif // APTITUDE_UTIL_PERF_STATS_H
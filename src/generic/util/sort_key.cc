@@ -0,0 +1,99 @@
+/** \file sort_key.cc */
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#include "sort_key.h"
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace sort_key
+    {
+      void append_number(std::string &key, unsigned long long n, int bytes)
+      {
+        for(int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+          key.push_back(static_cast<char>((n >> shift) & 0xff));
+      }
+
+      void append_string(std::string &key, const char *s)
+      {
+        key.append(s);
+        key.push_back('\0');
+      }
+
+      void append_optional_number(std::string &key,
+                                  bool present, unsigned long long n,
+                                  int bytes, bool missing_first)
+      {
+        // The marker byte puts missing numbers on the right side, and
+        // keeps the one-byte part of a missing number from being a
+        // prefix of a present one.
+        if(!present)
+          key.push_back(missing_first ? '\0' : '\1');
+        else
+          {
+            key.push_back(missing_first ? '\1' : '\0');
+            append_number(key, n, bytes);
+          }
+      }
+
+      int compare_optional_numbers(bool present1, unsigned long long n1,
+                                   bool present2, unsigned long long n2,
+                                   bool missing_first)
+      {
+        if(!present1 && !present2)
+          return 0;
+        else if(!present1)
+          return missing_first ? -1 : 1;
+        else if(!present2)
+          return missing_first ? 1 : -1;
+        else if(n1 < n2)
+          return -1;
+        else if(n1 > n2)
+          return 1;
+        else
+          return 0;
+      }
+
+      void reverse_part(std::string &key, std::string::size_type start)
+      {
+        for(std::string::iterator it = key.begin() + start;
+            it != key.end(); ++it)
+          *it = ~*it;
+      }
+
+      shared_rank_table::table_ptr
+      shared_rank_table::get(const boost::function<table_ptr ()> &build)
+      {
+        cwidget::threads::mutex::lock l(table_mutex);
+
+        if(table.get() == NULL)
+          table = build();
+
+        return table;
+      }
+
+      void shared_rank_table::reset()
+      {
+        cwidget::threads::mutex::lock l(table_mutex);
+        table.reset();
+      }
+    }
+  }
+}
@@ -0,0 +1,138 @@
+/** \file sort_key.h */    // -*-c++-*-
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+#ifndef APTITUDE_UTIL_SORT_KEY_H
+#define APTITUDE_UTIL_SORT_KEY_H
+
+// System includes:
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cwidget/generic/threads/threads.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief Building blocks for sort keys: byte strings that compare
+     *  (with std::string::compare()) in the same order as the values
+     *  they were built from.
+     *
+     *  A key is a sequence of parts, one per field.  No part may be a
+     *  proper prefix of another part for the same field, so that the
+     *  parts that follow never affect the comparison of a field that
+     *  differs, and a part can be reversed by inverting its bytes.
+     */
+    namespace sort_key
+    {
+      /** \brief Append a number, most significant byte first, using
+       *  \b bytes bytes.
+       */
+      void append_number(std::string &key, unsigned long long n, int bytes);
+
+      /** \brief Append a string, terminated by a NUL, so that keys
+       *  compare like strcmp().
+       */
+      void append_string(std::string &key, const char *s);
+
+      /** \brief Append a number that may be missing.
+       *
+       *  \param missing_first  If \b true, a missing number sorts
+       *                        before every number; otherwise it
+       *                        sorts after every number.
+       */
+      void append_optional_number(std::string &key,
+                                  bool present, unsigned long long n,
+                                  int bytes, bool missing_first);
+
+      /** \brief Compare two numbers that may be missing, in the order
+       *  that append_optional_number() encodes.
+       *
+       *  \return a negative number, zero or a positive number.
+       */
+      int compare_optional_numbers(bool present1, unsigned long long n1,
+                                   bool present2, unsigned long long n2,
+                                   bool missing_first);
+
+      /** \brief Reverse the order of the part of \b key starting at
+       *  \b start, by inverting its bytes.
+       */
+      void reverse_part(std::string &key, std::string::size_type start);
+
+      /** \brief Rank the given IDs by \b lt.
+       *
+       *  \param ids    The IDs to rank; each must be less than
+       *                ranks.size().
+       *  \param lt     A strict weak order on the IDs.
+       *  \param ranks  Indexed by ID; set to the rank of each ID in
+       *                \b ids, where IDs that are equivalent under
+       *                \b lt have the same rank.
+       */
+      template<typename LessThan>
+      void compute_ranks(std::vector<unsigned int> ids,
+                         const LessThan &lt,
+                         std::vector<unsigned int> &ranks)
+      {
+        std::sort(ids.begin(), ids.end(), lt);
+
+        unsigned int rank = 0;
+        for(std::vector<unsigned int>::const_iterator it = ids.begin();
+            it != ids.end(); ++it)
+          {
+            if(it != ids.begin() && lt(*(it - 1), *it))
+              ++rank;
+            ranks[*it] = rank;
+          }
+      }
+
+      /** \brief A table of ranks that is built once and shared by
+       *  every sort until it is reset.
+       *
+       *  The sorts that are running when the table is reset keep the
+       *  copy they already have.
+       */
+      class shared_rank_table
+      {
+      public:
+        typedef boost::shared_ptr<const std::vector<unsigned int> > table_ptr;
+
+      private:
+        cwidget::threads::mutex table_mutex;
+        table_ptr table;
+
+      public:
+        /** \brief Return the table, invoking \b build to create it if
+         *  there isn't one.
+         */
+        table_ptr get(const boost::function<table_ptr ()> &build);
+
+        /** \brief Discard the table, so that the next get() builds a
+         *  new one.
+         */
+        void reset();
+      };
+    }
+  }
+}
+
+#endif // APTITUDE_UTIL_SORT_KEY_H
@@ -11,6 +11,8 @@
 
 #include <generic/util/util.h>
 
+#include <cwidget/generic/threads/threads.h>
+
 #include <errno.h>
 #include <sys/time.h>
 
@@ -36,12 +38,51 @@ namespace aptitude
         // failing.
         bool wrote_time_error;
 
-        static const double update_interval = 0.7;
+        // The minimum number of seconds between two updates.
+        const double update_interval;
+
+        // Protects everything above and below, since the timer thread
+        // reads last_update.
+        cwidget::threads::mutex state_mutex;
+        cwidget::threads::condition state_changed;
+
+        // The function passed to call_when_expired(), if it hasn't
+        // been invoked yet.
+        boost::function<void ()> pending_call;
+
+        // true while the timer thread is invoking a function.
+        bool call_running;
+
+        bool stopping;
+
+        // Started the first time call_when_expired() is invoked.
+        boost::shared_ptr<cwidget::threads::thread> timer_thread;
+
+        class bootstrap
+        {
+          throttle_impl *target;
+
+        public:
+          bootstrap(throttle_impl *_target)
+            : target(_target)
+          {
+          }
+
+          void operator()() const
+          {
+            target->run_timer();
+          }
+        };
 
         void write_time_error(int errnum);
 
+        bool timer_expired();
+
+        void run_timer();
+
       public:
-        throttle_impl();
+        explicit throttle_impl(double _update_interval);
+        ~throttle_impl();
 
         /** \return \b true if the timer has expired. */
         bool update_required();
@@ -50,9 +91,10 @@ namespace aptitude
          *  updated.
          */
         void reset_timer();
-      };
 
-      const double throttle_impl::update_interval;
+        void call_when_expired(const boost::function<void ()> &f);
+        void cancel_call();
+      };
 
       void throttle_impl::write_time_error(int errnum)
       {
@@ -65,13 +107,36 @@ namespace aptitude
           }
       }
 
-      throttle_impl::throttle_impl()
+      throttle_impl::throttle_impl(double _update_interval)
         : logger(Loggers::getAptitudeCmdlineThrottle()),
-          wrote_time_error(false)
+          wrote_time_error(false),
+          update_interval(_update_interval),
+          call_running(false),
+          stopping(false)
       {
       }
 
+      throttle_impl::~throttle_impl()
+      {
+        if(timer_thread.get() != NULL)
+          {
+            {
+              cwidget::threads::mutex::lock l(state_mutex);
+              stopping = true;
+              state_changed.wake_all();
+            }
+
+            timer_thread->join();
+          }
+      }
+
       bool throttle_impl::update_required()
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+        return timer_expired();
+      }
+
+      bool throttle_impl::timer_expired()
       {
         if(!last_update)
           return true;
@@ -103,11 +168,86 @@ namespace aptitude
       {
         LOG_TRACE(logger, "Resetting the update timer.");
 
+        cwidget::threads::mutex::lock l(state_mutex);
+
         struct timeval now;
         if(gettimeofday(&now, 0) != 0)
           write_time_error(errno);
         else
           last_update = now;
+
+        state_changed.wake_all();
+      }
+
+      void throttle_impl::call_when_expired(const boost::function<void ()> &f)
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        pending_call = f;
+
+        if(timer_thread.get() == NULL)
+          timer_thread = make_shared<cwidget::threads::thread>(bootstrap(this));
+        else
+          state_changed.wake_all();
+      }
+
+      void throttle_impl::cancel_call()
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        pending_call.clear();
+
+        while(call_running)
+          state_changed.wait(l);
+      }
+
+      void throttle_impl::run_timer()
+      {
+        cwidget::threads::mutex::lock l(state_mutex);
+
+        while(!stopping)
+          {
+            if(pending_call.empty())
+              {
+                state_changed.wait(l);
+                continue;
+              }
+
+            if(!timer_expired())
+              {
+                // Sleep until the timer should expire; a reset or a
+                // new call wakes us up early, and the loop works out
+                // the new deadline.
+                struct timeval until = *last_update;
+                const long interval_usec =
+                  static_cast<long>(update_interval * 1000000);
+                until.tv_sec += interval_usec / 1000000;
+                until.tv_usec += interval_usec % 1000000;
+                if(until.tv_usec >= 1000000)
+                  {
+                    until.tv_sec += 1;
+                    until.tv_usec -= 1000000;
+                  }
+
+                struct timespec until_spec;
+                until_spec.tv_sec = until.tv_sec;
+                until_spec.tv_nsec = until.tv_usec * 1000;
+
+                state_changed.timed_wait(l, until_spec);
+                continue;
+              }
+
+            boost::function<void ()> f;
+            f.swap(pending_call);
+            call_running = true;
+
+            l.release();
+            f();
+            l.acquire();
+
+            call_running = false;
+            state_changed.wake_all();
+          }
       }
     }
 
@@ -115,9 +255,14 @@ namespace aptitude
     {
     }
 
+    shared_ptr<throttle> create_throttle(double update_interval)
+    {
+      return make_shared<throttle_impl>(update_interval);
+    }
+
     shared_ptr<throttle> create_throttle()
     {
-      return make_shared<throttle_impl>();
+      return create_throttle(0.7);
     }
   }
 }
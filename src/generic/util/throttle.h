@@ -21,6 +21,7 @@
 #define APTITUDE_UTIL_THROTTLE_H
 
 // System includes:
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 namespace aptitude
@@ -45,12 +46,37 @@ namespace aptitude
        *  updated.
        */
       virtual void reset_timer() = 0;
+
+      /** \brief Invoke a function once the timer next expires.
+       *
+       *  Use this to draw an update that was held back, so that it
+       *  doesn't stay off the screen until the next update arrives.
+       *  The function is invoked from a background thread, so it
+       *  must lock anything it shares with the caller.  A later call
+       *  replaces a function that hasn't been invoked yet.  If the
+       *  timer is reset first, the function waits for the new
+       *  expiry.
+       */
+      virtual void call_when_expired(const boost::function<void ()> &f) = 0;
+
+      /** \brief Forget the function passed to call_when_expired(), and
+       *  wait for it to return if it's running.
+       *
+       *  Must not be invoked while holding a lock that the function
+       *  takes.
+       */
+      virtual void cancel_call() = 0;
     };
 
     /** \brief Create a throttle object.
      *
-     *  \todo This should take an argument giving the update interval
-     *  in seconds.
+     *  \param update_interval  The minimum time, in seconds, between
+     *                          two updates.
+     */
+    boost::shared_ptr<throttle> create_throttle(double update_interval);
+
+    /** \brief Create a throttle object with the default update
+     *  interval (0.7 seconds).
      */
     boost::shared_ptr<throttle> create_throttle();
   }
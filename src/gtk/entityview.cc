@@ -873,4 +873,9 @@ namespace gui
 				   get_reverse_store()));
     get_treeview()->set_model(model);
   }
+
+  void EntityView::add_to_reverse_store(const Gtk::TreeModel::iterator &iter)
+  {
+    post_process_model(iter, get_model(), get_columns(), get_reverse_store());
+  }
 }
@@ -281,6 +281,11 @@ namespace gui
        */
       void set_model(const Glib::RefPtr<Gtk::TreeModel> &model);
 
+      /** \brief Build the reverse pointers for a row that was added
+       *  to the model after it was attached with set_model().
+       */
+      void add_to_reverse_store(const Gtk::TreeModel::iterator &iter);
+
 
       /** \brief Return the Package menu actions that are currently
        *  allowed on the selection.
@@ -145,7 +145,7 @@ namespace gui
     return "white";
   }
 
-  void PkgEntity::fill_row(const EntityColumns *cols, Gtk::TreeModel::Row &row)
+  void PkgEntity::compute_row_values(PkgRowValues &values)
   {
     using cwidget::util::ssprintf;
     using cwidget::util::transcode;
@@ -154,17 +154,14 @@ namespace gui
 
     pkgCache::VerIterator ver = get_ver();
 
-    row[cols->EntObject] = this;
-
-    string BgColor = selected_package_state_color();
-    row[cols->BgColor] = BgColor;
-    row[cols->BgSet] = (BgColor != "white");
+    values.BgColor = selected_package_state_color();
+    values.BgSet = (values.BgColor != "white");
 
     entity_state_info current_state(current_state_columns());
     entity_state_info selected_state(selected_package_state_columns());
-    row[cols->CurrentStatusIcon] = current_state.get_icon().get_string();
-    row[cols->SelectedStatusIcon] = selected_state.get_icon().get_string();
-    row[cols->StatusDescriptionMarkup] =
+    values.CurrentStatusIcon = current_state.get_icon().get_string();
+    values.SelectedStatusIcon = selected_state.get_icon().get_string();
+    values.StatusDescriptionMarkup =
       ssprintf("<b>%s:</b> %s\n<b>%s:</b> %s",
 	       Glib::Markup::escape_text(_("Current status")).c_str(),
 	       Glib::Markup::escape_text(current_state.get_description_i18n()).c_str(),
@@ -175,12 +172,12 @@ namespace gui
     if(ver.end())
       {
 	if(pkg.VersionList().end() && !pkg.ProvidesList().end())
-	  row[cols->NameMarkup] = ssprintf("<i><b>%s</b></i>\n<span size=\"smaller\"><i>Virtual package</i></span>",
-					   safe_name.c_str());
+	  values.NameMarkup = ssprintf("<i><b>%s</b></i>\n<span size=\"smaller\"><i>Virtual package</i></span>",
+				       safe_name.c_str());
 	else
-	  row[cols->NameMarkup] = ssprintf("<b>%s</b>", safe_name.c_str());
+	  values.NameMarkup = ssprintf("<b>%s</b>", safe_name.c_str());
 
-	row[cols->Description] = "";
+	values.Description = "";
       }
     else
       {
@@ -189,30 +186,30 @@ namespace gui
 					  "UTF-8"));
         Glib::ustring safe_description =
           Glib::Markup::escape_text(description);
-        row[cols->NameMarkup] =
+        values.NameMarkup =
           ssprintf("<b>%s</b>\n<span size=\"smaller\">%s</span>",
                    safe_name.c_str(), safe_description.c_str());
 
-	row[cols->Description] = description;
+	values.Description = description;
       }
 
     if (!ver.end())
     {
-      row[cols->VersionMarkup] = Glib::Markup::escape_text(ver.VerStr());
+      values.VersionMarkup = Glib::Markup::escape_text(ver.VerStr());
       pkgCache::VerIterator candver=state.CandidateVerIter(*apt_cache_file);
       if (state.Upgrade() || state.Downgrade())
-        row[cols->VersionMarkup] = row[cols->VersionMarkup] + "\n<i>" + Glib::Markup::escape_text(candver.VerStr()) + "</i>";
-      row[cols->ArchiveMarkup] = Glib::Markup::escape_text(archives_text(ver));
+        values.VersionMarkup += "\n<i>" + Glib::Markup::escape_text(candver.VerStr()) + "</i>";
+      values.ArchiveMarkup = Glib::Markup::escape_text(archives_text(ver));
     }
     else
     {
-      row[cols->VersionMarkup] = "";
-      row[cols->ArchiveMarkup] = "";
+      values.VersionMarkup = "";
+      values.ArchiveMarkup = "";
     }
 
-    row[cols->Name] = pkg.end() ? "" : pkg.Name();
-    row[cols->Version] = ver.end() ? "" : ver.VerStr();
-    row[cols->Archive] = ver.end() ? "" : archives_text(ver);
+    values.Name = pkg.end() ? "" : pkg.Name();
+    values.Version = ver.end() ? "" : ver.VerStr();
+    values.Archive = ver.end() ? "" : archives_text(ver);
 
     {
       const bool is_auto = (state.Flags & pkgCache::Flag::Auto) != 0;
@@ -221,31 +218,70 @@ namespace gui
       if(is_auto)
 	{
 	  if(is_installed)
-	    row[cols->AutomaticallyInstalledTooltip] = ssprintf(_("%s was installed automatically."),
-								pkg.Name());
+	    values.AutomaticallyInstalledTooltip = ssprintf(_("%s was installed automatically."),
+							    pkg.Name());
 	  else if(state.Install())
-	    row[cols->AutomaticallyInstalledTooltip] = ssprintf(_("%s is being installed automatically."),
-								pkg.Name());
+	    values.AutomaticallyInstalledTooltip = ssprintf(_("%s is being installed automatically."),
+							    pkg.Name());
 	  else
-	    row[cols->AutomaticallyInstalledTooltip] = "";
+	    values.AutomaticallyInstalledTooltip = "";
 	}
       else
 	{
 	  if(is_installed)
-	    row[cols->AutomaticallyInstalledTooltip] = ssprintf(_("%s was installed manually."),
-								pkg.Name());
+	    values.AutomaticallyInstalledTooltip = ssprintf(_("%s was installed manually."),
+							    pkg.Name());
 	  else if(state.Install())
-	    row[cols->AutomaticallyInstalledTooltip] = ssprintf(_("%s is being installed manually."),
-								pkg.Name());
+	    values.AutomaticallyInstalledTooltip = ssprintf(_("%s is being installed manually."),
+							    pkg.Name());
 	  else
-	    row[cols->AutomaticallyInstalledTooltip] = "";
+	    values.AutomaticallyInstalledTooltip = "";
 	}
-      row[cols->AutomaticallyInstalled] =
+      values.AutomaticallyInstalled =
 	is_auto && (is_installed || state.Install());
     }
+  }
+
+  void PkgEntity::fill_row(const EntityColumns *cols, Gtk::TreeModel::Row &row)
+  {
+    const PkgRowValues &values = PkgRowStore::get()->get_values(*this);
+
+    row[cols->EntObject] = this;
+    row[cols->BgColor] = values.BgColor;
+    row[cols->BgSet] = values.BgSet;
+    row[cols->CurrentStatusIcon] = values.CurrentStatusIcon;
+    row[cols->SelectedStatusIcon] = values.SelectedStatusIcon;
+    row[cols->StatusDescriptionMarkup] = values.StatusDescriptionMarkup;
+    row[cols->NameMarkup] = values.NameMarkup;
+    row[cols->Description] = values.Description;
+    row[cols->VersionMarkup] = values.VersionMarkup;
+    row[cols->ArchiveMarkup] = values.ArchiveMarkup;
+    row[cols->Name] = values.Name;
+    row[cols->Version] = values.Version;
+    row[cols->Archive] = values.Archive;
+    row[cols->AutomaticallyInstalledTooltip] = values.AutomaticallyInstalledTooltip;
+    row[cols->AutomaticallyInstalled] = values.AutomaticallyInstalled;
     row[cols->AutomaticallyInstalledVisible] = true;
   }
 
+  void PkgEntity::fill_key_columns(const EntityColumns *cols, Gtk::TreeModel::Row &row)
+  {
+    using cwidget::util::ssprintf;
+
+    row[cols->EntObject] = this;
+
+    // Keep the row the same height as it will have once it's filled
+    // in, so that the view doesn't jump around when that happens.
+    Glib::ustring safe_name = Glib::Markup::escape_text(pkg.Name());
+    if(get_ver().end())
+      row[cols->NameMarkup] = ssprintf("<b>%s</b>", safe_name.c_str());
+    else
+      row[cols->NameMarkup] = ssprintf("<b>%s</b>\n<span size=\"smaller\"> </span>",
+				       safe_name.c_str());
+
+    row[cols->Name] = pkg.end() ? "" : pkg.Name();
+  }
+
   void PkgEntity::activated(const Gtk::TreeModel::Path &path,
 			    const Gtk::TreeViewColumn *column,
 			    const EntityView *view)
@@ -361,10 +397,102 @@ namespace gui
     return get_ver(pkg);
   }
 
+  namespace
+  {
+    cwidget::util::ref_ptr<PkgRowStore> current_row_store;
+  }
+
+  PkgRowStore::PkgRowStore()
+  {
+    const unsigned long num_packages = (*apt_cache_file)->Head().PackageCount;
+    entities.resize(num_packages);
+    values.resize(num_packages);
+    valid.resize(num_packages, false);
+
+    // The views refresh their rows from package_states_changed too
+    // (see EntityView::init), and a refresh copies the values in
+    // this store.  Views connect when they are created, which is
+    // usually before this store exists (it's created when the first
+    // row is filled in), so connecting in the normal order would let
+    // them copy the values of the changed packages before they are
+    // discarded, and they'd keep showing the old states.  Running
+    // first guarantees that every view recomputes them.  Since the
+    // store is trackable, the slot is still disconnected when the
+    // store is destroyed.
+    (*apt_cache_file)->package_states_changed.slots().push_front(sigc::mem_fun(*this, &PkgRowStore::handle_package_states_changed));
+  }
+
+  PkgRowStore::~PkgRowStore()
+  {
+  }
+
+  void PkgRowStore::discard_current()
+  {
+    current_row_store = cwidget::util::ref_ptr<PkgRowStore>();
+  }
+
+  cwidget::util::ref_ptr<PkgRowStore> PkgRowStore::get()
+  {
+    if(!current_row_store.valid())
+      {
+	static bool connected = false;
+	if(!connected)
+	  {
+	    cache_closed.connect(sigc::ptr_fun(&PkgRowStore::discard_current));
+	    connected = true;
+	  }
+
+	current_row_store = new PkgRowStore;
+      }
+
+    return current_row_store;
+  }
+
+  void PkgRowStore::handle_package_states_changed(const std::set<pkgCache::PkgIterator> *changed_packages)
+  {
+    for(std::set<pkgCache::PkgIterator>::const_iterator it = changed_packages->begin();
+	it != changed_packages->end(); ++it)
+      {
+	const unsigned long id = (*it)->ID;
+	if(id < valid.size())
+	  valid[id] = false;
+      }
+  }
+
+  cwidget::util::ref_ptr<PkgEntity> PkgRowStore::get_entity(const pkgCache::PkgIterator &pkg)
+  {
+    cwidget::util::ref_ptr<PkgEntity> &entity = entities[pkg->ID];
+    if(!entity.valid())
+      entity = new PkgEntity(pkg);
+
+    return entity;
+  }
+
+  const PkgRowValues &PkgRowStore::get_values(PkgEntity &entity)
+  {
+    const unsigned long id = entity.get_pkg()->ID;
+    boost::shared_ptr<PkgRowValues> &entry = values[id];
+    if(entry.get() == NULL)
+      entry.reset(new PkgRowValues);
+
+    if(!valid[id])
+      {
+	entity.compute_row_values(*entry);
+	valid[id] = true;
+      }
+
+    return *entry;
+  }
+
   PkgTreeModelGenerator::~PkgTreeModelGenerator()
   {
   }
 
+  bool PkgTreeModelGenerator::fills_rows_lazily() const
+  {
+    return false;
+  }
+
   PkgViewBase::PkgViewBase(const sigc::slot1<PkgTreeModelGenerator *, const EntityColumns *> _generatorK,
 			   const Glib::RefPtr<Gnome::Glade::Xml> &refGlade,
 			   const Glib::ustring &gladename,
@@ -372,6 +500,8 @@ namespace gui
 			   const Glib::ustring &_limit,
 			   const sigc::slot<cwidget::util::ref_ptr<refcounted_progress> > &build_progress_k)
     : EntityView(refGlade, gladename, parent_title),
+      lazy_fill(false),
+      model_attached(false),
       background_builder(build_progress_k)
   {
     generatorK = _generatorK;
@@ -382,7 +512,13 @@ namespace gui
     get_version_column()->set_visible(false);
     get_archive_column()->set_visible(false);
 
+    background_builder.batch_added.connect(sigc::mem_fun(*this, &PkgViewBase::batch_added));
     background_builder.store_rebuilt.connect(sigc::mem_fun(*this, &PkgViewBase::store_rebuilt));
+
+    // Run before the default handler, so that rows are filled in
+    // before they're drawn.
+    get_treeview()->signal_expose_event().connect(sigc::mem_fun(*this, &PkgViewBase::fill_visible_rows),
+						  false);
   }
 
   PkgViewBase::~PkgViewBase()
@@ -394,6 +530,7 @@ namespace gui
     // The builder has to be stopped before the cache is closed;
     // otherwise it might access the closed cache and blow up.
     background_builder.cancel_now();
+    reset_lazy_fill();
 
     Glib::RefPtr<Gtk::ListStore> store = Gtk::ListStore::create(*get_columns());
     Gtk::TreeModel::iterator iter = store->append();
@@ -405,15 +542,15 @@ namespace gui
   // Bootstrap class for the build thread.
   class PkgViewBase::background_build_store::build_thread
   {
-    // How to create a generator.
-    sigc::slot1<PkgTreeModelGenerator *, const EntityColumns *> generatorK;
-    const EntityColumns *columns;
     // The search term to use as a filter.
     cwidget::util::ref_ptr<aptitude::matching::pattern> limit;
     // The location to check for our cancel flag.
     cwidget::util::ref_ptr<cancel_flag> canceled;
+    // Receives each batch of packages; will be invoked in the main
+    // thread.
+    safe_slot1<void, package_batch> batch_k;
     // The build's continuation; will be invoked in the main thread.
-    safe_slot1<void, Glib::RefPtr<Gtk::TreeModel> > k;
+    safe_slot0<void> k;
 
 
     // TODO: I really should just have a threadsafe OpProgress that
@@ -467,26 +604,60 @@ namespace gui
     // parent might destroy its box too soon!
     cwidget::threads::box<void> &thread_box_done_box;
 
+    // The first batch is small, so that the first results show up
+    // quickly; each later batch is twice as big as the one before,
+    // up to a limit, to keep the number of events posted to the main
+    // thread down.
+    static const std::vector<unsigned long>::size_type first_batch_size = 256;
+    static const std::vector<unsigned long>::size_type max_batch_size = 8192;
+
+    package_batch batch;
+    std::vector<unsigned long>::size_type batch_size;
+
+    // Send the current batch to the main thread, along with the
+    // current progress.
+    void flush_batch(int num, int total)
+    {
+      post_event(safe_bind(progress_callback, num, total));
+
+      if(!batch->empty())
+	{
+	  post_event(safe_bind(batch_k, batch));
+	  batch = package_batch(new std::vector<unsigned long>);
+	  if(batch_size < max_batch_size)
+	    batch_size *= 2;
+	  batch->reserve(batch_size);
+	}
+    }
+
+    void add_package(const pkgCache::PkgIterator &pkg, int num, int total)
+    {
+      batch->push_back(pkg->ID);
+      if(batch->size() >= batch_size)
+	flush_batch(num, total);
+    }
+
   public:
-    build_thread(sigc::slot1<PkgTreeModelGenerator *, const EntityColumns *> _generatorK,
-		 const EntityColumns *_columns,
-		 const cwidget::util::ref_ptr<aptitude::matching::pattern> &_limit,
+    build_thread(const cwidget::util::ref_ptr<aptitude::matching::pattern> &_limit,
 		 const cwidget::util::ref_ptr<cancel_flag> &_canceled,
-		 const safe_slot1<void, Glib::RefPtr<Gtk::TreeModel> > &_k,
+		 const safe_slot1<void, package_batch> &_batch_k,
+		 const safe_slot0<void> &_k,
 		 const safe_slot2<void, int, int> &_progress_callback,
 		 const safe_slot1<void, cwidget::threads::thread *> &_done_callback,
 		 cwidget::threads::box<cwidget::threads::thread *> &_thread_box,
 		 cwidget::threads::box<void> &_thread_box_done_box)
-      : generatorK(_generatorK),
-	columns(_columns),
-	limit(_limit),
+      : limit(_limit),
 	canceled(_canceled),
+	batch_k(_batch_k),
 	k(_k),
 	progress_callback(_progress_callback),
 	done_callback(_done_callback),
 	thread_box(_thread_box),
-	thread_box_done_box(_thread_box_done_box)
+	thread_box_done_box(_thread_box_done_box),
+	batch(new std::vector<unsigned long>),
+	batch_size(first_batch_size)
     {
+      batch->reserve(batch_size);
     }
 
     void operator()();
@@ -510,8 +681,6 @@ namespace gui
 
     LOG_TRACE(logger, "PkgView build thread: telling main thread to continue.");
 
-    std::auto_ptr<PkgTreeModelGenerator> generator(generatorK(columns));
-
     bool limited = limit.valid();
 
     std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match> > > matches;
@@ -529,13 +698,11 @@ namespace gui
 	    if(canceled->is_canceled())
 	      return;
 
-	    post_event(safe_bind(progress_callback, num, total));
-
 	    ++num;
-	    generator->add(it->first);
+	    add_package(it->first, num, total);
 	  }
 
-	post_event(safe_bind(progress_callback, total, total));
+	flush_batch(total, total);
       }
     else
       {
@@ -548,32 +715,16 @@ namespace gui
 	    if(canceled->is_canceled())
 	      return;
 
-	    post_event(safe_bind(progress_callback, num, total));
-
 	    ++num;
-	    generator->add(pkg);
+	    add_package(pkg, num, total);
 	  }
 
-	post_event(safe_bind(progress_callback, total, total));
+	flush_batch(total, total);
       }
 
-    LOG_TRACE(logger, "PkgView build thread: sorting view.");
-
-    generator->finish();
-
-    // CAREFUL.  Glib::RefPtr isn't thread-safe, so we must relinquish
-    // all our references before the main thread sees the object.  We
-    // keep the model alive by binding one reference into the safe
-    // slot object, so it lives on the heap until the main thread
-    // picks it up.
+    LOG_TRACE(logger, "PkgView build thread: all packages delivered.");
 
-    // The slot that binds up the reference:
-    safe_slot0<void> bound_k(safe_bind(k, generator->get_model()));
-    // Zero out our reference.
-    generator.reset();
-
-    // Now post the heap-allocated reference to the main thread.
-    post_event(bound_k);
+    post_event(k);
   }
 
   PkgViewBase::background_build_store::background_build_store(const sigc::slot<cwidget::util::ref_ptr<refcounted_progress> > &_builder_progress_k)
@@ -610,7 +761,13 @@ namespace gui
 
     builder_progress = builder_progress_k();
     builder_cancel = cancel_flag::create();
-    sigc::slot<void, Glib::RefPtr<Gtk::TreeModel> > k =
+    generator.reset(generatorK(columns));
+
+    sigc::slot<void, package_batch> batch_k =
+      sigc::mem_fun(*this, &background_build_store::add_batch);
+    builder_batch_callback = make_safe_slot(batch_k);
+
+    sigc::slot<void> k =
       sigc::mem_fun(*this, &background_build_store::rebuild_store_finished);
     builder_callback = make_safe_slot(k);
 
@@ -629,10 +786,9 @@ namespace gui
     cwidget::threads::box<void>
       thread_box_done_box;
 
-    builder = new cwidget::threads::thread(build_thread(generatorK,
-							columns,
-							limit,
+    builder = new cwidget::threads::thread(build_thread(limit,
 							builder_cancel,
+							builder_batch_callback,
 							builder_callback,
 							builder_progress_callback,
 							thread_stopped_safe_slot,
@@ -659,8 +815,10 @@ namespace gui
       builder_cancel->cancel();
 
     builder_callback.disconnect();
+    builder_batch_callback.disconnect();
     builder_progress_callback.disconnect();
     builder_cancel = cwidget::util::ref_ptr<cancel_flag>();
+    generator.reset();
     builder_progress = cwidget::util::ref_ptr<guiOpProgress>();
     pulse_connection.disconnect();
     builder = NULL;
@@ -729,15 +887,31 @@ namespace gui
       }
   }
 
-  void PkgViewBase::background_build_store::rebuild_store_finished(Glib::RefPtr<Gtk::TreeModel> model)
+  void PkgViewBase::background_build_store::add_batch(package_batch batch)
+  {
+    logging::LoggerPtr logger(Loggers::getAptitudeGtkPkgView());
+    LOG_TRACE(logger, "Adding " << batch->size() << " packages to the package view store.");
+
+    pkgCache &cache = (*apt_cache_file)->GetCache();
+    for(std::vector<unsigned long>::const_iterator it = batch->begin();
+	it != batch->end(); ++it)
+      generator->add(pkgCache::PkgIterator(cache, cache.PkgP + *it));
+
+    batch_added(generator.get());
+  }
+
+  void PkgViewBase::background_build_store::rebuild_store_finished()
   {
     logging::LoggerPtr logger(Loggers::getAptitudeGtkPkgView());
     LOG_TRACE(logger, "The package view store was successfully rebuilt.");
 
+    generator->finish();
+
     // Clear out the background thread's structures and signal
-    // connections.
+    // connections.  The generator has to outlive the signal.
+    std::auto_ptr<PkgTreeModelGenerator> finished_generator(generator);
     cancel();
-    store_rebuilt(model);
+    store_rebuilt(finished_generator.get());
   }
 
   bool PkgViewBase::background_build_store::pulse_progress()
@@ -752,6 +926,9 @@ namespace gui
     // The builder has to be canceled before we reset the store;
     // otherwise it might just overwrite the store.
     background_builder.cancel();
+    // The current model stays up (and keeps being filled in) until
+    // the new one has some rows.
+    model_attached = false;
 
     if(apt_cache_file == NULL)
       return; // We'll try again when it's loaded.
@@ -761,12 +938,137 @@ namespace gui
     background_builder.start(generatorK, get_columns(), limit);
   }
 
-  void PkgViewBase::store_rebuilt(const Glib::RefPtr<Gtk::TreeModel> &model)
+  void PkgViewBase::reset_lazy_fill()
+  {
+    sort_column_changed_connection.disconnect();
+    row_fill_state.clear();
+    lazy_fill = false;
+    model_attached = false;
+  }
+
+  void PkgViewBase::attach_model(const Glib::RefPtr<Gtk::TreeModel> &model)
   {
     set_model(model);
+    model_attached = true;
+
+    Glib::RefPtr<Gtk::TreeSortable> sortable =
+      Glib::RefPtr<Gtk::TreeSortable>::cast_dynamic(model);
+    if(lazy_fill && sortable)
+      {
+	sort_column_changed_connection =
+	  sortable->signal_sort_column_changed().connect(sigc::mem_fun(*this, &PkgViewBase::handle_sort_column_changed));
+	handle_sort_column_changed();
+      }
+  }
+
+  void PkgViewBase::batch_added(PkgTreeModelGenerator *generator)
+  {
+    std::vector<Gtk::TreeModel::iterator> rows;
+    generator->take_added_rows(rows);
+
+    if(!model_attached)
+      reset_lazy_fill();
+
+    if(generator->fills_rows_lazily())
+      {
+	if(!lazy_fill)
+	  {
+	    lazy_fill = true;
+	    row_fill_state = aptitude::util::lazy_rows((*apt_cache_file)->Head().PackageCount);
+	  }
+
+	std::vector<unsigned long> ids;
+	ids.reserve(rows.size());
+	for(std::vector<Gtk::TreeModel::iterator>::const_iterator it = rows.begin();
+	    it != rows.end(); ++it)
+	  {
+	    cwidget::util::ref_ptr<Entity> ent = (**it)[get_columns()->EntObject];
+	    cwidget::util::ref_ptr<PkgEntity> pkg_ent = ent.dyn_downcast<PkgEntity>();
+	    if(pkg_ent.valid())
+	      ids.push_back(pkg_ent->get_pkg()->ID);
+	  }
+	row_fill_state.append(ids);
+      }
+
+    if(!model_attached)
+      attach_model(generator->get_model());
+    else
+      {
+	for(std::vector<Gtk::TreeModel::iterator>::const_iterator it = rows.begin();
+	    it != rows.end(); ++it)
+	  add_to_reverse_store(*it);
+
+	// A new row might belong to a column that's being sorted on.
+	if(sort_column_changed_connection.connected())
+	  handle_sort_column_changed();
+      }
+  }
+
+  void PkgViewBase::store_rebuilt(PkgTreeModelGenerator *generator)
+  {
+    if(!model_attached)
+      {
+	reset_lazy_fill();
+	attach_model(generator->get_model());
+      }
     store_reloaded();
   }
 
+  void PkgViewBase::fill_lazy_row(Gtk::TreeModel::Row row)
+  {
+    cwidget::util::ref_ptr<Entity> ent = row[get_columns()->EntObject];
+    cwidget::util::ref_ptr<PkgEntity> pkg_ent = ent.dyn_downcast<PkgEntity>();
+    if(pkg_ent.valid() && row_fill_state.claim(pkg_ent->get_pkg()->ID))
+      pkg_ent->fill_row(get_columns(), row);
+  }
+
+  bool PkgViewBase::fill_visible_rows(GdkEventExpose *event)
+  {
+    if(!lazy_fill || row_fill_state.get_num_filled() == row_fill_state.size())
+      return false;
+
+    Gtk::TreeModel::Path start, end;
+    if(!get_treeview()->get_visible_range(start, end))
+      return false;
+
+    Glib::RefPtr<Gtk::TreeModel> model = get_model();
+    const Gtk::TreeModel::iterator last = model->get_iter(end);
+    for(Gtk::TreeModel::iterator it = model->get_iter(start); it; ++it)
+      {
+	fill_lazy_row(*it);
+	if(it == last)
+	  break;
+      }
+
+    return false;
+  }
+
+  void PkgViewBase::fill_all_rows()
+  {
+    if(!lazy_fill || row_fill_state.get_num_filled() == row_fill_state.size())
+      return;
+
+    const Gtk::TreeModel::Children children = get_model()->children();
+    for(Gtk::TreeModel::iterator it = children.begin();
+	it != children.end(); ++it)
+      fill_lazy_row(*it);
+  }
+
+  void PkgViewBase::handle_sort_column_changed()
+  {
+    Glib::RefPtr<Gtk::TreeSortable> sortable =
+      Glib::RefPtr<Gtk::TreeSortable>::cast_dynamic(get_model());
+    if(!sortable)
+      return;
+
+    int sort_column_id;
+    Gtk::SortType order;
+    // Lazily filled rows only have the name to sort on.
+    if(sortable->get_sort_column_id(sort_column_id, order) &&
+       sort_column_id != get_columns()->Name.index())
+      fill_all_rows();
+  }
+
   void PkgViewBase::set_limit(const cwidget::util::ref_ptr<aptitude::matching::pattern> &_limit)
   {
     limit = _limit;
@@ -777,6 +1079,9 @@ namespace gui
     : columns(_columns)
   {
     store = Gtk::ListStore::create(*columns);
+    // Sort from the start, since the view is displayed while it's
+    // being built.
+    store->set_sort_column(columns->Name, Gtk::SORT_ASCENDING);
   }
 
   PkgView::Generator *PkgView::Generator::create(const EntityColumns *columns)
@@ -788,13 +1093,17 @@ namespace gui
   {
     Gtk::TreeModel::iterator iter = store->append();
     Gtk::TreeModel::Row row = *iter;
-    PkgEntity *ent = new PkgEntity(pkg);
-    ent->fill_row(columns, row);
+    PkgRowStore::get()->get_entity(pkg)->fill_key_columns(columns, row);
+    row_added(iter);
+  }
+
+  bool PkgView::Generator::fills_rows_lazily() const
+  {
+    return true;
   }
 
   void PkgView::Generator::finish()
   {
-    store->set_sort_column(columns->Name, Gtk::SORT_ASCENDING);
     // FIXME: Hack while finding a nonblocking thread join.
     finished = true;
   }
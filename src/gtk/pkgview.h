@@ -28,12 +28,18 @@
 
 #include <generic/apt/apt.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/util/lazy_rows.h>
 #include <generic/util/refcounted_base.h>
 
 #include <gtk/entityview.h>
 
 #include <cwidget/generic/util/ref_ptr.h>
 
+#include <boost/shared_ptr.hpp>
+
+#include <memory>
+#include <vector>
+
 #include "gui.h" // For entity_state_info.
 
 namespace cwidget
@@ -48,6 +54,32 @@ class refcounted_progress;
 
 namespace gui
 {
+  /** \brief The values that PkgEntity::fill_row() stores in a row,
+   *  apart from the entity itself.
+   */
+  struct PkgRowValues
+  {
+    Glib::ustring BgColor;
+    bool BgSet;
+    Glib::ustring CurrentStatusIcon;
+    Glib::ustring SelectedStatusIcon;
+    Glib::ustring StatusDescriptionMarkup;
+    Glib::ustring NameMarkup;
+    Glib::ustring Description;
+    Glib::ustring VersionMarkup;
+    Glib::ustring ArchiveMarkup;
+    Glib::ustring Name;
+    Glib::ustring Version;
+    Glib::ustring Archive;
+    Glib::ustring AutomaticallyInstalledTooltip;
+    bool AutomaticallyInstalled;
+
+    PkgRowValues()
+      : BgSet(false), AutomaticallyInstalled(false)
+    {
+    }
+  };
+
   class PkgEntity : public Entity
   {
     private:
@@ -56,6 +88,13 @@ namespace gui
       string selected_package_state_color();
       pkgCache::PkgIterator pkg;
 
+      /** \brief Work out what should be displayed for this entity's
+       *  package.
+       */
+      void compute_row_values(PkgRowValues &values);
+
+      friend class PkgRowStore;
+
     public:
       PkgEntity(const pkgCache::PkgIterator &_pkg) : pkg(_pkg) { }
 
@@ -74,6 +113,17 @@ namespace gui
        *                             coloring and selected status display)
        */
       void fill_row(const EntityColumns *columns, Gtk::TreeModel::Row &row);
+
+      /** \brief Fill in only the columns that are needed to sort and
+       *  search on the package name.
+       *
+       *  This is much cheaper than fill_row(), which has to look up
+       *  the package's description; views that display many packages
+       *  use it to add rows and call fill_row() once the rows are
+       *  actually displayed.
+       */
+      void fill_key_columns(const EntityColumns *columns, Gtk::TreeModel::Row &row);
+
       void add_packages(std::set<pkgCache::PkgIterator> &packages);
       void add_actions(std::set<PackagesAction> &actions);
       void dispatch_action(PackagesAction action, bool first_pass);
@@ -86,6 +136,62 @@ namespace gui
       static pkgCache::VerIterator get_ver(const pkgCache::PkgIterator &pkg);
   };
 
+  /** \brief Package entities and row contents that are shared by
+   *  every package view of the current cache.
+   *
+   *  Each package has one PkgEntity, which all the views that list
+   *  the package put in their rows, and one set of row values, which
+   *  is computed the first time a view fills in a row for the package
+   *  and copied by every other view.  When package states change, the
+   *  store discards the values of the changed packages before any
+   *  view refreshes its rows, so a change costs one computation per
+   *  package however many tabs display it.
+   *
+   *  A new store is created for each cache that is loaded; the old
+   *  one lives until the last reference to it is dropped.
+   */
+  class PkgRowStore : public aptitude::util::refcounted_base_threadsafe,
+		      public sigc::trackable
+  {
+    /** \brief The shared entities, indexed by package ID. */
+    std::vector<cwidget::util::ref_ptr<PkgEntity> > entities;
+
+    /** \brief The row values, indexed by package ID; NULL until a
+     *  package is first displayed.
+     */
+    std::vector<boost::shared_ptr<PkgRowValues> > values;
+
+    /** \brief Indexed by package ID: \b true if the values are up
+     *  to date.
+     */
+    std::vector<bool> valid;
+
+    PkgRowStore();
+
+    void handle_package_states_changed(const std::set<pkgCache::PkgIterator> *changed_packages);
+
+    /** \brief Drop the store of the cache that is being closed. */
+    static void discard_current();
+
+  public:
+    ~PkgRowStore();
+
+    /** \brief Return the store of the current cache, creating it if
+     *  necessary.
+     *
+     *  The cache must be open.
+     */
+    static cwidget::util::ref_ptr<PkgRowStore> get();
+
+    /** \brief Return the shared entity of the given package. */
+    cwidget::util::ref_ptr<PkgEntity> get_entity(const pkgCache::PkgIterator &pkg);
+
+    /** \brief Return the row values of the given entity's package,
+     *  computing them if they aren't up to date.
+     */
+    const PkgRowValues &get_values(PkgEntity &entity);
+  };
+
   /** \brief Interface for generating tree-views.
    *
    *  A tree-view generator takes each package that appears in the
@@ -94,6 +200,18 @@ namespace gui
    */
   class PkgTreeModelGenerator
   {
+    std::vector<Gtk::TreeModel::iterator> added_rows;
+
+  protected:
+    /** \brief Record that add() created a row for a package.
+     *
+     *  Header rows don't need to be recorded.
+     */
+    void row_added(const Gtk::TreeModel::iterator &iter)
+    {
+      added_rows.push_back(iter);
+    }
+
   public:
     // FIXME: Hack while finding a nonblocking thread join.
     bool finished;
@@ -118,13 +236,28 @@ namespace gui
 
     /** \brief Retrieve the model associated with this generator.
      *
-     *  The model will be filled in as add_package() is invoked.
-     *  Normally you should only use the model once it is entirely
-     *  filled in (to avoid unnecessary screen updates).
+     *  The model will be filled in as add() is invoked; it may be
+     *  displayed before it is complete.
      *
      *  \return  The model built by this generator.
      */
     virtual Glib::RefPtr<Gtk::TreeModel> get_model() = 0;
+
+    /** \brief Return \b true if add() only fills in the key columns
+     *  of each package row (see PkgEntity::fill_key_columns()).
+     *
+     *  The view fills in the rest of a row when it is displayed.
+     */
+    virtual bool fills_rows_lazily() const;
+
+    /** \brief Move the rows that were recorded by row_added() since
+     *  the last call into \b output.
+     */
+    void take_added_rows(std::vector<Gtk::TreeModel::iterator> &output)
+    {
+      output.clear();
+      output.swap(added_rows);
+    }
   };
 
   /** \brief Base class for views that display a subset of the packages
@@ -142,26 +275,41 @@ namespace gui
      */
     void do_cache_closed();
 
+    /** \brief Tracks which package rows of the current model have
+     *  been filled in, if its generator fills rows lazily.
+     */
+    aptitude::util::lazy_rows row_fill_state;
+
+    /** \brief \b true if the current generator fills rows lazily. */
+    bool lazy_fill;
+
+    /** \brief \b true once the model of the current build has been
+     *  attached to the tree-view.
+     */
+    bool model_attached;
+
+    sigc::connection sort_column_changed_connection;
+
+    /** \brief A batch of package IDs found by the build thread. */
+    typedef boost::shared_ptr<std::vector<unsigned long> > package_batch;
+
     class background_build_store : public sigc::trackable
     {
-      /** \brief Used to cancel the background build thread on a
-       *  best-effort basis.
+      /** \brief Used to cancel the background build thread.
        *
-       *  Canceling the thread isn't always possible, and it isn't
-       *  strictly necessary; it just saves some CPU time to do so.
+       *  The thread checks the flag between packages, so it stops
+       *  soon after cancel() is invoked; nothing it has already
+       *  posted to the main thread will be acted on, since the slots
+       *  are disconnected at the same time.
        */
       class cancel_flag : public aptitude::util::refcounted_base_threadsafe
       {
 	cancel_flag()
-	  : canceled(false)
+	  : canceled(0)
 	{
 	}
 
-	// TODO: is it any better to have a mutex around this?  Seems
-	// like that might just introduce tons of locks for no good
-	// reason, esp. since this is just a best-effort cancel.  (of
-	// course, we could check every 1000 iterations or so...)
-	bool canceled;
+	volatile int canceled;
 
       public:
 	static cwidget::util::ref_ptr<cancel_flag> create()
@@ -171,23 +319,37 @@ namespace gui
 
 	bool is_canceled() const
 	{
-	  return canceled;
+	  __sync_synchronize();
+	  return canceled != 0;
 	}
 
 	void cancel()
 	{
-	  canceled = true;
+	  __sync_lock_test_and_set(&canceled, 1);
 	}
       };
 
       class build_thread;
 
+      /** \brief The generator that is receiving the packages found by
+       *  the current build thread, if any.
+       *
+       *  It lives in the main thread; the build thread only searches
+       *  for packages.
+       */
+      std::auto_ptr<PkgTreeModelGenerator> generator;
+
       /** \brief The callback for the current build thread.
        *
        *  When the build is canceled we disconnect this slot, so that it
        *  has no effect if it's posted to the mean thread.
        */
-      safe_slot1<void, Glib::RefPtr<Gtk::TreeModel> > builder_callback;
+      safe_slot0<void> builder_callback;
+
+      /** \brief Like builder_callback, but for each batch of
+       *  packages.
+       */
+      safe_slot1<void, package_batch> builder_batch_callback;
 
       /** \brief Like builder_callback, but for the current progress. */
       safe_slot2<void, int, int> builder_progress_callback;
@@ -242,12 +404,17 @@ namespace gui
 
       void progress(int current, int total);
 
-      /** \brief Invoked in the main thread when the store is done being
-       *  built in the background.
+      /** \brief Invoked in the main thread to add a batch of
+       *  packages to the generator.
+       */
+      void add_batch(package_batch batch);
+
+      /** \brief Invoked in the main thread when the build thread has
+       *  delivered every package.
        *
        *  Not invoked if the rebuild is canceled.
        */
-      void rebuild_store_finished(Glib::RefPtr<Gtk::TreeModel> model);
+      void rebuild_store_finished();
 
     public:
       background_build_store(const sigc::slot<cwidget::util::ref_ptr<refcounted_progress> > &_builder_progress_k);
@@ -265,7 +432,8 @@ namespace gui
        *
        *  This actually just disconnects it (so that invoking its slot
        *  has no effect) and then asks it to cancel; it doesn't wait for
-       *  the thread to actually stop.
+       *  the thread to actually stop.  The model that was being built
+       *  is left as it is.
        */
       void cancel();
 
@@ -277,18 +445,53 @@ namespace gui
        */
       void cancel_now();
 
+      /** \brief Signal emitted after a batch of packages has been
+       *  added to the generator.
+       */
+      sigc::signal<void, PkgTreeModelGenerator *> batch_added;
+
       /** \brief Signal indicating that the store has been rebuilt.
        */
-      sigc::signal<void, Glib::RefPtr<Gtk::TreeModel> > store_rebuilt;
+      sigc::signal<void, PkgTreeModelGenerator *> store_rebuilt;
     };
 
+    /** \brief Attach the model that is being built to the tree-view. */
+    void attach_model(const Glib::RefPtr<Gtk::TreeModel> &model);
+
+    /** \brief Invoked when the background builder adds a batch of
+     *  packages to the model.
+     *
+     *  The first batch attaches the model to the tree-view, so that
+     *  results are displayed while the rest of them are found;
+     *  later batches are registered with the view as they arrive.
+     */
+    void batch_added(PkgTreeModelGenerator *generator);
+
     /** \brief Invoked when the background builder is finished
      *  rebuilding the store.
      *
-     *  This attaches the model to the tree-view and signals to
-     *  clients that it's ready.
+     *  This attaches the model to the tree-view if no batch did and
+     *  signals to clients that it's ready.
      */
-    void store_rebuilt(const Glib::RefPtr<Gtk::TreeModel> &model);
+    void store_rebuilt(PkgTreeModelGenerator *generator);
+
+    /** \brief Fill in a row that was added with only its key
+     *  columns, if it hasn't been filled in yet.
+     */
+    void fill_lazy_row(Gtk::TreeModel::Row row);
+
+    /** \brief Fill in the rows that are about to be drawn. */
+    bool fill_visible_rows(GdkEventExpose *event);
+
+    /** \brief Fill in every row, for instance because the view is
+     *  being sorted on a column that lazily filled rows don't have.
+     */
+    void fill_all_rows();
+
+    void handle_sort_column_changed();
+
+    /** \brief Forget the fill state of the current model. */
+    void reset_lazy_fill();
 
     background_build_store background_builder;
 
@@ -329,7 +532,6 @@ namespace gui
     class Generator : public PkgTreeModelGenerator
     {
       Glib::RefPtr<Gtk::ListStore> store;
-      // We need this to set up the sorting at the end.
       const EntityColumns *columns;
     public:
       Generator(const EntityColumns *columns);
@@ -338,6 +540,7 @@ namespace gui
       void add(const pkgCache::PkgIterator &pkg);
       void finish();
       Glib::RefPtr<Gtk::TreeModel> get_model();
+      bool fills_rows_lazily() const;
     };
 
     /** \brief Create a new PkgView.
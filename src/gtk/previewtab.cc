@@ -72,8 +72,8 @@ namespace gui
 	Gtk::TreeModel::iterator iter = store->append(tree->children());
 	Gtk::TreeModel::Row row = *iter;
 
-	PkgEntity *entity = new PkgEntity(pkg);
-	entity->fill_row(entity_columns, row);
+	PkgRowStore::get()->get_entity(pkg)->fill_row(entity_columns, row);
+	row_added(iter);
       }
   }
 
@@ -2086,7 +2086,7 @@ namespace gui
       }
     else if(force_update || new_solution != displayed_solution)
       {
-	if(Loggers::getAptitudeGtkResolver()->isEnabledFor(logging::DEBUG_LEVEL))
+	if(LOG_ENABLED(logging::DEBUG_LEVEL, Loggers::getAptitudeGtkResolver()))
 	  {
 	    if(new_solution != displayed_solution)
 	      LOG_DEBUG(Loggers::getAptitudeGtkResolver(),
@@ -154,6 +154,11 @@ namespace aptitude
     return Logger::getLogger("aptitude.gtk.toplevel.tabs");
   }
 
+  LoggerPtr Loggers::getAptitudePkgTree()
+  {
+    return Logger::getLogger("aptitude.pkgtree");
+  }
+
   LoggerPtr Loggers::getAptitudeQtInit()
   {
     return Logger::getLogger("aptitude.qt.init");
@@ -229,6 +234,11 @@ namespace aptitude
     return Logger::getLogger("aptitude.resolver.search.costs");
   }
 
+  LoggerPtr Loggers::getAptitudeStats()
+  {
+    return Logger::getLogger("aptitude.stats");
+  }
+
   LoggerPtr Loggers::getAptitudeTemp()
   {
     return Logger::getLogger("aptitude.temp");
@@ -200,6 +200,12 @@ namespace aptitude
      */
     static logging::LoggerPtr getAptitudeGtkToplevelTabs();
 
+    /** \brief The logger for the curses package tree.
+     *
+     *  Name: aptitude.pkgtree
+     */
+    static logging::LoggerPtr getAptitudePkgTree();
+
     /** \brief The logger for the initialization of the Qt frontend.
      *
      *  Name: aptitude.qt.init
@@ -293,6 +299,12 @@ namespace aptitude
      */
     static logging::LoggerPtr getAptitudeResolverThread();
 
+    /** \brief The logger for performance statistics reports.
+     *
+     *  Name: aptitude.stats
+     */
+    static logging::LoggerPtr getAptitudeStats();
+
     /** \brief The logger for messages related to temporary files. */
     static logging::LoggerPtr getAptitudeTemp();
 
@@ -25,6 +25,10 @@
 
 #include <getopt.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "aptitude.h"
 
@@ -40,7 +44,9 @@
 
 #include <generic/problemresolver/exceptions.h>
 
+#include <generic/util/async_log_sink.h>
 #include <generic/util/logging.h>
+#include <generic/util/perf_stats.h>
 #include <generic/util/temp.h>
 #include <generic/util/util.h>
 
@@ -53,6 +59,7 @@
 #endif
 
 #include <cwidget/config/keybindings.h>
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/generic/util/transcode.h>
 #include <cwidget/toplevel.h>
 #include <cwidget/dialogs.h>
@@ -66,6 +73,7 @@
 #include <cmdline/cmdline_dump_resolver.h>
 #include <cmdline/cmdline_extract_cache_subset.h>
 #include <cmdline/cmdline_forget_new.h>
+#include <cmdline/cmdline_history.h>
 #include <cmdline/cmdline_moo.h>
 #include <cmdline/cmdline_prompt.h>
 #include <cmdline/cmdline_search.h>
@@ -76,6 +84,7 @@
 #include <cmdline/cmdline_why.h>
 #include <cmdline/terminal.h>
 
+#include <sigc++/functors/mem_fun.h>
 #include <sigc++/functors/ptr_fun.h>
 
 #include <apt-pkg/error.h>
@@ -216,6 +225,7 @@ static void usage()
   printf(_(" changelog    - View a package's changelog.\n"));
   printf(_(" download     - Download the .deb file for a package.\n"));
   printf(_(" reinstall    - Download and (possibly) reinstall a currently installed package.\n"));
+  printf(_(" history      - Show the recorded history of package changes.\n"));
   printf(_(" why          - Show the manually installed packages that require a package, or\n"
            "                why one or more packages would require the given package.\n"));
   printf(_(" why-not      - Show the manually installed packages that lead to a conflict\n"
@@ -239,6 +249,8 @@ static void usage()
   printf(_(" -F format      Specify a format for displaying search results; see the manual.\n"));
   printf(_(" -O order       Specify how search results should be sorted; see the manual.\n"));
   printf(_(" -w width       Specify the display width for formatting search results.\n"));
+  printf(_(" --output-format fmt  Write the results of search, show, versions and why\n"
+           "                as \"text\" (the default) or as one \"json\" object per line.\n"));
   printf(_(" -f             Aggressively try to fix broken packages.\n"));
   printf(_(" -V             Show which versions of packages are to be installed.\n"));
   printf(_(" -D             Show the dependencies of automatically changed packages.\n"));
@@ -295,6 +307,9 @@ enum {
   OPTION_GROUP_BY,
   OPTION_SHOW_PACKAGE_NAMES,
   OPTION_NEW_GUI,
+  OPTION_SINCE,
+  OPTION_UNTIL,
+  OPTION_OUTPUT_FORMAT,
 };
 int getopt_result;
 
@@ -305,6 +320,7 @@ option opts[]={
   {"quiet", 2, NULL, 'q'},
   {"width", 1, NULL, 'w'},
   {"simulate", 0, NULL, 's'},
+  {"dry-run", 0, NULL, 's'},
   {"allow-untrusted", 0, &getopt_result, OPTION_ALLOW_UNTRUSTED},
   {"with-recommends", 0, NULL, 'r'},
   {"without-recommends", 0, NULL, 'R'},
@@ -353,6 +369,9 @@ option opts[]={
   {"group-by", 1, &getopt_result, OPTION_GROUP_BY},
   {"show-package-names", 1, &getopt_result, OPTION_SHOW_PACKAGE_NAMES},
   {"new-gui", 0, &getopt_result, OPTION_NEW_GUI},
+  {"since", 1, &getopt_result, OPTION_SINCE},
+  {"until", 1, &getopt_result, OPTION_UNTIL},
+  {"output-format", 1, &getopt_result, OPTION_OUTPUT_FORMAT},
   {0,0,0,0}
 };
 
@@ -589,6 +608,151 @@ void handle_message_logged(const char *sourceFilename,
     }
 }
 
+namespace
+{
+  // The sink that --log-file messages go to when asynchronous logging
+  // is enabled.  This is a global so that it's destroyed (and its
+  // pending messages flushed) when exit() runs global destructors,
+  // not just when main() returns.
+  boost::shared_ptr<logging::async_log_sink> async_log_file_sink;
+
+  // Where and how to write the Aptitude::Stats report.  These are
+  // read when the report is enabled, since the configuration might
+  // not be usable by the time exit handlers run.
+  std::string stats_report_file;
+  bool stats_report_json = false;
+
+  void write_stats_report()
+  {
+    namespace stats = aptitude::util::stats;
+
+    FILE *out = stderr;
+    if(!stats_report_file.empty())
+      {
+        out = fopen(stats_report_file.c_str(), "a");
+        if(out == NULL)
+          {
+            fprintf(stderr, _("Unable to open %s to write statistics: %s\n"),
+                    stats_report_file.c_str(), strerror(errno));
+            return;
+          }
+      }
+
+    if(stats_report_json)
+      stats::write_json_report(out);
+    else
+      stats::write_text_report(out);
+
+    if(out != stderr)
+      fclose(out);
+  }
+
+  // The write end of the pipe that the SIGUSR1 handler uses to wake
+  // up the thread that logs the statistics report.
+  int stats_dump_pipe_write = -1;
+
+  void handle_stats_dump_signal(int)
+  {
+    const int saved_errno = errno;
+    const char c = 0;
+    // Nothing sensible can be done about errors here; if the pipe is
+    // full, a dump is already pending anyway.
+    const ssize_t ignored = write(stats_dump_pipe_write, &c, 1);
+    (void) ignored;
+    errno = saved_errno;
+  }
+
+  /** \brief Log the statistics report each time SIGUSR1 is received.
+   *
+   *  The report can't be written from the signal handler, so the
+   *  handler just pokes this thread through a pipe.
+   */
+  class stats_dump_thread
+  {
+    int pipe_read;
+
+  public:
+    explicit stats_dump_thread(int _pipe_read)
+      : pipe_read(_pipe_read)
+    {
+    }
+
+    void operator()() const
+    {
+      logging::LoggerPtr logger = Loggers::getAptitudeStats();
+
+      while(1)
+        {
+          char c;
+          const ssize_t amt = read(pipe_read, &c, 1);
+          if(amt < 0 && errno == EINTR)
+            continue;
+          else if(amt <= 0)
+            return;
+
+          char *buf = NULL;
+          size_t size = 0;
+          FILE *report = open_memstream(&buf, &size);
+          if(report == NULL)
+            continue;
+
+          aptitude::util::stats::write_text_report(report);
+          fclose(report);
+
+          LOG_INFO(logger, "Performance statistics:\n" << std::string(buf, size));
+          free(buf);
+        }
+    }
+  };
+
+  void enable_stats_dump_signal()
+  {
+    int fds[2];
+    if(pipe(fds) != 0)
+      {
+        _error->Warning(_("Unable to create a pipe for the statistics signal handler: %s"),
+                        strerror(errno));
+        return;
+      }
+
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    stats_dump_pipe_write = fds[1];
+
+    // The thread runs until the program exits, so it's never
+    // deleted.
+    new cw::threads::thread(stats_dump_thread(fds[0]));
+
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = &handle_stats_dump_signal;
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &act, NULL);
+  }
+
+  /** \brief Turn on timing, and arrange to report the performance
+   *  statistics when aptitude exits.
+   */
+  void enable_stats_report()
+  {
+    const std::string format = aptcfg->Find(PACKAGE "::Stats::Format", "text");
+    if(format == "json")
+      stats_report_json = true;
+    else if(format != "text")
+      _error->Warning(_("Unknown statistics format \"%s\" (should be \"text\" or \"json\")."),
+                      format.c_str());
+
+    stats_report_file = aptcfg->Find(PACKAGE "::Stats::File", "");
+
+    aptitude::util::stats::set_enabled(true);
+    atexit(&write_stats_report);
+
+    enable_stats_dump_signal();
+  }
+}
+
 int main(int argc, char *argv[])
 {
   // Block signals that we want to sigwait() on by default and put the
@@ -640,6 +804,7 @@ int main(int argc, char *argv[])
   string group_by_mode_string = aptcfg->Find(PACKAGE "::CmdLine::Versions-Group-By", "auto");
   string show_package_names_mode_string = aptcfg->Find(PACKAGE "::CmdLine::Versions-Show-Package-Names", "auto");
   string sort_policy="name,version";
+  string history_since, history_until;
   string width=aptcfg->Find(PACKAGE "::CmdLine::Package-Display-Width", "");
   // Set to a non-empty string to enable logging simplistically; set
   // to "-" to log to stdout.
@@ -962,6 +1127,23 @@ int main(int argc, char *argv[])
               use_new_gtk_gui = true;
 #endif
               break;
+
+            case OPTION_SINCE:
+              history_since = optarg;
+              break;
+
+            case OPTION_UNTIL:
+              history_until = optarg;
+              break;
+
+            case OPTION_OUTPUT_FORMAT:
+              if(strcasecmp(optarg, "text") != 0 &&
+                 strcasecmp(optarg, "json") != 0)
+                _error->Error(_("Invalid output format \"%s\" (should be \"text\" or \"json\")."),
+                              optarg);
+              else
+                aptcfg->SetNoUser(PACKAGE "::CmdLine::Output-Format", optarg);
+              break;
 #ifdef HAVE_QT
 	    case OPTION_QT_GUI:
 	      use_qt_gui = true;
@@ -1038,9 +1220,25 @@ int main(int argc, char *argv[])
     }
 
   if(!log_file.empty())
-    Logger::getLogger("")
-      ->connect_message_logged(sigc::bind(sigc::ptr_fun(&handle_message_logged),
-                                          log_file));
+    {
+      if(aptcfg->FindB(PACKAGE "::Logging::Asynchronous", false))
+        {
+          async_log_file_sink =
+            logging::create_async_log_sink(log_file,
+                                           aptcfg->FindI(PACKAGE "::Logging::Buffer-Size", 1 << 20));
+
+          Logger::getLogger("")
+            ->connect_message_logged(sigc::mem_fun(*async_log_file_sink,
+                                                   &logging::async_log_sink::log_message));
+        }
+      else
+        Logger::getLogger("")
+          ->connect_message_logged(sigc::bind(sigc::ptr_fun(&handle_message_logged),
+                                              log_file));
+    }
+
+  if(aptcfg->FindB(PACKAGE "::Stats", false))
+    enable_stats_report();
 
   temp::initialize("aptitude");
 
@@ -1129,6 +1327,9 @@ int main(int argc, char *argv[])
                                     debug_search,
                                     group_by_mode,
                                     show_package_names_mode);
+	  else if(!strcasecmp(argv[optind], "history"))
+	    return cmdline_history(argc - optind, argv + optind,
+				   history_since, history_until);
 	  else if(!strcasecmp(argv[optind], "why"))
 	    return cmdline_why(argc - optind, argv + optind,
 			       status_fname, verbose,
@@ -37,6 +37,12 @@
 
 #include <cwidget/generic/util/transcode.h>
 
+#include <sigc++/connection.h>
+#include <sigc++/functors/mem_fun.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
 #include <unistd.h>
 
 namespace cw = cwidget;
@@ -113,7 +119,187 @@ const char *pkg_item::pkg_columnizer::column_names[pkg_columnizer::numtypes]=
 
 cw::column_disposition pkg_item::pkg_columnizer::setup_column(int type)
 {
-  return setup_column(pkg, visible_ver, basex, type);
+  if(use_cache)
+    return setup_cached_column(pkg, visible_ver, basex, type);
+  else
+    return setup_column(pkg, visible_ver, basex, type);
+}
+
+namespace
+{
+  // How a column may be cached by setup_cached_column().
+  enum column_lifetime
+    {
+      // The column depends on basex or on the whole system.
+      lifetime_uncached,
+      // The column depends on the state of the package cache.
+      lifetime_state,
+      // The column only depends on the package cache itself.
+      lifetime_cache
+    };
+
+  column_lifetime get_column_lifetime(int type)
+  {
+    typedef pkg_item::pkg_columnizer c;
+
+    switch(type)
+      {
+      case c::installed_size:
+      case c::debsize:
+      case c::stateflag:
+      case c::longstate:
+      case c::currver:
+      case c::description:
+      case c::maintainer:
+      case c::priority:
+      case c::shortpriority:
+      case c::section:
+      case c::revdepcount:
+      case c::archive:
+      case c::pin_priority:
+      case c::trust_state:
+	return lifetime_cache;
+
+      case c::actionflag:
+      case c::longaction:
+      case c::candver:
+      case c::sizechange:
+      case c::autoset:
+      case c::tagged:
+	return lifetime_state;
+
+      default:
+	return lifetime_uncached;
+      }
+  }
+
+  // The columns that setup_cached_column() has generated, indexed by
+  // package ID and column type.
+  class column_cache
+  {
+    struct entry
+    {
+      const pkgCache::Version *ver;
+      // The value of state_generation when the column was generated.
+      unsigned long generation;
+      cw::column_disposition value;
+
+      entry(const pkgCache::Version *_ver,
+	    unsigned long _generation,
+	    const cw::column_disposition &_value)
+	: ver(_ver), generation(_generation), value(_value)
+      {
+      }
+    };
+
+    typedef boost::unordered_map<std::pair<unsigned long, int>, entry> entry_map;
+    entry_map entries;
+
+    // Incremented whenever a package's state changes, which
+    // invalidates every column with lifetime_state.
+    unsigned long state_generation;
+
+    // The depcache whose package_state_changed signal is connected.
+    const aptitudeDepCache *connected_cache;
+    sigc::connection state_changed_connection;
+
+    // Scrolling through a very long list would otherwise keep a copy
+    // of every column of every package.
+    static const entry_map::size_type max_entries = 50000;
+
+    void handle_state_changed()
+    {
+      ++state_generation;
+    }
+
+    void handle_cache_closed()
+    {
+      clear();
+      state_changed_connection.disconnect();
+      connected_cache = NULL;
+    }
+
+    column_cache()
+      : state_generation(0), connected_cache(NULL)
+    {
+      cache_closed.connect(sigc::mem_fun(*this, &column_cache::handle_cache_closed));
+    }
+
+  public:
+    static column_cache &get()
+    {
+      // Leaked so that it outlives the signals it's connected to.
+      static column_cache *instance = new column_cache;
+      return *instance;
+    }
+
+    void clear()
+    {
+      entries.clear();
+    }
+
+    cw::column_disposition get_column(const pkgCache::PkgIterator &pkg,
+				      const pkgCache::VerIterator &ver,
+				      int basex,
+				      int type)
+    {
+      const column_lifetime lifetime = get_column_lifetime(type);
+      if(lifetime == lifetime_uncached || pkg.end() || !apt_cache_file)
+	return pkg_item::pkg_columnizer::setup_column(pkg, ver, basex, type);
+
+      const aptitudeDepCache *cache = *apt_cache_file;
+      if(cache != connected_cache)
+	{
+	  clear();
+	  state_changed_connection.disconnect();
+	  state_changed_connection =
+	    (*apt_cache_file)->package_state_changed.connect(sigc::mem_fun(*this, &column_cache::handle_state_changed));
+	  connected_cache = cache;
+	}
+
+      const std::pair<unsigned long, int> key(pkg->ID, type);
+      const pkgCache::Version *v = ver.end() ? NULL : static_cast<const pkgCache::Version *>(ver);
+
+      entry_map::iterator found = entries.find(key);
+      if(found != entries.end() &&
+	 found->second.ver == v &&
+	 (lifetime == lifetime_cache ||
+	  found->second.generation == state_generation))
+	return found->second.value;
+
+      const cw::column_disposition value =
+	pkg_item::pkg_columnizer::setup_column(pkg, ver, basex, type);
+
+      if(found != entries.end())
+	{
+	  found->second.ver = v;
+	  found->second.generation = state_generation;
+	  found->second.value = value;
+	}
+      else
+	{
+	  if(entries.size() >= max_entries)
+	    clear();
+
+	  entries.insert(entry_map::value_type(key, entry(v, state_generation, value)));
+	}
+
+      return value;
+    }
+  };
+}
+
+cw::column_disposition pkg_item::pkg_columnizer::setup_cached_column(const pkgCache::PkgIterator &pkg,
+								     const pkgCache::VerIterator &ver,
+								     int basex,
+								     int type)
+{
+  return column_cache::get().get_column(pkg, ver, basex, type);
+}
+
+void pkg_item::pkg_columnizer::clear_column_cache()
+{
+  column_cache::get().clear();
 }
 
 cw::column_disposition pkg_item::pkg_columnizer::setup_column(const pkgCache::PkgIterator &pkg,
@@ -660,7 +846,10 @@ void pkg_item::pkg_columnizer::setup_columns(bool force_update)
     init_formatting();
 
   if(force_update)
-    delete columns;
+    {
+      delete columns;
+      clear_column_cache();
+    }
   if(force_update || !columns)
     {
       std::wstring cfg;
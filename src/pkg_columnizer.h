@@ -44,6 +44,9 @@ class pkg_item::pkg_columnizer : public cwidget::config::column_generator
 
   int basex;
 
+  // If true, setup_column(int) uses the rendered-column cache.
+  bool use_cache;
+
   // Set up the translated format widths.
   static void init_formatting();
 protected:
@@ -56,6 +59,25 @@ public:
 						  int type);
   virtual cwidget::column_disposition setup_column(int type);
 
+  /** \brief Like setup_column(pkg, ver, basex, type), but reuse the
+   *  text that was generated the last time this column was shown for
+   *  this package and version, if it is still valid.
+   *
+   *  Columns that depend only on the package cache are kept until the
+   *  cache is closed; columns that depend on the state of the package
+   *  (or, like the action flag, on the state of other packages) are
+   *  thrown away whenever any package's state changes.  Columns that
+   *  describe the whole system and the name column, which depends on
+   *  \b basex, are never cached.
+   */
+  static cwidget::column_disposition setup_cached_column(const pkgCache::PkgIterator &pkg,
+							 const pkgCache::VerIterator &ver,
+							 int basex,
+							 int type);
+
+  /** \brief Throw away every column stored by setup_cached_column(). */
+  static void clear_column_cache();
+
   static const cwidget::config::column_definition_list &get_columns()
   {
     setup_columns();
@@ -86,14 +108,22 @@ public:
 
   int get_basex() {return basex;}
 
+  /** \brief Create a columnizer for one package.
+   *
+   *  \param _use_cache  If \b true, columns are looked up with
+   *                     setup_cached_column(); this is meant for
+   *                     package lists that are repainted often.
+   */
   pkg_columnizer(const pkgCache::PkgIterator &_pkg,
 		 const pkgCache::VerIterator &_visible_ver,
 		 const cwidget::config::column_definition_list &_columns,
-		 int _basex)
+		 int _basex,
+		 bool _use_cache = false)
     : column_generator(_columns),
       pkg(_pkg),
       visible_ver(_visible_ver),
-      basex(_basex)
+      basex(_basex),
+      use_cache(_use_cache)
   {
   }
 
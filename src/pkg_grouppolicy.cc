@@ -54,10 +54,6 @@ namespace cw = cwidget;
 namespace matching = aptitude::matching;
 using cw::util::ref_ptr;
 
-pkg_grouppolicy_factory::~pkg_grouppolicy_factory()
-{
-}
-
 // This special tree munges its tag to allow an integer to be prepended to it.
 // Ok, it's a dreadful hack.  I admit it.
 class pkg_subtree_with_order:public pkg_subtree
@@ -96,7 +92,8 @@ public:
 
   virtual void add_package(const pkgCache::PkgIterator &i, pkg_subtree *root)
     {
-      root->add_child(new pkg_item(i, get_sig()));
+      // The item is only created if the user looks inside root.
+      root->add_package_lazily(i, get_sig());
       root->inc_num_packages();
     }
 };
@@ -123,21 +120,39 @@ class pkg_grouppolicy_section:public pkg_grouppolicy
   pkg_grouppolicy_section_factory::split_mode_type split_mode;
   bool passthrough;
 
+  // The sections that the factory worked out ahead of time.
+  const std::vector<pkg_grouppolicy_section_factory::package_section> *classes;
+
   // The descriptions are in the cw::style used by package descriptions.
   static std::map<string, wstring> section_descriptions;
   static void init_section_descriptions();
 public:
   pkg_grouppolicy_section(pkg_grouppolicy_section_factory::split_mode_type _split_mode,
 			  bool _passthrough,
+			  const std::vector<pkg_grouppolicy_section_factory::package_section> *_classes,
 			  pkg_grouppolicy_factory *_chain,
 			  pkg_signal *_sig,
 			  desc_signal *_desc_sig)
     :pkg_grouppolicy(_sig, _desc_sig), chain(_chain),
-     split_mode(_split_mode), passthrough(_passthrough)
+     split_mode(_split_mode), passthrough(_passthrough),
+     classes(_classes)
   {
     init_section_descriptions();
   }
 
+  /** \brief Find the section that \b pkg is placed in.
+   *
+   *  \param may_passthrough  Set to \b true if the package is
+   *                          virtual, has no section, or is a task
+   *                          package.
+   *
+   *  This only reads the package cache, so it can be called from
+   *  any thread.
+   */
+  static string get_section(const pkgCache::PkgIterator &pkg,
+			    pkg_grouppolicy_section_factory::split_mode_type split_mode,
+			    bool &may_passthrough);
+
   virtual void add_package(const pkgCache::PkgIterator &pkg, pkg_subtree *root);
 
   virtual ~pkg_grouppolicy_section()
@@ -150,8 +165,32 @@ public:
 pkg_grouppolicy *pkg_grouppolicy_section_factory::instantiate(pkg_signal *_sig,
 							      desc_signal *_desc_sig)
 {
-  return new pkg_grouppolicy_section(split_mode, passthrough, chain,
-				     _sig, _desc_sig);
+  return new pkg_grouppolicy_section(split_mode, passthrough, &sections,
+				     chain, _sig, _desc_sig);
+}
+
+bool pkg_grouppolicy_section_factory::prepare_classify(unsigned long num_packages)
+{
+  sections.clear();
+  sections.resize(num_packages);
+  chain->prepare_classify(num_packages);
+  return true;
+}
+
+void pkg_grouppolicy_section_factory::classify(const pkgCache::PkgIterator &pkg)
+{
+  package_section &entry(sections[pkg->ID]);
+  entry.section = pkg_grouppolicy_section::get_section(pkg, split_mode,
+						       entry.may_passthrough);
+  entry.classified = true;
+
+  chain->classify(pkg);
+}
+
+void pkg_grouppolicy_section_factory::clear_classify()
+{
+  std::vector<package_section>().swap(sections);
+  chain->clear_classify();
 }
 
 std::map<string, wstring> pkg_grouppolicy_section::section_descriptions;
@@ -243,13 +282,11 @@ void pkg_grouppolicy_section::init_section_descriptions()
   already_done = true;
 }
 
-void pkg_grouppolicy_section::add_package(const pkgCache::PkgIterator &pkg,
-					  pkg_subtree *root)
+string pkg_grouppolicy_section::get_section(const pkgCache::PkgIterator &pkg,
+					    pkg_grouppolicy_section_factory::split_mode_type split_mode,
+					    bool &may_passthrough)
 {
-  // This flag tracks whether we're in a branch of the logic in which
-  // the passthrough option is obeyed.  That basically means that the
-  // package is virtual, has no section, or is a task package.
-  bool may_passthrough = false;
+  may_passthrough = false;
 
   string section;
   if(!strncmp(pkg.Name(), "task-", 5))
@@ -287,6 +324,26 @@ void pkg_grouppolicy_section::add_package(const pkgCache::PkgIterator &pkg,
 	section = section.substr(first_split + 1);
     }
 
+  return section;
+}
+
+void pkg_grouppolicy_section::add_package(const pkgCache::PkgIterator &pkg,
+					  pkg_subtree *root)
+{
+  // This flag tracks whether we're in a branch of the logic in which
+  // the passthrough option is obeyed.  That basically means that the
+  // package is virtual, has no section, or is a task package.
+  bool may_passthrough;
+
+  string section;
+  if(pkg->ID < classes->size() && (*classes)[pkg->ID].classified)
+    {
+      section = (*classes)[pkg->ID].section;
+      may_passthrough = (*classes)[pkg->ID].may_passthrough;
+    }
+  else
+    section = get_section(pkg, split_mode, may_passthrough);
+
   // If passthrough is enabled and this package is in a section that
   // can pass through, place it directly in the top-level tree.
   if(passthrough && may_passthrough)
@@ -427,20 +484,34 @@ void pkg_grouppolicy_section::add_package(const pkgCache::PkgIterator &pkg,
 
 class pkg_grouppolicy_status:public pkg_grouppolicy
 {
+public:
   static const int numgroups=7;
-  pkg_grouppolicy_factory *chain;
 
   enum states {security_upgradable, upgradable, newpkg, installed, not_installed, obsolete_pkg, virtual_pkg};
 
+  /** \brief Find the group that \b pkg is placed in.
+   *
+   *  This only reads the package cache, so it can be called from
+   *  any thread.
+   */
+  static states get_state(const pkgCache::PkgIterator &pkg);
+
+private:
+  pkg_grouppolicy_factory *chain;
+
+  // The groups that the factory worked out ahead of time.
+  const std::vector<signed char> *classes;
+
   static const char * const state_titles[numgroups];
   // FIXME: need better titles :)
 
   pair<pkg_grouppolicy *, pkg_subtree *> children[numgroups];
 public:
   pkg_grouppolicy_status(pkg_grouppolicy_factory *_chain,
+			 const std::vector<signed char> *_classes,
 			 pkg_signal *_sig,
 			 desc_signal *_desc_sig)
-    :pkg_grouppolicy(_sig, _desc_sig), chain(_chain)
+    :pkg_grouppolicy(_sig, _desc_sig), chain(_chain), classes(_classes)
     {
       for(int i=0; i<( (int) (sizeof(children)/sizeof(children[0]))); i++)
 	{
@@ -472,7 +543,26 @@ const char * const pkg_grouppolicy_status::state_titles[numgroups] =
 pkg_grouppolicy *pkg_grouppolicy_status_factory::instantiate(pkg_signal *_sig,
 							     desc_signal *_desc_sig)
 {
-  return new pkg_grouppolicy_status(chain, _sig, _desc_sig);
+  return new pkg_grouppolicy_status(chain, &states, _sig, _desc_sig);
+}
+
+bool pkg_grouppolicy_status_factory::prepare_classify(unsigned long num_packages)
+{
+  states.assign(num_packages, -1);
+  chain->prepare_classify(num_packages);
+  return true;
+}
+
+void pkg_grouppolicy_status_factory::classify(const pkgCache::PkgIterator &pkg)
+{
+  states[pkg->ID] = pkg_grouppolicy_status::get_state(pkg);
+  chain->classify(pkg);
+}
+
+void pkg_grouppolicy_status_factory::clear_classify()
+{
+  std::vector<signed char>().swap(states);
+  chain->clear_classify();
 }
 
 // Stolen from apt-watch:
@@ -490,8 +580,8 @@ static bool version_is_security(const pkgCache::VerIterator &ver)
   return false;
 }
 
-void pkg_grouppolicy_status::add_package(const pkgCache::PkgIterator &pkg,
-					 pkg_subtree *root)
+pkg_grouppolicy_status::states
+pkg_grouppolicy_status::get_state(const pkgCache::PkgIterator &pkg)
 {
   states section;
   pkgDepCache::StateCache &state=(*apt_cache_file)[pkg];
@@ -518,6 +608,18 @@ void pkg_grouppolicy_status::add_package(const pkgCache::PkgIterator &pkg,
 	section=installed;
     }
 
+  return section;
+}
+
+void pkg_grouppolicy_status::add_package(const pkgCache::PkgIterator &pkg,
+					 pkg_subtree *root)
+{
+  states section;
+  if(pkg->ID < classes->size() && (*classes)[pkg->ID] >= 0)
+    section = static_cast<states>((*classes)[pkg->ID]);
+  else
+    section = get_state(pkg);
+
   if(!children[section].second)
     {
       wstring desc = W_(state_titles[section]);
@@ -572,6 +674,8 @@ pkg_grouppolicy_filter_factory::~pkg_grouppolicy_filter_factory()
   delete chain;
 }
 
+PKG_GROUPPOLICY_CLASSIFY_CHAIN(pkg_grouppolicy_filter_factory)
+
 /*****************************************************************************/
 
 class pkg_grouppolicy_mode:public pkg_grouppolicy
@@ -581,10 +685,21 @@ class pkg_grouppolicy_mode:public pkg_grouppolicy
   pair<pkg_grouppolicy *, pkg_subtree *> suggested_child;
   pair<pkg_grouppolicy *, pkg_subtree *> recommended_child;
   pkg_grouppolicy_factory *chain;
+
+  // The groups that the factory worked out ahead of time.
+  const std::vector<signed char> *classes;
 public:
+  /** \brief The group of a package that is placed in no group. */
+  static const int no_group = -1;
+  /** \brief The group of a package that wasn't classified. */
+  static const int unclassified = -2;
+  static const int recommended_group = num_pkg_action_states;
+  static const int suggested_group = num_pkg_action_states + 1;
+
   pkg_grouppolicy_mode(pkg_grouppolicy_factory *_chain,
+		       const std::vector<signed char> *_classes,
 		       pkg_signal *_sig, desc_signal *_desc_sig)
-    :pkg_grouppolicy(_sig, _desc_sig), chain(_chain)
+    :pkg_grouppolicy(_sig, _desc_sig), chain(_chain), classes(_classes)
   {
     for(int i=0; i<num_pkg_action_states; i++)
       {
@@ -593,10 +708,35 @@ public:
       }
   }
 
-  void add_package(const pkgCache::PkgIterator &pkg, pkg_subtree *root)
+  /** \brief Find the group that \b pkg is placed in: a
+   *  pkg_action_state, recommended_group, suggested_group or
+   *  no_group.
+   *
+   *  This only reads the package cache, so it can be called from
+   *  any thread.
+   */
+  static int get_group(const pkgCache::PkgIterator &pkg)
   {
     int group = find_pkg_state(pkg, *apt_cache_file);
     if(group!=pkg_unchanged)
+      return group;
+    else if(pkg.CurrentVer().end() && package_recommended(pkg))
+      return recommended_group;
+    else if(pkg.CurrentVer().end() && package_suggested(pkg))
+      return suggested_group;
+    else
+      return no_group;
+  }
+
+  void add_package(const pkgCache::PkgIterator &pkg, pkg_subtree *root)
+  {
+    int group;
+    if(pkg->ID < classes->size() && (*classes)[pkg->ID] != unclassified)
+      group = (*classes)[pkg->ID];
+    else
+      group = get_group(pkg);
+
+    if(group>=0 && group<num_pkg_action_states)
       {
 	if(!children[group].second)
 	  {
@@ -617,7 +757,7 @@ public:
 
 	children[group].first->add_package(pkg, children[group].second);
       }
-    else if(pkg.CurrentVer().end() && package_recommended(pkg))
+    else if(group==recommended_group)
       {
 	if(!recommended_child.second)
 	  {
@@ -638,7 +778,7 @@ public:
 
 	recommended_child.first->add_package(pkg, recommended_child.second);
       }
-    else if(pkg.CurrentVer().end() && package_suggested(pkg))
+    else if(group==suggested_group)
       {
 	if(!suggested_child.second)
 	  {
@@ -687,7 +827,26 @@ const char * const pkg_grouppolicy_mode::child_names[num_pkg_action_states]=
 pkg_grouppolicy *pkg_grouppolicy_mode_factory::instantiate(pkg_signal *_sig,
 							   desc_signal *_desc_sig)
 {
-  return new pkg_grouppolicy_mode(chain, _sig, _desc_sig);
+  return new pkg_grouppolicy_mode(chain, &groups, _sig, _desc_sig);
+}
+
+bool pkg_grouppolicy_mode_factory::prepare_classify(unsigned long num_packages)
+{
+  groups.assign(num_packages, pkg_grouppolicy_mode::unclassified);
+  chain->prepare_classify(num_packages);
+  return true;
+}
+
+void pkg_grouppolicy_mode_factory::classify(const pkgCache::PkgIterator &pkg)
+{
+  groups[pkg->ID] = pkg_grouppolicy_mode::get_group(pkg);
+  chain->classify(pkg);
+}
+
+void pkg_grouppolicy_mode_factory::clear_classify()
+{
+  std::vector<signed char>().swap(groups);
+  chain->clear_classify();
 }
 
 /*****************************************************************************/
@@ -746,6 +905,8 @@ pkg_grouppolicy *pkg_grouppolicy_firstchar_factory::instantiate(pkg_signal *sig,
   return new pkg_grouppolicy_firstchar(chain, sig, desc_sig);
 }
 
+PKG_GROUPPOLICY_CLASSIFY_CHAIN(pkg_grouppolicy_firstchar_factory)
+
 /*****************************************************************************/
 
 // Groups packages by priority
@@ -843,6 +1004,8 @@ pkg_grouppolicy *pkg_grouppolicy_priority_factory::instantiate(pkg_signal *sig,
   return new pkg_grouppolicy_priority(chain, sig, desc_sig);
 }
 
+PKG_GROUPPOLICY_CLASSIFY_CHAIN(pkg_grouppolicy_priority_factory)
+
 /*****************************************************************************/
 
 // This class generates a pkg_subtree from a hierarchy
@@ -1171,6 +1334,8 @@ pkg_grouppolicy_task_factory::~pkg_grouppolicy_task_factory()
   delete chain;
 }
 
+PKG_GROUPPOLICY_CLASSIFY_CHAIN(pkg_grouppolicy_task_factory)
+
 
 class pkg_grouppolicy_patterns : public pkg_grouppolicy
 {
@@ -1759,3 +1924,5 @@ pkg_grouppolicy *pkg_grouppolicy_source_factory::instantiate(pkg_signal *sig,
 {
   return new pkg_grouppolicy_source(chain, sig, desc_sig);
 }
+
+PKG_GROUPPOLICY_CLASSIFY_CHAIN(pkg_grouppolicy_source_factory)
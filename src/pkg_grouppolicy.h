@@ -24,6 +24,7 @@
 #include <apt-pkg/pkgcache.h>
 #include <sigc++/signal.h>
 
+#include <string>
 #include <vector>
 
 #include <generic/apt/matching/pattern.h>
@@ -89,15 +90,67 @@ public:
 };
 
 // Where policy comes from.
+//
+// Before a large batch of packages is added, a factory can be asked to
+// classify them ahead of time: prepare_classify() is called once, then
+// classify() is called for each package, possibly from several threads
+// at once (each thread gets its own range of packages).  Policies that
+// the factory instantiates afterwards can then look up the group of a
+// package instead of computing it in add_package().  clear_classify()
+// throws the results away.
+//
+// Factories that classify nothing still have to pass these calls on to
+// their chain.  Policies must fall back to computing the group
+// themselves for packages that weren't classified.
 class pkg_grouppolicy_factory
 {
 public:
   virtual pkg_grouppolicy *instantiate(pkg_signal *_sig,
 				       desc_signal *_desc_sig)=0;
 
-  virtual ~pkg_grouppolicy_factory();
+  /** \brief Get ready to classify the packages of a cache that holds
+   *  \b num_packages packages.
+   *
+   *  \return \b true if classify() does any work in this factory or
+   *  in one that it chains to.  The default returns \b false.
+   */
+  virtual bool prepare_classify(unsigned long num_packages) { return false; }
+
+  /** \brief Work out and remember the group of \b pkg.
+   *
+   *  This may be called concurrently for different packages, so it
+   *  must only read the package cache and the factory's own table
+   *  entry for \b pkg.
+   */
+  virtual void classify(const pkgCache::PkgIterator &pkg) {}
+
+  /** \brief Forget everything that classify() worked out. */
+  virtual void clear_classify() {}
+
+  virtual ~pkg_grouppolicy_factory() {}
 };
 
+// Implements the classification calls for a factory that classifies
+// nothing itself, by passing them on to its chain; the factory must
+// declare them and keep its chain in a member named "chain".
+#define PKG_GROUPPOLICY_CLASSIFY_CHAIN(factory)				\
+bool factory::prepare_classify(unsigned long num_packages)		\
+{									\
+  return chain != NULL && chain->prepare_classify(num_packages);	\
+}									\
+									\
+void factory::classify(const pkgCache::PkgIterator &pkg)		\
+{									\
+  if(chain != NULL)							\
+    chain->classify(pkg);						\
+}									\
+									\
+void factory::clear_classify()						\
+{									\
+  if(chain != NULL)							\
+    chain->clear_classify();						\
+}
+
 // ==========================================================================
 //                           BEGIN SPECIALIZED FACTORIES
 // NOTE: This code may move to its own header/source files someday.
@@ -157,6 +210,22 @@ private:
   // task packages will be 'passed through' to the next policy without having
   // a new level of tree structure created.
   bool passthrough;
+
+public:
+  /** \brief The section of one package, as worked out by classify(). */
+  struct package_section
+  {
+    std::string section;
+    bool classified;
+    bool may_passthrough;
+
+    package_section() : classified(false), may_passthrough(false) {}
+  };
+
+private:
+  // Indexed by package ID.
+  std::vector<package_section> sections;
+
 public:
   pkg_grouppolicy_section_factory(split_mode_type _split_mode,
 				  bool _passthrough,
@@ -166,6 +235,10 @@ public:
   virtual pkg_grouppolicy *instantiate(pkg_signal *_sig,
 				       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_section_factory()
   {delete chain;}
 };
@@ -174,12 +247,20 @@ public:
 class pkg_grouppolicy_status_factory:public pkg_grouppolicy_factory
 {
   pkg_grouppolicy_factory *chain;
+
+  // The status group of each package, indexed by package ID; -1 if
+  // the package wasn't classified.
+  std::vector<signed char> states;
 public:
   pkg_grouppolicy_status_factory(pkg_grouppolicy_factory *_chain):chain(_chain) {}
 
   virtual pkg_grouppolicy *instantiate(pkg_signal *_sig,
 				       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_status_factory()
   {delete chain;}
 };
@@ -198,6 +279,10 @@ public:
   virtual pkg_grouppolicy *instantiate(pkg_signal *_sig,
 				       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_filter_factory();
 };
 
@@ -208,12 +293,20 @@ bool pkg_missing_filter(const pkgCache::PkgIterator &pkg);
 class pkg_grouppolicy_mode_factory:public pkg_grouppolicy_factory
 {
   pkg_grouppolicy_factory *chain;
+
+  // The mode group of each package, indexed by package ID; see
+  // pkg_grouppolicy.cc for the encoding.
+  std::vector<signed char> groups;
 public:
   pkg_grouppolicy_mode_factory(pkg_grouppolicy_factory *_chain):chain(_chain) {}
 
   pkg_grouppolicy *instantiate(pkg_signal *_sig,
 			       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_mode_factory()
   {delete chain;}
 };
@@ -232,6 +325,10 @@ public:
   pkg_grouppolicy *instantiate(pkg_signal *_sig,
 			       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_firstchar_factory()
   {delete chain;}
 };
@@ -246,6 +343,10 @@ public:
   pkg_grouppolicy *instantiate(pkg_signal *_sig,
 			       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_priority_factory()
   {delete chain;}
 };
@@ -290,6 +391,10 @@ public:
   pkg_grouppolicy *instantiate(pkg_signal *sig,
 			       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_task_factory();
 };
 
@@ -387,6 +492,10 @@ public:
   pkg_grouppolicy *instantiate(pkg_signal *_sig,
 			       desc_signal *_desc_sig);
 
+  virtual bool prepare_classify(unsigned long num_packages);
+  virtual void classify(const pkgCache::PkgIterator &pkg);
+  virtual void clear_classify();
+
   virtual ~pkg_grouppolicy_source_factory()
   {delete chain;}
 };
@@ -122,96 +122,126 @@ void pkg_item::do_highlighted_changed(bool highlighted)
     }
 }
 
-void pkg_item::do_select(undo_group *undo)
+void pkg_item::do_select(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
-	(*apt_cache_file)->mark_install(package, aptcfg->FindB(PACKAGE "::Auto-Install", true), false, undo);
+	(*apt_cache_file)->mark_install(pkg, aptcfg->FindB(PACKAGE "::Auto-Install", true), false, undo);
 }
 
-void pkg_item::select(undo_group *undo)
+void pkg_item::select_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
   if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
-    do_select(undo);
-  else if(!(*apt_cache_file)[package].Delete())
-    do_select(undo);
+    do_select(pkg, undo);
+  else if(!(*apt_cache_file)[pkg].Delete())
+    do_select(pkg, undo);
   else
-    do_hold(undo);
+    do_hold(pkg, undo);
+}
+
+void pkg_item::select(undo_group *undo)
+{
+  select_package(package, undo);
 }
 
-void pkg_item::do_hold(undo_group *undo)
+void pkg_item::do_hold(const pkgCache::PkgIterator &pkg, undo_group *undo)
   // Sets an explicit hold state.
 {
-  (*apt_cache_file)->mark_keep(package, false, true, undo);
+  (*apt_cache_file)->mark_keep(pkg, false, true, undo);
 }
 
-void pkg_item::hold(undo_group *undo)
+void pkg_item::hold_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
   // Sets an /explicit/ hold state.  May be useful for, eg, saying that the
   // current package version (which is the newest) should be kept even if/when
   // a newer version becomes available.
 {
   if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
-    do_hold(undo);
+    do_hold(pkg, undo);
   else
     // Toggle the held state.
-    (*apt_cache_file)->mark_keep(package,
+    (*apt_cache_file)->mark_keep(pkg,
 				 false,
-				 (*apt_cache_file)->get_ext_state(package).selection_state!=pkgCache::State::Hold,
+				 (*apt_cache_file)->get_ext_state(pkg).selection_state!=pkgCache::State::Hold,
 				 undo);
 }
 
-void pkg_item::keep(undo_group *undo)
+void pkg_item::hold(undo_group *undo)
+{
+  hold_package(package, undo);
+}
+
+void pkg_item::keep_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
   // Keep, don't hold, the package.
-  (*apt_cache_file)->mark_keep(package,
+  (*apt_cache_file)->mark_keep(pkg,
 			       false,
 			       false,
 			       undo);
 }
 
-void pkg_item::do_remove(undo_group *undo)
+void pkg_item::keep(undo_group *undo)
+{
+  keep_package(package, undo);
+}
+
+void pkg_item::do_remove(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
-  if(((package->Flags&pkgCache::Flag::Essential)==pkgCache::Flag::Essential ||
-      (package->Flags&pkgCache::Flag::Important)==pkgCache::Flag::Important) &&
-     (*apt_cache_file)[package].Status != 2)
-    confirm_delete_essential(package, false);
+  if(((pkg->Flags&pkgCache::Flag::Essential)==pkgCache::Flag::Essential ||
+      (pkg->Flags&pkgCache::Flag::Important)==pkgCache::Flag::Important) &&
+     (*apt_cache_file)[pkg].Status != 2)
+    confirm_delete_essential(pkg, false);
   else
-    (*apt_cache_file)->mark_delete(package, false, false, undo);
+    (*apt_cache_file)->mark_delete(pkg, false, false, undo);
 }
 
-void pkg_item::remove(undo_group *undo)
+void pkg_item::remove_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
   if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
-    do_remove(undo);
-  else if(!(*apt_cache_file)[package].Install() && !((*apt_cache_file)[package].iFlags&pkgDepCache::ReInstall))
-    do_remove(undo);
+    do_remove(pkg, undo);
+  else if(!(*apt_cache_file)[pkg].Install() && !((*apt_cache_file)[pkg].iFlags&pkgDepCache::ReInstall))
+    do_remove(pkg, undo);
   else
     {
-      if((*apt_cache_file)[package].iFlags&pkgDepCache::ReInstall)
-	(*apt_cache_file)->mark_keep(package, false, false, undo);
+      if((*apt_cache_file)[pkg].iFlags&pkgDepCache::ReInstall)
+	(*apt_cache_file)->mark_keep(pkg, false, false, undo);
       else
-	(*apt_cache_file)->mark_keep(package, false, (*apt_cache_file)[package].Status==1, undo);
+	(*apt_cache_file)->mark_keep(pkg, false, (*apt_cache_file)[pkg].Status==1, undo);
     }
 }
 
+void pkg_item::remove(undo_group *undo)
+{
+  remove_package(package, undo);
+}
+
 // No "do_purge" because purge was always idempotent.
-void pkg_item::purge(undo_group *undo)
+void pkg_item::purge_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
-  if(((package->Flags&pkgCache::Flag::Essential)==pkgCache::Flag::Essential ||
-      (package->Flags&pkgCache::Flag::Important)==pkgCache::Flag::Important) &&
-     (*apt_cache_file)[package].Status != 2)
-    confirm_delete_essential(package, false);
+  if(((pkg->Flags&pkgCache::Flag::Essential)==pkgCache::Flag::Essential ||
+      (pkg->Flags&pkgCache::Flag::Important)==pkgCache::Flag::Important) &&
+     (*apt_cache_file)[pkg].Status != 2)
+    confirm_delete_essential(pkg, false);
   else
-    (*apt_cache_file)->mark_delete(package, true, false, undo);
+    (*apt_cache_file)->mark_delete(pkg, true, false, undo);
 }
 
-void pkg_item::reinstall(undo_group *undo)
+void pkg_item::purge(undo_group *undo)
+{
+  purge_package(package, undo);
+}
+
+void pkg_item::reinstall_package(const pkgCache::PkgIterator &pkg, undo_group *undo)
 {
-  if(!package.CurrentVer().end())
-    (*apt_cache_file)->mark_install(package,
+  if(!pkg.CurrentVer().end())
+    (*apt_cache_file)->mark_install(pkg,
 				    aptcfg->FindB(PACKAGE "::Auto-Install", true),
 				    true,
 				    undo);
 }
 
+void pkg_item::reinstall(undo_group *undo)
+{
+  reinstall_package(package, undo);
+}
+
 void pkg_item::forbid_upgrade(undo_group *undo)
 {
   pkgCache::VerIterator curver=package.CurrentVer();
@@ -221,9 +251,14 @@ void pkg_item::forbid_upgrade(undo_group *undo)
     (*apt_cache_file)->forbid_upgrade(package, candver.VerStr(), undo);
 }
 
+void pkg_item::set_package_auto(const pkgCache::PkgIterator &pkg, bool isauto, undo_group *undo)
+{
+  (*apt_cache_file)->mark_auto_installed(pkg, isauto, undo);
+}
+
 void pkg_item::set_auto(bool isauto, undo_group *undo)
 {
-  (*apt_cache_file)->mark_auto_installed(package, isauto, undo);
+  set_package_auto(package, isauto, undo);
 }
 
 void pkg_item::show_information()
@@ -310,7 +345,7 @@ void pkg_item::paint(cw::tree *win, int y, bool hierarchical, const cw::style &s
   pkg_columnizer::setup_columns();
 
   cw::config::empty_column_parameters p;
-  wstring disp=pkg_columnizer(package, visible_version(), pkg_columnizer::get_columns(), basex).layout_columns(width, p);
+  wstring disp=pkg_columnizer(package, visible_version(), pkg_columnizer::get_columns(), basex, true).layout_columns(width, p);
   win->mvaddnstr(y, 0, disp.c_str(), width);
 }
 
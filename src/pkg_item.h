@@ -44,9 +44,9 @@ class pkg_item:public pkg_tree_node
 
   // These perform the given action.  They are idempotent, like dselect's
   // keyboard commands.
-  void do_select(undo_group *undo);
-  void do_hold(undo_group *undo);
-  void do_remove(undo_group *undo);
+  static void do_select(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void do_hold(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void do_remove(const pkgCache::PkgIterator &pkg, undo_group *undo);
 
   void do_highlighted_changed(bool highlighted);
 public:
@@ -72,6 +72,22 @@ public:
   virtual void set_auto(bool isauto, undo_group *undo);
   virtual void forbid_upgrade(undo_group *undo);
 
+  /** \name Package actions
+   *
+   *  These do what the corresponding methods do to an item of \b
+   *  pkg, so that subtrees can act on their packages without
+   *  creating items for them.
+   */
+  // @{
+  static void select_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void hold_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void keep_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void remove_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void purge_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void reinstall_package(const pkgCache::PkgIterator &pkg, undo_group *undo);
+  static void set_package_auto(const pkgCache::PkgIterator &pkg, bool isauto, undo_group *undo);
+  // @}
+
   virtual cwidget::style get_highlight_style();
   virtual cwidget::style get_normal_style();
 
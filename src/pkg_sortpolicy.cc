@@ -21,23 +21,139 @@
 #include "pkg_item.h"
 #include "pkg_ver_item.h"
 
+#include <generic/apt/apt.h>
+#include <generic/util/sort_key.h>
+
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/widgets/subtree.h>
 
 namespace cw = cwidget;
+namespace sort_key = aptitude::util::sort_key;
 namespace cwidget
 {
   using namespace widgets;
 }
 
+namespace
+{
+  /** Order version IDs by their version strings. */
+  class version_id_lt
+  {
+    const std::vector<const char *> &version_strings;
+
+  public:
+    version_id_lt(const std::vector<const char *> &_version_strings)
+      : version_strings(_version_strings)
+    {
+    }
+
+    bool operator()(unsigned int id1, unsigned int id2) const
+    {
+      return _system->VS->CmpVersion(version_strings[id1],
+				     version_strings[id2]) < 0;
+    }
+  };
+}
+
+namespace
+{
+  // The version ranks of the open cache, shared by every sort.
+  // Allocated at startup, so that they exist before any thread can
+  // sort anything.
+  sort_key::shared_rank_table *shared_version_ranks = new sort_key::shared_rank_table;
+  cw::threads::mutex *version_ranks_mutex = new cw::threads::mutex;
+  bool version_ranks_connected = false;
+
+  void reset_version_ranks()
+  {
+    shared_version_ranks->reset();
+  }
+
+  /** Sort every version in the cache once; this is much cheaper than
+   *  calling CmpVersion from every comparison of a large sort.
+   */
+  boost::shared_ptr<const std::vector<unsigned int> > build_version_ranks()
+  {
+    const unsigned int count = (*apt_cache_file)->Head().VersionCount;
+    std::vector<const char *> version_strings(count, "");
+    std::vector<unsigned int> ids;
+    ids.reserve(count);
+
+    for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin();
+	!pkg.end(); ++pkg)
+      for(pkgCache::VerIterator v = pkg.VersionList(); !v.end(); ++v)
+	{
+	  version_strings[v->ID] = v.VerStr();
+	  ids.push_back(v->ID);
+	}
+
+    boost::shared_ptr<std::vector<unsigned int> >
+      rval(new std::vector<unsigned int>(count));
+    sort_key::compute_ranks(ids, version_id_lt(version_strings), *rval);
+
+    return rval;
+  }
+}
+
+unsigned int pkg_sort_key_context::get_version_rank(const pkgCache::VerIterator &ver)
+{
+  if(version_ranks.get() == NULL)
+    {
+      {
+	cw::threads::mutex::lock l(*version_ranks_mutex);
+
+	if(!version_ranks_connected)
+	  {
+	    cache_closed.connect(sigc::ptr_fun(&reset_version_ranks));
+	    version_ranks_connected = true;
+	  }
+      }
+
+      version_ranks = shared_version_ranks->get(&build_version_ranks);
+    }
+
+  return (*version_ranks)[ver->ID];
+}
+
+void pkg_sortpolicy::make_key(std::string &key,
+			      const pkgCache::PkgIterator &pkg,
+			      const pkgCache::VerIterator &ver,
+			      pkg_sort_key_context &context) const
+{
+  key.clear();
+
+  for(const pkg_sortpolicy *policy = this; policy != NULL;
+      policy = policy->chain)
+    {
+      const std::string::size_type start = key.size();
+      policy->append_key(key, pkg, ver, context);
+
+      if(policy->reversed)
+	sort_key::reverse_part(key, start);
+    }
+}
+
 // Blah, this is the easiest way to define trivial subclasses:
 // (not that far from lambda, actually)
 // Yes, I hate typing more than I have to.
-#define PKG_SORTPOLICY_SUBCLASS(name,code)	\
+//
+// "keycode" appends to "key" a part that compares the same way as
+// "code".
+#define PKG_SORTPOLICY_SUBCLASS(name,code,keycode)	\
 class name##_impl:public pkg_sortpolicy		\
 {						\
+protected:					\
+  void append_key(std::string &key,		\
+		  const pkgCache::PkgIterator &pkg, \
+		  const pkgCache::VerIterator &ver, \
+		  pkg_sort_key_context &context) const \
+  {						\
+    keycode					\
+  }						\
+						\
 public:						\
   name##_impl(pkg_sortpolicy *_chain, bool _reversed)\
   :pkg_sortpolicy(_chain, _reversed) {}		\
@@ -98,46 +214,60 @@ bool find_package_and_ver(cw::treeitem *item,
   return false;
 }
 
+const std::string *pkg_sortpolicy_wrapper::get_key(cw::treeitem *item) const
+{
+  boost::unordered_map<const cw::treeitem *, std::string>::const_iterator
+    found = keys.find(item);
+  if(found != keys.end())
+    return &found->second;
+
+  pkgCache::PkgIterator pkg;
+  pkgCache::VerIterator ver;
+  if(!find_package_and_ver(item, pkg, ver))
+    return NULL;
+
+  std::string &key = keys[item];
+  if(chain)
+    chain->make_key(key, pkg, ver, context);
+  return &key;
+}
+
 int pkg_sortpolicy_wrapper::compare(cw::treeitem *item1,
 				    cw::treeitem *item2) const
 {
-  pkgCache::PkgIterator pkg1, pkg2;
-  pkgCache::VerIterator ver1, ver2;
+  const std::string *key1 = get_key(item1);
+  const std::string *key2 = get_key(item2);
 
   // To ensure that the sort is sane, sort non-package stuff above all package stuff.
-  if(!find_package_and_ver(item1, pkg1, ver1))
+  if(key1 == NULL)
     {
-      if(!find_package_and_ver(item2, pkg2, ver2))
+      if(key2 == NULL)
 	return wcscmp(item1->tag(), item2->tag());
       else
 	return -1;
     }
-  else if(!find_package_and_ver(item2, pkg2, ver2))
+  else if(key2 == NULL)
     return 1;
-  else if(chain)
-    return chain->compare(pkg1, ver1, pkg2, ver2);
   else
-    return 0; // punt!
+    // With no chain, the keys are all empty, so this punts.
+    return key1->compare(*key2);
 }
 
 // The old by-name sorting
 PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_name,
-			return strcmp(pkg1.Name(), pkg2.Name()););
+			return strcmp(pkg1.Name(), pkg2.Name());,
+			sort_key::append_string(key, pkg.Name()););
 
 // installed-size-sorting, treats virtual packages as 0-size
 PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_installed_size,
-			if(ver1.end() && ver2.end())
-			  return 0;
-			else if(ver1.end())
-			  return 1;
-			else if(ver2.end())
-			  return -1;
-			else if(ver1->InstalledSize<ver2->InstalledSize)
-			  return -1;
-			else if(ver1->InstalledSize>ver2->InstalledSize)
-			  return 1;
-			else
-			  return 0;);
+			return sort_key::compare_optional_numbers(!ver1.end(),
+								  ver1.end() ? 0 : ver1->InstalledSize,
+								  !ver2.end(),
+								  ver2.end() ? 0 : ver2->InstalledSize,
+								  false);,
+			sort_key::append_optional_number(key, !ver.end(),
+							 ver.end() ? 0 : ver->InstalledSize,
+							 8, false););
 
 // Priority sorting
 PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_priority,
@@ -148,14 +278,20 @@ PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_priority,
 			else if(pri1==pri2)
 			  return 0;
 			else // if(pri1>pri2)
-			  return 1;);
+			  return 1;,
+			sort_key::append_number(key, ver.end() ? 0 : ver->Priority, 1););
 
 // Sort by version number
 PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_ver,
-			if(ver1.end())
+			if(ver1.end() && ver2.end())
+			  return 0;
+			else if(ver1.end())
 			  return -1;
 			else if(ver2.end())
 			  return 1;
 			else
 			  return _system->VS->CmpVersion(ver1.VerStr(),
-							 ver2.VerStr()););
+							 ver2.VerStr());,
+			sort_key::append_optional_number(key, !ver.end(),
+							 ver.end() ? 0 : context.get_version_rank(ver),
+							 4, true););
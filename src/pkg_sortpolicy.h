@@ -24,6 +24,12 @@
 #include <apt-pkg/pkgcache.h>
 #include <cwidget/widgets/treeitem.h>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <string>
+#include <vector>
+
 /** \brief Package sorting policies
  *
  * 
@@ -37,6 +43,30 @@
 
 class pkg_tree_node;
 
+/** \brief State shared by all the sort keys built for one sort.
+ *
+ *  Version numbers can't be compared bytewise, so keys that depend on
+ *  them use the rank of the version among all the versions in the
+ *  cache.  The ranks are computed the first time any sort needs them
+ *  and shared by every later sort until the cache is closed; since
+ *  they depend on the cache, a context should not outlive the sort it
+ *  was created for.
+ */
+class pkg_sort_key_context
+{
+  // The rank of each version in the cache, indexed by ID; NULL
+  // until the first call to get_version_rank().
+  boost::shared_ptr<const std::vector<unsigned int> > version_ranks;
+
+public:
+  /** \brief Return the rank of a version among all the versions in
+   *  the cache, in the order defined by the versioning system.
+   *
+   *  Versions that compare equal have the same rank.
+   */
+  unsigned int get_version_rank(const pkgCache::VerIterator &ver);
+};
+
 class pkg_sortpolicy
 {
   pkg_sortpolicy *chain;
@@ -45,6 +75,18 @@ class pkg_sortpolicy
 protected:
   const pkg_sortpolicy *get_chain() const {return chain;}
   bool get_reversed() const {return reversed;}
+
+  /** \brief Append this policy's part of a sort key (ignoring the
+   *  chain and the reversed flag) to \b key.
+   *
+   *  The part must compare bytewise the same way that this policy's
+   *  own test compares, and no part may be a proper prefix of
+   *  another.
+   */
+  virtual void append_key(std::string &key,
+			  const pkgCache::PkgIterator &pkg,
+			  const pkgCache::VerIterator &ver,
+			  pkg_sort_key_context &context) const=0;
 public:
   pkg_sortpolicy(pkg_sortpolicy *_chain, bool _reversed)
     :chain(_chain), reversed(_reversed) {}
@@ -53,6 +95,24 @@ public:
 
   virtual int compare(const pkgCache::PkgIterator &pkg1, const pkgCache::VerIterator &ver1,
 		      const pkgCache::PkgIterator &pkg2, const pkgCache::VerIterator &ver2) const=0;
+
+  /** \brief Build the sort key of a package/version pair.
+   *
+   *  Comparing two keys as byte strings gives the same order as
+   *  compare() gives for the corresponding pairs, so a large list can
+   *  be sorted by computing each key once and then comparing only the
+   *  keys.
+   *
+   *  \param[out] key  Set to the sort key.
+   *  \param pkg       The package to build a key for.
+   *  \param ver       The version to build a key for (may be an end
+   *                   iterator).
+   *  \param context   The state shared between the keys of one sort.
+   */
+  void make_key(std::string &key,
+		const pkgCache::PkgIterator &pkg,
+		const pkgCache::VerIterator &ver,
+		pkg_sort_key_context &context) const;
 };
 
 // This is an experiment..I'm using factories to avoid a massively oversized
@@ -71,12 +131,27 @@ pkg_sortpolicy *pkg_sortpolicy_priority(pkg_sortpolicy *chain, bool reversed);
 // work if it did without all sorts of evil.  You have been warned.
 //
 //  Having the operator() be virtual is a bit of an ick..
+//
+//  The sort key of each package item is computed the first time the item
+// is compared and remembered until the wrapper is destroyed, so wrappers
+// should only live as long as a single sort.
 class pkg_sortpolicy_wrapper : public cwidget::widgets::sortpolicy
 {
   pkg_sortpolicy *chain;
+
+  mutable pkg_sort_key_context context;
+  mutable boost::unordered_map<const cwidget::widgets::treeitem *, std::string> keys;
+
+  /** \brief Find or compute the sort key of a package item.
+   *
+   *  \return \b NULL if the item isn't a package or version.
+   */
+  const std::string *get_key(cwidget::widgets::treeitem *item) const;
 public:
   pkg_sortpolicy_wrapper(pkg_sortpolicy *_chain):chain(_chain) {}
 
+  pkg_sortpolicy *get_policy() const {return chain;}
+
   int compare(cwidget::widgets::treeitem *item1, cwidget::widgets::treeitem *item2) const;
   bool operator()(cwidget::widgets::treeitem *item1, cwidget::widgets::treeitem *item2)
   {
@@ -21,12 +21,20 @@
 
 #include "pkg_subtree.h"
 
+#include "pkg_item.h"
+#include "pkg_sortpolicy.h"
+
 #include <generic/apt/apt.h>
 
 #include <cwidget/generic/util/ssprintf.h>
 #include <cwidget/generic/util/transcode.h>
 #include <cwidget/widgets/tree.h>
 
+#include <algorithm>
+#include <typeinfo>
+
+#include <boost/unordered_map.hpp>
+
 #include "aptitude.h"
 
 namespace cw = cwidget;
@@ -35,6 +43,130 @@ namespace cwidget
   using namespace widgets;
 }
 
+/** Where the lazily added packages of a tree are, by package ID. */
+class pkg_subtree::package_index
+{
+public:
+  typedef std::vector<pkgCache::Package *>::size_type position;
+
+  struct location
+  {
+    pkg_subtree *subtree;
+    /** The position of the package in subtree->pending_packages. */
+    position index;
+
+    location(pkg_subtree *_subtree, position _index)
+      : subtree(_subtree), index(_index)
+    {
+    }
+
+    /** Puts later positions first, so that taking a package out of
+     *  a subtree doesn't move the ones that are still to be taken
+     *  out.
+     */
+    static bool later_position(const location &l1, const location &l2)
+    {
+      return l1.index > l2.index;
+    }
+
+    bool operator==(const location &other) const
+    {
+      return subtree == other.subtree && index == other.index;
+    }
+  };
+
+  typedef boost::unordered_multimap<unsigned long, location> pending_map;
+  typedef boost::unordered_multimap<unsigned long, pkg_subtree *> materialized_map;
+
+  /** The subtrees that hold each package whose item hasn't been
+   *  created.
+   */
+  pending_map pending;
+
+  /** The subtrees that hold the item of each package whose item has
+   *  been created.
+   */
+  materialized_map materialized;
+
+  /** How many packages were added and not taken out again; counts
+   *  a package once for each subtree it was added to.
+   */
+  int num_packages;
+
+  package_index()
+    : num_packages(0)
+  {
+  }
+
+  /** Find the entry for a package in a subtree. */
+  pending_map::iterator find(unsigned long id, pkg_subtree *subtree,
+			     position index)
+  {
+    std::pair<pending_map::iterator, pending_map::iterator>
+      range(pending.equal_range(id));
+
+    for(pending_map::iterator it = range.first; it != range.second; ++it)
+      if(it->second.subtree == subtree && it->second.index == index)
+	return it;
+
+    return pending.end();
+  }
+
+  /** Test whether the item of a package was created in \b subtree. */
+  bool is_materialized_in(unsigned long id, pkg_subtree *subtree) const
+  {
+    std::pair<materialized_map::const_iterator, materialized_map::const_iterator>
+      range(materialized.equal_range(id));
+
+    for(materialized_map::const_iterator it = range.first; it != range.second; ++it)
+      if(it->second == subtree)
+	return true;
+
+    return false;
+  }
+
+  /** Append the places where a package is pending to \b out. */
+  void get_pending(unsigned long id, std::vector<location> &out) const
+  {
+    std::pair<pending_map::const_iterator, pending_map::const_iterator>
+      range(pending.equal_range(id));
+
+    for(pending_map::const_iterator it = range.first; it != range.second; ++it)
+      out.push_back(it->second);
+  }
+
+  /** Take a package out of some of the places where it is pending,
+   *  and decrement the package counts to match.
+   */
+  void remove(unsigned long id, std::vector<location> locations)
+  {
+    // Forget the entries first, so that moving another entry of the
+    // same package into a hole updates the right one.
+    for(std::vector<location>::const_iterator it = locations.begin();
+	it != locations.end(); ++it)
+      {
+	pending_map::iterator found = find(id, it->subtree, it->index);
+	if(found != pending.end())
+	  pending.erase(found);
+      }
+
+    std::sort(locations.begin(), locations.end(), &location::later_position);
+
+    for(std::vector<location>::const_iterator it = locations.begin();
+	it != locations.end(); ++it)
+      {
+	it->subtree->remove_pending_package(it->index);
+	it->subtree->dec_num_packages();
+	--num_packages;
+      }
+  }
+};
+
+pkg_subtree::~pkg_subtree()
+{
+  delete lazy_index;
+}
+
 void pkg_subtree::paint(cw::tree *win, int y, bool hierarchical,
 			const cw::style &st)
 {
@@ -71,6 +203,11 @@ void pkg_subtree::select(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::select_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->select(undo);
 }
@@ -79,6 +216,11 @@ void pkg_subtree::hold(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::hold_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->hold(undo);
 }
@@ -87,6 +229,11 @@ void pkg_subtree::keep(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::keep_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->keep(undo);
 }
@@ -95,6 +242,11 @@ void pkg_subtree::remove(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::remove_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->remove(undo);
 }
@@ -103,6 +255,11 @@ void pkg_subtree::purge(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::purge_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->purge(undo);
 }
@@ -111,6 +268,11 @@ void pkg_subtree::reinstall(undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  if(apply_to_leaves(&pkg_item::reinstall_package, undo))
+    return;
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->reinstall(undo);
 }
@@ -119,10 +281,400 @@ void pkg_subtree::set_auto(bool isauto, undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
+  std::vector<pkgCache::Package *> packages;
+  if(collect_leaf_packages(packages))
+    {
+      pkgCache &cache = (*apt_cache_file)->GetCache();
+      for(std::vector<pkgCache::Package *>::const_iterator it = packages.begin();
+	  it != packages.end(); ++it)
+	pkg_item::set_package_auto(pkgCache::PkgIterator(cache, *it), isauto, undo);
+
+      return;
+    }
+
+  materialize();
+
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
     (*i)->set_auto(isauto, undo);
 }
 
+bool pkg_subtree::collect_leaf_packages(std::vector<pkgCache::Package *> &out)
+{
+  // The bulk actions of a plain pkg_item apply the same action to
+  // its package; anything else (versions, dependencies, or a
+  // subclass) has to be asked.
+  for(child_iterator i = get_children_begin(); i != get_children_end(); ++i)
+    {
+      if(typeid(**i) == typeid(pkg_item))
+	out.push_back(static_cast<pkg_item *>(*i)->get_package());
+      else
+	{
+	  pkg_subtree *subtree = dynamic_cast<pkg_subtree *>(*i);
+	  if(subtree == NULL || !subtree->collect_leaf_packages(out))
+	    return false;
+	}
+    }
+
+  out.insert(out.end(), pending_packages.begin(), pending_packages.end());
+  return true;
+}
+
+bool pkg_subtree::apply_to_leaves(leaf_action action, undo_group *undo)
+{
+  std::vector<pkgCache::Package *> packages;
+  if(!collect_leaf_packages(packages))
+    return false;
+
+  pkgCache &cache = (*apt_cache_file)->GetCache();
+  for(std::vector<pkgCache::Package *>::const_iterator it = packages.begin();
+      it != packages.end(); ++it)
+    action(pkgCache::PkgIterator(cache, *it), undo);
+
+  return true;
+}
+
+pkg_subtree::package_index *pkg_subtree::find_lazy_index()
+{
+  pkg_subtree *tree = this;
+  while(tree->num_packages_parent != NULL)
+    tree = tree->num_packages_parent;
+
+  return tree->lazy_index;
+}
+
+void pkg_subtree::track_lazy_packages()
+{
+  if(lazy_index == NULL)
+    lazy_index = new package_index;
+}
+
+bool pkg_subtree::all_packages_indexed()
+{
+  return lazy_index != NULL &&
+    num_packages_known &&
+    num_packages == lazy_index->num_packages &&
+    all_packages_indexed(lazy_index);
+}
+
+bool pkg_subtree::all_packages_indexed(package_index *index)
+{
+  for(child_iterator i = get_children_begin(); i != get_children_end(); ++i)
+    {
+      pkg_subtree *subtree = dynamic_cast<pkg_subtree *>(*i);
+      if(subtree != NULL)
+	{
+	  if(subtree->find_lazy_index() != index ||
+	     !subtree->all_packages_indexed(index))
+	    return false;
+	}
+      else
+	{
+	  // Items created by materialize() are recorded; anything
+	  // else was added directly by a grouping policy.
+	  pkg_item *item = dynamic_cast<pkg_item *>(*i);
+	  if(item == NULL || !index->is_materialized_in(item->get_package()->ID, this))
+	    return false;
+	}
+    }
+
+  return true;
+}
+
+void pkg_subtree::remove_pending_package(std::vector<pkgCache::Package *>::size_type index)
+{
+  // Order doesn't matter here, since materialize() sorts the items
+  // it creates; move the last package into the hole.
+  const std::vector<pkgCache::Package *>::size_type last =
+    pending_packages.size() - 1;
+
+  if(index != last)
+    {
+      pkgCache::Package * const moved = pending_packages[last];
+      pending_packages[index] = moved;
+
+      package_index *lazy = find_lazy_index();
+      if(lazy != NULL)
+	{
+	  package_index::pending_map::iterator found =
+	    lazy->find(moved->ID, this, last);
+	  if(found != lazy->pending.end())
+	    found->second.index = index;
+	}
+    }
+
+  pending_packages.pop_back();
+}
+
+pkg_subtree::regroup_result
+pkg_subtree::regroup_package(const pkgCache::PkgIterator &pkg,
+			     const sigc::slot0<void> &add)
+{
+  if(lazy_index == NULL)
+    return regroup_failed;
+
+  const unsigned long id = pkg->ID;
+
+  std::vector<package_index::location> old_pending;
+  lazy_index->get_pending(id, old_pending);
+
+  // The subtrees that hold the package now, with or without an item.
+  std::vector<pkg_subtree *> old_subtrees;
+  for(std::vector<package_index::location>::const_iterator it = old_pending.begin();
+      it != old_pending.end(); ++it)
+    old_subtrees.push_back(it->subtree);
+
+  std::pair<package_index::materialized_map::const_iterator,
+	    package_index::materialized_map::const_iterator>
+    materialized_range(lazy_index->materialized.equal_range(id));
+  const bool any_materialized =
+    materialized_range.first != materialized_range.second;
+  for(package_index::materialized_map::const_iterator it = materialized_range.first;
+      it != materialized_range.second; ++it)
+    old_subtrees.push_back(it->second);
+
+  const int old_num_packages = num_packages;
+  const int old_num_indexed = lazy_index->num_packages;
+
+  add();
+
+  // Adding only appends to the pending lists, so the old entries are
+  // where they were.
+  std::vector<package_index::location> all_pending, new_pending;
+  lazy_index->get_pending(id, all_pending);
+  for(std::vector<package_index::location>::const_iterator it = all_pending.begin();
+      it != all_pending.end(); ++it)
+    if(std::find(old_pending.begin(), old_pending.end(), *it) == old_pending.end())
+      new_pending.push_back(*it);
+
+  std::vector<pkg_subtree *> new_subtrees;
+  for(std::vector<package_index::location>::const_iterator it = new_pending.begin();
+      it != new_pending.end(); ++it)
+    new_subtrees.push_back(it->subtree);
+
+  std::sort(old_subtrees.begin(), old_subtrees.end());
+  std::sort(new_subtrees.begin(), new_subtrees.end());
+
+  // If the counts went up by more than the index did, the policy
+  // added something that can't be found again.
+  if(num_packages - old_num_packages != lazy_index->num_packages - old_num_indexed)
+    {
+      lazy_index->remove(id, new_pending);
+      return regroup_failed;
+    }
+
+  if(new_subtrees == old_subtrees)
+    {
+      lazy_index->remove(id, new_pending);
+      return regroup_unchanged;
+    }
+
+  // Items can't be taken out of a subtree.
+  if(any_materialized)
+    {
+      lazy_index->remove(id, new_pending);
+      return regroup_failed;
+    }
+
+  lazy_index->remove(id, old_pending);
+
+  for(std::vector<package_index::location>::const_iterator it = new_pending.begin();
+      it != new_pending.end(); ++it)
+    if(it->subtree->sort_policy == NULL)
+      return regroup_moved_to_new_subtree;
+
+  return regroup_moved;
+}
+
+void pkg_subtree::save_view(cw::treeitem *selected, view_state &state)
+{
+  std::vector<std::wstring> path;
+  save_view(selected, path, state);
+}
+
+void pkg_subtree::save_view(cw::treeitem *selected,
+			    std::vector<std::wstring> &path,
+			    view_state &state)
+{
+  // Only looks at the children that exist: a package that is still
+  // pending can't be selected, and its subtree can't be expanded.
+  for(child_iterator i = get_children_begin(); i != get_children_end(); ++i)
+    {
+      path.push_back((*i)->label());
+
+      if(*i == selected)
+	state.selected = path;
+
+      pkg_subtree *subtree = dynamic_cast<pkg_subtree *>(*i);
+      if(subtree != NULL)
+	{
+	  if(subtree->get_expanded())
+	    state.expanded.insert(path);
+
+	  subtree->save_view(selected, path, state);
+	}
+
+      path.pop_back();
+    }
+}
+
+pkg_tree_node *pkg_subtree::restore_view(const view_state &state)
+{
+  std::vector<std::wstring> path;
+  materialize();
+  return restore_view(state, path);
+}
+
+pkg_tree_node *pkg_subtree::restore_view(const view_state &state,
+					 std::vector<std::wstring> &path)
+{
+  pkg_tree_node *rval = NULL;
+
+  for(child_iterator i = get_children_begin(); i != get_children_end(); ++i)
+    {
+      path.push_back((*i)->label());
+
+      if(path == state.selected)
+	rval = *i;
+
+      pkg_subtree *subtree = dynamic_cast<pkg_subtree *>(*i);
+      if(subtree != NULL)
+	{
+	  // Expanded subtrees would create their items as soon as
+	  // they are drawn anyway; creating them here lets the
+	  // selection be found.
+	  if(state.expanded.find(path) != state.expanded.end())
+	    {
+	      subtree->expand();
+	      subtree->materialize();
+	    }
+
+	  pkg_tree_node *found = subtree->restore_view(state, path);
+	  if(found != NULL)
+	    rval = found;
+	}
+
+      path.pop_back();
+    }
+
+  return rval;
+}
+
+void pkg_subtree::add_package_lazily(const pkgCache::PkgIterator &pkg,
+				     sigc::signal2<void,
+				     const pkgCache::PkgIterator &,
+				     const pkgCache::VerIterator &> *sig)
+{
+  package_index *lazy = find_lazy_index();
+  if(lazy != NULL)
+    {
+      lazy->pending.insert(std::make_pair(static_cast<unsigned long>(pkg->ID),
+					  package_index::location(this, pending_packages.size())));
+      ++lazy->num_packages;
+    }
+
+  pending_packages.push_back(pkg);
+  pending_sig = sig;
+}
+
+void pkg_subtree::materialize()
+{
+  if(pending_packages.empty())
+    return;
+
+  std::vector<pkgCache::Package *> packages;
+  packages.swap(pending_packages);
+
+  package_index *lazy = find_lazy_index();
+
+  pkgCache &cache = (*apt_cache_file)->GetCache();
+  for(std::vector<pkgCache::Package *>::size_type i = 0;
+      i < packages.size(); ++i)
+    {
+      pkgCache::Package * const pkg = packages[i];
+
+      if(lazy != NULL)
+	{
+	  package_index::pending_map::iterator found =
+	    lazy->find(pkg->ID, this, i);
+	  if(found != lazy->pending.end())
+	    lazy->pending.erase(found);
+	  lazy->materialized.insert(std::make_pair(static_cast<unsigned long>(pkg->ID),
+						   this));
+	}
+
+      add_child(new pkg_item(pkgCache::PkgIterator(cache, pkg), pending_sig));
+    }
+
+  if(sort_policy != NULL)
+    {
+      pkg_sortpolicy_wrapper sorter(sort_policy);
+      cw::subtree<pkg_tree_node>::sort(sorter);
+    }
+}
+
+cw::subtree<pkg_tree_node>::levelref *pkg_subtree::begin()
+{
+  materialize();
+  return cw::subtree<pkg_tree_node>::begin();
+}
+
+cw::subtree<pkg_tree_node>::levelref *pkg_subtree::end()
+{
+  materialize();
+  return cw::subtree<pkg_tree_node>::end();
+}
+
+bool pkg_subtree::has_visible_children()
+{
+  // Collapsed subtrees stay unmaterialized.
+  if(get_expanded())
+    materialize();
+
+  return cw::subtree<pkg_tree_node>::has_visible_children();
+}
+
+bool pkg_subtree::has_children()
+{
+  return !pending_packages.empty() ||
+    cw::subtree<pkg_tree_node>::has_children();
+}
+
+void pkg_subtree::expand_all()
+{
+  materialize();
+  cw::subtree<pkg_tree_node>::expand_all();
+}
+
+void pkg_subtree::sort(cw::sortpolicy &sort_method)
+{
+  if(!pending_packages.empty())
+    {
+      pkg_sortpolicy_wrapper *wrapper =
+	dynamic_cast<pkg_sortpolicy_wrapper *>(&sort_method);
+
+      if(wrapper != NULL)
+	{
+	  sort_policy = wrapper->get_policy();
+	  return;
+	}
+
+      materialize();
+    }
+
+  pkg_sortpolicy_wrapper *wrapper =
+    dynamic_cast<pkg_sortpolicy_wrapper *>(&sort_method);
+  sort_policy = wrapper != NULL ? wrapper->get_policy() : NULL;
+
+  cw::subtree<pkg_tree_node>::sort(sort_method);
+}
+
+void pkg_subtree::sort()
+{
+  materialize();
+  sort_policy = NULL;
+  cw::subtree<pkg_tree_node>::sort();
+}
+
 void pkg_subtree::inc_num_packages()
 {
   if(num_packages_known)
@@ -133,6 +685,16 @@ void pkg_subtree::inc_num_packages()
     }
 }
 
+void pkg_subtree::dec_num_packages()
+{
+  if(num_packages_known)
+    {
+      --num_packages;
+      if(num_packages_parent != NULL)
+	num_packages_parent->dec_num_packages();
+    }
+}
+
 void pkg_subtree::clear_num_packages()
 {
   num_packages_known = false;
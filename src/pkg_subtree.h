@@ -23,8 +23,18 @@
 
 #include <cwidget/widgets/subtree.h>
 
+#include <apt-pkg/pkgcache.h>
+
+#include <sigc++/slot.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
 #include "pkg_node.h"
 
+class pkg_sortpolicy;
+
 /** \brief A subtree which contains packages (and other subtrees)
  * 
  *  \file pkg_subtree.h
@@ -42,9 +52,67 @@ class pkg_subtree:public cwidget::widgets::subtree<pkg_tree_node>,
   bool num_packages_known;
   int num_packages;
 
+  // Packages added by add_package_lazily() whose items haven't been
+  // created yet, and the signal to give those items.
+  std::vector<pkgCache::Package *> pending_packages;
+  sigc::signal2<void,
+		const pkgCache::PkgIterator &,
+		const pkgCache::VerIterator &> *pending_sig;
+
+  class package_index;
+
+  // Set on the root of a tree by track_lazy_packages(); NULL in
+  // every other subtree.
+  package_index *lazy_index;
+
+  // The policy that this subtree was last sorted by, if it was sorted
+  // through a pkg_sortpolicy_wrapper; items created by materialize()
+  // are sorted into place with it.
+  pkg_sortpolicy *sort_policy;
+
   void do_highlighted_changed(bool highlighted);
+
+  /** Find the index kept by the root of the num_packages_parent
+   *  chain, or NULL if it doesn't keep one.
+   */
+  package_index *find_lazy_index();
+
+  /** Take the package at the given position out of
+   *  pending_packages, without changing any counts.
+   */
+  void remove_pending_package(std::vector<pkgCache::Package *>::size_type index);
+
+  /** Test whether every package below this subtree was added with
+   *  add_package_lazily() to a subtree that records it in \b index.
+   */
+  bool all_packages_indexed(package_index *index);
+
+  typedef void (*leaf_action)(const pkgCache::PkgIterator &, undo_group *);
+
+  /** Apply an action to every package in this subtree, without
+   *  creating any items.
+   *
+   *  \return \b false (and do nothing) if collect_leaf_packages()
+   *  fails.
+   */
+  bool apply_to_leaves(leaf_action action, undo_group *undo);
 protected:
   void set_label(const std::wstring &_name) {name=_name;}
+
+  /** \brief Append every package in this subtree to \b out, without
+   *  creating any items, so that a bulk action can be applied to
+   *  them directly.
+   *
+   *  This walks the subtrees and the items that have been created,
+   *  but not the packages that are still pending.
+   *
+   *  \return \b false if a bulk action on this subtree might do
+   *  something other than apply the same action to each package:
+   *  that is, if it holds anything but plain pkg_items, lazily
+   *  added packages and subtrees that return \b true themselves.
+   *  Subclasses whose bulk actions differ must return \b false.
+   */
+  virtual bool collect_leaf_packages(std::vector<pkgCache::Package *> &out);
 public:
   pkg_subtree(std::wstring _name, std::wstring _description=L"",
 	      sigc::signal1<void, std::wstring> *_info_signal=NULL,
@@ -52,7 +120,10 @@ public:
     cwidget::widgets::subtree<pkg_tree_node>(_expanded), name(_name),
     description(_description), info_signal(_info_signal),
     num_packages_parent(NULL),
-    num_packages_known(true), num_packages(0)
+    num_packages_known(true), num_packages(0),
+    pending_sig(NULL),
+    lazy_index(NULL),
+    sort_policy(NULL)
   {
     highlighted_changed.connect(sigc::mem_fun(this, &pkg_subtree::do_highlighted_changed));
   }
@@ -61,11 +132,16 @@ public:
     cwidget::widgets::subtree<pkg_tree_node>(_expanded), name(_name),
     description(L""), info_signal(NULL),
     num_packages_parent(NULL),
-    num_packages_known(true), num_packages(0)
+    num_packages_known(true), num_packages(0),
+    pending_sig(NULL),
+    lazy_index(NULL),
+    sort_policy(NULL)
   {
     highlighted_changed.connect(sigc::mem_fun(this, &pkg_subtree::do_highlighted_changed));
   }
 
+  ~pkg_subtree();
+
   virtual void paint(cwidget::widgets::tree *win, int y, bool hierarchical,
 		     const cwidget::style &st);
   virtual const wchar_t *tag();
@@ -79,6 +155,142 @@ public:
   virtual void reinstall(undo_group *undo);
   virtual void set_auto(bool isauto, undo_group *undo);
 
+  /** \brief Add a package to this subtree without creating its item.
+   *
+   *  Only the package is remembered; its pkg_item is created, and the
+   *  children of this subtree are sorted, the first time that the
+   *  children are displayed or acted upon.  This keeps building a
+   *  tree of every package cheap, since most subtrees are never
+   *  expanded.
+   *
+   *  \param pkg  The package to add.
+   *  \param sig  The signal to pass to the new pkg_item; every
+   *              package added to one subtree must use the same
+   *              signal.
+   */
+  void add_package_lazily(const pkgCache::PkgIterator &pkg,
+			  sigc::signal2<void,
+			  const pkgCache::PkgIterator &,
+			  const pkgCache::VerIterator &> *sig);
+
+  /** \brief Create the items of any packages that were added with
+   *  add_package_lazily(), and perform any sort that was deferred
+   *  until then.
+   */
+  void materialize();
+
+  /** \brief Start recording, by package ID, which subtrees the
+   *  packages of this tree are added to.
+   *
+   *  Invoke this on the root of a tree before any packages are
+   *  added.  Packages added with add_package_lazily() to subtrees
+   *  whose num_packages_parent chain leads to the root are recorded.
+   */
+  void track_lazy_packages();
+
+  /** \brief Test whether the root of a tree found every package in
+   *  it with track_lazy_packages().
+   *
+   *  This walks the subtrees of the tree, but not the packages in
+   *  them; invoke it once the tree is built.  Packages that grouping
+   *  policies add as items or as versions aren't recorded.
+   */
+  bool all_packages_indexed();
+
+  /** \brief What regroup_package() did. */
+  enum regroup_result
+    {
+      /** The package is in the same subtrees as before; the tree
+       *  wasn't changed.
+       */
+      regroup_unchanged,
+      /** The package was moved to other subtrees. */
+      regroup_moved,
+      /** The package was moved, and one of the subtrees it was moved
+       *  to has never been sorted: the policy just created it.
+       */
+      regroup_moved_to_new_subtree,
+      /** The package couldn't be moved: its item was created in one
+       *  of the subtrees it was in, or the grouping policy added it
+       *  in some way that isn't indexed.  The tree has to be rebuilt.
+       */
+      regroup_failed
+    };
+
+  /** \brief Move a package to the subtrees that a grouping policy
+   *  now places it in.
+   *
+   *  \b add is invoked to add the package to this tree again, and
+   *  the subtrees that it lands in are compared with the ones it was
+   *  in before.  If they are the same, or if the package can't be
+   *  moved, the new copies are taken out again; otherwise the old
+   *  copies are taken out and the package counts are updated.
+   *
+   *  Only valid on a root that tracks its packages; the cost depends
+   *  on the number of places that the package was added to, not on
+   *  the size of the tree.
+   *
+   *  \param pkg  The package to move.
+   *  \param add  Adds \b pkg to this tree; it should do nothing if
+   *              the package no longer belongs in the tree.
+   */
+  regroup_result regroup_package(const pkgCache::PkgIterator &pkg,
+				 const sigc::slot0<void> &add);
+
+  /** \brief The subtrees of a tree that are expanded and the item
+   *  that is selected, by the labels of the subtrees that lead to
+   *  them.
+   */
+  struct view_state
+  {
+    std::set<std::vector<std::wstring> > expanded;
+    std::vector<std::wstring> selected;
+  };
+
+  /** \brief Record which subtrees of this tree are expanded and
+   *  where \b selected is, so that a new tree of the same packages
+   *  can be shown the same way.
+   */
+  void save_view(cwidget::widgets::treeitem *selected, view_state &state);
+
+  /** \brief Expand the subtrees of this tree that were expanded in
+   *  the tree that \b state was saved from.
+   *
+   *  \return the item in the place of the one that was selected, or
+   *  NULL if there isn't one.
+   */
+  pkg_tree_node *restore_view(const view_state &state);
+
+private:
+  // The recursive parts of save_view() and restore_view(); path
+  // holds the labels of the subtrees from the root to this one.
+  void save_view(cwidget::widgets::treeitem *selected,
+		 std::vector<std::wstring> &path,
+		 view_state &state);
+  pkg_tree_node *restore_view(const view_state &state,
+			      std::vector<std::wstring> &path);
+
+public:
+
+  // Overridden so that lazily added packages appear when the tree
+  // first looks at the children of this subtree.
+  cwidget::widgets::subtree<pkg_tree_node>::levelref *begin();
+  cwidget::widgets::subtree<pkg_tree_node>::levelref *end();
+  bool has_visible_children();
+  bool has_children();
+  void expand_all();
+
+  /** \brief Sort this subtree.
+   *
+   *  If this subtree has lazily added packages and the policy is a
+   *  pkg_sortpolicy_wrapper, the sort is deferred until the packages
+   *  are materialized.  Packages that are added lazily after the
+   *  subtree was sorted are sorted into place when they are
+   *  materialized.
+   */
+  void sort(cwidget::widgets::sortpolicy &sort_method);
+  void sort();
+
   /** \brief Set the parent of this tree for the purposes of package counting.
    *
    *  When inc_num_packages() is called on this tree, it's also called
@@ -95,6 +307,12 @@ public:
    *  Has no effect if num_packages_known is false.
    */
   void inc_num_packages();
+  /** \brief Decrement the number of packages in this tree and in
+   *  the parent (if any).
+   *
+   *  Has no effect if num_packages_known is false.
+   */
+  void dec_num_packages();
   /** \brief Discard all information about how many packages
    *  this subtree contains.
    */
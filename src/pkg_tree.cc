@@ -24,15 +24,18 @@
 #include "aptitude.h"
 #include "load_grouppolicy.h"
 #include "load_sortpolicy.h"
+#include "loggers.h"
 #include "pkg_columnizer.h"
 #include "pkg_grouppolicy.h"
 #include "pkg_node.h"
 #include "pkg_sortpolicy.h"
 #include "pkg_subtree.h"
+#include "safe_slot_event.h"
 #include "ui.h"
 #include "progress.h"
 
 #include <cwidget/columnify.h>
+#include <cwidget/generic/threads/threads.h>
 #include <cwidget/generic/util/transcode.h>
 #include <cwidget/toplevel.h>
 #include <cwidget/widgets/treeitem.h>
@@ -42,13 +45,27 @@
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/util/job_queue_thread.h>
+#include <generic/util/safe_slot.h>
 
 #include <apt-pkg/progress.h>
 #include <apt-pkg/configuration.h>
 #include <apt-pkg/algorithms.h>
 
+#include <sigc++/adaptors/bind.h>
 #include <sigc++/adaptors/retype_return.h>
 #include <sigc++/functors/mem_fun.h>
+#include <sigc++/functors/ptr_fun.h>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <sys/time.h>
+#include <unistd.h>
 
 namespace cw = cwidget;
 namespace cwidget
@@ -69,6 +86,440 @@ void pkg_tree::init_bindings()
   bindings=new cw::config::keybindings(cw::tree::bindings);
 }
 
+namespace
+{
+  typedef boost::shared_ptr<std::vector<pkgCache::PkgIterator> > package_batch;
+
+  // Bumped when the cache is closed, so that searches of the old
+  // cache give up as soon as they can.
+  volatile int search_generation = 0;
+
+  /** \brief Thrown from the progress callback of matching::search()
+   *  to abandon a search.
+   *
+   *  This deliberately isn't a std::exception, so that search()
+   *  doesn't swallow it.
+   */
+  class search_canceled
+  {
+  };
+
+  // Guard the turns of the background search; allocated at startup
+  // so that they exist before the search thread does.
+  cw::threads::mutex *search_turn_mutex = new cw::threads::mutex;
+  cw::threads::condition *search_turn_cond = new cw::threads::condition;
+
+  // How long the background search may hold the cache before it lets
+  // the UI thread run again, in microseconds.
+  const long search_turn_usec = 20000;
+
+  /** \brief The state of one turn of the background search; guarded
+   *  by search_turn_mutex.
+   *
+   *  The depcache and the package records aren't thread-safe, so the
+   *  search thread only reads them while the UI thread is parked in
+   *  a search_turn_event.
+   */
+  struct search_turn
+  {
+    /** Set by the UI thread when it has stopped to wait for the turn. */
+    bool granted;
+    /** Set by the search thread when the UI thread may go on. */
+    bool finished;
+    /** Set by the search thread if it gave up before the turn was
+     *  granted.
+     */
+    bool abandoned;
+
+    search_turn()
+      : granted(false), finished(false), abandoned(false)
+    {
+    }
+  };
+
+  /** \brief Posted by the search thread to get the UI thread to
+   *  wait while the search reads the cache.
+   */
+  class search_turn_event : public cw::toplevel::event
+  {
+    boost::shared_ptr<search_turn> turn;
+
+  public:
+    search_turn_event(const boost::shared_ptr<search_turn> &_turn)
+      : turn(_turn)
+    {
+    }
+
+    void dispatch()
+    {
+      cw::threads::mutex::lock l(*search_turn_mutex);
+
+      if(turn->abandoned)
+	return;
+
+      turn->granted = true;
+      search_turn_cond->wake_all();
+
+      while(!turn->finished)
+	search_turn_cond->wait(l);
+    }
+  };
+
+  /** \brief Wake the search thread if it is waiting for a turn, so
+   *  that it notices that its job was canceled.
+   */
+  void wake_search_thread()
+  {
+    cw::threads::mutex::lock l(*search_turn_mutex);
+    search_turn_cond->wake_all();
+  }
+
+  /** \brief A request to find the packages matching a tree limit. */
+  class limit_search_job
+  {
+    ref_ptr<matching::pattern> limit;
+    std::wstring limitstr;
+    safe_slot1<void, package_batch> batch_ready;
+    safe_slot1<void, aptitude::util::progress_info> progress;
+    safe_slot0<void> finished;
+    const int generation;
+    volatile int canceled;
+
+    // The last percentage that was posted; only used by the
+    // background thread.
+    int last_percent;
+
+    // The turn that the background thread holds, if any, and when it
+    // was granted; only used by the background thread.
+    boost::shared_ptr<search_turn> turn;
+    struct timeval turn_start;
+
+  public:
+    /** \param _limit  the pattern to search for; it must not be
+     *                 shared with the UI thread, since patterns
+     *                 aren't reference-counted in a thread-safe way.
+     */
+    limit_search_job(const ref_ptr<matching::pattern> &_limit,
+		     const std::wstring &_limitstr,
+		     const safe_slot1<void, package_batch> &_batch_ready,
+		     const safe_slot1<void, aptitude::util::progress_info> &_progress,
+		     const safe_slot0<void> &_finished)
+      : limit(_limit), limitstr(_limitstr),
+	batch_ready(_batch_ready), progress(_progress), finished(_finished),
+	generation(search_generation), canceled(0), last_percent(-1)
+    {
+    }
+
+    ~limit_search_job()
+    {
+      end_turn();
+    }
+
+    const ref_ptr<matching::pattern> &get_limit() const { return limit; }
+    const std::wstring &get_limitstr() const { return limitstr; }
+    const safe_slot1<void, package_batch> &get_batch_ready() const { return batch_ready; }
+    const safe_slot1<void, aptitude::util::progress_info> &get_progress() const { return progress; }
+    const safe_slot0<void> &get_finished() const { return finished; }
+
+    /** \brief Return \b true if the job was canceled or the cache
+     *  it was searching has been closed.  Safe to call from any
+     *  thread.
+     */
+    bool is_canceled() const
+    {
+      __sync_synchronize();
+      return canceled != 0 || generation != search_generation;
+    }
+
+    /** \brief Ask the background thread to give up on this job. */
+    void cancel()
+    {
+      __sync_lock_test_and_set(&canceled, 1);
+      wake_search_thread();
+    }
+
+    /** \brief Wait until the UI thread stops to let the background
+     *  thread read the cache.
+     *
+     *  \return \b false if the job was canceled first.
+     */
+    bool begin_turn()
+    {
+      boost::shared_ptr<search_turn> new_turn(boost::make_shared<search_turn>());
+      cw::toplevel::post_event(new search_turn_event(new_turn));
+
+      cw::threads::mutex::lock l(*search_turn_mutex);
+      while(!new_turn->granted && !is_canceled())
+	search_turn_cond->wait(l);
+
+      if(!new_turn->granted)
+	{
+	  new_turn->abandoned = true;
+	  return false;
+	}
+
+      turn = new_turn;
+      gettimeofday(&turn_start, 0);
+      return true;
+    }
+
+    /** \brief Let the UI thread go on, if the background thread has
+     *  a turn.
+     */
+    void end_turn()
+    {
+      if(turn.get() == NULL)
+	return;
+
+      cw::threads::mutex::lock l(*search_turn_mutex);
+      turn->finished = true;
+      search_turn_cond->wake_all();
+      turn.reset();
+    }
+
+    /** \brief If the current turn has gone on long enough, let the
+     *  UI thread run and wait for another one.
+     *
+     *  \return \b false if the job was canceled in the meantime.
+     */
+    bool yield_turn()
+    {
+      struct timeval now;
+      gettimeofday(&now, 0);
+
+      const long elapsed =
+	(now.tv_sec - turn_start.tv_sec) * 1000000L +
+	(now.tv_usec - turn_start.tv_usec);
+      if(elapsed < search_turn_usec)
+	return true;
+
+      end_turn();
+      return begin_turn();
+    }
+
+    /** \brief Return \b true if \b info should be shown; used to
+     *  avoid flooding the UI thread with progress updates.
+     */
+    bool progress_changed(const aptitude::util::progress_info &info)
+    {
+      const int percent = info.get_progress_percent_int();
+      if(percent == last_percent)
+	return false;
+
+      last_percent = percent;
+      return true;
+    }
+  };
+
+  std::ostream &operator<<(std::ostream &out, const boost::shared_ptr<limit_search_job> &job);
+
+  std::ostream &operator<<(std::ostream &out, const boost::shared_ptr<limit_search_job> &job)
+  {
+    return out << "(limit=" << cw::util::transcode(job->get_limitstr()) << ")";
+  }
+
+  void post_to_ui(const safe_slot0<void> &slot)
+  {
+    cw::toplevel::post_event(new aptitude::safe_slot_event(slot));
+  }
+
+  void check_search_progress(aptitude::util::progress_info info,
+			     limit_search_job *job)
+  {
+    if(job->is_canceled() || !job->yield_turn())
+      throw search_canceled();
+
+    if(job->progress_changed(info))
+      post_to_ui(safe_bind(job->get_progress(), info));
+  }
+
+  /** \brief Evaluates tree limits in the background, one at a time.
+   *
+   *  Matches are posted to the UI thread in batches, and the UI
+   *  thread builds the new tree from them.
+   *
+   *  This is a self-terminating singleton thread.
+   */
+  class limit_search_thread : public aptitude::util::job_queue_thread<limit_search_thread,
+								      boost::shared_ptr<limit_search_job> >
+  {
+    // Set to true when the global signal handlers are connected up.
+    static bool signals_connected;
+
+    static void handle_cache_closed()
+    {
+      // Make the running search give up, so that stop() doesn't
+      // wait for it to finish.
+      __sync_add_and_fetch(&search_generation, 1);
+      wake_search_thread();
+      stop();
+    }
+
+  public:
+    // Tell the job_queue_thread what our log category is.
+    static logging::LoggerPtr get_log_category()
+    {
+      return aptitude::Loggers::getAptitudePkgTree();
+    }
+
+    limit_search_thread()
+    {
+      if(!signals_connected)
+	{
+	  cache_closed.connect(sigc::ptr_fun(&limit_search_thread::handle_cache_closed));
+	  cache_reloaded.connect(sigc::ptr_fun(&limit_search_thread::start));
+	  signals_connected = true;
+	}
+    }
+
+    void process_job(const boost::shared_ptr<limit_search_job> &job)
+    {
+      if(job->is_canceled())
+	{
+	  LOG_TRACE(get_log_category(), "Skipping the canceled search " << job);
+	  return;
+	}
+
+      ref_ptr<matching::search_cache> search_info(matching::search_cache::create());
+      std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<matching::structural_match> > > matches;
+
+      // The search only reads the cache while the UI thread is
+      // waiting for it, and lets the UI thread run every so often.
+      if(!job->begin_turn())
+	{
+	  LOG_TRACE(get_log_category(), "Canceled the search " << job);
+	  return;
+	}
+
+      try
+	{
+	  matching::search(job->get_limit(), search_info,
+			   matches,
+			   *apt_cache_file,
+			   *apt_package_records,
+			   false,
+			   sigc::bind(sigc::ptr_fun(&check_search_progress),
+				      job.get()));
+	}
+      catch(search_canceled &)
+	{
+	  job->end_turn();
+	  LOG_TRACE(get_log_category(), "Canceled the search " << job);
+	  return;
+	}
+      catch(...)
+	{
+	  job->end_turn();
+	  throw;
+	}
+
+      job->end_turn();
+
+      LOG_TRACE(get_log_category(), "Found " << matches.size() << " matches for " << job);
+
+      // Small batches at first so that the tree starts filling in
+      // quickly, then larger ones to keep the number of events down.
+      std::vector<pkgCache::PkgIterator>::size_type batch_size = 256;
+      const std::vector<pkgCache::PkgIterator>::size_type max_batch_size = 8192;
+
+      package_batch batch;
+      for(std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<matching::structural_match> > >::const_iterator
+	    it = matches.begin(); it != matches.end(); ++it)
+	{
+	  if(batch.get() == NULL)
+	    {
+	      if(job->is_canceled())
+		return;
+
+	      batch = boost::make_shared<std::vector<pkgCache::PkgIterator> >();
+	      batch->reserve(batch_size);
+	    }
+
+	  batch->push_back(it->first);
+
+	  if(batch->size() >= batch_size)
+	    {
+	      post_to_ui(safe_bind(job->get_batch_ready(), batch));
+	      batch.reset();
+
+	      if(batch_size < max_batch_size)
+		batch_size *= 2;
+	    }
+	}
+
+      if(batch.get() != NULL)
+	post_to_ui(safe_bind(job->get_batch_ready(), batch));
+
+      post_to_ui(job->get_finished());
+    }
+  };
+  bool limit_search_thread::signals_connected = false;
+
+  /** The trees whose background searches are running, by search ID.
+   *  The slots of a search job only carry its ID, so that nothing
+   *  they refer to can be freed on the search thread; this is only
+   *  used by the UI thread.
+   */
+  std::map<int, pkg_tree *> running_limit_searches;
+
+  // The ID of the next search; only used by the UI thread.
+  int next_limit_search_id = 0;
+}
+
+/** \brief The UI-thread side of a background limit search. */
+class pkg_tree::limit_search
+{
+public:
+  /** Identifies this search to the slots of the job. */
+  const int id;
+
+  ref_ptr<matching::pattern> limit;
+  std::wstring limitstr;
+
+  /** The job that is searching for the limit. */
+  boost::shared_ptr<limit_search_job> job;
+
+  /** The tree that the matches are added to, and the policy that
+   *  adds them; owned by this object until they are displayed.
+   */
+  pkg_subtree *root;
+  pkg_grouppolicy *grouper;
+
+  progress_ref progress;
+
+  /** \b true if the search found any package, even one that isn't
+   *  displayed.
+   */
+  bool any_matches;
+
+  /** \b true if any package was added to root. */
+  bool any_packages;
+
+  /** The packages whose states changed while the search was
+   *  running; they might have been grouped by their old states, so
+   *  they are regrouped when the search finishes.
+   */
+  std::set<pkgCache::PkgIterator> changed_packages;
+
+  limit_search(int _id,
+	       const ref_ptr<matching::pattern> &_limit,
+	       const std::wstring &_limitstr)
+    : id(_id), limit(_limit), limitstr(_limitstr),
+      root(NULL), grouper(NULL),
+      any_matches(false), any_packages(false)
+  {
+  }
+
+  ~limit_search()
+  {
+    delete grouper;
+    delete root;
+
+    if(progress.valid())
+      progress->destroy();
+  }
+};
+
 pkg_tree::pkg_tree(const std::string &def_grouping,
 		   pkg_grouppolicy_factory *_grouping,
 		   const std::wstring &def_limit)
@@ -77,7 +528,11 @@ pkg_tree::pkg_tree(const std::string &def_grouping,
    sorting(parse_sortpolicy(aptcfg->Find(PACKAGE "::UI::Default-Sorting",
 					 "name"))),
    limit(NULL),
-   limitstr(def_limit)
+   limitstr(def_limit),
+   active_grouper(NULL),
+   active_root(NULL),
+   active_root_indexed(false),
+   rebuild_pending(false)
 {
   if(!limitstr.empty())
     limit = matching::parse(cw::util::transcode(limitstr));
@@ -90,19 +545,216 @@ pkg_tree::pkg_tree(const std::string &def_grouping,
    sorting(parse_sortpolicy(aptcfg->Find(PACKAGE "::UI::Default-Sorting",
 					 "name"))),
    limit(NULL),
-   limitstr(cw::util::transcode(aptcfg->Find(PACKAGE "::Pkg-Display-Limit", "")))
+   limitstr(cw::util::transcode(aptcfg->Find(PACKAGE "::Pkg-Display-Limit", ""))),
+   active_grouper(NULL),
+   active_root(NULL),
+   active_root_indexed(false),
+   rebuild_pending(false)
 {
   if(!limitstr.empty())
     limit = matching::parse(cw::util::transcode(limitstr));
 }
 
+void pkg_tree::release_grouper()
+{
+  package_states_changed_connection.disconnect();
+
+  delete active_grouper;
+  active_grouper = NULL;
+  active_root = NULL;
+  active_root_indexed = false;
+  rebuild_pending = false;
+}
+
+void pkg_tree::handle_package_states_changed(const std::set<pkgCache::PkgIterator> *changed)
+{
+  if(changed->empty())
+    return;
+
+  // The search goes on; its tree is fixed up when it's displayed.
+  if(pending_limit_search.get() != NULL)
+    pending_limit_search->changed_packages.insert(changed->begin(),
+						  changed->end());
+
+  regroup_packages(*changed);
+}
+
+namespace
+{
+  /** \brief Add a package to a tree if it matches the tree's limit.
+   *
+   *  Used as the callback of pkg_subtree::regroup_package().
+   */
+  class limited_add
+  {
+    pkg_grouppolicy *grouper;
+    pkg_subtree *root;
+    ref_ptr<matching::pattern> limit;
+    ref_ptr<matching::search_cache> search_info;
+    pkgCache::PkgIterator pkg;
+
+  public:
+    limited_add(pkg_grouppolicy *_grouper, pkg_subtree *_root,
+		const ref_ptr<matching::pattern> &_limit,
+		const ref_ptr<matching::search_cache> &_search_info,
+		const pkgCache::PkgIterator &_pkg)
+      : grouper(_grouper), root(_root), limit(_limit),
+	search_info(_search_info), pkg(_pkg)
+    {
+    }
+
+    void operator()() const
+    {
+      // A package might have started or stopped matching the limit.
+      if(!limit.valid() ||
+	 matching::get_match(limit, pkg, search_info,
+			     *apt_cache_file, *apt_package_records).valid())
+	grouper->add_package(pkg, root);
+    }
+  };
+}
+
+void pkg_tree::regroup_packages(const std::set<pkgCache::PkgIterator> &packages)
+{
+  if(active_grouper == NULL || !active_root_indexed || rebuild_pending)
+    return;
+
+  ref_ptr<matching::search_cache> search_info;
+  if(limit.valid())
+    search_info = matching::search_cache::create();
+
+  bool new_subtrees = false;
+  for(std::set<pkgCache::PkgIterator>::const_iterator it = packages.begin();
+      it != packages.end(); ++it)
+    {
+      const pkgCache::PkgIterator &pkg(*it);
+
+      // Useless packages were never added; see build_tree().
+      if(pkg.VersionList().end() && pkg.ProvidesList().end())
+	continue;
+
+      const sigc::slot0<void> add(limited_add(active_grouper, active_root,
+					       limit, search_info, pkg));
+      switch(active_root->regroup_package(pkg, add))
+	{
+	case pkg_subtree::regroup_unchanged:
+	case pkg_subtree::regroup_moved:
+	  break;
+
+	case pkg_subtree::regroup_moved_to_new_subtree:
+	  new_subtrees = true;
+	  break;
+
+	case pkg_subtree::regroup_failed:
+	  schedule_rebuild();
+	  return;
+	}
+    }
+
+  // Puts the new groups in their place; packages are sorted when
+  // their items are created.
+  if(new_subtrees)
+    {
+      pkg_sortpolicy_wrapper sorter(sorting);
+      active_root->sort(sorter);
+    }
+}
+
+void pkg_tree::schedule_rebuild()
+{
+  rebuild_pending = true;
+  cw::toplevel::post_event(new cw::toplevel::slot_event(sigc::mem_fun(*this, &pkg_tree::rebuild_after_state_change)));
+}
+
+void pkg_tree::rebuild_after_state_change()
+{
+  // A limit search that is running will replace the tree anyway;
+  // if it finds nothing, the tree is rebuilt then.
+  if(!rebuild_pending || pending_limit_search.get() != NULL)
+    return;
+
+  rebuild_pending = false;
+  rebuild_keeping_view();
+}
+
+namespace
+{
+  /** \brief Finds one particular item of a tree. */
+  class item_search : public cw::tree_search_func
+  {
+    const cw::treeitem *target;
+
+  public:
+    item_search(const cw::treeitem *_target)
+      : target(_target)
+    {
+    }
+
+    bool operator()(const cw::treeitem &item)
+    {
+      return &item == target;
+    }
+  };
+}
+
+void pkg_tree::rebuild_keeping_view()
+{
+  pkg_subtree::view_state state;
+  if(active_root != NULL)
+    {
+      cw::treeiterator selected = get_selection();
+      active_root->save_view(selected == get_end() ? NULL : &*selected,
+			     state);
+    }
+
+  build_tree();
+
+  if(active_root == NULL)
+    return;
+
+  pkg_tree_node *target = active_root->restore_view(state);
+  if(target != NULL)
+    {
+      cw::treeiterator selected = get_selection();
+      if(selected == get_end() || &*selected != target)
+	{
+	  item_search searcher(target);
+	  search_for(searcher);
+	}
+    }
+
+  cw::toplevel::update();
+}
+
 void pkg_tree::handle_cache_close()
 {
+  cancel_limit_search();
+  release_grouper();
   set_root(NULL);
 }
 
+void pkg_tree::cancel_limit_search()
+{
+  if(pending_limit_search.get() == NULL)
+    return;
+
+  running_limit_searches.erase(pending_limit_search->id);
+
+  if(pending_limit_search->job.get() != NULL)
+    {
+      LOG_TRACE(aptitude::Loggers::getAptitudePkgTree(),
+		"Canceling the search " << pending_limit_search->job);
+      pending_limit_search->job->cancel();
+      pending_limit_search->job.reset();
+    }
+
+  pending_limit_search.reset();
+}
+
 pkg_tree::~pkg_tree()
 {
+  cancel_limit_search();
+  release_grouper();
   delete sorting;
 }
 
@@ -152,6 +804,184 @@ void pkg_tree::set_sorting(const std::wstring &s)
     set_sorting(policy);
 }
 
+namespace
+{
+  /** \brief The packages being classified by classify_packages(),
+   *  handed out to the worker threads a chunk at a time.
+   *
+   *  The chunks are much smaller than a thread's share of the
+   *  packages, so the calling thread can report progress as they
+   *  are finished.
+   */
+  class classify_work
+  {
+  public:
+    typedef std::vector<pkgCache::PkgIterator>::size_type size_type;
+
+  private:
+    pkg_grouppolicy_factory *grouping;
+    const std::vector<pkgCache::PkgIterator> &packages;
+    const size_type chunk;
+
+    cw::threads::mutex m;
+    cw::threads::condition chunk_finished;
+
+    // The first package that hasn't been handed out.
+    size_type next;
+    // The number of packages that have been classified.
+    size_type done;
+
+  public:
+    classify_work(pkg_grouppolicy_factory *_grouping,
+		  const std::vector<pkgCache::PkgIterator> &_packages,
+		  size_type _chunk)
+      : grouping(_grouping), packages(_packages), chunk(_chunk),
+	next(0), done(0)
+    {
+    }
+
+    /** \brief Classify chunks until none are left. */
+    void run()
+    {
+      cw::threads::mutex::lock l(m);
+
+      while(next < packages.size())
+	{
+	  const size_type begin = next;
+	  const size_type end = std::min(begin + chunk, packages.size());
+	  next = end;
+
+	  l.release();
+	  for(size_type i = begin; i < end; ++i)
+	    grouping->classify(packages[i]);
+	  l.acquire();
+
+	  done += end - begin;
+	  chunk_finished.wake_all();
+	}
+    }
+
+    /** \brief Wait until more packages have been classified than
+     *  \b seen, and return the new count.
+     */
+    size_type wait_for_progress(size_type seen)
+    {
+      cw::threads::mutex::lock l(m);
+
+      while(done == seen)
+	chunk_finished.wait(l);
+
+      return done;
+    }
+
+  };
+
+  class classify_thread
+  {
+    classify_work *work;
+
+  public:
+    classify_thread(classify_work *_work)
+      : work(_work)
+    {
+    }
+
+    void operator()() const
+    {
+      work->run();
+    }
+  };
+
+  /** \brief Let \b grouping classify \b packages ahead of time, on
+   *  several threads if the list is large.
+   *
+   *  The number of threads is set by Aptitude::UI::Grouping-Threads,
+   *  and defaults to the number of online processors.  While the
+   *  workers run, the calling thread reports their progress.
+   *
+   *  \param progress  If not NULL, the first half of this bar
+   *                   tracks the classification.
+   *
+   *  \return \b true if the packages were classified; \b false if
+   *  the factory classifies nothing.
+   */
+  bool classify_packages(pkg_grouppolicy_factory *grouping,
+			 const std::vector<pkgCache::PkgIterator> &packages,
+			 OpProgress *progress)
+  {
+    typedef classify_work::size_type size_type;
+
+    if(packages.empty() ||
+       !grouping->prepare_classify((*apt_cache_file)->Head().PackageCount))
+      return false;
+
+    // Below this, starting a thread costs more than it saves.
+    const size_type min_packages_per_thread = 2048;
+    // Small enough that the progress bar moves smoothly, large enough
+    // that the workers rarely wait for each other.
+    const size_type chunk = 512;
+
+    long num_threads = aptcfg->FindI(PACKAGE "::UI::Grouping-Threads", 0);
+    if(num_threads < 1)
+      num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(num_threads < 1)
+      num_threads = 1;
+
+    const size_type useful_threads =
+      (packages.size() + min_packages_per_thread - 1) / min_packages_per_thread;
+    if(static_cast<size_type>(num_threads) > useful_threads)
+      num_threads = useful_threads;
+
+    const size_type total = packages.size();
+    classify_work work(grouping, packages, chunk);
+
+    std::vector<boost::shared_ptr<cw::threads::thread> > threads;
+    if(num_threads > 1)
+      for(long i = 0; i < num_threads; ++i)
+	{
+	  try
+	    {
+	      threads.push_back(boost::make_shared<cw::threads::thread>(classify_thread(&work)));
+	    }
+	  catch(cw::threads::ThreadCreateException &)
+	    {
+	      break;
+	    }
+	}
+
+    if(threads.empty())
+      // Do the work here, a chunk at a time.
+      for(size_type begin = 0; begin < total; begin += chunk)
+	{
+	  const size_type end = std::min(begin + chunk, total);
+	  for(size_type i = begin; i < end; ++i)
+	    grouping->classify(packages[i]);
+
+	  if(progress != NULL)
+	    progress->OverallProgress(end, 2 * total, 1, _("Building view"));
+	}
+    else
+      {
+	size_type done = 0;
+	while(done < total)
+	  {
+	    done = work.wait_for_progress(done);
+	    if(progress != NULL)
+	      progress->OverallProgress(done, 2 * total, 1, _("Building view"));
+	  }
+
+	for(std::vector<boost::shared_ptr<cw::threads::thread> >::const_iterator
+	      it = threads.begin(); it != threads.end(); ++it)
+	  (*it)->join();
+      }
+
+    if(progress != NULL)
+      progress->OverallProgress(total, 2 * total, 1, _("Building view"));
+
+    return true;
+  }
+}
+
 bool pkg_tree::build_tree(OpProgress &progress)
 {
   bool rval;
@@ -167,6 +997,8 @@ bool pkg_tree::build_tree(OpProgress &progress)
 
   reset_incsearch();
 
+  cancel_limit_search();
+  release_grouper();
   set_root(NULL);
 
   reset_incsearch();
@@ -180,6 +1012,10 @@ bool pkg_tree::build_tree(OpProgress &progress)
 						     &selected_desc_signal);
 
       mytree->set_depth(-1);
+      mytree->track_lazy_packages();
+
+      // The packages to add, in the order they are added.
+      std::vector<pkgCache::PkgIterator> packages;
 
       if(limit.valid())
 	{
@@ -191,9 +1027,6 @@ bool pkg_tree::build_tree(OpProgress &progress)
 			   *apt_cache_file,
 			   *apt_package_records);
 
-	  int num = 0;
-	  int total = matches.size();
-
 	  for(std::vector<std::pair<pkgCache::PkgIterator, cwidget::util::ref_ptr<matching::structural_match> > >::const_iterator
 		it = matches.begin(); it != matches.end(); ++it)
 	    {
@@ -201,49 +1034,63 @@ bool pkg_tree::build_tree(OpProgress &progress)
 
 	      cache_empty = false;
 
-	      progress.OverallProgress(num, total, 1, _("Building view"));
-	      ++num;
-
 	      // Filter useless packages up-front.
 	      if(pkg.VersionList().end() && pkg.ProvidesList().end())
 		continue;
 
-	      empty = false;
-	      grouper->add_package(pkg, mytree);
+	      packages.push_back(pkg);
 	    }
-
-	  progress.OverallProgress(total, total, 1, _("Building view"));
 	}
       else
 	{
-	  int num = 0;
-	  int total = (*apt_cache_file)->Head().PackageCount;
+	  packages.reserve((*apt_cache_file)->Head().PackageCount);
 
 	  for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin(); !pkg.end(); ++pkg)
 	    {
 	      cache_empty = false;
 
-	      progress.OverallProgress(num, total, 1, _("Building view"));
-
-	      ++num;
-
 	      // Filter useless packages up-front.
 	      if(pkg.VersionList().end() && pkg.ProvidesList().end())
 		continue;
 
-	      empty = false;
-	      grouper->add_package(pkg, mytree);
+	      packages.push_back(pkg);
 	    }
+	}
+
+      empty = packages.empty();
 
-	  progress.OverallProgress(total, total, 1, _("Building view"));
+      // Work out the groups of the packages on several threads, then
+      // build the tree here; since the packages are added in the same
+      // order either way, the tree doesn't depend on how the work was
+      // split up.
+      // When the packages are classified, that's the first half of
+      // the progress bar.
+      const int total = packages.size();
+      const int offset =
+	classify_packages(grouping, packages, &progress) ? total : 0;
+
+      for(int num = 0; num < total; ++num)
+	{
+	  progress.OverallProgress(offset + num, offset + total, 1,
+				   _("Building view"));
+	  grouper->add_package(packages[num], mytree);
 	}
 
+      progress.OverallProgress(offset + total, offset + total, 1,
+			       _("Building view"));
+
+      grouping->clear_classify();
+
       pkg_sortpolicy_wrapper sorter(sorting);
       mytree->sort(sorter);
 
       set_root(mytree);
 
-      delete grouper;
+      active_grouper = grouper;
+      active_root = mytree;
+      active_root_indexed = mytree->all_packages_indexed();
+      package_states_changed_connection =
+	(*apt_cache_file)->package_states_changed.connect(sigc::mem_fun(*this, &pkg_tree::handle_package_states_changed));
 
       rval=cache_empty || !empty;
     }
@@ -264,14 +1111,142 @@ bool pkg_tree::build_tree()
   return rval;
 }
 
-void pkg_tree::set_limit(const std::wstring &_limit)
+void pkg_tree::dispatch_limit_search_batch(int id, package_batch batch)
+{
+  std::map<int, pkg_tree *>::const_iterator found =
+    running_limit_searches.find(id);
+  if(found != running_limit_searches.end())
+    found->second->limit_search_batch_ready(batch);
+}
+
+void pkg_tree::dispatch_limit_search_progress(int id,
+					      aptitude::util::progress_info info)
+{
+  std::map<int, pkg_tree *>::const_iterator found =
+    running_limit_searches.find(id);
+  if(found != running_limit_searches.end())
+    found->second->limit_search_progress(info);
+}
+
+void pkg_tree::dispatch_limit_search_finished(int id)
+{
+  std::map<int, pkg_tree *>::const_iterator found =
+    running_limit_searches.find(id);
+  if(found != running_limit_searches.end())
+    found->second->limit_search_finished();
+}
+
+void pkg_tree::limit_search_batch_ready(const package_batch &batch)
+{
+  const boost::shared_ptr<limit_search> &search = pending_limit_search;
+
+  std::vector<pkgCache::PkgIterator> packages;
+  packages.reserve(batch->size());
+  for(std::vector<pkgCache::PkgIterator>::const_iterator it = batch->begin();
+      it != batch->end(); ++it)
+    {
+      search->any_matches = true;
+
+      // Filter useless packages up-front.
+      if(it->VersionList().end() && it->ProvidesList().end())
+	continue;
+
+      packages.push_back(*it);
+    }
+
+  classify_packages(grouping, packages, NULL);
+
+  for(std::vector<pkgCache::PkgIterator>::const_iterator it = packages.begin();
+      it != packages.end(); ++it)
+    search->grouper->add_package(*it, search->root);
+
+  grouping->clear_classify();
+
+  if(!packages.empty())
+    search->any_packages = true;
+}
+
+void pkg_tree::limit_search_progress(aptitude::util::progress_info info)
+{
+  OpProgress *progress = pending_limit_search->progress->get_progress().unsafe_get_ref();
+
+  progress->OverallProgress(info.get_progress_percent_int(), 100, 1,
+			    _("Searching"));
+}
+
+void pkg_tree::limit_search_finished()
 {
-  ref_ptr<matching::pattern> old_limit(limit);
-  std::wstring old_limitstr(limitstr);
+  // Keeps the search alive until its tree has been taken over.
+  const boost::shared_ptr<limit_search> search = pending_limit_search;
+
+  running_limit_searches.erase(search->id);
+  search->job.reset();
+  pending_limit_search.reset();
+
+  // As in build_tree(), a limit is rejected only if it matched
+  // nothing but useless packages.
+  if(search->any_matches && !search->any_packages &&
+     !aptcfg->FindB(PACKAGE "::UI::Allow-Unmatched-Limit", false))
+    {
+      wchar_t buf[512];
+
+      swprintf(buf, 512, W_("No packages matched the pattern \"%ls\".").c_str(),
+	       search->limitstr.c_str());
+
+      show_message(buf);
+
+      // The current tree is kept, so carry out any rebuild that was
+      // put off for the search.
+      if(rebuild_pending)
+	{
+	  rebuild_pending = false;
+	  rebuild_keeping_view();
+	}
+
+      return;
+    }
+
+  pkg_sortpolicy_wrapper sorter(sorting);
+  search->root->sort(sorter);
+
+  reset_incsearch();
+
+  release_grouper();
+  set_root(search->root);
+
+  limit = search->limit;
+  limitstr = search->limitstr;
+
+  active_grouper = search->grouper;
+  active_root = search->root;
+  active_root_indexed = search->root->all_packages_indexed();
+  package_states_changed_connection =
+    (*apt_cache_file)->package_states_changed.connect(sigc::mem_fun(*this, &pkg_tree::handle_package_states_changed));
+
+  // The tree and the grouping policy belong to this widget now.
+  search->root = NULL;
+  search->grouper = NULL;
+
+  regroup_packages(search->changed_packages);
+
+  cw::toplevel::update();
+}
 
+void pkg_tree::set_limit(const std::wstring &_limit)
+{
   ref_ptr<matching::pattern> new_limit(matching::parse(cw::util::transcode(_limit)));
-  if(_limit.empty() || new_limit.valid())
+  if(!_limit.empty() && !new_limit.valid())
+    return;
+
+  cancel_limit_search();
+
+  // Without a limit there's nothing to search for, and until the tree
+  // has been built once, there's no tree to keep.
+  if(_limit.empty() || !initialized || !grouping || !apt_cache_file)
     {
+      ref_ptr<matching::pattern> old_limit(limit);
+      std::wstring old_limitstr(limitstr);
+
       limit=new_limit;
       limitstr=_limit;
 
@@ -288,7 +1263,47 @@ void pkg_tree::set_limit(const std::wstring &_limit)
 
 	  build_tree();
 	}
+
+      return;
     }
+
+  boost::shared_ptr<limit_search> search =
+    boost::make_shared<limit_search>(next_limit_search_id++, new_limit, _limit);
+
+  search->root = new pkg_subtree(W_("All Packages"), true);
+  search->root->set_depth(-1);
+  search->root->track_lazy_packages();
+  search->grouper = grouping->instantiate(&selected_signal,
+					  &selected_desc_signal);
+  search->progress = gen_progress_bar();
+
+  // The last copies of these slots might be thrown away on the
+  // search thread, so they hold nothing but the ID of the search.
+  sigc::slot1<void, package_batch> batch_ready_slot =
+    sigc::bind<0>(sigc::ptr_fun(&pkg_tree::dispatch_limit_search_batch),
+		  search->id);
+  sigc::slot1<void, aptitude::util::progress_info> progress_slot =
+    sigc::bind<0>(sigc::ptr_fun(&pkg_tree::dispatch_limit_search_progress),
+		  search->id);
+  sigc::slot0<void> finished_slot =
+    sigc::bind(sigc::ptr_fun(&pkg_tree::dispatch_limit_search_finished),
+	       search->id);
+
+  // The job gets its own copy of the pattern, since it's released
+  // on whichever thread lets go of the job last.
+  search->job =
+    boost::make_shared<limit_search_job>(matching::parse(cw::util::transcode(_limit)),
+					 _limit,
+					 make_safe_slot(batch_ready_slot),
+					 make_safe_slot(progress_slot),
+					 make_safe_slot(finished_slot));
+
+  pending_limit_search = search;
+  running_limit_searches[search->id] = this;
+
+  LOG_TRACE(aptitude::Loggers::getAptitudePkgTree(),
+	    "Starting the search " << search->job);
+  limit_search_thread::add_job(search->job);
 }
 
 bool pkg_tree::find_limit_enabled()
@@ -27,6 +27,14 @@
 #include <apt-pkg/pkgcache.h>
 
 #include <generic/apt/matching/pattern.h>
+#include <generic/util/progress_info.h>
+
+#include <sigc++/connection.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <set>
+#include <vector>
 
 /** \brief Uses the cwidget::widgets::tree classes to display a tree containing packages
  *
@@ -43,6 +51,7 @@ class OpProgress;
 class pkg_grouppolicy;
 class pkg_grouppolicy_factory;
 class pkg_sortpolicy;
+class pkg_subtree;
 class pkg_tree_node;
 class undo_group;
 
@@ -66,8 +75,102 @@ class pkg_tree:public apt_undo_tree
   static cwidget::widgets::editline::history_list limit_history, grouping_history,
     sorting_history;
 
+  /** The policy that built the current tree and its root, kept so
+   *  that packages can be regrouped when their states change; NULL
+   *  if there is no tree.
+   */
+  pkg_grouppolicy *active_grouper;
+  pkg_subtree *active_root;
+
+  /** \b true if active_root knows where every package in it is, so
+   *  that packages can be moved without rebuilding the tree.
+   */
+  bool active_root_indexed;
+
+  /** \b true if a rebuild of the tree has been posted and hasn't
+   *  happened yet.
+   */
+  bool rebuild_pending;
+
+  sigc::connection package_states_changed_connection;
+
+  /** Throw away active_grouper and stop listening for state changes. */
+  void release_grouper();
+
+  /** Regroup the packages whose states changed, in the displayed
+   *  tree and, once it finishes, in the tree of the pending limit
+   *  search.
+   */
+  void handle_package_states_changed(const std::set<pkgCache::PkgIterator> *changed);
+
+  /** Move each of the given packages to the groups that it now
+   *  belongs in, if they changed.
+   *
+   *  Only the affected packages are touched.  Items can't be taken
+   *  out of a subtree, so if a package whose item was created has to
+   *  move, the tree is rebuilt instead.  Trees whose packages aren't
+   *  indexed (because the grouping policy creates items itself) are
+   *  left alone.
+   */
+  void regroup_packages(const std::set<pkgCache::PkgIterator> &packages);
+
+  /** Rebuild the tree once control returns to the main loop; the
+   *  item whose package changed might still be running.
+   */
+  void schedule_rebuild();
+
+  /** Carry out a rebuild posted by schedule_rebuild(). */
+  void rebuild_after_state_change();
+
+  /** Rebuild the tree, expanding the same groups as before and
+   *  selecting the same item, if they still exist.
+   */
+  void rebuild_keeping_view();
+
   void handle_cache_close();
 
+  class limit_search;
+
+  /** The limit search that is running in the background, if any.
+   *  Its results are collected in a separate tree, which replaces
+   *  the displayed tree when the search finishes.
+   *
+   *  Only the UI thread refers to this object; the background job
+   *  reaches it through the ID of the search, so it's always freed
+   *  on the UI thread.
+   */
+  boost::shared_ptr<limit_search> pending_limit_search;
+
+  /** Abandon pending_limit_search, if there is one.  The current
+   *  tree and limit are left alone.
+   */
+  void cancel_limit_search();
+
+  /** \brief Pass the results of a background search to the tree that
+   *  started it.
+   *
+   *  These do nothing if the search was abandoned or the tree was
+   *  destroyed.
+   */
+  static void dispatch_limit_search_batch(int id,
+					  boost::shared_ptr<std::vector<pkgCache::PkgIterator> > batch);
+  static void dispatch_limit_search_progress(int id,
+					     aptitude::util::progress_info info);
+  static void dispatch_limit_search_finished(int id);
+
+  /** Add a batch of packages found by the background search to its
+   *  tree.
+   */
+  void limit_search_batch_ready(const boost::shared_ptr<std::vector<pkgCache::PkgIterator> > &batch);
+
+  /** Display the tree built by the background search, or keep the
+   *  current tree if nothing matched.
+   */
+  void limit_search_finished();
+
+  /** Show how far the background search has gotten. */
+  void limit_search_progress(aptitude::util::progress_info info);
+
   /** Set up the limit and handle a few other things. */
   void init(const char *limitstr);
 protected:
@@ -134,8 +237,13 @@ public:
   void set_grouping(const std::wstring &s);
   void set_sorting(pkg_sortpolicy *_sorting);
   void set_sorting(const std::wstring &s);
+  /** Select a new limit and rebuild the tree.
+   *
+   *  The search runs in the background; the current tree is
+   *  displayed until the new one is ready, and a later call to
+   *  set_limit() or build_tree() abandons the search.
+   */
   void set_limit(const std::wstring &_limit);
-  // Selects a new limit and rebuilds the tree.
   std::wstring get_limit_str() {return limitstr;}
 
   /** Return \b true. */
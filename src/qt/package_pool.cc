@@ -25,7 +25,9 @@
 #include <generic/apt/apt.h>
 
 // System includes
-#include "vector"
+#include <algorithm>
+#include <set>
+#include <vector>
 
 namespace aptitude
 {
@@ -33,9 +35,36 @@ namespace aptitude
   {
     namespace qt
     {
+      namespace
+      {
+	struct range_ends_before
+	{
+	  bool operator()(const package_id_ranges::range &r,
+			  unsigned long id) const
+	  {
+	    return r.second <= id;
+	  }
+	};
+      }
+
+      bool package_id_ranges::contains(unsigned long id) const
+      {
+	const_iterator found =
+	  std::lower_bound(ranges.begin(), ranges.end(), id, range_ends_before());
+
+	return found != ranges.end() && found->first <= id;
+      }
+
       class package_pool::package_pool_impl : public package_pool,
                                               public sigc::trackable
       {
+	/** \brief The IDs of the packages in the pool, by index. */
+	std::vector<unsigned long> package_ids;
+
+	/** \brief The index of each package, by ID, or -1. */
+	std::vector<int> package_indices;
+
+	/** \brief The package objects that have been created, by ID. */
 	std::vector<package_ptr> packages;
 
 	/** \brief Metod invoked after cache reloading.
@@ -54,10 +83,10 @@ namespace aptitude
 
 	/** \brief Metod invoked after changing cache state.
 	 *
-	 *  This method uses package_aware_object to inform others classes about
-	 *  packages which state has changed
+	 *  This method discards the objects of the changed packages
+	 *  and informs others classes about which packages changed.
 	 */
-	void cache_state_changed();
+	void cache_state_changed(const std::set<pkgCache::PkgIterator> *changed_packages);
 
       public:
 	/** \brief Create a new package_pool_impl. */
@@ -74,9 +103,12 @@ namespace aptitude
 	/** \brief Retrieve a pointer to package at given index. */
 	package_ptr get_package_at_index(unsigned int index);
 
+	/** \brief Retrieve the index of the package with the given ID. */
+	int get_package_index(unsigned long id);
+
 	sigc::signal0<void> cache_closed_signal;
 	sigc::signal0<void> cache_reloaded_signal;
-	sigc::signal1<void, std::vector<package_ptr> > cache_state_changed_signal;
+	sigc::signal1<void, const package_id_ranges &> cache_state_changed_signal;
 
 	/** \brief Register a slot to be invoked when the apt cache is reloaded. */
 	sigc::connection connect_cache_reloaded(const sigc::slot<void> &slot);
@@ -85,7 +117,7 @@ namespace aptitude
 	sigc::connection connect_cache_closed(const sigc::slot<void> &slot);
 
 	/** \brief Register a slot to be invoked when the state of packages changes. */
-	sigc::connection connect_cache_state_changed(const sigc::slot<void, std::vector<package_ptr> > &slot);
+	sigc::connection connect_cache_state_changed(const sigc::slot<void, const package_id_ranges &> &slot);
       };
 
       package_pool::package_pool_impl::package_pool_impl()
@@ -105,9 +137,12 @@ namespace aptitude
 	if(apt_cache_file == NULL)
 	  return;
 
-	(*apt_cache_file)->package_state_changed.connect(sigc::mem_fun(*this, &package_pool::package_pool_impl::cache_state_changed));
+	(*apt_cache_file)->package_states_changed.connect(sigc::mem_fun(*this, &package_pool::package_pool_impl::cache_state_changed));
 
-	packages.reserve((*apt_cache_file)->Head().PackageCount);
+	const unsigned long num_packages = (*apt_cache_file)->Head().PackageCount;
+	package_ids.reserve(num_packages);
+	package_indices.assign(num_packages, -1);
+	packages.resize(num_packages);
 
 	for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin(); !pkg.end(); ++pkg)
           {
@@ -115,7 +150,8 @@ namespace aptitude
             if(pkg.VersionList().end() && pkg.ProvidesList().end())
               continue;
 
-            packages.push_back(package::create(pkg));
+            package_indices[pkg->ID] = package_ids.size();
+            package_ids.push_back(pkg->ID);
           }
 
 	cache_reloaded_signal();
@@ -125,25 +161,60 @@ namespace aptitude
       {
 	cache_closed_signal();
 
+	package_ids.clear();
+	package_indices.clear();
 	packages.clear();
       }
 
-      void package_pool::package_pool_impl::cache_state_changed()
+      void package_pool::package_pool_impl::cache_state_changed(const std::set<pkgCache::PkgIterator> *changed_packages)
       {
-	// TODO
+	// The set is sorted by position in the cache, which is ID
+	// order.
+	package_id_ranges changed;
+	for(std::set<pkgCache::PkgIterator>::const_iterator it = changed_packages->begin();
+	    it != changed_packages->end(); ++it)
+	  {
+	    const unsigned long id = (*it)->ID;
+	    if(id >= packages.size() || package_indices[id] < 0)
+	      continue;
+
+	    // Package objects cache their versions, so the next
+	    // request has to build a new one.
+	    packages[id].reset();
+	    changed.push_back(id);
+	  }
+
+	if(!changed.empty())
+	  cache_state_changed_signal(changed);
       }
 
       int package_pool::package_pool_impl::get_packages_count()
       {
-	return packages.size();
+	return package_ids.size();
       }
 
       package_ptr package_pool::package_pool_impl::get_package_at_index(unsigned int index)
       {
-	if(index >= 0 && index < packages.size())
-	  return packages.at(index);
+	if(index >= package_ids.size())
+	  return package_ptr();
+
+	const unsigned long id = package_ids[index];
+	package_ptr &rval = packages[id];
+	if(rval.get() == NULL)
+	  {
+	    pkgCache &cache = (*apt_cache_file)->GetCache();
+	    rval = package::create(pkgCache::PkgIterator(cache, cache.PkgP + id));
+	  }
+
+	return rval;
+      }
+
+      int package_pool::package_pool_impl::get_package_index(unsigned long id)
+      {
+	if(id >= package_indices.size())
+	  return -1;
 
-	return package_ptr();
+	return package_indices[id];
       }
 
       sigc::connection
@@ -159,7 +230,7 @@ namespace aptitude
       }
 
       sigc::connection
-      package_pool::package_pool_impl::connect_cache_state_changed(const sigc::slot<void, std::vector<package_ptr> > &slot)
+      package_pool::package_pool_impl::connect_cache_state_changed(const sigc::slot<void, const package_id_ranges &> &slot)
       {
 	return cache_state_changed_signal.connect(slot);
       }
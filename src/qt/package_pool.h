@@ -26,6 +26,7 @@
 #include <sigc++/connection.h>
 #include <sigc++/slot.h>
 
+#include <utility>
 #include <vector>
 
 namespace aptitude
@@ -37,11 +38,52 @@ namespace aptitude
       class package;
       typedef boost::shared_ptr<package> package_ptr;
 
+      /** \brief A set of package IDs, stored as sorted, disjoint
+       *  ranges.
+       *
+       *  Package state changes tend to touch runs of neighbouring
+       *  packages (or a handful of scattered ones), so this is much
+       *  smaller than a list of package objects and lets a view find
+       *  out quickly whether a given row is affected.
+       */
+      class package_id_ranges
+      {
+      public:
+	/** \brief A half-open range [first, second) of package IDs. */
+	typedef std::pair<unsigned long, unsigned long> range;
+	typedef std::vector<range>::const_iterator const_iterator;
+
+      private:
+	std::vector<range> ranges;
+
+      public:
+	/** \brief Add an ID to the set.
+	 *
+	 *  IDs must be added in increasing order.
+	 */
+	void push_back(unsigned long id)
+	{
+	  if(!ranges.empty() && ranges.back().second == id)
+	    ++ranges.back().second;
+	  else
+	    ranges.push_back(range(id, id + 1));
+	}
+
+	const_iterator begin() const { return ranges.begin(); }
+	const_iterator end() const { return ranges.end(); }
+	bool empty() const { return ranges.empty(); }
+
+	/** \brief Return \b true if the given ID is in the set. */
+	bool contains(unsigned long id) const;
+      };
+
       /** \brief A global pool of package objects.
        *
-       *  The pool is filled when the object is created or when the
-       *  cache is (re)loaded, and it is emptied when the cache is
-       *  closed.
+       *  When the cache is (re)loaded, the pool records the IDs of
+       *  the packages it exposes; the package objects themselves are
+       *  created the first time they are requested, and kept in a
+       *  table indexed by package ID until the cache is closed or the
+       *  package's state changes.
        *
        *  This pool also interprets signals for the benefit of its
        *  client code.
@@ -76,6 +118,13 @@ namespace aptitude
          */
 	virtual package_ptr get_package_at_index(unsigned int index) = 0;
 
+	/** \brief Retrieve the index of the package with the given ID.
+	 *
+	 *  \return the package's index, or -1 if the package isn't in
+	 *  the pool.
+	 */
+	virtual int get_package_index(unsigned long id) = 0;
+
 	/** \brief Register a slot to be invoked when the apt cache is reloaded.
          *
          *  The slot is guaranteed to be invoked after the pool has
@@ -92,8 +141,12 @@ namespace aptitude
 
 	/** \brief Register a slot to be invoked when the state of one
          *  or more packages changes.
+         *
+         *  The slot receives the IDs of the packages that changed.
+         *  Their package objects have already been discarded, so
+         *  the next request for them returns up-to-date objects.
          */
-	virtual sigc::connection connect_cache_state_changed(const sigc::slot<void, std::vector<package_ptr> > &slot) = 0;
+	virtual sigc::connection connect_cache_state_changed(const sigc::slot<void, const package_id_ranges &> &slot) = 0;
       };
     }
   }
@@ -31,7 +31,6 @@
 #include <boost/weak_ptr.hpp>
 
 #include <apt-pkg/acquire.h>
-#include <apt-pkg/clean.h>
 #include <apt-pkg/configuration.h>
 #include <apt-pkg/error.h>
 #include <apt-pkg/packagemanager.h>
@@ -89,6 +88,7 @@
 
 #include <generic/apt/apt.h>
 #include <generic/apt/apt_undo_group.h>
+#include <generic/apt/archive_cleaner.h>
 #include <generic/apt/aptitude_resolver_universe.h>
 #include <generic/apt/config_signal.h>
 #include <generic/apt/download_install_manager.h>
@@ -1279,9 +1279,13 @@ static void check_package_trust()
 {
   vector<pkgCache::VerIterator> untrusted;
 
-  for(pkgCache::PkgIterator pkg=(*apt_cache_file)->PkgBegin();
-      !pkg.end(); ++pkg)
+  const std::set<pkgCache::PkgIterator> &changed =
+    (*apt_cache_file)->get_changed_packages();
+
+  for(std::set<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+      it != changed.end(); ++it)
     {
+      const pkgCache::PkgIterator &pkg = *it;
       pkgDepCache::StateCache &state=(*apt_cache_file)[pkg];
 
       if(state.Install())
@@ -1530,9 +1534,15 @@ namespace
 	// confirmed and not ask twice.
 	std::vector<pkgCache::PkgIterator> deleted_essential, broken_essential;
 
-	for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin();
-	    !pkg.end(); ++pkg)
+	// Only packages that are being removed or are broken can
+	// trigger this check, and they're all in the changed set.
+	const std::set<pkgCache::PkgIterator> &changed =
+	  (*apt_cache_file)->get_changed_packages();
+
+	for(std::set<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+	    it != changed.end(); ++it)
 	  {
+	    const pkgCache::PkgIterator &pkg = *it;
 	    pkgDepCache::StateCache &state = (*apt_cache_file)[pkg];
 
 	    if((pkg->Flags & pkgCache::Flag::Essential) &&
@@ -1604,9 +1614,14 @@ void do_package_run_or_show_preview()
   // UI: check that something will actually be done first.
   bool some_action_happening=false;
   bool some_non_simple_keep_happening=false;
-  for(pkgCache::PkgIterator i=(*apt_cache_file)->PkgBegin(); !i.end(); ++i)
+  const std::set<pkgCache::PkgIterator> &changed =
+    (*apt_cache_file)->get_changed_packages();
+
+  for(std::set<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+      it != changed.end(); ++it)
     {
-      pkg_action_state state = find_pkg_state(i, *apt_cache_file);
+      const pkgCache::PkgIterator &i = *it;
+      pkg_action_state state = (*apt_cache_file)->get_action_state(i);
 
       if(state!=pkg_unchanged)
 	{
@@ -1778,11 +1793,8 @@ static void really_do_clean()
       cw::toplevel::tryupdate();
 
       if(aptcfg)
-	{
-	  pkgAcquire fetcher;
-	  fetcher.Clean(aptcfg->FindDir("Dir::Cache::archives"));
-	  fetcher.Clean(aptcfg->FindDir("Dir::Cache::archives")+"partial/");
-	}
+	aptitude::apt::clean_archives(aptcfg->FindDir("Dir::Cache::archives"),
+				      NULL);
 
       msg->destroy();
 
@@ -1806,34 +1818,6 @@ void do_clean()
     }
 }
 
-// Ok, this is, uh, weird.  Erase has to be overridden to at least
-// call unlink()
-//
-// Should I list what I'm doing like apt-get does?
-class my_cleaner:public pkgArchiveCleaner
-{
-  long total_size;
-protected:
-  virtual void Erase(const char *file,
-		     string pkg,
-		     string ver,
-		     struct stat &stat)
-  {
-    if(unlink(file)==0)
-      total_size+=stat.st_size;
-  }
-public:
-  my_cleaner();
-  long get_total_size() {return total_size;}
-};
-
-// g++ bug?  If I include this implementation above in the class
-// def'n, it never gets called!
-my_cleaner::my_cleaner()
-  :total_size(0)
-{
-}
-
 static bool do_autoclean_enabled()
 {
   return apt_cache_file != NULL;
@@ -1865,18 +1849,11 @@ static void really_do_autoclean()
       popup_widget(msg);
       cw::toplevel::tryupdate();
 
-      long cleaned_size=0;
+      unsigned long long cleaned_size=0;
 
       if(aptcfg)
-	{
-	  my_cleaner cleaner;
-
-	  cleaner.Go(aptcfg->FindDir("Dir::Cache::archives"), *apt_cache_file);
-	  cleaner.Go(aptcfg->FindDir("Dir::Cache::archives")+"partial/",
-		     *apt_cache_file);
-
-	  cleaned_size=cleaner.get_total_size();
-	}
+	cleaned_size=aptitude::apt::clean_archives(aptcfg->FindDir("Dir::Cache::archives"),
+						   &(*apt_cache_file)->GetCache());
 
       msg->destroy();
 
@@ -0,0 +1,131 @@
+/** \file test_archive_cleaner.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/apt/archive_cleaner.h>
+
+// System includes:
+#include <apt-pkg/error.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using aptitude::apt::archive_file;
+using aptitude::apt::erase_archives;
+using aptitude::apt::find_archives_to_clean;
+using aptitude::apt::parse_archive_name;
+
+TEST(ArchiveCleaner, ParseName)
+{
+  std::string package, version, arch;
+
+  EXPECT_TRUE(parse_archive_name("foo_1%3a2.0-1_i386.deb",
+				 package, version, arch));
+  EXPECT_EQ("foo", package);
+  EXPECT_EQ("1:2.0-1", version);
+  EXPECT_EQ("i386", arch);
+
+  EXPECT_TRUE(parse_archive_name("libbar-dev_0.5_all.deb",
+				 package, version, arch));
+  EXPECT_EQ("libbar-dev", package);
+  EXPECT_EQ("0.5", version);
+  EXPECT_EQ("all", arch);
+}
+
+TEST(ArchiveCleaner, ParseBadName)
+{
+  std::string package, version, arch;
+
+  EXPECT_FALSE(parse_archive_name("lock", package, version, arch));
+  EXPECT_FALSE(parse_archive_name("foo_1.0", package, version, arch));
+  EXPECT_FALSE(parse_archive_name("foo_1.0_i386", package, version, arch));
+}
+
+namespace
+{
+  void write_file(const std::string &path, size_t size)
+  {
+    FILE *f = fopen(path.c_str(), "w");
+    ASSERT_TRUE(f != NULL);
+    for(size_t i = 0; i < size; ++i)
+      fputc('x', f);
+    fclose(f);
+  }
+
+  bool archive_name_lt(const archive_file &f1, const archive_file &f2)
+  {
+    return f1.name < f2.name;
+  }
+}
+
+TEST(ArchiveCleaner, CleanAll)
+{
+  char tmpl[] = "/tmp/aptitude-test-archives.XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  const std::string dir = std::string(tmpl) + "/";
+
+  write_file(dir + "foo_1.0_i386.deb", 10);
+  write_file(dir + "README", 3);
+  write_file(dir + "lock", 0);
+  ASSERT_EQ(0, mkdir((dir + "partial").c_str(), 0700));
+
+  std::vector<archive_file> files;
+  EXPECT_TRUE(find_archives_to_clean(dir, NULL, files));
+  ASSERT_EQ(2U, files.size());
+
+  std::sort(files.begin(), files.end(), archive_name_lt);
+  EXPECT_EQ("README", files[0].name);
+  EXPECT_EQ("", files[0].package);
+  EXPECT_EQ(3, files[0].size);
+  EXPECT_EQ("foo_1.0_i386.deb", files[1].name);
+  EXPECT_EQ("foo", files[1].package);
+  EXPECT_EQ("1.0", files[1].version);
+  EXPECT_EQ(10, files[1].size);
+
+  EXPECT_EQ(13ULL, erase_archives(dir, files));
+
+  std::vector<archive_file> remaining;
+  EXPECT_TRUE(find_archives_to_clean(dir, NULL, remaining));
+  EXPECT_TRUE(remaining.empty());
+
+  // The lock file and the partial directory are left alone.
+  struct stat st;
+  EXPECT_EQ(0, stat((dir + "lock").c_str(), &st));
+  EXPECT_EQ(0, stat((dir + "partial").c_str(), &st));
+
+  unlink((dir + "lock").c_str());
+  rmdir((dir + "partial").c_str());
+  rmdir(tmpl);
+}
+
+TEST(ArchiveCleaner, MissingDirectory)
+{
+  std::vector<archive_file> files;
+  EXPECT_FALSE(find_archives_to_clean("/nonexistent/aptitude-test/",
+				      NULL, files));
+  EXPECT_TRUE(files.empty());
+  _error->Discard();
+}
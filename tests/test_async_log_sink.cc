@@ -0,0 +1,217 @@
+/** \file test_async_log_sink.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/async_log_sink.h>
+#include <generic/util/logging.h>
+#include <generic/util/temp.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <cwidget/generic/threads/threads.h>
+
+#include <sigc++/functors/mem_fun.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using aptitude::util::logging::INFO_LEVEL;
+using aptitude::util::logging::LoggerPtr;
+using aptitude::util::logging::LoggingSystem;
+using aptitude::util::logging::TRACE_LEVEL;
+using aptitude::util::logging::async_log_sink;
+using aptitude::util::logging::async_log_sink_stats;
+using aptitude::util::logging::createLoggingSystem;
+using aptitude::util::logging::create_async_log_sink;
+using boost::shared_ptr;
+
+namespace
+{
+  struct AsyncLogSinkTest : public testing::Test
+  {
+    shared_ptr<LoggingSystem> loggingSystem;
+    LoggerPtr logger;
+
+    AsyncLogSinkTest()
+      : loggingSystem(createLoggingSystem())
+    {
+      temp::initialize("test");
+      logger = loggingSystem->getLogger("aptitude.test");
+      logger->setLevel(TRACE_LEVEL);
+    }
+
+    ~AsyncLogSinkTest()
+    {
+      temp::shutdown();
+    }
+
+    static std::vector<std::string> read_lines(const std::string &filename)
+    {
+      std::vector<std::string> rval;
+      std::ifstream in(filename.c_str());
+      std::string line;
+      while(std::getline(in, line))
+        rval.push_back(line);
+
+      return rval;
+    }
+
+    // Logs one message from a thread of its own.
+    struct log_from_thread
+    {
+      LoggerPtr logger;
+      std::string msg;
+
+      log_from_thread(const LoggerPtr &_logger, const std::string &_msg)
+        : logger(_logger), msg(_msg)
+      {
+      }
+
+      void operator()() const
+      {
+        LOG_INFO(logger, msg);
+      }
+    };
+
+    static bool ends_with(const std::string &s, const std::string &suffix)
+    {
+      return
+        s.size() >= suffix.size() &&
+        s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+  };
+}
+
+TEST_F(AsyncLogSinkTest, testMessagesAreWrittenInOrder)
+{
+  temp::name name("log");
+  shared_ptr<async_log_sink> sink = create_async_log_sink(name.get_name());
+
+  loggingSystem->getLogger("")
+    ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+
+  LOG_INFO(logger, "first");
+  LOG_TRACE(logger, "second");
+  sink->flush();
+
+  std::vector<std::string> lines = read_lines(name.get_name());
+  ASSERT_EQ(2U, lines.size());
+  EXPECT_TRUE(ends_with(lines[0], "INFO aptitude.test - first")) << lines[0];
+  EXPECT_TRUE(ends_with(lines[1], "TRACE aptitude.test - second")) << lines[1];
+
+  async_log_sink_stats stats = sink->get_stats();
+  EXPECT_EQ(2U, stats.written);
+  EXPECT_EQ(0U, stats.dropped);
+}
+
+TEST_F(AsyncLogSinkTest, testDestroyingTheSinkFlushes)
+{
+  temp::name name("log");
+
+  {
+    shared_ptr<async_log_sink> sink = create_async_log_sink(name.get_name());
+
+    loggingSystem->getLogger("")
+      ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+
+    LOG_INFO(logger, "message");
+  }
+
+  // The sink is trackable, so this shouldn't go anywhere.
+  LOG_INFO(logger, "after the sink was destroyed");
+
+  std::vector<std::string> lines = read_lines(name.get_name());
+  ASSERT_EQ(1U, lines.size());
+  EXPECT_TRUE(ends_with(lines[0], " - message")) << lines[0];
+}
+
+TEST_F(AsyncLogSinkTest, testOverflowDropsMessages)
+{
+  temp::name name("log");
+  // Use a long flush interval so that the writer doesn't drain the
+  // ring while we're filling it up.
+  shared_ptr<async_log_sink> sink =
+    create_async_log_sink(name.get_name(), 4096, 60 * 1000);
+
+  loggingSystem->getLogger("")
+    ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+
+  const std::string payload(1000, 'x');
+  for(int i = 0; i < 10; ++i)
+    LOG_INFO(logger, payload);
+
+  sink->flush();
+
+  async_log_sink_stats stats = sink->get_stats();
+  EXPECT_LT(0U, stats.written);
+  EXPECT_LT(0U, stats.dropped);
+  EXPECT_EQ(10U, stats.written + stats.dropped);
+
+  std::vector<std::string> lines = read_lines(name.get_name());
+  ASSERT_EQ(stats.written + 1, lines.size());
+  EXPECT_NE(std::string::npos, lines.back().find("log messages dropped"));
+}
+
+TEST_F(AsyncLogSinkTest, testMessagesFromExitedThreadsAreWritten)
+{
+  temp::name name("log");
+  shared_ptr<async_log_sink> sink = create_async_log_sink(name.get_name());
+
+  loggingSystem->getLogger("")
+    ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+
+  // Each thread's ring is given up when it exits; what it logged
+  // must still reach the file.
+  for(int i = 0; i < 3; ++i)
+    {
+      cwidget::threads::thread t(log_from_thread(logger, "from a thread"));
+      t.join();
+    }
+
+  sink->flush();
+
+  std::vector<std::string> lines = read_lines(name.get_name());
+  ASSERT_EQ(3U, lines.size());
+  for(std::vector<std::string>::const_iterator it = lines.begin();
+      it != lines.end(); ++it)
+    EXPECT_TRUE(ends_with(*it, " - from a thread")) << *it;
+
+  async_log_sink_stats stats = sink->get_stats();
+  EXPECT_EQ(3U, stats.written);
+  EXPECT_EQ(0U, stats.dropped);
+}
+
+TEST_F(AsyncLogSinkTest, testUnwrittenMessagesAreNotCounted)
+{
+  shared_ptr<async_log_sink> sink =
+    create_async_log_sink("/nonexistent/aptitude-test/log");
+
+  loggingSystem->getLogger("")
+    ->connect_message_logged(sigc::mem_fun(*sink, &async_log_sink::log_message));
+
+  LOG_INFO(logger, "lost");
+  sink->flush();
+
+  async_log_sink_stats stats = sink->get_stats();
+  EXPECT_EQ(0U, stats.written);
+  EXPECT_EQ(0U, stats.batches);
+}
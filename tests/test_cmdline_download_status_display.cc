@@ -22,9 +22,11 @@
 #include <cmdline/mocks/terminal.h>
 #include <cmdline/mocks/transient_message.h>
 
+#include <generic/util/mocks/throttle.h>
 #include <generic/views/download_progress.h>
 
 // System includes:
+#include <boost/function.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -39,8 +41,12 @@ using aptitude::views::download_progress;
 using boost::make_shared;
 using boost::optional;
 using boost::shared_ptr;
+using testing::AnyNumber;
+using testing::InSequence;
 using testing::Return;
+using testing::SaveArg;
 using testing::StrEq;
+using testing::Test;
 using testing::TestWithParam;
 using testing::Values;
 using testing::_;
@@ -52,6 +58,11 @@ namespace mocks
   using namespace aptitude::cmdline::mocks;
 }
 
+namespace util_mocks
+{
+  using namespace aptitude::util::mocks;
+}
+
 namespace
 {
   // We pretend this character occupies two cells and all the rest
@@ -545,3 +556,89 @@ INSTANTIATE_TEST_CASE_P(WithStatus,
 INSTANTIATE_TEST_CASE_P(WithoutStatus,
                         CmdlineDownloadStatusDisplayTest,
                         Values(true));
+
+namespace
+{
+  struct CmdlineThrottledDownloadStatusDisplayTest : public Test
+  {
+    typedef download_progress::status status;
+    typedef download_progress::status::worker_status worker_status;
+
+    shared_ptr<mocks::transient_message> msg;
+    shared_ptr<mocks::terminal_locale> term_locale;
+    shared_ptr<mocks::terminal_metrics> term_metrics;
+    shared_ptr<util_mocks::throttle> throttle;
+    shared_ptr<download_status_display> status_display;
+
+    // The function the display asked the throttle to invoke when it
+    // expires.
+    boost::function<void ()> flush;
+
+    CmdlineThrottledDownloadStatusDisplayTest()
+      : msg(mocks::transient_message::create_strict()),
+        term_locale(mocks::terminal_locale::create_strict()),
+        term_metrics(mocks::terminal_metrics::create_strict()),
+        throttle(make_shared<util_mocks::throttle>()),
+        status_display(create_cmdline_download_status_display(msg,
+                                                              term_locale,
+                                                              term_metrics,
+                                                              false,
+                                                              throttle))
+    {
+      EXPECT_CALL(*throttle, reset_timer())
+        .Times(AnyNumber());
+      EXPECT_CALL(*throttle, call_when_expired(_))
+        .Times(AnyNumber())
+        .WillRepeatedly(SaveArg<0>(&flush));
+      EXPECT_CALL(*throttle, cancel_call())
+        .Times(AnyNumber());
+    }
+  };
+}
+
+TEST_F(CmdlineThrottledDownloadStatusDisplayTest, PendingStatusIsDrawnWhenThrottleExpires)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*throttle, update_required())
+      .WillOnce(Return(true));
+    EXPECT_CALL(*msg, set_text(StrEq(L"10% [Working]")));
+    EXPECT_CALL(*throttle, update_required())
+      .Times(2)
+      .WillRepeatedly(Return(false));
+    EXPECT_CALL(*msg, set_text(StrEq(L"30% [Working]")));
+  }
+
+  const std::vector<worker_status> no_files;
+  status_display->display_status(status(0, no_files, 0.1, 0));
+  status_display->display_status(status(0, no_files, 0.2, 0));
+  status_display->display_status(status(0, no_files, 0.3, 0));
+
+  ASSERT_FALSE(flush.empty());
+  flush();
+
+  // Nothing is left to draw.
+  flush();
+}
+
+TEST_F(CmdlineThrottledDownloadStatusDisplayTest, DiscardedStatusIsNotDrawn)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*throttle, update_required())
+      .WillOnce(Return(true));
+    EXPECT_CALL(*msg, set_text(StrEq(L"10% [Working]")));
+    EXPECT_CALL(*throttle, update_required())
+      .WillOnce(Return(false));
+  }
+
+  const std::vector<worker_status> no_files;
+  status_display->display_status(status(0, no_files, 0.1, 0));
+  status_display->display_status(status(0, no_files, 0.2, 0));
+  status_display->discard_pending();
+
+  ASSERT_FALSE(flush.empty());
+  flush();
+}
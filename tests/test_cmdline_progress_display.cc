@@ -24,10 +24,12 @@
 #include <cmdline/cmdline_progress_display.h>
 #include <cmdline/mocks/transient_message.h>
 
+#include <generic/util/mocks/throttle.h>
 #include <generic/util/progress_info.h>
 #include <generic/views/progress.h>
 
 // System includes:
+#include <boost/function.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -42,13 +44,18 @@ using testing::AnyNumber;
 using testing::AtMost;
 using testing::Expectation;
 using testing::HasSubstr;
+using testing::InSequence;
+using testing::Return;
+using testing::SaveArg;
 using testing::StrEq;
 using testing::StrNe;
+using testing::Test;
 using testing::TestWithParam;
 using testing::Values;
 using testing::_;
 
 namespace mocks = aptitude::cmdline::mocks;
+namespace util_mocks = aptitude::util::mocks;
 namespace views = aptitude::views;
 
 namespace
@@ -631,3 +638,120 @@ INSTANTIATE_TEST_CASE_P(CmdlineProgressDisplayTestNewStyleAndRetainCompleted,
 INSTANTIATE_TEST_CASE_P(CmdlineProgressDisplayTestNewStyleAndNoRetainCompleted,
                         CmdlineProgressDisplayTest,
                         Values(CmdlineProgressDisplayParams(false, false)));
+
+namespace
+{
+  struct CmdlineThrottledProgressDisplayTest : public Test
+  {
+    shared_ptr<mocks::transient_message> msg;
+    shared_ptr<util_mocks::throttle> throttle;
+    shared_ptr<views::progress> progress;
+
+    // The function the display asked the throttle to invoke when it
+    // expires.
+    boost::function<void ()> flush;
+
+    CmdlineThrottledProgressDisplayTest()
+      : msg(mocks::transient_message::create_strict()),
+        throttle(make_shared<util_mocks::throttle>()),
+        progress(create_progress_display(msg, false, false, throttle))
+    {
+      EXPECT_CALL(*throttle, reset_timer())
+        .Times(AnyNumber());
+      EXPECT_CALL(*throttle, call_when_expired(_))
+        .Times(AnyNumber())
+        .WillRepeatedly(SaveArg<0>(&flush));
+      EXPECT_CALL(*throttle, cancel_call())
+        .Times(AnyNumber());
+    }
+  };
+}
+
+TEST_F(CmdlineThrottledProgressDisplayTest, FirstUpdateIsNotThrottled)
+{
+  EXPECT_CALL(*throttle, update_required())
+    .WillRepeatedly(Return(false));
+
+  EXPECT_CALL(*msg, set_text(StrEq(L"[ 10%] Counting sheep")));
+
+  progress->set_progress(progress_info::bar(0.1, "Counting sheep"));
+}
+
+TEST_F(CmdlineThrottledProgressDisplayTest, UpdatesAreCoalesced)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 10%] Counting sheep")));
+    EXPECT_CALL(*throttle, update_required())
+      .Times(2)
+      .WillRepeatedly(Return(false));
+    EXPECT_CALL(*throttle, update_required())
+      .WillOnce(Return(true));
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 40%] Counting sheep")));
+  }
+
+  progress->set_progress(progress_info::bar(0.1, "Counting sheep"));
+  progress->set_progress(progress_info::bar(0.2, "Counting sheep"));
+  progress->set_progress(progress_info::bar(0.3, "Counting sheep"));
+  progress->set_progress(progress_info::bar(0.4, "Counting sheep"));
+}
+
+TEST_F(CmdlineThrottledProgressDisplayTest, PendingUpdateIsDrawnWhenThrottleExpires)
+{
+  EXPECT_CALL(*throttle, update_required())
+    .WillRepeatedly(Return(false));
+
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 10%] Counting sheep")));
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 30%] Counting sheep")));
+  }
+
+  progress->set_progress(progress_info::bar(0.1, "Counting sheep"));
+  progress->set_progress(progress_info::bar(0.2, "Counting sheep"));
+  progress->set_progress(progress_info::bar(0.3, "Counting sheep"));
+
+  ASSERT_FALSE(flush.empty());
+  flush();
+
+  // Nothing is left to draw.
+  flush();
+}
+
+TEST_F(CmdlineThrottledProgressDisplayTest, ChangingTypeIsNotThrottled)
+{
+  EXPECT_CALL(*throttle, update_required())
+    .WillRepeatedly(Return(false));
+
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*msg, set_text(StrEq(L"[----] Counting sheep")));
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 10%] Counting sheep")));
+  }
+
+  progress->set_progress(progress_info::pulse("Counting sheep"));
+  progress->set_progress(progress_info::bar(0.1, "Counting sheep"));
+}
+
+TEST_F(CmdlineThrottledProgressDisplayTest, DoneReportsPendingStatus)
+{
+  const shared_ptr<views::progress> retaining_progress =
+    create_progress_display(msg, false, true, throttle);
+
+  EXPECT_CALL(*throttle, update_required())
+    .WillRepeatedly(Return(false));
+
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*msg, set_text(StrEq(L"[ 10%] Counting sheep")));
+    EXPECT_CALL(*msg, display_and_advance(StrEq(L"[DONE] Counting goats")));
+  }
+
+  retaining_progress->set_progress(progress_info::bar(0.1, "Counting sheep"));
+  retaining_progress->set_progress(progress_info::bar(0.2, "Counting goats"));
+  retaining_progress->done();
+}
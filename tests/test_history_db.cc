@@ -0,0 +1,247 @@
+#include <boost/test/unit_test.hpp>
+
+#include <config.h>
+
+#include <generic/apt/history/history_db.h>
+#include <generic/util/temp.h>
+
+#include <sstream>
+
+using aptitude::history::action_record;
+using aptitude::history::find_database_path;
+using aptitude::history::history_db;
+using aptitude::history::history_query;
+using aptitude::history::make_action_record;
+using aptitude::history::parse_log_date;
+
+namespace
+{
+  class historyDbTest
+  {
+  public:
+    historyDbTest()
+    {
+      temp::initialize("testHistoryDb");
+    }
+
+    ~historyDbTest()
+    {
+      temp::shutdown();
+    }
+  };
+
+  const char *sample_log =
+    "Aptitude 0.6.3: log report\n"
+    "Mon, May 10 2010 21:15:02 -0700\n"
+    "\n"
+    "IMPORTANT: this log only lists intended actions; actions which fail due to\n"
+    "dpkg problems may not be completed.\n"
+    "\n"
+    "Will install 2 packages, and remove 1 packages.\n"
+    "===============================================================================\n"
+    "[REMOVE, NOT USED] libold\n"
+    "[INSTALL, DEPENDENCIES] libbar\n"
+    "[UPGRADE] libfoo 1.0-1 -> 1.1-1\n"
+    "===============================================================================\n"
+    "\n"
+    "Log complete.\n"
+    "Aptitude 0.6.3: log report\n"
+    "Tue, May 11 2010 08:00:00 +0000\n"
+    "\n"
+    "===============================================================================\n"
+    "[UPGRADE] libfoo 1.1-1 -> 1.2-1\n"
+    "[HOLD] baz\n"
+    "===============================================================================\n"
+    "\n"
+    "Log complete.\n";
+}
+
+BOOST_AUTO_TEST_CASE(historyParseLogDate)
+{
+  time_t t = 0;
+
+  BOOST_REQUIRE(parse_log_date("Tue, May 11 2010 08:00:00 +0000", t));
+  BOOST_CHECK_EQUAL(t, 1273564800);
+
+  BOOST_REQUIRE(parse_log_date("Mon, May 10 2010 21:15:02 -0700", t));
+  BOOST_CHECK_EQUAL(t, 1273551302);
+
+  BOOST_CHECK(!parse_log_date("Lun, mai 10 2010 21:15:02 -0700", t));
+  BOOST_CHECK(!parse_log_date("garbage", t));
+}
+
+BOOST_FIXTURE_TEST_CASE(historyAddAndFind, historyDbTest)
+{
+  temp::name tn("history");
+  boost::shared_ptr<history_db> db(history_db::create(tn.get_name()));
+
+  std::vector<action_record> run1;
+  run1.push_back(action_record(0, "libfoo", "install", "", ""));
+  run1.push_back(action_record(0, "bar", "install-auto", "", ""));
+  db->add_run(1000, "aptitude", run1);
+
+  std::vector<action_record> run2;
+  run2.push_back(action_record(0, "libfoo", "upgrade", "1.0", "1.1"));
+  db->add_run(2000, "aptitude", run2);
+
+  std::vector<action_record> results;
+  history_query q;
+  q.packages.push_back("libfoo");
+  db->find(q, results);
+
+  BOOST_REQUIRE_EQUAL(results.size(), 2U);
+  BOOST_CHECK_EQUAL(results[0].time, 1000);
+  BOOST_CHECK_EQUAL(results[0].action, "install");
+  BOOST_CHECK_EQUAL(results[1].time, 2000);
+  BOOST_CHECK_EQUAL(results[1].action, "upgrade");
+  BOOST_CHECK_EQUAL(results[1].old_version, "1.0");
+  BOOST_CHECK_EQUAL(results[1].new_version, "1.1");
+
+  results.clear();
+  q = history_query();
+  q.since = 1500;
+  db->find(q, results);
+  BOOST_REQUIRE_EQUAL(results.size(), 1U);
+  BOOST_CHECK_EQUAL(results[0].package, "libfoo");
+
+  results.clear();
+  q = history_query();
+  q.packages.push_back("b*");
+  q.until = 1500;
+  db->find(q, results);
+  BOOST_REQUIRE_EQUAL(results.size(), 1U);
+  BOOST_CHECK_EQUAL(results[0].package, "bar");
+
+  results.clear();
+  q = history_query();
+  q.action = "upgrade";
+  db->find(q, results);
+  BOOST_CHECK_EQUAL(results.size(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(historyImportLog, historyDbTest)
+{
+  temp::name tn("history");
+  boost::shared_ptr<history_db> db(history_db::create(tn.get_name()));
+
+  {
+    std::istringstream in(sample_log);
+    BOOST_CHECK_EQUAL(db->import_log(in), 2);
+  }
+
+  // Importing the same log twice doesn't duplicate anything.
+  {
+    std::istringstream in(sample_log);
+    BOOST_CHECK_EQUAL(db->import_log(in), 0);
+  }
+
+  std::vector<action_record> results;
+  history_query q;
+  q.packages.push_back("libfoo");
+  db->find(q, results);
+
+  BOOST_REQUIRE_EQUAL(results.size(), 2U);
+  BOOST_CHECK_EQUAL(results[0].time, 1273551302);
+  BOOST_CHECK_EQUAL(results[0].old_version, "1.0-1");
+  BOOST_CHECK_EQUAL(results[1].time, 1273564800);
+  BOOST_CHECK_EQUAL(results[1].new_version, "1.2-1");
+
+  results.clear();
+  q = history_query();
+  q.action = "remove-unused";
+  db->find(q, results);
+  BOOST_REQUIRE_EQUAL(results.size(), 1U);
+  BOOST_CHECK_EQUAL(results[0].package, "libold");
+}
+
+BOOST_FIXTURE_TEST_CASE(historyReopen, historyDbTest)
+{
+  temp::name tn("history");
+
+  {
+    boost::shared_ptr<history_db> db(history_db::create(tn.get_name()));
+    db->add_run(1000, "aptitude",
+		std::vector<action_record>(1, action_record(0, "foo", "remove", "", "")));
+  }
+
+  boost::shared_ptr<history_db> db(history_db::create(tn.get_name(), true));
+  std::vector<action_record> results;
+  db->find(history_query(), results);
+  BOOST_CHECK_EQUAL(results.size(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(historyRemoveHasNoNewVersion, historyDbTest)
+{
+  temp::name tn("history");
+  boost::shared_ptr<history_db> db(history_db::create(tn.get_name()));
+
+  std::vector<action_record> run;
+  run.push_back(make_action_record(0, "foo", "remove", "1.0", "1.1"));
+  run.push_back(make_action_record(0, "bar", "hold", "2.0", "2.1"));
+  run.push_back(make_action_record(0, "baz", "upgrade", "3.0", "3.1"));
+  db->add_run(1000, "aptitude", run);
+
+  std::vector<action_record> results;
+  db->find(history_query(), results);
+
+  BOOST_REQUIRE_EQUAL(results.size(), 3U);
+  // Ordered by package name.
+  BOOST_CHECK_EQUAL(results[0].package, "bar");
+  BOOST_CHECK_EQUAL(results[0].old_version, "2.0");
+  BOOST_CHECK_EQUAL(results[0].new_version, "");
+  BOOST_CHECK_EQUAL(results[1].package, "baz");
+  BOOST_CHECK_EQUAL(results[1].new_version, "3.1");
+  BOOST_CHECK_EQUAL(results[2].package, "foo");
+  BOOST_CHECK_EQUAL(results[2].action, "remove");
+  BOOST_CHECK_EQUAL(results[2].old_version, "1.0");
+  BOOST_CHECK_EQUAL(results[2].new_version, "");
+}
+
+BOOST_FIXTURE_TEST_CASE(historyOverlappingPatterns, historyDbTest)
+{
+  temp::name tn("history");
+  boost::shared_ptr<history_db> db(history_db::create(tn.get_name()));
+
+  std::vector<action_record> run1;
+  run1.push_back(action_record(0, "libfoo", "install", "", "1.0"));
+  run1.push_back(action_record(0, "bar", "install", "", "2.0"));
+  db->add_run(1000, "aptitude", run1);
+
+  std::vector<action_record> run2;
+  run2.push_back(action_record(0, "libfoo", "remove", "1.0", ""));
+  db->add_run(2000, "aptitude", run2);
+
+  // Both patterns match libfoo; each of its rows is returned once.
+  std::vector<action_record> results;
+  history_query q;
+  q.packages.push_back("lib*");
+  q.packages.push_back("*foo");
+  q.packages.push_back("bar");
+  db->find(q, results);
+
+  BOOST_REQUIRE_EQUAL(results.size(), 3U);
+  BOOST_CHECK_EQUAL(results[0].time, 1000);
+  BOOST_CHECK_EQUAL(results[0].package, "bar");
+  BOOST_CHECK_EQUAL(results[1].time, 1000);
+  BOOST_CHECK_EQUAL(results[1].package, "libfoo");
+  BOOST_CHECK_EQUAL(results[2].time, 2000);
+  BOOST_CHECK_EQUAL(results[2].action, "remove");
+}
+
+BOOST_AUTO_TEST_CASE(historyDatabasePath)
+{
+  const char * const name = PACKAGE "::History::Database";
+
+  Configuration config;
+  BOOST_CHECK_EQUAL(find_database_path(config, "/default/history.db"),
+		    "/default/history.db");
+
+  config.Set(name, "/elsewhere/history.db");
+  BOOST_CHECK_EQUAL(find_database_path(config, "/default/history.db"),
+		    "/elsewhere/history.db");
+
+  // An empty value disables the database.
+  config.Set(name, "");
+  BOOST_CHECK_EQUAL(find_database_path(config, "/default/history.db"),
+		    "");
+}
@@ -0,0 +1,126 @@
+/** \file test_json_record.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/json_record.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+using aptitude::util::append_json_string;
+using aptitude::util::json_record;
+
+TEST(JsonRecord, Empty)
+{
+  json_record rec;
+
+  EXPECT_EQ("{}", rec.str());
+}
+
+TEST(JsonRecord, Fields)
+{
+  json_record rec;
+
+  rec.add_string("package", "aptitude");
+  rec.add_number("size", -42);
+  rec.add_bool("automatic", true);
+  rec.add_null("installed");
+  rec.add_string_or_null("candidate", NULL);
+
+  std::vector<std::string> archives;
+  archives.push_back("unstable");
+  archives.push_back("experimental");
+  rec.add_string_list("archives", archives);
+
+  EXPECT_EQ("{\"package\":\"aptitude\",\"size\":-42,\"automatic\":true,"
+            "\"installed\":null,\"candidate\":null,"
+            "\"archives\":[\"unstable\",\"experimental\"]}",
+            rec.str());
+}
+
+TEST(JsonRecord, Nested)
+{
+  json_record inner;
+  inner.add_string("x", "y");
+
+  json_record outer;
+  outer.add_raw("inner", inner.str());
+
+  EXPECT_EQ("{\"inner\":{\"x\":\"y\"}}", outer.str());
+}
+
+TEST(JsonRecord, Clear)
+{
+  json_record rec;
+  rec.add_bool("a", false);
+  rec.clear();
+  rec.add_bool("b", true);
+
+  EXPECT_EQ("{\"b\":true}", rec.str());
+}
+
+TEST(JsonRecord, EscapeString)
+{
+  const std::string input("a\"b\\c\nd\te\x01" "f\xc3\xa9");
+  std::string output;
+  append_json_string(output, input.data(), input.data() + input.size());
+
+  EXPECT_EQ("\"a\\\"b\\\\c\\nd\\te\\u0001f\xc3\xa9\"", output);
+}
+
+TEST(JsonRecord, EscapeInvalidUtf8)
+{
+  // A Latin-1 maintainer name, a truncated sequence, an overlong
+  // encoding of '/', an encoded surrogate and a stray continuation
+  // byte; each bad byte becomes U+FFFD.
+  const std::string input("Ren\xe9" " \xc3" " \xc0\xaf" " \xed\xa0\x80" " \x80");
+  std::string output;
+  append_json_string(output, input.data(), input.data() + input.size());
+
+  EXPECT_EQ("\"Ren\xef\xbf\xbd"
+            " \xef\xbf\xbd"
+            " \xef\xbf\xbd\xef\xbf\xbd"
+            " \xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd"
+            " \xef\xbf\xbd\"", output);
+}
+
+TEST(JsonRecord, NonUtf8Record)
+{
+  // Raw package records are passed straight through; they must not
+  // produce invalid JSON.
+  const std::string maintainer("Jos\xe9 Garc\xed" "a <jose@example.org>");
+
+  json_record rec;
+  rec.add_string("package", "foo");
+  rec.add_string("maintainer", maintainer.data(),
+                 maintainer.data() + maintainer.size());
+
+  EXPECT_EQ("{\"package\":\"foo\","
+            "\"maintainer\":\"Jos\xef\xbf\xbd" " Garc\xef\xbf\xbd" "a <jose@example.org>\"}",
+            rec.str());
+}
+
+TEST(JsonRecord, EscapeWideString)
+{
+  std::string output;
+  append_json_string(output, std::wstring(L"\"\x00e9\x20ac\x1f600\n"));
+
+  EXPECT_EQ("\"\\\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\\n\"", output);
+}
@@ -0,0 +1,134 @@
+/** \file test_lazy_rows.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/lazy_rows.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using aptitude::util::lazy_rows;
+
+namespace
+{
+  std::vector<unsigned long> make_batch(unsigned long first,
+                                        unsigned long last)
+  {
+    std::vector<unsigned long> rval;
+    for(unsigned long id = first; id < last; ++id)
+      rval.push_back(id);
+
+    return rval;
+  }
+}
+
+TEST(LazyRowsTest, AppendInBatches)
+{
+  lazy_rows rows(10);
+
+  EXPECT_TRUE(rows.empty());
+  EXPECT_EQ(0U, rows.append(make_batch(5, 8)));
+  EXPECT_EQ(3U, rows.append(make_batch(0, 2)));
+
+  ASSERT_EQ(5U, rows.size());
+  EXPECT_EQ(5UL, rows.get_id(0));
+  EXPECT_EQ(7UL, rows.get_id(2));
+  EXPECT_EQ(0UL, rows.get_id(3));
+  EXPECT_EQ(1UL, rows.get_id(4));
+
+  EXPECT_TRUE(rows.contains(6));
+  EXPECT_FALSE(rows.contains(3));
+  EXPECT_EQ(0U, rows.get_num_filled());
+}
+
+TEST(LazyRowsTest, DuplicatesAreSkipped)
+{
+  lazy_rows rows;
+
+  rows.append(make_batch(0, 3));
+  EXPECT_EQ(3U, rows.append(make_batch(2, 5)));
+  EXPECT_EQ(5U, rows.size());
+  EXPECT_EQ(3UL, rows.get_id(3));
+}
+
+TEST(LazyRowsTest, IdsBeyondTheHintGrowTheTables)
+{
+  lazy_rows rows(2);
+
+  rows.append(make_batch(100, 101));
+  EXPECT_TRUE(rows.contains(100));
+  EXPECT_FALSE(rows.contains(1000));
+  EXPECT_FALSE(rows.is_filled(1000));
+  EXPECT_TRUE(rows.claim(100));
+}
+
+TEST(LazyRowsTest, ClaimFillsEachRowOnce)
+{
+  lazy_rows rows(10);
+  rows.append(make_batch(0, 4));
+
+  EXPECT_TRUE(rows.claim(2));
+  EXPECT_FALSE(rows.claim(2));
+  EXPECT_TRUE(rows.is_filled(2));
+  EXPECT_FALSE(rows.is_filled(1));
+  EXPECT_EQ(1U, rows.get_num_filled());
+
+  // IDs that aren't in the list are never claimed.
+  EXPECT_FALSE(rows.claim(8));
+  EXPECT_EQ(1U, rows.get_num_filled());
+}
+
+TEST(LazyRowsTest, Invalidate)
+{
+  lazy_rows rows(10);
+  rows.append(make_batch(0, 4));
+
+  rows.claim(0);
+  rows.claim(1);
+  rows.claim(3);
+
+  rows.invalidate(1);
+  rows.invalidate(2);
+  EXPECT_EQ(2U, rows.get_num_filled());
+  EXPECT_TRUE(rows.claim(1));
+
+  rows.invalidate_all();
+  EXPECT_EQ(0U, rows.get_num_filled());
+  for(unsigned long id = 0; id < 4; ++id)
+    EXPECT_TRUE(rows.claim(id));
+}
+
+TEST(LazyRowsTest, Clear)
+{
+  lazy_rows rows(10);
+  rows.append(make_batch(0, 4));
+  rows.claim(1);
+
+  rows.clear();
+  EXPECT_TRUE(rows.empty());
+  EXPECT_EQ(0U, rows.get_num_filled());
+  EXPECT_FALSE(rows.contains(1));
+  EXPECT_FALSE(rows.is_filled(1));
+
+  rows.append(make_batch(1, 2));
+  EXPECT_TRUE(rows.claim(1));
+}
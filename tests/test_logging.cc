@@ -503,3 +503,21 @@ TEST_F(LoggingTest, testLogTrace)
   root->setLevel(TRACE_LEVEL);
   LOG_TRACE(root, msg1);
 }
+
+TEST_F(LoggingTest, testAnyLoggerEnabledFor)
+{
+  using aptitude::util::logging::anyLoggerEnabledFor;
+
+  LoggerPtr root = getLogger("");
+  LoggerPtr child = getLogger("a.b");
+
+  root->setLevel(TRACE_LEVEL);
+  EXPECT_TRUE(anyLoggerEnabledFor(TRACE_LEVEL));
+  EXPECT_TRUE(LOG_ENABLED(TRACE_LEVEL, child));
+
+  // Some other logging system might have loggers enabled, so only
+  // the per-logger check can be tested in the negative.
+  child->setLevel(OFF_LEVEL);
+  EXPECT_FALSE(LOG_ENABLED(TRACE_LEVEL, child));
+  EXPECT_TRUE(LOG_ENABLED(FATAL_LEVEL, root));
+}
@@ -0,0 +1,239 @@
+/** \file test_ordered_strategies.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/ordered_strategies.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <sched.h>
+
+using aptitude::util::ordered_strategies;
+
+namespace
+{
+  typedef ordered_strategies<int> int_strategies;
+
+  // How many times a strategy that waits for something checks for
+  // it before giving up, so that a broken runner fails the test
+  // instead of hanging it.
+  const int max_polls = 1000000;
+
+  /** \brief A strategy that produces a fixed list of results, giving
+   *  other threads a chance to run before each one.
+   */
+  class fixed_strategy
+  {
+    const std::vector<std::vector<int> > *results;
+
+  public:
+    fixed_strategy(const std::vector<std::vector<int> > *_results)
+      : results(_results)
+    {
+    }
+
+    void operator()(int_strategies::context &c) const
+    {
+      const std::vector<int> &mine((*results)[c.get_index()]);
+
+      for(std::vector<int>::const_iterator it = mine.begin();
+          it != mine.end() && !c.is_canceled(); ++it)
+        {
+          sched_yield();
+          if(!c.add_result(*it))
+            return;
+        }
+    }
+  };
+
+  /** \brief Collect the results of a run strongest first, stopping at
+   *  the first one unless every result is wanted, as
+   *  find_best_justification() does.
+   */
+  std::vector<int> combine(const int_strategies &strategies, bool find_all)
+  {
+    std::vector<int> rval;
+
+    for(int i = 0; i < strategies.size(); ++i)
+      {
+        const std::vector<int> &results(strategies.get_results(i));
+        for(std::vector<int>::const_iterator it = results.begin();
+            it != results.end(); ++it)
+          {
+            rval.push_back(*it);
+            if(!find_all)
+              return rval;
+          }
+      }
+
+    return rval;
+  }
+
+  std::vector<int> run_fixed(const std::vector<std::vector<int> > &results,
+                             bool find_all, int num_threads)
+  {
+    int_strategies strategies(results.size(), find_all);
+    strategies.run(fixed_strategy(&results), num_threads);
+    return combine(strategies, find_all);
+  }
+
+  // Strategy 0 waits until strategy 1 has succeeded, then succeeds
+  // itself; strategy 1 succeeds at once.
+  volatile int weaker_succeeded;
+
+  void stronger_finishes_last(int_strategies::context &c)
+  {
+    if(c.get_index() == 0)
+      {
+        for(int i = 0; i < max_polls && !weaker_succeeded; ++i)
+          sched_yield();
+
+        c.add_result(0);
+      }
+    else
+      {
+        c.add_result(c.get_index());
+        __sync_lock_test_and_set(&weaker_succeeded, 1);
+      }
+  }
+
+  // Strategy 0 succeeds at once; the others wait until they are
+  // canceled, and succeed if they never are.
+  void weaker_waits_for_cancel(int_strategies::context &c)
+  {
+    if(c.get_index() == 0)
+      {
+        c.add_result(0);
+        return;
+      }
+
+    for(int i = 0; i < max_polls && !c.is_canceled(); ++i)
+      sched_yield();
+
+    if(!c.is_canceled())
+      c.add_result(c.get_index());
+  }
+}
+
+TEST(OrderedStrategies, ParallelMatchesSerial)
+{
+  std::vector<std::vector<int> > results(8);
+  results[2].push_back(20);
+  results[2].push_back(21);
+  results[5].push_back(50);
+  results[6].push_back(60);
+  results[6].push_back(61);
+  results[6].push_back(62);
+
+  for(int find_all = 0; find_all < 2; ++find_all)
+    {
+      const std::vector<int> serial = run_fixed(results, find_all, 1);
+
+      if(find_all)
+        {
+          const int expected[] = { 20, 21, 50, 60, 61, 62 };
+          EXPECT_EQ(std::vector<int>(expected, expected + sizeof(expected) / sizeof(expected[0])),
+                    serial);
+        }
+      else
+        EXPECT_EQ(std::vector<int>(1, 20), serial);
+
+      for(int num_threads = 2; num_threads <= 8; num_threads *= 2)
+        for(int attempt = 0; attempt < 20; ++attempt)
+          EXPECT_EQ(serial, run_fixed(results, find_all, num_threads))
+            << "With " << num_threads << " threads"
+            << (find_all ? ", finding every result" : "");
+    }
+}
+
+TEST(OrderedStrategies, NothingFound)
+{
+  std::vector<std::vector<int> > results(4);
+
+  EXPECT_TRUE(run_fixed(results, false, 1).empty());
+  EXPECT_TRUE(run_fixed(results, false, 4).empty());
+}
+
+TEST(OrderedStrategies, SerialSkipsWeakerStrategies)
+{
+  std::vector<std::vector<int> > results(3);
+  results[0].push_back(1);
+  results[1].push_back(2);
+  results[2].push_back(3);
+
+  int_strategies strategies(results.size(), false);
+  strategies.run(fixed_strategy(&results), 1);
+
+  EXPECT_EQ(std::vector<int>(1, 1), strategies.get_results(0));
+  EXPECT_TRUE(strategies.get_results(1).empty());
+  EXPECT_TRUE(strategies.get_results(2).empty());
+  EXPECT_FALSE(strategies.is_canceled(0));
+  EXPECT_TRUE(strategies.is_canceled(1));
+  EXPECT_TRUE(strategies.is_canceled(2));
+}
+
+TEST(OrderedStrategies, SuccessCancelsWeakerStrategies)
+{
+  int_strategies strategies(4, false);
+  strategies.run(&weaker_waits_for_cancel, 4);
+
+  EXPECT_EQ(std::vector<int>(1, 0), strategies.get_results(0));
+  EXPECT_FALSE(strategies.is_canceled(0));
+  for(int i = 1; i < strategies.size(); ++i)
+    {
+      EXPECT_TRUE(strategies.is_canceled(i)) << "Strategy " << i;
+      EXPECT_TRUE(strategies.get_results(i).empty()) << "Strategy " << i;
+    }
+}
+
+TEST(OrderedStrategies, SuccessDoesNotCancelStrongerStrategies)
+{
+  weaker_succeeded = 0;
+
+  int_strategies strategies(2, false);
+  strategies.run(&stronger_finishes_last, 2);
+
+  // Strategy 1 finished first, and was canceled afterwards.
+  EXPECT_FALSE(strategies.is_canceled(0));
+  EXPECT_TRUE(strategies.is_canceled(1));
+  EXPECT_EQ(std::vector<int>(1, 1), strategies.get_results(1));
+  EXPECT_EQ(std::vector<int>(1, 0), strategies.get_results(0));
+  EXPECT_EQ(std::vector<int>(1, 0), combine(strategies, false));
+}
+
+TEST(OrderedStrategies, FindAllCancelsNothing)
+{
+  std::vector<std::vector<int> > results(3);
+  results[0].push_back(0);
+  results[1].push_back(1);
+  results[2].push_back(2);
+
+  int_strategies strategies(results.size(), true);
+  strategies.run(fixed_strategy(&results), 3);
+
+  for(int i = 0; i < strategies.size(); ++i)
+    {
+      EXPECT_FALSE(strategies.is_canceled(i)) << "Strategy " << i;
+      EXPECT_EQ(results[i], strategies.get_results(i)) << "Strategy " << i;
+    }
+}
@@ -0,0 +1,110 @@
+/** \file test_output_buffer.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/output_buffer.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <locale.h>
+
+using aptitude::util::output_buffer;
+
+namespace
+{
+  struct OutputBufferTest : public testing::Test
+  {
+    FILE *f;
+
+    OutputBufferTest()
+      : f(tmpfile())
+    {
+    }
+
+    ~OutputBufferTest()
+    {
+      fclose(f);
+    }
+
+    // Return everything that has reached the file so far.
+    std::string contents()
+    {
+      fflush(f);
+      rewind(f);
+
+      std::string rval;
+      int c;
+      while((c = getc(f)) != EOF)
+        rval.push_back(static_cast<char>(c));
+
+      return rval;
+    }
+  };
+}
+
+TEST_F(OutputBufferTest, WritesOnFlush)
+{
+  output_buffer out(f);
+
+  out.write_line(L"abc");
+  out.write(std::string("def"));
+  out.put('\n');
+  EXPECT_EQ("", contents());
+
+  out.flush();
+  EXPECT_EQ("abc\ndef\n", contents());
+}
+
+TEST_F(OutputBufferTest, WritesOnDestruction)
+{
+  {
+    output_buffer out(f);
+    out.write_line(L"abc");
+  }
+
+  EXPECT_EQ("abc\n", contents());
+}
+
+TEST_F(OutputBufferTest, WritesAtThreshold)
+{
+  output_buffer out(f, 4);
+
+  out.write(L"abc");
+  EXPECT_EQ("", contents());
+
+  out.write(L"de");
+  EXPECT_EQ("abcde", contents());
+}
+
+TEST_F(OutputBufferTest, UnrepresentableCharacters)
+{
+  const std::string old_locale(setlocale(LC_CTYPE, NULL));
+  setlocale(LC_CTYPE, "C");
+
+  {
+    output_buffer out(f);
+    out.write_line(L"a\x00e9z");
+  }
+
+  setlocale(LC_CTYPE, old_locale.c_str());
+
+  EXPECT_EQ("a?z\n", contents());
+}
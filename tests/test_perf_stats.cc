@@ -0,0 +1,225 @@
+/** \file test_perf_stats.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/perf_stats.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace stats = aptitude::util::stats;
+
+namespace
+{
+  stats::counter test_counter("test.counter");
+  stats::counter unused_counter("test.unused-counter");
+  stats::timer fast_timer("test.fast-timer");
+  stats::timer slow_timer("test.slow-timer");
+  stats::timer unused_timer("test.unused-timer");
+  stats::timer sample_timer("test.sample-timer");
+  stats::histogram sample_histogram("test.histogram");
+  stats::histogram overflow_histogram("test.overflow-histogram");
+  stats::queue_stats test_queue("test.queue");
+
+  // Capture the output of a report function.
+  std::string capture(void (*report)(FILE *))
+  {
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&buf, &size);
+    report(out);
+    fclose(out);
+
+    const std::string rval(buf, size);
+    free(buf);
+    return rval;
+  }
+}
+
+TEST(PerfStats, CounterAdd)
+{
+  const unsigned long long start = test_counter.get_value();
+
+  test_counter.add();
+  test_counter.add(4);
+
+  EXPECT_EQ(start + 5, test_counter.get_value());
+}
+
+TEST(PerfStats, TimerSamples)
+{
+  sample_timer.add_sample(10);
+  sample_timer.add_sample(30);
+  sample_timer.add_sample(20);
+
+  EXPECT_EQ(3U, sample_timer.get_calls());
+  EXPECT_EQ(60U, sample_timer.get_total_usec());
+  EXPECT_EQ(30U, sample_timer.get_max_usec());
+}
+
+TEST(PerfStats, ScopedTimerDisabled)
+{
+  stats::set_enabled(false);
+  const unsigned long long start = fast_timer.get_calls();
+
+  {
+    stats::scoped_timer t(fast_timer);
+  }
+
+  EXPECT_EQ(start, fast_timer.get_calls());
+}
+
+TEST(PerfStats, ScopedTimerEnabled)
+{
+  stats::set_enabled(true);
+  const unsigned long long start = fast_timer.get_calls();
+
+  {
+    stats::scoped_timer t(fast_timer);
+  }
+
+  stats::set_enabled(false);
+  EXPECT_EQ(start + 1, fast_timer.get_calls());
+}
+
+TEST(PerfStats, TextReport)
+{
+  test_counter.add();
+  fast_timer.add_sample(1);
+  slow_timer.add_sample(5000000);
+
+  const std::string report = capture(&stats::write_text_report);
+
+  const std::string::size_type slow = report.find("test.slow-timer");
+  const std::string::size_type fast = report.find("test.fast-timer");
+  ASSERT_NE(std::string::npos, slow);
+  ASSERT_NE(std::string::npos, fast);
+  // Slowest first.
+  EXPECT_LT(slow, fast);
+
+  EXPECT_NE(std::string::npos, report.find("test.counter"));
+  EXPECT_EQ(std::string::npos, report.find("test.unused-counter"));
+  EXPECT_EQ(std::string::npos, report.find("test.unused-timer"));
+}
+
+TEST(PerfStats, JsonReport)
+{
+  slow_timer.add_sample(5000000);
+
+  const std::string report = capture(&stats::write_json_report);
+
+  ASSERT_FALSE(report.empty());
+  EXPECT_EQ('{', report[0]);
+  EXPECT_EQ('\n', report[report.size() - 1]);
+  EXPECT_NE(std::string::npos, report.find("\"test.slow-timer\":{\"calls\":"));
+  EXPECT_EQ(std::string::npos, report.find("test.unused-timer"));
+}
+
+TEST(PerfStats, HistogramBuckets)
+{
+  EXPECT_EQ(0, stats::histogram::bucket_of(0));
+  EXPECT_EQ(1, stats::histogram::bucket_of(1));
+  EXPECT_EQ(2, stats::histogram::bucket_of(2));
+  EXPECT_EQ(2, stats::histogram::bucket_of(3));
+  EXPECT_EQ(3, stats::histogram::bucket_of(4));
+  EXPECT_EQ(stats::histogram::num_buckets - 1,
+            stats::histogram::bucket_of(~0ULL));
+
+  EXPECT_EQ(0U, stats::histogram::bucket_upper_bound(0));
+  EXPECT_EQ(3U, stats::histogram::bucket_upper_bound(2));
+}
+
+TEST(PerfStats, HistogramSamples)
+{
+  EXPECT_EQ(0U, sample_histogram.estimate_quantile(0.5));
+
+  for(int i = 0; i < 9; ++i)
+    sample_histogram.add_sample(1);
+  sample_histogram.add_sample(100);
+
+  EXPECT_EQ(10U, sample_histogram.get_count());
+  EXPECT_EQ(109U, sample_histogram.get_total());
+  EXPECT_EQ(100U, sample_histogram.get_max());
+  EXPECT_EQ(9U, sample_histogram.get_bucket(1));
+  EXPECT_EQ(1U, sample_histogram.get_bucket(7));
+
+  EXPECT_EQ(1U, sample_histogram.estimate_quantile(0.5));
+  EXPECT_EQ(1U, sample_histogram.estimate_quantile(0.9));
+  EXPECT_EQ(100U, sample_histogram.estimate_quantile(0.99));
+}
+
+TEST(PerfStats, HistogramOverflowQuantile)
+{
+  // Larger than anything but the last bucket can hold.
+  const unsigned long long huge = (1ULL << 31) + 12345;
+
+  overflow_histogram.add_sample(1);
+  overflow_histogram.add_sample(huge);
+
+  EXPECT_EQ(1U, overflow_histogram.get_bucket(stats::histogram::num_buckets - 1));
+  EXPECT_EQ(1U, overflow_histogram.estimate_quantile(0.5));
+  EXPECT_EQ(huge, overflow_histogram.estimate_quantile(0.99));
+  EXPECT_EQ(huge, overflow_histogram.estimate_quantile(1));
+}
+
+TEST(PerfStats, HistogramReports)
+{
+  test_queue.depth.add_sample(3);
+
+  const std::string text = capture(&stats::write_text_report);
+  EXPECT_NE(std::string::npos, text.find("test.queue.queue-depth"));
+  EXPECT_EQ(std::string::npos, text.find("test.queue.wait-usec"));
+
+  const std::string json = capture(&stats::write_json_report);
+  EXPECT_NE(std::string::npos,
+            json.find("\"test.queue.queue-depth\":{\"count\":1,\"total\":3,"
+                      "\"max\":3,\"buckets\":[0,0,1]}"));
+}
+
+TEST(PerfStats, ScopedHistogramTimer)
+{
+  const unsigned long long start = test_queue.run_usec.get_count();
+
+  stats::set_enabled(true);
+  {
+    stats::scoped_histogram_timer t(test_queue.run_usec);
+  }
+
+  stats::set_enabled(false);
+  {
+    stats::scoped_histogram_timer t(test_queue.run_usec);
+  }
+
+  EXPECT_EQ(start + 1, test_queue.run_usec.get_count());
+}
+
+TEST(PerfStats, MeasurementDisabled)
+{
+  stats::set_enabled(false);
+
+  struct timeval tv;
+  EXPECT_FALSE(stats::start_measurement(tv));
+  EXPECT_EQ(0U, stats::usec_since(tv));
+}
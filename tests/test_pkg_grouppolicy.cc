@@ -0,0 +1,147 @@
+/** \file test_pkg_grouppolicy.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <pkg_grouppolicy.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+namespace
+{
+  // A factory that classifies packages itself and records the calls
+  // it receives.
+  class recording_factory : public pkg_grouppolicy_factory
+  {
+  public:
+    unsigned long prepared_size;
+    int num_prepared;
+    int num_classified;
+    int num_cleared;
+
+    recording_factory()
+      : prepared_size(0), num_prepared(0), num_classified(0), num_cleared(0)
+    {
+    }
+
+    pkg_grouppolicy *instantiate(pkg_signal *sig, desc_signal *desc_sig)
+    {
+      return NULL;
+    }
+
+    bool prepare_classify(unsigned long num_packages)
+    {
+      prepared_size = num_packages;
+      ++num_prepared;
+      return true;
+    }
+
+    void classify(const pkgCache::PkgIterator &pkg)
+    {
+      ++num_classified;
+    }
+
+    void clear_classify()
+    {
+      ++num_cleared;
+    }
+  };
+
+  // A factory that classifies nothing itself, like the filter and
+  // priority policies.
+  class chaining_factory : public pkg_grouppolicy_factory
+  {
+    pkg_grouppolicy_factory *chain;
+
+  public:
+    explicit chaining_factory(pkg_grouppolicy_factory *_chain)
+      : chain(_chain)
+    {
+    }
+
+    pkg_grouppolicy *instantiate(pkg_signal *sig, desc_signal *desc_sig)
+    {
+      return NULL;
+    }
+
+    bool prepare_classify(unsigned long num_packages);
+    void classify(const pkgCache::PkgIterator &pkg);
+    void clear_classify();
+  };
+
+  PKG_GROUPPOLICY_CLASSIFY_CHAIN(chaining_factory)
+
+  // A factory that doesn't override the classification calls.
+  class plain_factory : public pkg_grouppolicy_factory
+  {
+  public:
+    pkg_grouppolicy *instantiate(pkg_signal *sig, desc_signal *desc_sig)
+    {
+      return NULL;
+    }
+  };
+}
+
+TEST(PkgGroupPolicy, DefaultClassifiesNothing)
+{
+  plain_factory factory;
+
+  EXPECT_FALSE(factory.prepare_classify(100));
+  factory.classify(pkgCache::PkgIterator());
+  factory.clear_classify();
+}
+
+TEST(PkgGroupPolicy, ChainWithoutClassifierClassifiesNothing)
+{
+  plain_factory end;
+  chaining_factory middle(&end);
+  chaining_factory top(&middle);
+
+  EXPECT_FALSE(top.prepare_classify(100));
+}
+
+TEST(PkgGroupPolicy, ChainEndClassifiesNothing)
+{
+  chaining_factory top(NULL);
+
+  EXPECT_FALSE(top.prepare_classify(100));
+  top.classify(pkgCache::PkgIterator());
+  top.clear_classify();
+}
+
+TEST(PkgGroupPolicy, ChainPassesCallsOn)
+{
+  recording_factory classifier;
+  chaining_factory middle(&classifier);
+  chaining_factory top(&middle);
+
+  EXPECT_TRUE(top.prepare_classify(100));
+  EXPECT_EQ(1, classifier.num_prepared);
+  EXPECT_EQ(100U, classifier.prepared_size);
+
+  top.classify(pkgCache::PkgIterator());
+  top.classify(pkgCache::PkgIterator());
+  top.classify(pkgCache::PkgIterator());
+  EXPECT_EQ(3, classifier.num_classified);
+
+  EXPECT_EQ(0, classifier.num_cleared);
+  top.clear_classify();
+  EXPECT_EQ(1, classifier.num_cleared);
+}
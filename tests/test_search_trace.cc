@@ -0,0 +1,132 @@
+// test_search_trace.cc
+//
+//   Copyright (C) 2026 The aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//   Boston, MA 02111-1307, USA.
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <generic/problemresolver/search_trace.h>
+#include <generic/util/temp.h>
+
+#include <stdio.h>
+
+class SearchTraceTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(SearchTraceTest);
+
+  CPPUNIT_TEST(testRoundTrip);
+  CPPUNIT_TEST(testMultipleSegments);
+  CPPUNIT_TEST(testRejectGarbage);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp()
+  {
+    temp::initialize("test");
+  }
+
+  void tearDown()
+  {
+    temp::shutdown();
+  }
+
+  static void assertEvent(int type, int arg1, int arg2, int arg3,
+			  const search_trace_event &event)
+  {
+    CPPUNIT_ASSERT_EQUAL(type, event.type);
+    CPPUNIT_ASSERT_EQUAL(arg1, event.arg1);
+    CPPUNIT_ASSERT_EQUAL(arg2, event.arg2);
+    CPPUNIT_ASSERT_EQUAL(arg3, event.arg3);
+  }
+
+  void testRoundTrip()
+  {
+    temp::name name("trace");
+
+    {
+      boost::shared_ptr<search_trace_writer> writer =
+	search_trace_writer::open(name.get_name());
+      CPPUNIT_ASSERT(writer.get() != NULL);
+
+      writer->step_created(0, -1, 100);
+      writer->successor_generated(0, 1, 17);
+      writer->deferral_changed(17, true, 0);
+      writer->solution_found(1, 1, -25);
+    }
+
+    search_trace_reader reader(fopen(name.get_name().c_str(), "rb"), true);
+    search_trace_event event;
+
+    CPPUNIT_ASSERT(reader.next(event));
+    assertEvent(search_trace_step_created, 0, -1, 100, event);
+    CPPUNIT_ASSERT(reader.next(event));
+    assertEvent(search_trace_successor_generated, 0, 1, 17, event);
+    CPPUNIT_ASSERT(reader.next(event));
+    assertEvent(search_trace_deferral_changed, 17, 1, 0, event);
+    CPPUNIT_ASSERT(reader.next(event));
+    assertEvent(search_trace_solution_found, 1, 1, -25, event);
+    CPPUNIT_ASSERT_EQUAL(1U, reader.get_segment());
+
+    CPPUNIT_ASSERT(!reader.next(event));
+    CPPUNIT_ASSERT(!reader.get_bad());
+  }
+
+  void testMultipleSegments()
+  {
+    temp::name name("trace");
+
+    for(int i = 0; i < 3; ++i)
+      {
+	boost::shared_ptr<search_trace_writer> writer =
+	  search_trace_writer::open(name.get_name());
+	writer->step_created(0, -1, i);
+	writer->step_created(1, 0, i);
+	writer->step_created(2, 1, i);
+      }
+
+    search_trace_reader reader(fopen(name.get_name().c_str(), "rb"), true);
+    search_trace_event event;
+    search_trace_summary summary;
+
+    while(reader.next(event))
+      update_search_trace_summary(summary, reader.get_segment(), event);
+
+    CPPUNIT_ASSERT(!reader.get_bad());
+    CPPUNIT_ASSERT_EQUAL(3U, summary.segments);
+    CPPUNIT_ASSERT_EQUAL(9ULL, summary.event_counts[search_trace_step_created]);
+    CPPUNIT_ASSERT_EQUAL(2U, summary.max_depth);
+    CPPUNIT_ASSERT(!summary.found_solution);
+  }
+
+  void testRejectGarbage()
+  {
+    temp::name name("trace");
+
+    FILE *f = fopen(name.get_name().c_str(), "wb");
+    fputs("this is not a trace file at all", f);
+    fclose(f);
+
+    search_trace_reader reader(fopen(name.get_name().c_str(), "rb"), true);
+    search_trace_event event;
+
+    CPPUNIT_ASSERT(!reader.next(event));
+    CPPUNIT_ASSERT(reader.get_bad());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SearchTraceTest);
@@ -0,0 +1,378 @@
+/** \file test_sort_key.cc */
+
+
+// Copyright (C) 2026 The aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+// Boston, MA 02111-1307, USA.
+
+// Local includes:
+#include <generic/util/sort_key.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace sort_key = aptitude::util::sort_key;
+
+namespace
+{
+  // Stands in for a package/version pair; the fields mirror the ones
+  // that the package sort policies look at.
+  struct record
+  {
+    const char *name;
+    bool has_version;
+    unsigned long long installed_size;
+    int priority;
+    // Compared numerically, so that "1" and "01" are equal, like
+    // versions that differ only in their spelling.
+    const char *version;
+    unsigned int id;
+  };
+
+  int version_cmp(const char *v1, const char *v2)
+  {
+    const long n1 = strtol(v1, NULL, 10);
+    const long n2 = strtol(v2, NULL, 10);
+    return n1 < n2 ? -1 : (n1 > n2 ? 1 : 0);
+  }
+
+  class version_id_lt
+  {
+    const std::vector<record> &records;
+
+  public:
+    explicit version_id_lt(const std::vector<record> &_records)
+      : records(_records)
+    {
+    }
+
+    bool operator()(unsigned int id1, unsigned int id2) const
+    {
+      return version_cmp(records[id1].version, records[id2].version) < 0;
+    }
+  };
+
+  enum policy_kind { by_name, by_installed_size, by_priority, by_version };
+
+  struct policy
+  {
+    policy_kind kind;
+    bool reversed;
+
+    policy(policy_kind _kind, bool _reversed)
+      : kind(_kind), reversed(_reversed)
+    {
+    }
+  };
+
+  // The comparisons of the policies in pkg_sortpolicy.cc.
+  int do_compare(policy_kind kind, const record &r1, const record &r2)
+  {
+    switch(kind)
+      {
+      case by_name:
+        return strcmp(r1.name, r2.name);
+
+      case by_installed_size:
+        return sort_key::compare_optional_numbers(r1.has_version, r1.installed_size,
+                                                  r2.has_version, r2.installed_size,
+                                                  false);
+
+      case by_priority:
+        {
+          const int pri1 = r1.has_version ? r1.priority : 0;
+          const int pri2 = r2.has_version ? r2.priority : 0;
+          return pri1 < pri2 ? -1 : (pri1 > pri2 ? 1 : 0);
+        }
+
+      case by_version:
+        if(!r1.has_version && !r2.has_version)
+          return 0;
+        else if(!r1.has_version)
+          return -1;
+        else if(!r2.has_version)
+          return 1;
+        else
+          return version_cmp(r1.version, r2.version);
+      }
+
+    return 0;
+  }
+
+  // Follows pkg_sortpolicy::compare(): a policy that finds a
+  // difference decides, and is reversed on its own.
+  int compare(const std::vector<policy> &chain,
+              const record &r1, const record &r2)
+  {
+    for(std::vector<policy>::const_iterator it = chain.begin();
+        it != chain.end(); ++it)
+      {
+        const int rval = do_compare(it->kind, r1, r2);
+        if(rval != 0)
+          return it->reversed ? -rval : rval;
+      }
+
+    return 0;
+  }
+
+  // Follows pkg_sortpolicy::make_key() and the key code of each
+  // policy.
+  std::string make_key(const std::vector<policy> &chain,
+                       const record &r,
+                       const std::vector<unsigned int> &version_ranks)
+  {
+    std::string key;
+
+    for(std::vector<policy>::const_iterator it = chain.begin();
+        it != chain.end(); ++it)
+      {
+        const std::string::size_type start = key.size();
+
+        switch(it->kind)
+          {
+          case by_name:
+            sort_key::append_string(key, r.name);
+            break;
+
+          case by_installed_size:
+            sort_key::append_optional_number(key, r.has_version,
+                                             r.installed_size, 8, false);
+            break;
+
+          case by_priority:
+            sort_key::append_number(key, r.has_version ? r.priority : 0, 1);
+            break;
+
+          case by_version:
+            sort_key::append_optional_number(key, r.has_version,
+                                             r.has_version ? version_ranks[r.id] : 0,
+                                             4, true);
+            break;
+          }
+
+        if(it->reversed)
+          sort_key::reverse_part(key, start);
+      }
+
+    return key;
+  }
+
+  int sign(int n)
+  {
+    return n < 0 ? -1 : (n > 0 ? 1 : 0);
+  }
+
+  struct SortKeyTest : public testing::Test
+  {
+    std::vector<record> records;
+    std::vector<unsigned int> version_ranks;
+
+    void add(const char *name, bool has_version,
+             unsigned long long installed_size, int priority,
+             const char *version)
+    {
+      record r;
+      r.name = name;
+      r.has_version = has_version;
+      r.installed_size = installed_size;
+      r.priority = priority;
+      r.version = version;
+      r.id = records.size();
+      records.push_back(r);
+    }
+
+    SortKeyTest()
+    {
+      add("", true, 0, 1, "0");
+      add("a", true, 10, 2, "1");
+      add("ab", true, 10, 2, "01");
+      add("abc", false, 0, 0, "");
+      add("b", true, 255, 3, "2");
+      add("b", true, 256, 3, "10");
+      add("ba", false, 0, 0, "");
+      add("c", true, 1ULL << 40, 5, "10");
+      add("\xc3\xa9", true, ~0ULL, 255, "3");
+
+      std::vector<unsigned int> ids;
+      for(std::vector<record>::const_iterator it = records.begin();
+          it != records.end(); ++it)
+        if(it->has_version)
+          ids.push_back(it->id);
+
+      version_ranks.resize(records.size());
+      sort_key::compute_ranks(ids, version_id_lt(records), version_ranks);
+    }
+
+    // Check that the keys of every pair of records compare like the
+    // policies do.
+    void check_chain(const std::vector<policy> &chain)
+    {
+      for(std::vector<record>::const_iterator it1 = records.begin();
+          it1 != records.end(); ++it1)
+        for(std::vector<record>::const_iterator it2 = records.begin();
+            it2 != records.end(); ++it2)
+          {
+            const std::string key1 = make_key(chain, *it1, version_ranks);
+            const std::string key2 = make_key(chain, *it2, version_ranks);
+
+            EXPECT_EQ(sign(compare(chain, *it1, *it2)),
+                      sign(key1.compare(key2)))
+              << "Comparing \"" << it1->name << "\" (" << it1->id
+              << ") to \"" << it2->name << "\" (" << it2->id << ")";
+          }
+    }
+  };
+
+  const policy_kind all_kinds[] =
+    { by_name, by_installed_size, by_priority, by_version };
+  const int num_kinds = sizeof(all_kinds) / sizeof(all_kinds[0]);
+}
+
+TEST(SortKey, Numbers)
+{
+  const unsigned long long numbers[] =
+    { 0, 1, 255, 256, 65535, 65536, 1ULL << 32, 1ULL << 63, ~0ULL };
+  const int num_numbers = sizeof(numbers) / sizeof(numbers[0]);
+
+  for(int i = 0; i < num_numbers; ++i)
+    for(int j = 0; j < num_numbers; ++j)
+      {
+        std::string key1, key2;
+        sort_key::append_number(key1, numbers[i], 8);
+        sort_key::append_number(key2, numbers[j], 8);
+
+        EXPECT_EQ(numbers[i] < numbers[j] ? -1 : (numbers[i] > numbers[j] ? 1 : 0),
+                  sign(key1.compare(key2)));
+      }
+}
+
+TEST(SortKey, MissingNumbers)
+{
+  for(int missing_first = 0; missing_first < 2; ++missing_first)
+    {
+      std::string missing, zero, one;
+      sort_key::append_optional_number(missing, false, 0, 4, missing_first);
+      sort_key::append_optional_number(zero, true, 0, 4, missing_first);
+      sort_key::append_optional_number(one, true, 1, 4, missing_first);
+
+      const int expected = missing_first ? -1 : 1;
+      EXPECT_EQ(expected, sign(missing.compare(zero)));
+      EXPECT_EQ(expected, sign(missing.compare(one)));
+      EXPECT_EQ(-1, sign(zero.compare(one)));
+
+      EXPECT_EQ(expected,
+                sort_key::compare_optional_numbers(false, 0, true, 0, missing_first));
+      EXPECT_EQ(-expected,
+                sort_key::compare_optional_numbers(true, 5, false, 0, missing_first));
+      EXPECT_EQ(0, sort_key::compare_optional_numbers(false, 1, false, 2, missing_first));
+    }
+}
+
+TEST(SortKey, ReversedPartIsNotAPrefix)
+{
+  // "a" sorts after "ab" when reversed, even though the part that
+  // follows it would sort first.
+  std::string a, ab;
+  sort_key::append_string(a, "a");
+  sort_key::reverse_part(a, 0);
+  sort_key::append_number(a, 0, 1);
+  sort_key::append_string(ab, "ab");
+  sort_key::reverse_part(ab, 0);
+  sort_key::append_number(ab, 255, 1);
+
+  EXPECT_GT(a.compare(ab), 0);
+}
+
+TEST_F(SortKeyTest, VersionRanks)
+{
+  // Equal versions share a rank, and ranks follow the versions.
+  EXPECT_EQ(version_ranks[1], version_ranks[2]);
+  EXPECT_EQ(version_ranks[5], version_ranks[7]);
+  EXPECT_EQ(0U, version_ranks[0]);
+  EXPECT_LT(version_ranks[1], version_ranks[4]);
+  EXPECT_LT(version_ranks[4], version_ranks[8]);
+  EXPECT_LT(version_ranks[8], version_ranks[5]);
+}
+
+TEST_F(SortKeyTest, SinglePolicies)
+{
+  for(int i = 0; i < num_kinds; ++i)
+    for(int reversed = 0; reversed < 2; ++reversed)
+      {
+        SCOPED_TRACE(testing::Message() << "Policy " << all_kinds[i]
+                     << (reversed ? " reversed" : ""));
+
+        std::vector<policy> chain;
+        chain.push_back(policy(all_kinds[i], reversed));
+        check_chain(chain);
+      }
+}
+
+TEST_F(SortKeyTest, PolicyChains)
+{
+  for(int i = 0; i < num_kinds; ++i)
+    for(int j = 0; j < num_kinds; ++j)
+      for(int reversed = 0; reversed < 4; ++reversed)
+        {
+          SCOPED_TRACE(testing::Message() << "Policies " << all_kinds[i]
+                       << ((reversed & 1) ? " reversed" : "")
+                       << ", " << all_kinds[j]
+                       << ((reversed & 2) ? " reversed" : ""));
+
+          std::vector<policy> chain;
+          chain.push_back(policy(all_kinds[i], (reversed & 1) != 0));
+          chain.push_back(policy(all_kinds[j], (reversed & 2) != 0));
+          check_chain(chain);
+        }
+}
+
+namespace
+{
+  int num_builds = 0;
+
+  sort_key::shared_rank_table::table_ptr build_table()
+  {
+    ++num_builds;
+    return sort_key::shared_rank_table::table_ptr(new std::vector<unsigned int>(1, num_builds));
+  }
+}
+
+TEST(SortKey, SharedRankTable)
+{
+  sort_key::shared_rank_table table;
+  num_builds = 0;
+
+  const sort_key::shared_rank_table::table_ptr first = table.get(&build_table);
+  EXPECT_EQ(1, num_builds);
+  EXPECT_EQ(first, table.get(&build_table));
+  EXPECT_EQ(1, num_builds);
+
+  table.reset();
+
+  const sort_key::shared_rank_table::table_ptr second = table.get(&build_table);
+  EXPECT_EQ(2, num_builds);
+  EXPECT_NE(first, second);
+
+  // Sorts that took the old table keep it.
+  EXPECT_EQ(1U, (*first)[0]);
+  EXPECT_EQ(2U, (*second)[0]);
+}
@@ -260,6 +260,56 @@ TEST_F(TransientMessage, ReplaceWideCharTextWithLonger)
   message->set_text(L"abc");
 }
 
+TEST_F(TransientMessage, ReplaceChangedSuffix)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"Reading... 10%")));
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"Reading... 20%")));
+  }
+
+  message->set_text(L"Reading... 10%");
+  message->set_text(L"Reading... 20%");
+}
+
+TEST_F(TransientMessage, ReplaceChangedSuffixWritesOnlySuffix)
+{
+  EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"Reading... 10%")));
+
+  message->set_text(L"Reading... 10%");
+
+  EXPECT_CALL(*term_output, output(StrEq(L"\b\b\b20%")));
+
+  message->set_text(L"Reading... 20%");
+}
+
+TEST_F(TransientMessage, ReplaceChangedSuffixWithShorter)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"Reading... 100%")));
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"Reading... 5%")));
+  }
+
+  message->set_text(L"Reading... 100%");
+  message->set_text(L"Reading... 5%");
+}
+
+TEST_F(TransientMessage, ReplaceWideCharSuffix)
+{
+  {
+    InSequence dummy;
+
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"ab" + widechar)));
+    EXPECT_CALL(*teletype, set_last_line(StrTrimmedRightEq(L"abc")));
+  }
+
+  message->set_text(L"ab" + widechar);
+  message->set_text(L"abc");
+}
+
 TEST_F(TransientMessage, TruncateLongLine)
 {
   EXPECT_CALL(*term_metrics, get_screen_width())